@@ -0,0 +1,715 @@
+// Microbenchmarks of the media hot path, for catching regressions between
+// releases before production graphs do.
+//
+//   voice_bench [--format=text|json] [--filter=SUBSTRING] [--repetitions=N] [--min-time=SECONDS] [--list]
+//
+// Every case is timed --repetitions times for about --min-time seconds in
+// total after a calibration run; the median and the minimum ns/op over the
+// repetitions are reported. Inputs are synthetic and seeded, so two runs on
+// the same host differ only by noise. For stable numbers pin the process to
+// one idle core (taskset -c N) and compare medians; --format=json prints one
+// result per line so that two runs diff line by line.
+
+#include "audio_processor.h"
+#include "channel_registry.h"
+#include "dsp_kernels.h"
+#include "epoch.h"
+#include "logger.h"
+#include "media_buffer.h"
+#include "noise_suppressor.h"
+#include "opus_codec.h"
+#include "real_fft.h"
+#include "resampler.h"
+#include "rtp_packet.h"
+#include "ssrc_router.h"
+#include "udp_media_engine.h"
+#include "user_intern_table.h"
+#include "voice_activity.h"
+#include "voice_channel.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace driftway;
+
+namespace {
+
+constexpr size_t kFrameSamples = 960; // 20 ms at 48 kHz
+constexpr int kFrameMs = 20;
+
+struct Options {
+    bool json = false;
+    bool list = false;
+    std::string filter;
+    int repetitions = 5;
+    double min_time = 0.5; // Seconds per case, all repetitions together
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations = 0; // Per repetition
+    double ns_median = 0.0;
+    double ns_min = 0.0;
+    double items = 1.0; // Work items per op: samples, packet copies, ...
+};
+
+// Keeps the compiler from discarding a computed value or a store
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+std::string JsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+class Runner {
+public:
+    // op(n) performs the operation n times
+    using Op = std::function<void(uint64_t)>;
+
+    explicit Runner(const Options& options) : options_(options) {}
+
+    bool Selected(const std::string& name) const {
+        return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+    }
+
+    void Run(const std::string& name, double items, const Op& op) {
+        if (!Selected(name)) {
+            return;
+        }
+        if (options_.list) {
+            std::printf("%s\n", name.c_str());
+            return;
+        }
+
+        // Grow the batch until it takes a measurable time, then size each
+        // repetition from that rate
+        double sample_ns = options_.min_time * 1e9 / options_.repetitions;
+        uint64_t n = 1;
+        double elapsed = Time(op, n);
+        while (elapsed < std::min(sample_ns / 10.0, 1e7) && n < (uint64_t{1} << 40)) {
+            n *= 2;
+            elapsed = Time(op, n);
+        }
+        uint64_t iterations = std::max<uint64_t>(1, static_cast<uint64_t>(sample_ns * n / std::max(elapsed, 1.0)));
+
+        std::vector<double> samples;
+        for (int r = 0; r < options_.repetitions; ++r) {
+            samples.push_back(Time(op, iterations) / static_cast<double>(iterations));
+        }
+        std::sort(samples.begin(), samples.end());
+
+        Result result;
+        result.name = name;
+        result.iterations = iterations;
+        result.ns_min = samples.front();
+        result.ns_median = samples.size() % 2 ? samples[samples.size() / 2]
+                                              : 0.5 * (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]);
+        result.items = items;
+        Print(result);
+    }
+
+    void Begin() {
+        if (options_.list) {
+            return;
+        }
+        if (options_.json) {
+            std::printf("{\n\"context\": {\"kernels\": \"%s\", \"cpus\": %u, \"compiler\": \"%s\", "
+                        "\"repetitions\": %d, \"min_time_s\": %g},\n\"benchmarks\": [\n",
+                        dsp::Active().name, std::thread::hardware_concurrency(), JsonEscape(__VERSION__).c_str(),
+                        options_.repetitions, options_.min_time);
+        } else {
+            std::printf("DSP kernels: %s, %u CPUs, %d repetitions of %.2f s per case\n\n", dsp::Active().name,
+                        std::thread::hardware_concurrency(), options_.repetitions, options_.min_time);
+            std::printf("%-40s %12s %14s %14s %14s %12s\n", "benchmark", "iterations", "ns/op", "min ns/op", "ops/s",
+                        "ns/item");
+        }
+        std::fflush(stdout);
+    }
+
+    void End() {
+        if (options_.json && !options_.list) {
+            std::printf("\n]\n}\n");
+        }
+    }
+
+private:
+    const Options& options_;
+    bool first_ = true;
+
+    static double Time(const Op& op, uint64_t n) {
+        auto start = std::chrono::steady_clock::now();
+        op(n);
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Print(const Result& result) {
+        double ops_per_sec = 1e9 / result.ns_median;
+        double ns_per_item = result.ns_median / result.items;
+        if (options_.json) {
+            std::printf("%s{\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, "
+                        "\"ops_per_sec\": %.1f, \"items_per_op\": %g, \"ns_per_item\": %.3f}",
+                        first_ ? "" : ",\n", JsonEscape(result.name).c_str(),
+                        static_cast<unsigned long long>(result.iterations), result.ns_median, result.ns_min,
+                        ops_per_sec, result.items, ns_per_item);
+        } else {
+            std::printf("%-40s %12llu %14.1f %14.1f %14.0f %12.3f\n", result.name.c_str(),
+                        static_cast<unsigned long long>(result.iterations), result.ns_median, result.ns_min,
+                        ops_per_sec, ns_per_item);
+        }
+        first_ = false;
+        std::fflush(stdout);
+    }
+};
+
+// Deterministic test signals
+
+uint32_t NextRandom(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+// Voiced-speech stand-in: a few harmonics of a wandering pitch under a
+// syllable-rate envelope, plus a little noise, so the codec and the noise
+// suppressor do real work and DTX never kicks in
+std::vector<float> SpeechLike(size_t samples, int rate) {
+    std::vector<float> signal(samples);
+    uint32_t seed = 12345;
+    double phase = 0.0;
+    for (size_t i = 0; i < samples; ++i) {
+        double t = static_cast<double>(i) / rate;
+        double pitch = 140.0 + 30.0 * std::sin(2.0 * M_PI * 0.7 * t);
+        phase += 2.0 * M_PI * pitch / rate;
+        double voiced = 0.5 * std::sin(phase) + 0.25 * std::sin(2.0 * phase) + 0.12 * std::sin(3.0 * phase);
+        double envelope = 0.55 + 0.45 * std::sin(2.0 * M_PI * 4.0 * t);
+        double noise = (static_cast<double>(NextRandom(&seed) >> 8) / (1 << 24) - 0.5) * 0.02;
+        signal[i] = static_cast<float>(0.4 * envelope * voiced + noise);
+    }
+    return signal;
+}
+
+std::vector<int16_t> ToPcm(const std::vector<float>& signal) {
+    std::vector<int16_t> pcm(signal.size());
+    dsp::Active().f32_to_s16(pcm.data(), signal.data(), signal.size());
+    return pcm;
+}
+
+// An Opus packet as a browser sends it: audio level extension, 80 bytes
+// of payload
+size_t WriteTestPacket(uint8_t* buffer, size_t capacity, uint32_t ssrc) {
+    RtpHeader header;
+    header.payload_type = kDefaultOpusPayloadType;
+    header.sequence_number = 4711;
+    header.timestamp = 960000;
+    header.ssrc = ssrc;
+    uint8_t payload[80];
+    for (size_t i = 0; i < sizeof(payload); ++i) {
+        payload[i] = static_cast<uint8_t>(i * 37);
+    }
+    uint8_t level = 0x80 | 30; // Voice, -30 dBov
+
+    RtpPacketWriter writer(buffer, capacity);
+    writer.WriteHeader(header);
+    writer.BeginExtensions();
+    writer.AddExtension(kDefaultAudioLevelExtensionId, &level, 1);
+    writer.WritePayload(payload, sizeof(payload));
+    return writer.Finish();
+}
+
+// Cases
+
+void BenchRtp(Runner& runner) {
+    uint8_t packet[MediaBuffer::kCapacity];
+    size_t size = WriteTestPacket(packet, sizeof(packet), 0x1234);
+
+    // What the media loop does with every datagram before routing it
+    runner.Run("rtp/parse", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            RtpPacketView view;
+            bool ok = view.Parse(packet, size);
+            RtpHeaderExtension extension;
+            uint8_t level = kNoAudioLevel;
+            bool voice = false;
+            if (ok && view.FindExtension(kDefaultAudioLevelExtensionId, &extension)) {
+                ParseAudioLevel(extension, &level, &voice);
+            }
+            DoNotOptimize(level);
+            DoNotOptimize(view.payloadSize());
+        }
+    });
+
+    uint8_t out[MediaBuffer::kCapacity];
+    runner.Run("rtp/serialize", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(WriteTestPacket(out, sizeof(out), static_cast<uint32_t>(i)));
+        }
+    });
+
+    RtpStream stream(0x1234, kDefaultOpusPayloadType);
+    runner.Run("rtp/stream_write_packet", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(stream.WritePacket(packet + 12, 80, kFrameSamples, out, sizeof(out)));
+        }
+    });
+}
+
+void BenchSsrcLookup(Runner& runner) {
+    // Per channel: VoiceChannel::GetParticipantBySSRC, behind the channel lock
+    constexpr size_t kParticipants = 50;
+    auto channel = std::make_shared<VoiceChannel>("bench-lookup", "bench");
+    std::vector<uint32_t> ssrcs;
+    for (ParticipantHandle handle = 0; handle < kParticipants; ++handle) {
+        channel->AddParticipant(handle, "user-" + std::to_string(handle));
+        ssrcs.push_back(channel->GetSSRC(handle));
+    }
+    runner.Run("ssrc/channel_lookup_50", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(channel->GetParticipantBySSRC(ssrcs[i % kParticipants]));
+        }
+    });
+
+    // Server-wide: SsrcRouter::Find, one read guard per receive batch of
+    // 64 datagrams as in the media loop
+    constexpr size_t kRoutes = 10000;
+    constexpr uint64_t kBatch = 64;
+    SsrcRouter router;
+    std::vector<uint32_t> routed;
+    for (size_t i = 0; i < kRoutes; ++i) {
+        uint32_t ssrc = static_cast<uint32_t>(0x10000 + i);
+        router.Add(ssrc, channel, std::make_shared<Participant>(), nullptr, nullptr);
+        routed.push_back(ssrc);
+    }
+    // Hit the routes in a scattered order, like packets of many streams
+    uint32_t seed = 99;
+    std::vector<uint32_t> order(4096);
+    for (uint32_t& ssrc : order) {
+        ssrc = routed[NextRandom(&seed) % kRoutes];
+    }
+    runner.Run("ssrc/router_find_10000", 1, [&](uint64_t n) {
+        for (uint64_t done = 0; done < n; done += kBatch) {
+            epoch::ReadGuard guard;
+            for (uint64_t i = done; i < std::min(n, done + kBatch); ++i) {
+                DoNotOptimize(router.Find(order[i % order.size()]));
+            }
+        }
+    });
+    router.Clear();
+    epoch::Reclaim();
+}
+
+// Loopback socket nobody reads: forwarded copies go through the whole
+// send path and are then dropped by the kernel once its queue is full
+class Sink {
+public:
+    Sink() : fd_(::socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0)) {
+        sockaddr_in6 addr{};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_loopback;
+        socklen_t len = sizeof(addr);
+        if (fd_ >= 0 && ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), len) == 0 &&
+            ::getsockname(fd_, reinterpret_cast<sockaddr*>(&endpoint_.addr), &len) == 0) {
+            endpoint_.len = len;
+        }
+    }
+    ~Sink() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    const MediaEndpoint& endpoint() const { return endpoint_; }
+
+private:
+    int fd_;
+    MediaEndpoint endpoint_;
+};
+
+void BenchBroadcast(Runner& runner) {
+    Sink sink;
+    UdpMediaEngine transport(0, 256);
+    if (!sink.endpoint().IsSet() || !transport.open()) {
+        std::fprintf(stderr, "broadcast: cannot open loopback sockets, skipped\n");
+        return;
+    }
+
+    for (size_t participants : {2, 10, 50, 200}) {
+        VoiceChannel channel("bench-broadcast", "bench");
+        channel.SetMaxParticipants(participants);
+        channel.SetTransport(&transport);
+        for (ParticipantHandle handle = 0; handle < participants; ++handle) {
+            channel.AddParticipant(handle, "user-" + std::to_string(handle));
+            channel.SetParticipantEndpoint(*channel.GetParticipant(handle), sink.endpoint());
+        }
+
+        AudioPacket packet;
+        packet.buffer = MediaBuffer::Allocate();
+        size_t size = WriteTestPacket(packet.buffer->data(), MediaBuffer::kCapacity, channel.GetSSRC(0));
+        packet.buffer->setSize(size);
+        packet.header_size = static_cast<uint16_t>(size - 80);
+        packet.payload_size = 80;
+        packet.source = 0;
+        packet.ssrc = channel.GetSSRC(0);
+
+        // One speaker's packet to everyone else, including the sendmmsg()
+        runner.Run("broadcast/fanout_" + std::to_string(participants), static_cast<double>(participants - 1),
+                   [&](uint64_t n) {
+                       for (uint64_t i = 0; i < n; ++i) {
+                           channel.BroadcastAudio(packet, packet.source);
+                           transport.flush();
+                       }
+                   });
+        channel.SetTransport(nullptr);
+    }
+}
+
+void BenchKernels(Runner& runner) {
+    std::vector<float> signal = SpeechLike(kFrameSamples, 48000);
+    std::vector<int16_t> pcm = ToPcm(signal);
+    // Integer kernels cost the same whatever the data; zeros keep the
+    // accumulator from wrapping over billions of calls
+    std::vector<int16_t> zeros(kFrameSamples, 0);
+    std::vector<int32_t> acc(kFrameSamples, 0);
+    std::vector<int16_t> pcm_out(kFrameSamples);
+    std::vector<float> floats(signal);
+    std::vector<float> float_acc(kFrameSamples, 0.0f);
+    std::vector<float> re(signal), im(kFrameSamples, 0.0f), re_out(kFrameSamples), im_out(kFrameSamples);
+    std::vector<float> unit_re(kFrameSamples, 1.0f), unit_im(kFrameSamples, 0.0f);
+    const double items = static_cast<double>(kFrameSamples);
+
+    for (dsp::Isa isa : {dsp::Isa::kScalar, dsp::Isa::kSse42, dsp::Isa::kAvx2, dsp::Isa::kAvx512}) {
+        const dsp::Kernels* k = dsp::ForIsa(isa);
+        if (!k) {
+            continue;
+        }
+        std::string prefix = std::string("dsp/") + k->name + "/";
+
+        runner.Run(prefix + "accumulate_s16", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->accumulate_s16(acc.data(), zeros.data(), kFrameSamples);
+                DoNotOptimize(acc[0]);
+            }
+        });
+        runner.Run(prefix + "mix_minus_s16", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->mix_minus_s16(pcm_out.data(), acc.data(), pcm.data(), kFrameSamples);
+                DoNotOptimize(pcm_out[0]);
+            }
+        });
+        runner.Run(prefix + "s16_to_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->s16_to_f32(floats.data(), pcm.data(), kFrameSamples);
+                DoNotOptimize(floats[0]);
+            }
+        });
+        runner.Run(prefix + "f32_to_s16", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->f32_to_s16(pcm_out.data(), signal.data(), kFrameSamples);
+                DoNotOptimize(pcm_out[0]);
+            }
+        });
+        // Unity gain and a zero mix gain keep the data from drifting into
+        // denormals; the arithmetic is the same
+        runner.Run(prefix + "gain_ramp_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->gain_ramp_f32(floats.data(), kFrameSamples, 1.0f, 0.0f);
+                DoNotOptimize(floats[0]);
+            }
+        });
+        runner.Run(prefix + "mix_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->mix_f32(float_acc.data(), signal.data(), kFrameSamples, 0.0f);
+                DoNotOptimize(float_acc[0]);
+            }
+        });
+        runner.Run(prefix + "clip_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->clip_f32(floats.data(), kFrameSamples, 1.0f);
+                DoNotOptimize(floats[0]);
+            }
+        });
+        runner.Run(prefix + "peak_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                DoNotOptimize(k->peak_f32(signal.data(), kFrameSamples));
+            }
+        });
+        runner.Run(prefix + "sum_squares_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                DoNotOptimize(k->sum_squares_f32(signal.data(), kFrameSamples));
+            }
+        });
+        runner.Run(prefix + "dot_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                DoNotOptimize(k->dot_f32(signal.data(), floats.data(), kFrameSamples));
+            }
+        });
+        runner.Run(prefix + "fft_butterfly_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->fft_butterfly_f32(re_out.data(), im_out.data(), re.data(), im.data(), kFrameSamples / 2,
+                                     kFrameSamples / 2, kFrameSamples / 2, 0.0f, -1.0f);
+                DoNotOptimize(re_out[0]);
+            }
+        });
+        runner.Run(prefix + "complex_mul_f32", items, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->complex_mul_f32(re.data(), im.data(), unit_re.data(), unit_im.data(), kFrameSamples);
+                DoNotOptimize(re[0]);
+            }
+        });
+    }
+}
+
+void BenchAudioProcessor(Runner& runner) {
+    AudioProcessor processor;
+    std::vector<float> signal = SpeechLike(kFrameSamples, 48000);
+    std::vector<int16_t> pcm = ToPcm(signal);
+    std::vector<int16_t> frame(kFrameSamples);
+    std::vector<float> floats(kFrameSamples);
+    const double items = static_cast<double>(kFrameSamples);
+
+    // Mutating cases restart from the same frame each time; the copy is a
+    // small part of the cost
+    runner.Run("audio/volume_ramp_20ms", items, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            floats.assign(signal.begin(), signal.end());
+            processor.applyVolumeRamp(floats, 0.5f, 0.8f);
+            DoNotOptimize(floats[0]);
+        }
+    });
+    runner.Run("audio/noise_suppression_20ms", items, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::copy(pcm.begin(), pcm.end(), frame.begin());
+            processor.applyNoiseReduction(1, frame.data(), kFrameSamples);
+            DoNotOptimize(frame[0]);
+        }
+    });
+    processor.releaseStream(1);
+
+    RealFft fft(NoiseSuppressor::kFftSize);
+    std::vector<float> spectrum_re(fft.Bins()), spectrum_im(fft.Bins()), block(NoiseSuppressor::kFftSize);
+    runner.Run("audio/real_fft_512_roundtrip", static_cast<double>(fft.Size()), [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            fft.Forward(signal.data(), spectrum_re.data(), spectrum_im.data());
+            fft.Inverse(spectrum_re.data(), spectrum_im.data(), block.data());
+            DoNotOptimize(block[0]);
+        }
+    });
+
+    // ns/op is per 20 ms frame of input, so streams per core = 2e7 / ns/op
+    const int rates[][2] = {
+        {8000, 48000}, {48000, 8000},
+        {16000, 48000}, {48000, 16000},
+        {24000, 48000}, {48000, 24000},
+        {44100, 48000}, {48000, 44100},
+    };
+    for (const auto& rate : rates) {
+        size_t in_count = static_cast<size_t>(rate[0] / 1000 * kFrameMs);
+        std::vector<int16_t> in = ToPcm(SpeechLike(in_count, rate[0]));
+        Resampler resampler(rate[0], rate[1]);
+        std::vector<int16_t> out(resampler.MaxOutputSamples(in_count));
+        runner.Run("audio/resample_" + std::to_string(rate[0]) + "_" + std::to_string(rate[1]),
+                   static_cast<double>(in_count), [&](uint64_t n) {
+                       for (uint64_t i = 0; i < n; ++i) {
+                           DoNotOptimize(resampler.Process(in.data(), in_count, out.data(), out.size()));
+                       }
+                   });
+    }
+}
+
+void BenchOpus(Runner& runner) {
+    // One second of speech, encoded and decoded round robin
+    constexpr size_t kFrames = 50;
+    OpusCodec codec;
+    std::vector<int16_t> speech = ToPcm(SpeechLike(kFrames * kFrameSamples, OpusCodec::kSampleRate));
+    std::vector<std::vector<uint8_t>> packets(kFrames);
+    uint8_t out[OpusCodec::kMaxPacketSize];
+    for (size_t f = 0; f < kFrames; ++f) {
+        size_t size = codec.Encode(1, speech.data() + f * kFrameSamples, kFrameSamples, out, sizeof(out));
+        packets[f].assign(out, out + size);
+    }
+    const double items = static_cast<double>(kFrameSamples);
+
+    runner.Run("opus/encode_20ms", items, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            const int16_t* frame = speech.data() + (i % kFrames) * kFrameSamples;
+            DoNotOptimize(codec.Encode(2, frame, kFrameSamples, out, sizeof(out)));
+        }
+    });
+
+    std::vector<int16_t> pcm(kFrameSamples);
+    runner.Run("opus/decode_20ms", items, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            const std::vector<uint8_t>& packet = packets[i % kFrames];
+            DoNotOptimize(codec.Decode(3, packet.data(), packet.size(), pcm.data(), pcm.size()));
+        }
+    });
+    runner.Run("opus/conceal_20ms", items, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(codec.Decode(3, nullptr, 0, pcm.data(), pcm.size()));
+        }
+    });
+}
+
+void BenchRegistry(Runner& runner) {
+    // The join/leave path of VoiceServer: registry shard, channel lock,
+    // user table and SSRC router, from several threads at once over a few
+    // busy channels
+    constexpr size_t kChannels = 16;
+    constexpr size_t kUsersPerThread = 64;
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u}) {
+        if (threads > 1 && threads > cpus) {
+            break; // Oversubscribed numbers measure the scheduler
+        }
+        ChannelRegistry registry;
+        UserInternTable users;
+        SsrcRouter router;
+        std::vector<std::string> channel_ids;
+        for (size_t c = 0; c < kChannels; ++c) {
+            channel_ids.push_back("bench-channel-" + std::to_string(c));
+        }
+
+        auto join_leave = [&](unsigned thread, uint64_t count) {
+            uint32_t seed = 7 + thread;
+            for (uint64_t i = 0; i < count; ++i) {
+                const std::string& channel_id = channel_ids[NextRandom(&seed) % kChannels];
+                std::string user_id = "user-" + std::to_string(thread) + "-" + std::to_string(i % kUsersPerThread);
+
+                auto channel = registry.GetOrCreate(channel_id, [&] {
+                    auto created = std::make_shared<VoiceChannel>(channel_id, "bench");
+                    created->SetMaxParticipants(kUsersPerThread * 16);
+                    return created;
+                });
+                // The same sequence as VoiceServer::JoinChannel/LeaveChannel:
+                // routes change under the shard lock with the membership
+                ParticipantHandle handle = users.Acquire(user_id);
+                bool joined = false;
+                registry.Visit(channel_id, [&](VoiceChannel& registered) {
+                    if (&registered != channel.get() || !registered.AddParticipant(handle, user_id)) {
+                        return;
+                    }
+                    uint32_t ssrc = registered.GetSSRC(handle);
+                    router.Add(ssrc, channel, registered.GetParticipant(handle), registered.GetJitterBuffer(ssrc),
+                               registered.GetVoiceActivity(ssrc));
+                    joined = true;
+                });
+                if (!joined) {
+                    users.Release(handle);
+                    continue;
+                }
+
+                bool left = false;
+                registry.Visit(channel_id, [&](VoiceChannel& registered) {
+                    uint32_t ssrc = registered.GetSSRC(handle);
+                    left = registered.RemoveParticipant(handle);
+                    if (left) {
+                        router.Remove(ssrc);
+                    }
+                });
+                if (left) {
+                    users.Release(handle);
+                    registry.RemoveIf(channel_id, [](const VoiceChannel& c) { return c.IsEmpty(); });
+                }
+            }
+        };
+
+        runner.Run("registry/join_leave_threads_" + std::to_string(threads), 1, [&](uint64_t n) {
+            std::vector<std::thread> workers;
+            std::atomic<unsigned> ready{0};
+            for (unsigned t = 0; t < threads; ++t) {
+                uint64_t share = n / threads + (t < n % threads ? 1 : 0);
+                workers.emplace_back([&, t, share] {
+                    ready.fetch_add(1);
+                    while (ready.load() < threads) {
+                        std::this_thread::yield();
+                    }
+                    join_leave(t, share);
+                });
+            }
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+        });
+        router.Clear();
+        registry.Clear();
+        epoch::Reclaim();
+    }
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* flag) -> const char* {
+            size_t length = std::strlen(flag);
+            return arg.compare(0, length, flag) == 0 ? argv[i] + length : nullptr;
+        };
+        if (const char* format = value("--format=")) {
+            if (std::strcmp(format, "json") != 0 && std::strcmp(format, "text") != 0) {
+                return false;
+            }
+            options->json = std::strcmp(format, "json") == 0;
+        } else if (const char* filter = value("--filter=")) {
+            options->filter = filter;
+        } else if (const char* repetitions = value("--repetitions=")) {
+            options->repetitions = std::max(1, std::atoi(repetitions));
+        } else if (const char* min_time = value("--min-time=")) {
+            options->min_time = std::max(0.001, std::atof(min_time));
+        } else if (arg == "--list") {
+            options->list = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--format=text|json] [--filter=SUBSTRING] [--repetitions=N] [--min-time=SECONDS] "
+                     "[--list]\n",
+                     argv[0]);
+        return 2;
+    }
+    // Joins and leaves log at info; keep the logger out of the numbers
+    log::SetLevel(log::Level::kWarn);
+
+    Runner runner(options);
+    runner.Begin();
+    BenchRtp(runner);
+    BenchSsrcLookup(runner);
+    BenchBroadcast(runner);
+    BenchKernels(runner);
+    BenchAudioProcessor(runner);
+    BenchOpus(runner);
+    BenchRegistry(runner);
+    runner.End();
+    log::Flush();
+    return 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "media_buffer.h"
+#include "opus_codec.h"
+#include "rtp_packet.h"
+
+namespace driftway {
+
+class AudioProcessor;
+class NoiseSuppressor;
+
+// Server-side mixer for one channel (MCU mode). Each 20 ms frame the active
+// speakers are decoded and summed once into a 32-bit accumulator; what a
+// participant hears is that sum minus its own contribution, so producing
+// every output is O(N) rather than re-mixing N-1 inputs per listener.
+// Listeners who did not speak all hear the same full mix, which is encoded
+// once per frame and shared.
+//
+// Not thread-safe: a mixer is driven by the thread that owns its channel.
+// It holds its streams' codec and noise suppression state itself, taken
+// from the processor's pools when a stream appears, so a frame takes no
+// lock shared with other workers' mixers.
+class AudioMixer {
+public:
+    static constexpr uint32_t kSampleRate = 48000;
+    static constexpr size_t kFrameSamples = 960; // 20 ms, mono
+
+    AudioMixer(AudioProcessor* processor, uint32_t output_ssrc);
+    ~AudioMixer();
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    uint32_t outputSsrc() const { return output_ssrc_; }
+
+    void BeginFrame();
+
+    // Decodes one frame of `ssrc` into the mix. data == nullptr conceals a
+    // lost frame from the stream's decoder history; with fec set, `data` is
+    // the packet after the lost one and its redundancy rebuilds the frame.
+    bool AddSpeaker(uint32_t ssrc, const uint8_t* data, size_t size, bool fec = false);
+    size_t SpeakerCount() const { return speaker_count_; }
+
+    // Encoded mix-minus for `listener_ssrc`: the payload occupies the start
+    // of the returned buffer (buffer->size() bytes). Empty when the listener
+    // would only hear silence this frame.
+    MediaBufferRef EncodeFor(uint32_t listener_ssrc);
+
+    // Fills the RTP header of this frame's packet for `listener_ssrc`.
+    void NextHeader(uint32_t listener_ssrc, uint8_t payload_type, RtpHeader* header);
+
+    // Finishes the frame; state of streams not seen for a while is released.
+    void EndFrame();
+
+private:
+    struct Speaker {
+        uint32_t ssrc;
+        size_t frame;
+    };
+
+    struct Listener {
+        std::unique_ptr<RtpStream> stream;
+        OpusCodec::StreamEncoder encoder; // Its mix-minus, once it has spoken
+        bool sent_this_frame = false;
+        bool sent_last_frame = false;
+        uint64_t last_frame = 0;
+    };
+
+    struct Input {
+        OpusDecoder* decoder = nullptr;
+        std::unique_ptr<NoiseSuppressor> suppressor;
+        uint64_t last_frame = 0;
+    };
+
+    AudioProcessor* processor_;
+    uint32_t output_ssrc_;
+    uint64_t frame_counter_;
+
+    alignas(64) std::array<int32_t, kFrameSamples> accumulator_;
+    alignas(64) std::array<int16_t, kFrameSamples> output_;
+    std::vector<std::array<int16_t, kFrameSamples>> frames_;
+    std::vector<Speaker> speakers_;
+    size_t speaker_count_;
+
+    MediaBufferRef full_mix_;
+    bool full_mix_encoded_;
+    OpusCodec::StreamEncoder full_mix_encoder_;
+
+    std::unordered_map<uint32_t, Listener> listeners_;
+    std::unordered_map<uint32_t, Input> inputs_;
+
+    const Speaker* FindSpeaker(uint32_t ssrc) const;
+    MediaBufferRef Encode(OpusCodec::StreamEncoder& encoder);
+    void ReleaseInput(Input& input);
+};
+
+} // namespace driftway
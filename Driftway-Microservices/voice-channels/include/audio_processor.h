@@ -2,13 +2,21 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "noise_suppressor.h"
+#include "opus_codec.h"
+#include "resampler.h"
 
 namespace driftway {
 
 class AudioProcessor {
 public:
-    AudioProcessor();
+    explicit AudioProcessor(const OpusCodec::Config& codec_config = OpusCodec::Config());
     ~AudioProcessor();
     
     void processAudioFrame(const std::vector<uint8_t>& frame);
@@ -16,7 +24,52 @@ public:
     std::vector<float> decodeOpus(const std::vector<uint8_t>& encoded_data);
     void applyEchoCancellation(std::vector<float>& audio_data);
     void applyNoiseReduction(std::vector<float>& audio_data);
+    // Spectral noise suppression keeping its noise estimate per stream_id.
+    // Output is delayed by NoiseSuppressor::kLatency samples.
+    void applyNoiseReduction(uint32_t stream_id, float* data, size_t count);
+    void applyNoiseReduction(uint32_t stream_id, int16_t* pcm, size_t count);
+    void releaseNoiseSuppressor(uint32_t stream_id);
+    // Whether the mixer denoises each speaker before mixing
+    void setNoiseSuppression(bool enabled) { noise_suppression_.store(enabled, std::memory_order_relaxed); }
+    bool isNoiseSuppressionEnabled() const { return noise_suppression_.load(std::memory_order_relaxed); }
+    // Scales by volume_level and clips to full scale
     void applyVolumeControl(std::vector<float>& audio_data, float volume_level);
+    // Same, with the gain moving linearly from from_level to to_level over
+    // the buffer, so a volume change does not click
+    void applyVolumeRamp(std::vector<float>& audio_data, float from_level, float to_level);
+
+    // Frame-based codec entry points for the mixer. stream_id selects the
+    // codec state, so each stream decodes/encodes with its own history.
+    // decodeOpusFrame() with data == nullptr conceals a lost frame; with
+    // fec set it recovers the lost frame from the packet after it.
+    size_t decodeOpusFrame(uint32_t stream_id, const uint8_t* data, size_t size, int16_t* pcm, size_t max_samples,
+                           bool fec = false);
+    size_t encodeOpusFrame(uint32_t stream_id, const int16_t* pcm, size_t samples, uint8_t* out, size_t capacity);
+    void releaseEncoder(uint32_t stream_id);
+    void releaseDecoder(uint32_t stream_id);
+    void releaseStream(uint32_t stream_id);
+
+    // Converts a stream between sample rates, e.g. a 16 kHz client to the
+    // 48 kHz mix, keeping filter history per stream_id so frame boundaries
+    // stay seamless. A stream converted both ways needs two ids. Returns
+    // the samples written; 0 for unsupported rates or too small a buffer.
+    size_t resample(uint32_t stream_id, int in_rate, int out_rate, const int16_t* in, size_t in_count, int16_t* out,
+                    size_t capacity);
+    void releaseResampler(uint32_t stream_id);
+
+    OpusCodec& codec() { return codec_; }
+
+private:
+    OpusCodec codec_;
+
+    std::mutex resamplers_mutex_;
+    std::unordered_map<uint32_t, std::unique_ptr<Resampler>> resamplers_;
+
+    std::atomic<bool> noise_suppression_{false};
+    std::mutex suppressors_mutex_;
+    std::unordered_map<uint32_t, std::unique_ptr<NoiseSuppressor>> suppressors_;
+
+    NoiseSuppressor* acquireNoiseSuppressor(uint32_t stream_id);
 };
 
 } // namespace driftway
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace driftway {
+
+class VoiceChannel;
+
+// Channel id -> VoiceChannel map split into independently locked shards, so
+// joins, leaves and lookups on different channels rarely meet on a lock.
+// Whole-registry passes (cleanup, shutdown) take one shard at a time.
+class ChannelRegistry {
+public:
+    using Factory = std::function<std::shared_ptr<VoiceChannel>()>;
+
+    explicit ChannelRegistry(size_t shard_count = 64); // Rounded up to a power of two
+
+    ChannelRegistry(const ChannelRegistry&) = delete;
+    ChannelRegistry& operator=(const ChannelRegistry&) = delete;
+
+    std::shared_ptr<VoiceChannel> Find(const std::string& channel_id) const;
+
+    // Returns the existing channel, or inserts factory()'s. created reports which.
+    std::shared_ptr<VoiceChannel> GetOrCreate(const std::string& channel_id, const Factory& factory,
+                                              bool* created = nullptr);
+
+    std::shared_ptr<VoiceChannel> Remove(const std::string& channel_id);
+
+    // Runs fn(VoiceChannel&) with the channel's shard locked, so it cannot be
+    // removed meanwhile; false if there is no such channel. Keep fn short.
+    // The lock covers membership only: state kept elsewhere that must change
+    // atomically with a join or leave (the SSRC routes) has to be updated
+    // inside fn, or a concurrent leave or removal can run in between.
+    template <typename Fn>
+    bool Visit(const std::string& channel_id, Fn&& fn);
+
+    // Removes the channel if pred(VoiceChannel&) holds, atomically with
+    // respect to Visit() and the other shard operations.
+    template <typename Pred>
+    std::shared_ptr<VoiceChannel> RemoveIf(const std::string& channel_id, Pred&& pred);
+
+    // Removes every channel matching pred, one shard at a time, and returns
+    // them so they are destroyed outside the shard locks.
+    template <typename Pred>
+    std::vector<std::shared_ptr<VoiceChannel>> Sweep(Pred&& pred);
+
+    // Every channel at the time of the call, for read-only passes (metrics)
+    // that should not hold shard locks while they inspect channels
+    std::vector<std::shared_ptr<VoiceChannel>> Snapshot() const;
+
+    void Clear();
+    size_t size() const;
+    size_t shardCount() const { return shards_.size(); }
+
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<VoiceChannel>> channels;
+    };
+
+    std::vector<Shard> shards_;
+    uint32_t shard_bits_;
+
+    Shard& ShardFor(const std::string& channel_id);
+    const Shard& ShardFor(const std::string& channel_id) const;
+};
+
+template <typename Fn>
+bool ChannelRegistry::Visit(const std::string& channel_id, Fn&& fn) {
+    Shard& shard = ShardFor(channel_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.channels.find(channel_id);
+    if (it == shard.channels.end()) {
+        return false;
+    }
+    fn(*it->second);
+    return true;
+}
+
+template <typename Pred>
+std::shared_ptr<VoiceChannel> ChannelRegistry::RemoveIf(const std::string& channel_id, Pred&& pred) {
+    Shard& shard = ShardFor(channel_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.channels.find(channel_id);
+    if (it == shard.channels.end() || !pred(*it->second)) {
+        return nullptr;
+    }
+    std::shared_ptr<VoiceChannel> channel = std::move(it->second);
+    shard.channels.erase(it);
+    return channel;
+}
+
+template <typename Pred>
+std::vector<std::shared_ptr<VoiceChannel>> ChannelRegistry::Sweep(Pred&& pred) {
+    std::vector<std::shared_ptr<VoiceChannel>> removed;
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto it = shard.channels.begin(); it != shard.channels.end();) {
+            if (pred(*it->second)) {
+                removed.push_back(std::move(it->second));
+                it = shard.channels.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return removed;
+}
+
+} // namespace driftway
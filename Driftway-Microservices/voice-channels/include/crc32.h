@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace driftway {
+
+// CRC-32 as used by zlib, Ethernet and the STUN FINGERPRINT attribute
+// (reflected polynomial 0xEDB88320). Pass a previous result as `crc` to
+// continue over more data. Uses carry-less multiplication when the CPU has
+// PCLMULQDQ and SSE4.1, and slice-by-8 tables otherwise.
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+// Same checksum via the portable tables only.
+uint32_t Crc32SliceBy8(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+// Whether Crc32() takes the carry-less multiplication path on this CPU.
+bool Crc32HasPclmul();
+
+} // namespace driftway
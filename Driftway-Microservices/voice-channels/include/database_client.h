@@ -1,27 +1,121 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace driftway {
 
+// MongoDB client. Participant and activity writes are write-behind: the
+// calls only queue, and a flusher thread hands the queue to the database
+// as bulk writes of up to batch_size records, at least every
+// flush_interval_ms and as soon as a batch is full.
+//
+// Participant changes are kept as the latest state per (channel, user): a
+// join followed by a leave before either was written cancels out, and a
+// later change replaces an unwritten earlier one. When the database falls
+// behind, batches that fail are retried with backoff, activity records are
+// shed once the queue is three quarters full, and new participant keys are
+// refused when it is full. Callers never wait on the database.
 class DatabaseClient {
 public:
-    DatabaseClient(const std::string& uri);
+    static constexpr size_t kDefaultBatchSize = 500;
+    static constexpr uint32_t kDefaultFlushIntervalMs = 100;
+    static constexpr size_t kDefaultMaxQueued = 100000;
+
+    enum class WriteType { kAddParticipant, kRemoveParticipant, kActivity };
+
+    struct Write {
+        WriteType type;
+        std::string channel_id;  // Participant writes
+        std::string user_id;
+        std::string activity;    // kActivity
+        uint64_t time_ms;        // Unix time the change was queued
+    };
+
+    // One ordered bulk write, applying the records in sequence; returning
+    // false retries the same batch later
+    using BulkWriter = std::function<bool(const std::vector<Write>& batch)>;
+
+    struct Stats {
+        size_t queued = 0;            // Records waiting, including a batch being retried
+        size_t queued_peak = 0;
+        uint64_t accepted = 0;
+        uint64_t collapsed = 0;       // Records that cancelled or replaced an unwritten one
+        uint64_t written = 0;
+        uint64_t batches = 0;
+        uint64_t failed_batches = 0;
+        uint64_t dropped = 0;         // Refused or shed by backpressure, or lost at shutdown
+    };
+
+    explicit DatabaseClient(const std::string& uri, size_t batch_size = kDefaultBatchSize,
+                            uint32_t flush_interval_ms = kDefaultFlushIntervalMs,
+                            size_t max_queued = kDefaultMaxQueued);
     ~DatabaseClient();
-    
+
+    DatabaseClient(const DatabaseClient&) = delete;
+    DatabaseClient& operator=(const DatabaseClient&) = delete;
+
+    // False while the last bulk write failed
     bool IsConnected() const;
+    // Writes out what is queued (one attempt) and stops the flusher
     void disconnect();
     bool createChannel(const std::string& channel_name, int owner_id);
     bool deleteChannel(int channel_id);
     std::vector<int> getChannelParticipants(int channel_id);
-    bool addParticipant(int channel_id, int user_id);
-    bool removeParticipant(int channel_id, int user_id);
-    void logActivity(const std::string& activity);
+
+    // Queued; false if refused by backpressure or after disconnect()
+    bool addParticipant(const std::string& channel_id, const std::string& user_id);
+    bool removeParticipant(const std::string& channel_id, const std::string& user_id);
+    bool logActivity(const std::string& activity);
+
+    // Replaces the bulk write; set before the first write is queued
+    void setBulkWriter(BulkWriter writer) { writer_ = std::move(writer); }
+
+    Stats getStats() const;
 
 private:
+    struct PendingParticipant {
+        Write write;
+        // A join nothing earlier was pending for: a leave may cancel it
+        bool cancellable;
+    };
+
     std::string connection_uri_;
-    bool connected_;
+    std::atomic<bool> connected_{false};
+    size_t batch_size_;
+    uint32_t flush_interval_ms_;
+    size_t max_queued_;
+    BulkWriter writer_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::unordered_map<std::string, PendingParticipant> participants_;  // "channel\nuser" ->
+    std::vector<Write> activity_;
+    std::vector<Write> retry_;  // Failed batch, written before anything newer
+    size_t queued_peak_ = 0;
+    bool stopping_ = false;
+    std::thread flusher_;
+
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> collapsed_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> failed_batches_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    bool QueueParticipant(const std::string& channel_id, const std::string& user_id, bool joined);
+    size_t QueuedLocked() const { return participants_.size() + activity_.size() + retry_.size(); }
+    void TakeBatch(std::vector<Write>* batch);
+    bool WriteBatch(const std::vector<Write>& batch);
+    void FlushLoop();
 };
 
-} // namespace driftway
\ No newline at end of file
+} // namespace driftway
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace driftway {
+namespace dsp {
+
+enum class Isa {
+    kScalar,
+    kSse42,
+    kAvx2,
+    kAvx512, // AVX-512F
+};
+
+// Table of audio kernels for one instruction set. Active() picks the best
+// table the CPU supports once, at first use, so the binary stays portable.
+struct Kernels {
+    Isa isa;
+    const char* name;
+
+    // acc[i] += in[i], widened to 32 bits so sums of many speakers cannot wrap
+    void (*accumulate_s16)(int32_t* acc, const int16_t* in, size_t count);
+
+    // out[i] = saturate16(acc[i] - self[i]); self may be null for the full mix
+    void (*mix_minus_s16)(int16_t* out, const int32_t* acc, const int16_t* self, size_t count);
+
+    // Float samples are full scale at +-1.0.
+    // out[i] = in[i] / 32768
+    void (*s16_to_f32)(float* out, const int16_t* in, size_t count);
+    // out[i] = saturate16(round(in[i] * 32768)), rounding half to even
+    void (*f32_to_s16)(int16_t* out, const float* in, size_t count);
+
+    // data[i] *= start + step * i: a linear ramp, or a constant gain with
+    // step 0, so level changes do not click
+    void (*gain_ramp_f32)(float* data, size_t count, float start, float step);
+    // acc[i] += in[i] * gain
+    void (*mix_f32)(float* acc, const float* in, size_t count, float gain);
+    // data[i] = clamp(data[i], -limit, limit)
+    void (*clip_f32)(float* data, size_t count, float limit);
+
+    // max |in[i]|, 0 when empty
+    float (*peak_f32)(const float* in, size_t count);
+    // Sum of in[i]^2; summation order differs between instruction sets
+    float (*sum_squares_f32)(const float* in, size_t count);
+    // Sum of a[i] * b[i], e.g. one FIR output; order differs likewise
+    float (*dot_f32)(const float* a, const float* b, size_t count);
+
+    // Complex values are split: separate real and imaginary arrays.
+    // Radix-2 FFT butterfly over `count` lanes: with a = x[i] and
+    // b = x[i + x_stride], y[i] = a + b and y[i + y_stride] = (a - b) * w
+    void (*fft_butterfly_f32)(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count,
+                              size_t x_stride, size_t y_stride, float w_re, float w_im);
+    // data[i] *= w[i]
+    void (*complex_mul_f32)(float* re, float* im, const float* w_re, const float* w_im, size_t count);
+};
+
+const Kernels& Active();
+
+// Kernels for a specific instruction set, or nullptr if this CPU lacks it.
+const Kernels* ForIsa(Isa isa);
+
+// Root mean square level of in[0..count), 0 when empty
+float Rms(const float* in, size_t count);
+
+} // namespace dsp
+} // namespace driftway
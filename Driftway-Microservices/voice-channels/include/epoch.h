@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+namespace driftway {
+namespace epoch {
+
+// Epoch-based reclamation for read-mostly structures on the media path.
+// Writers build a new immutable version, publish it with an atomic pointer
+// swap and Retire() the old one; it is deleted only once every reader that
+// might still see it has left its ReadGuard. Readers take no locks and
+// write only to their own cache line.
+//
+// Pointers loaded inside a ReadGuard stay valid until the guard ends, so
+// guards should be short: the media loop holds one per receive batch.
+class ReadGuard {
+public:
+    ReadGuard();
+    ~ReadGuard();
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+};
+
+// Schedules deleter(object) for after the current readers are done.
+void Retire(void* object, void (*deleter)(void*));
+
+template <typename T>
+void Retire(T* object) {
+    Retire(object, [](void* p) { delete static_cast<T*>(p); });
+}
+
+// Frees whatever retired objects no reader can reach any more. Retire()
+// already does this; call it to drain after the last write.
+void Reclaim();
+
+size_t PendingCount();
+
+} // namespace epoch
+} // namespace driftway
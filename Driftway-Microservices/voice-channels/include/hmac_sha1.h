@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+struct evp_md_ctx_st; // OpenSSL's EVP_MD_CTX
+
+namespace driftway {
+
+// HMAC-SHA1 (RFC 2104) under a fixed key. The digest states after the
+// padded key blocks are computed once and copied per message, so a MAC
+// costs only the message's own SHA-1 blocks. Compute() may run on many
+// threads at once.
+class HmacSha1 {
+public:
+    static constexpr size_t kSize = 20;
+
+    using Piece = std::pair<const uint8_t*, size_t>;
+
+    HmacSha1() = default;
+    HmacSha1(const uint8_t* key, size_t size);
+    ~HmacSha1();
+
+    HmacSha1(HmacSha1&& other) noexcept;
+    HmacSha1& operator=(HmacSha1&& other) noexcept;
+
+    bool IsSet() const { return inner_ != nullptr && outer_ != nullptr; }
+
+    // MAC of the pieces concatenated; writes kSize bytes
+    bool Compute(std::initializer_list<Piece> pieces, uint8_t* mac) const;
+
+private:
+    evp_md_ctx_st* inner_ = nullptr;
+    evp_md_ctx_st* outer_ = nullptr;
+
+    void Reset();
+};
+
+} // namespace driftway
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 
 // Forward declarations
 namespace httplib {
@@ -12,10 +16,12 @@ namespace httplib {
 namespace driftway {
 
 class VoiceServer; // Forward declaration
+class VoiceChannel;
 
 class HttpServer {
 public:
-    HttpServer(int port, VoiceServer* voice_server);
+    // http_signaling serves the unauthenticated join, leave and mixing routes
+    HttpServer(int port, VoiceServer* voice_server, bool http_signaling = false);
     ~HttpServer();
     
     void start();
@@ -23,11 +29,35 @@ public:
 
 private:
     void setup_routes();
+    // Body of GET /channels and its ETag
+    std::shared_ptr<const std::string> render_channels(std::string* etag);
 
     int port_;
     VoiceServer* voice_server_;
+    bool http_signaling_;
     std::unique_ptr<httplib::Server> server_;
     std::thread server_thread_;
+
+    // GET /channels is polled by every client, so each channel's JSON is
+    // kept and rebuilt only when its version moves or its statistics are
+    // stale; the whole body is reused while no channel's JSON changed
+    struct CachedChannel {
+        std::weak_ptr<VoiceChannel> channel; // Tells a recreated channel of the same id apart
+        uint64_t version = 0;
+        std::chrono::steady_clock::time_point built;
+        uint64_t generation = 0; // Changes whenever json does
+        uint64_t seen = 0;       // Last poll the channel was listed in
+        std::string json;
+    };
+    std::mutex channels_mutex_;
+    std::unordered_map<std::string, CachedChannel> channel_cache_;
+    uint64_t channel_cache_generation_ = 0;
+    uint64_t channels_polls_ = 0;
+    // Random per process and hashed into the ETag, so generations that
+    // restart at 1 after a restart never repeat an earlier process's tag
+    uint64_t channels_etag_nonce_;
+    std::string channels_etag_;
+    std::shared_ptr<const std::string> channels_body_;
 };
 
 } // namespace driftway
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "voice_channel.h"
+
+namespace driftway {
+
+// Receive-side buffer for one RTP stream (SSRC). Every packet updates the
+// RFC 3550 reception statistics: extended highest sequence number, expected
+// vs. received counts and interarrival jitter (A.1, A.8). When playout is
+// enabled the buffer also holds packets, reorders them and releases them
+// on a schedule whose delay adapts to the measured jitter.
+//
+// Insert() and Pop() belong to the thread that handles the stream's media;
+// GetStats() may be called from any thread.
+class JitterBuffer {
+public:
+    struct Config {
+        uint32_t clock_rate = 48000;
+        uint32_t frame_ms = 20;
+        uint32_t min_delay_ms = 20;
+        uint32_t max_delay_ms = 200;
+        size_t capacity = 64; // Packets; rounded up to a power of two
+    };
+
+    struct Stats {
+        uint64_t packets_received = 0;
+        uint64_t packets_expected = 0;
+        int64_t packets_lost = 0;     // Cumulative, may go negative on duplicates
+        double loss_fraction = 0.0;   // packets_lost / packets_expected
+        double jitter_ms = 0.0;       // RFC 3550 interarrival jitter
+        uint32_t extended_highest_sequence = 0;
+        uint64_t duplicates = 0;
+        uint64_t reordered = 0;
+        uint64_t late_discarded = 0;  // Arrived after their playout slot
+        size_t depth = 0;             // Packets currently held
+        uint32_t target_delay_ms = 0;
+    };
+
+    enum class PopResult {
+        kPacket,   // `packet` holds the next frame
+        kLost,     // The next frame is missing; conceal it
+        kNotReady, // Nothing is due yet
+        kEmpty,    // Underrun, nothing buffered
+    };
+
+    explicit JitterBuffer(uint32_t ssrc);
+    JitterBuffer(uint32_t ssrc, const Config& config);
+
+    uint32_t ssrc() const { return ssrc_; }
+
+    // Playout is off by default: only statistics are kept and packets are
+    // not retained. Consumers such as the mixer switch it on.
+    void SetPlayoutEnabled(bool enabled);
+    bool IsPlayoutEnabled() const { return playout_enabled_; }
+
+    // arrival_us is on MediaClockMicros()'s clock.
+    void Insert(const AudioPacket& packet, uint64_t arrival_us);
+    PopResult Pop(uint64_t now_us, AudioPacket* packet);
+
+    // The packet Pop() will return next, if it has arrived; after kLost its
+    // FEC data can stand in for the missing frame.
+    const AudioPacket* PeekNext() const;
+
+    Stats GetStats() const;
+
+private:
+    uint32_t ssrc_;
+    Config config_;
+    size_t mask_;
+    bool playout_enabled_;
+
+    // Sequence tracking (RFC 3550 A.1, in extended form)
+    bool initialized_;
+    uint64_t base_ext_seq_;
+    uint64_t max_ext_seq_;
+    uint32_t bad_seq_;
+    uint64_t received_;
+    uint64_t duplicates_;
+    uint64_t reordered_;
+    uint64_t late_discarded_;
+    uint64_t received_window_; // Bit i: max_ext_seq_ - i was received
+
+    // Interarrival jitter (RFC 3550 A.8), in timestamp units
+    bool has_transit_;
+    int64_t last_transit_;
+    double jitter_;
+
+    // Playout
+    std::vector<AudioPacket> slots_;
+    std::vector<bool> occupied_;
+    size_t depth_;
+    bool playout_started_;
+    uint64_t next_play_ext_seq_;
+    uint32_t next_play_timestamp_;
+    uint64_t playout_base_us_;
+    uint32_t playout_base_timestamp_;
+    uint32_t target_delay_ms_;
+    uint32_t shrink_credit_;
+
+    // Published for GetStats()
+    std::atomic<uint64_t> published_received_{0};
+    std::atomic<uint64_t> published_expected_{0};
+    std::atomic<uint64_t> published_duplicates_{0};
+    std::atomic<uint64_t> published_reordered_{0};
+    std::atomic<uint64_t> published_late_{0};
+    std::atomic<uint32_t> published_highest_{0};
+    std::atomic<uint32_t> published_jitter_us_{0};
+    std::atomic<uint32_t> published_depth_{0};
+    std::atomic<uint32_t> published_target_ms_{0};
+
+    uint64_t ExtendSequence(uint16_t seq) const;
+    bool UpdateSequence(uint16_t seq, uint64_t* ext_seq);
+    void ResetSequence(uint16_t seq);
+    void UpdateJitter(uint32_t rtp_timestamp, uint64_t arrival_us);
+    void AdaptTargetDelay();
+    void Store(const AudioPacket& packet, uint64_t ext_seq, uint64_t arrival_us);
+    uint64_t DueTime(uint32_t rtp_timestamp) const;
+    void Publish();
+};
+
+} // namespace driftway
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace driftway {
+namespace log {
+
+enum class Level : uint8_t { kDebug = 0, kInfo = 1, kWarn = 2, kError = 3, kOff = 4 };
+
+enum class Format : uint8_t { kText, kJson };
+
+// Levels below this are compiled out entirely; build with
+// -DDRIFTWAY_LOG_MIN_LEVEL=0 to keep debug logging available at runtime.
+#ifndef DRIFTWAY_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define DRIFTWAY_LOG_MIN_LEVEL 1
+#else
+#define DRIFTWAY_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+constexpr Level kMinCompiledLevel = static_cast<Level>(DRIFTWAY_LOG_MIN_LEVEL);
+
+// Runtime threshold (default kInfo) and output format (default text).
+void SetLevel(Level level);
+Level GetLevel();
+void SetFormat(Format format);
+bool ParseLevel(std::string_view name, Level* level); // "debug", "info", "warn", "error", "off"
+
+class LogLine;
+class RateLimiter;
+
+namespace detail {
+struct Record;
+extern std::atomic<uint8_t> g_level;
+
+// Gives the LOG_ macros' ternary a void second branch
+struct Voidify {
+    void operator&(const LogLine&) {}
+};
+} // namespace detail
+
+inline bool Enabled(Level level) {
+    return static_cast<uint8_t>(level) >= detail::g_level.load(std::memory_order_relaxed);
+}
+
+// Blocks until every record logged before the call has been written.
+void Flush();
+
+// Drains and stops the writer thread. Later records are written synchronously.
+void Shutdown();
+
+// Records dropped because a thread's ring was full.
+uint64_t DroppedRecords();
+
+// One log record under construction. Formats straight into a slot of the
+// calling thread's ring buffer and publishes it on destruction; the writer
+// thread does the I/O. If the ring is full the record is dropped and counted
+// rather than blocking the caller.
+class LogLine {
+public:
+    static constexpr size_t kMaxMessage = 440;
+
+    LogLine(Level level, const char* file, int line);
+    // Rate-limited: an empty, discarded record unless limiter->Allow()
+    LogLine(RateLimiter* limiter, Level level, const char* file, int line);
+    ~LogLine();
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    LogLine& operator<<(std::string_view text) { Append(text.data(), text.size()); return *this; }
+    LogLine& operator<<(const std::string& text) { Append(text.data(), text.size()); return *this; }
+    LogLine& operator<<(const char* text);
+    LogLine& operator<<(char c) { Append(&c, 1); return *this; }
+    LogLine& operator<<(bool value) { return *this << (value ? '1' : '0'); }
+    LogLine& operator<<(double value);
+    LogLine& operator<<(float value) { return *this << static_cast<double>(value); }
+    LogLine& operator<<(const void* pointer);
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    LogLine& operator<<(T value) {
+        if (std::is_signed<T>::value) {
+            AppendSigned(static_cast<int64_t>(value));
+        } else {
+            AppendUnsigned(static_cast<uint64_t>(value));
+        }
+        return *this;
+    }
+
+private:
+    detail::Record* record_;
+    size_t length_;
+
+    void Begin(Level level, const char* file, int line, uint64_t suppressed);
+    void Append(const char* data, size_t size);
+    void AppendSigned(int64_t value);
+    void AppendUnsigned(uint64_t value);
+};
+
+// Token bucket for LOG_RATE_LIMITED: at most `per_second` records per call
+// site per second, with the number suppressed in between reported on the
+// next one that gets through.
+class RateLimiter {
+public:
+    explicit RateLimiter(uint32_t per_second) : per_second_(per_second == 0 ? 1 : per_second) {}
+
+    bool Allow();
+    uint64_t TakeSuppressed() { return suppressed_.exchange(0, std::memory_order_relaxed); }
+
+private:
+    uint32_t per_second_;
+    std::atomic<uint64_t> window_start_us_{0};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint64_t> suppressed_{0};
+};
+
+} // namespace log
+} // namespace driftway
+
+// LOG_INFO << "joined " << user_id;
+// The operands after the macro are not evaluated when the level is disabled,
+// and the whole statement compiles away when it is below
+// DRIFTWAY_LOG_MIN_LEVEL. Being an expression, it is safe in an unbraced if.
+#define DRIFTWAY_LOG(level)                                                                                  \
+    !((level) >= ::driftway::log::kMinCompiledLevel && ::driftway::log::Enabled(level))                     \
+        ? static_cast<void>(0)                                                                               \
+        : ::driftway::log::detail::Voidify() & ::driftway::log::LogLine((level), __FILE__, __LINE__)
+
+#define LOG_DEBUG DRIFTWAY_LOG(::driftway::log::Level::kDebug)
+#define LOG_INFO DRIFTWAY_LOG(::driftway::log::Level::kInfo)
+#define LOG_WARN DRIFTWAY_LOG(::driftway::log::Level::kWarn)
+#define LOG_ERROR DRIFTWAY_LOG(::driftway::log::Level::kError)
+
+// For conditions that can repeat per packet: LOG_RATE_LIMITED(kWarn, 1) << ...
+// Each call site gets its own limiter. Records over the limit are neither
+// formatted nor queued, though their operands are still evaluated.
+#define LOG_RATE_LIMITED(level, per_second)                                                                  \
+    !(::driftway::log::Level::level >= ::driftway::log::kMinCompiledLevel &&                                \
+      ::driftway::log::Enabled(::driftway::log::Level::level))                                              \
+        ? static_cast<void>(0)                                                                               \
+        : ::driftway::log::detail::Voidify() &                                                               \
+              ::driftway::log::LogLine(                                                                      \
+                  [] {                                                                                       \
+                      static ::driftway::log::RateLimiter limiter(per_second);                               \
+                      return &limiter;                                                                       \
+                  }(),                                                                                       \
+                  ::driftway::log::Level::level, __FILE__, __LINE__)
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace driftway {
+
+class MediaBufferRef;
+
+// MTU-sized datagram storage with an intrusive reference count. A received
+// packet lives in exactly one MediaBuffer; every receiver it is forwarded to
+// holds a reference instead of a copy. Buffers come from and go back to the
+// PacketPool, never the heap, once the pool is warm.
+class MediaBuffer {
+public:
+    static constexpr size_t kCapacity = 1500;
+
+    static MediaBufferRef Allocate(); // Empty buffer from the calling thread's pool
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    void setSize(size_t size) { size_ = static_cast<uint16_t>(size); }
+    uint32_t refCount() const { return refs_.load(std::memory_order_acquire); }
+
+private:
+    friend class MediaBufferRef;
+    friend class PacketPool;
+
+    MediaBuffer() = default;
+
+    void AddRef() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    void Release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Recycle(this);
+        }
+    }
+
+    static void Recycle(MediaBuffer* buffer); // Back to the releasing thread's pool
+
+    std::atomic<uint32_t> refs_{0};
+    uint16_t size_ = 0;
+    MediaBuffer* next_free_ = nullptr; // PacketPool free-list link
+    alignas(64) uint8_t data_[kCapacity];
+};
+
+class MediaBufferRef {
+public:
+    MediaBufferRef() = default;
+    explicit MediaBufferRef(MediaBuffer* buffer) : buffer_(buffer) {
+        if (buffer_) {
+            buffer_->AddRef();
+        }
+    }
+    MediaBufferRef(const MediaBufferRef& other) : MediaBufferRef(other.buffer_) {}
+    MediaBufferRef(MediaBufferRef&& other) noexcept : buffer_(std::exchange(other.buffer_, nullptr)) {}
+    ~MediaBufferRef() { reset(); }
+
+    MediaBufferRef& operator=(MediaBufferRef other) noexcept {
+        std::swap(buffer_, other.buffer_);
+        return *this;
+    }
+
+    void reset() {
+        if (buffer_) {
+            std::exchange(buffer_, nullptr)->Release();
+        }
+    }
+
+    MediaBuffer* get() const { return buffer_; }
+    MediaBuffer* operator->() const { return buffer_; }
+    MediaBuffer& operator*() const { return *buffer_; }
+    explicit operator bool() const { return buffer_ != nullptr; }
+
+    // True when this is the only reference, i.e. the storage may be reused.
+    bool unique() const { return buffer_ && buffer_->refCount() == 1; }
+
+private:
+    MediaBuffer* buffer_ = nullptr;
+};
+
+} // namespace driftway
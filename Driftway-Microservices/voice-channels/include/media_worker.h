@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "udp_media_engine.h"
+
+namespace driftway {
+
+class VoiceChannel;
+
+// One media thread: a SO_REUSEPORT socket on the shared RTC port, its event
+// loop, and the channels whose media it owns. Everything a channel sends goes
+// out through its worker's engine, so forwarding and mixing never cross
+// threads; datagrams that arrive on the wrong worker are handed off to the
+// owner through a bounded inbox.
+class MediaWorker {
+public:
+    static constexpr size_t kInboxCapacity = 4096;
+
+    // handed_off is true for datagrams that came through another worker's
+    // handOff(); they must not be handed off again.
+    using PacketHandler = std::function<void(MediaWorker& worker, MediaDatagram* datagrams, size_t count,
+                                             bool handed_off)>;
+
+    MediaWorker(uint32_t index, int port, int cpu);
+    ~MediaWorker();
+
+    MediaWorker(const MediaWorker&) = delete;
+    MediaWorker& operator=(const MediaWorker&) = delete;
+
+    uint32_t index() const { return index_; }
+    int cpu() const { return cpu_; }
+    UdpMediaEngine& engine() { return *engine_; }
+    const UdpMediaEngine& engine() const { return *engine_; }
+
+    bool open() { return engine_->open(); }
+    void start(PacketHandler handler);
+    void stop();
+    void close() { engine_->close(); }
+
+    // Thread-safe. Queues a copy of the datagram's metadata and a reference
+    // on its buffer for this worker's loop; false if the inbox is full.
+    bool handOff(const MediaDatagram& datagram);
+
+    // Thread-safe. The channel is mixed every 20 ms on this worker's loop
+    // until it leaves mixing mode or is destroyed.
+    void addMixingChannel(const std::shared_ptr<VoiceChannel>& channel);
+
+    uint64_t getHandoffs() const { return handoffs_.load(std::memory_order_relaxed); }
+    uint64_t getHandoffDrops() const { return handoff_drops_.load(std::memory_order_relaxed); }
+
+private:
+    struct Handoff {
+        MediaBufferRef buffer;
+        MediaEndpoint source;
+        uint8_t* data = nullptr;
+        size_t size = 0;
+        uint64_t arrival_us = 0;
+    };
+
+    uint32_t index_;
+    int cpu_;
+    std::unique_ptr<UdpMediaEngine> engine_;
+    PacketHandler handler_;
+
+    // Producers append to inbox_; the loop swaps it with drain_ and handles
+    // the batch without the lock. Both keep their capacity across swaps.
+    std::vector<Handoff> inbox_;
+    std::vector<Handoff> drain_;
+    std::vector<MediaDatagram> drain_datagrams_;
+    std::mutex inbox_mutex_;
+    std::atomic<uint64_t> handoffs_{0};
+    std::atomic<uint64_t> handoff_drops_{0};
+
+    std::vector<std::weak_ptr<VoiceChannel>> mixing_channels_;
+    std::vector<std::weak_ptr<VoiceChannel>> mixing_scratch_;
+    std::mutex mixing_mutex_;
+
+    void DrainInbox();
+    void OnTick(uint64_t now_us);
+};
+
+} // namespace driftway
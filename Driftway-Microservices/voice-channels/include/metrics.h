@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace driftway {
+
+namespace detail {
+uint32_t NextMetricsShard();
+} // namespace detail
+
+// Shard slot of the calling thread. Threads are numbered on first use, so as
+// long as fewer than kMetricsShards threads record, none share a slot.
+constexpr size_t kMetricsShards = 64;
+
+inline size_t MetricsShard() {
+    thread_local uint32_t shard = detail::NextMetricsShard() % kMetricsShards;
+    return shard;
+}
+
+// Monotonic counter kept in one cache line per thread. Add() is a relaxed
+// add to a line no other thread writes, so media workers recording the same
+// counter never contend; Value() sums the lines and may run on any thread.
+class ShardedCounter {
+public:
+    void Add(uint64_t n = 1) { cells_[MetricsShard()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Value() const;
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+
+    Cell cells_[kMetricsShards];
+};
+
+// High-dynamic-range histogram of non-negative integers, laid out like
+// HdrHistogram with two significant digits: values below 128 are counted
+// exactly, larger ones in buckets 1/64 of their power of two wide, which
+// keeps every quantile within 1.6% over the full 32-bit range (larger values
+// are clamped). Each recording thread gets its own bucket array on first use.
+class HdrHistogram {
+public:
+    static constexpr uint32_t kSubBucketBits = 7;
+    static constexpr size_t kBuckets = (32 - kSubBucketBits + 2) << (kSubBucketBits - 1);
+
+    HdrHistogram();
+    ~HdrHistogram();
+
+    HdrHistogram(const HdrHistogram&) = delete;
+    HdrHistogram& operator=(const HdrHistogram&) = delete;
+
+    void Record(uint64_t value);
+
+    struct Snapshot {
+        std::vector<uint64_t> counts; // Per bucket, merged over threads
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        // Highest value equivalent to the one at quantile q (0..1); 0 when empty
+        uint64_t ValueAtQuantile(double q) const;
+        // Recorded values that fall in value's bucket or below it
+        uint64_t CountAtOrBelow(uint64_t value) const;
+    };
+
+    // Not atomic with respect to concurrent Record() calls; each bucket is
+    // read once, so a scrape may miss values recorded while it runs.
+    Snapshot GetSnapshot() const;
+
+    static size_t BucketIndex(uint64_t value);
+    static uint64_t BucketUpperBound(size_t index); // Highest value counted in the bucket
+
+private:
+    struct Shard {
+        std::atomic<uint64_t> counts[kBuckets];
+        std::atomic<uint64_t> sum;
+    };
+
+    std::atomic<Shard*> shards_[kMetricsShards];
+
+    Shard* LocalShard();
+};
+
+// Media-path metrics for the whole process, recorded on the media workers.
+struct MediaMetrics {
+    ShardedCounter packets_dropped;    // Malformed, unrouted or undeliverable datagrams
+    ShardedCounter packets_forwarded;  // Ingress packets fanned out (SFU mode)
+    ShardedCounter copies_forwarded;   // Egress datagrams those produced
+    ShardedCounter bytes_forwarded;
+    ShardedCounter packets_suppressed; // Silent packets not forwarded
+    ShardedCounter packets_unselected; // Senders outside their channel's last N
+    ShardedCounter stun_responses;     // Connectivity checks answered with success
+    ShardedCounter stun_rejections;    // Connectivity checks answered with an error
+    ShardedCounter unverified_sources; // Plain RTP from an address its sender never checked; not latched
+    ShardedCounter dtls_packets;       // DTLS records received on the RTC port
+    ShardedCounter rtcp_packets;       // RTCP (after SRTCP) consumed from participants
+    ShardedCounter srtp_auth_failures; // SRTP packets whose tag did not verify
+    ShardedCounter srtp_replays;       // SRTP packets repeated or older than the replay window
+
+    HdrHistogram forward_latency_us;  // Kernel receive to sendmmsg() return, per egress datagram
+    HdrHistogram queue_wait_us;       // Kernel receive to handling on the owning worker
+    HdrHistogram jitter_buffer_depth; // Packets held, sampled per insert in playout mode
+};
+
+MediaMetrics& GetMediaMetrics();
+
+// Builds a Prometheus text exposition (format 0.0.4).
+class PrometheusWriter {
+public:
+    using Labels = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+    // "# HELP" and "# TYPE" lines; samples of the family follow
+    void Family(std::string_view name, std::string_view type, std::string_view help);
+
+    void Sample(std::string_view name, uint64_t value, Labels labels = {});
+    void Sample(std::string_view name, double value, Labels labels = {});
+
+    // A complete histogram family with the given upper bounds (in exported
+    // units, ascending) plus +Inf, _sum and _count. scale converts recorded
+    // values to exported units, e.g. 1e-6 for microseconds to seconds.
+    void Histogram(std::string_view name, std::string_view help, const HdrHistogram::Snapshot& snapshot,
+                   const std::vector<double>& bounds, double scale);
+
+    // Gauge family "<name>" with p50/p90/p99/p99.9 from the histogram's full
+    // resolution, which the exported buckets cannot give.
+    void Quantiles(std::string_view name, std::string_view help, const HdrHistogram::Snapshot& snapshot,
+                   double scale);
+
+    const std::string& str() const { return out_; }
+
+private:
+    std::string out_;
+
+    void BeginSample(std::string_view name, Labels labels);
+    void AppendLabelValue(std::string_view value);
+    void AppendDouble(double value);
+};
+
+} // namespace driftway
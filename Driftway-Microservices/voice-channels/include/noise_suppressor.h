@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "real_fft.h"
+
+namespace driftway {
+
+// Frame-based spectral noise suppressor for one mono stream. Audio is cut
+// into 50%-overlapping blocks, transformed, and each frequency bin is
+// scaled by a Wiener gain computed from its estimated signal-to-noise
+// ratio. The noise floor is tracked per bin from the minimum of the
+// smoothed power, so it follows slow changes (fans, hum, hiss) while
+// speech, which comes and goes, stays above it.
+//
+// Process accepts any number of samples and returns the same number,
+// delayed by kLatency. All buffers are sized up front; an instance holds a
+// stream's state and must be driven by one thread at a time.
+class NoiseSuppressor {
+public:
+    static constexpr size_t kFftSize = 512;          // 10.7 ms at 48 kHz
+    static constexpr size_t kHop = kFftSize / 2;
+    static constexpr size_t kLatency = kFftSize;     // Samples
+    static constexpr size_t kBins = kFftSize / 2 + 1;
+
+    NoiseSuppressor();
+    ~NoiseSuppressor();
+
+    NoiseSuppressor(const NoiseSuppressor&) = delete;
+    NoiseSuppressor& operator=(const NoiseSuppressor&) = delete;
+
+    // Denoises data[0..count) in place
+    void Process(float* data, size_t count);
+    void Process(int16_t* data, size_t count);
+
+    // Forgets the audio and the noise estimate, as if newly constructed
+    void Reset();
+
+private:
+    RealFft fft_;
+
+    std::vector<float> input_;   // Last kFftSize input samples; the newest hop is being filled
+    std::vector<float> output_;  // Finished samples handed out while the next hop fills
+    std::vector<float> overlap_; // Second half of the last synthesized block
+    std::vector<float> block_;
+    std::vector<float> re_;
+    std::vector<float> im_;
+    std::vector<float> scratch_; // One hop of int16 input as float
+
+    // Per bin
+    std::vector<float> power_;    // This block's
+    std::vector<float> smoothed_; // Recursively averaged power
+    std::vector<float> noise_;    // Noise power estimate
+    std::vector<float> gain_;     // Last gain, for the decision-directed SNR
+    std::vector<float> snr_;      // Last a posteriori SNR
+
+    size_t fill_;    // Samples of the current hop received
+    uint32_t blocks_; // Blocks analysed, counted up to the warm-up length
+
+    void ProcessBlock();
+};
+
+} // namespace driftway
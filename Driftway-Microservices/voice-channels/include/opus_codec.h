@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// libopus handle types (opus.h typedefs these structs)
+struct OpusEncoder;
+struct OpusDecoder;
+
+namespace driftway {
+
+// libopus wrapper that keeps one encoder and/or decoder per stream id
+// (normally an SSRC). A stream's state carries its prediction and
+// concealment history from frame to frame; when the stream is released the
+// state is reset and parked in a free list, so joins and leaves do not hit
+// the allocator once the pool is warm. Encode and decode write into caller
+// buffers and never allocate.
+//
+// Streams looked up by id share a map that is locked briefly per call. A
+// hot path instead holds its states directly (StreamEncoder, OpusDecoder*):
+// they come from the same pool, but coding with them takes no lock, only
+// taking and returning them does. Either way a stream must be driven by
+// one thread at a time, which the media loop guarantees.
+class OpusCodec {
+public:
+    static constexpr int kSampleRate = 48000;
+    static constexpr int kChannels = 1;
+    static constexpr size_t kMaxFrameSamples = 5760; // 120 ms
+    static constexpr size_t kMaxPacketSize = 1275;   // RFC 6716 section 3.4
+
+    struct Config {
+        int complexity = 5;            // 0-10; 10 costs about twice as much as 5
+        int bitrate = 32000;           // bits/s, or OPUS_AUTO (-1000)
+        bool fec = true;               // In-band FEC for the previous frame
+        int expected_loss_percent = 5; // How much FEC to spend
+        bool dtx = true;               // Skip near-silent frames entirely
+    };
+
+    // An encoder held by its stream's owner. SetConfig() reaches it on its
+    // next frame through one atomic load.
+    struct StreamEncoder {
+        OpusEncoder* encoder = nullptr;
+        uint32_t generation = 0; // Config generation last applied
+        bool dtx = false;
+    };
+
+    struct Stats {
+        size_t encoders = 0;           // Bound to a stream, by id or held directly
+        size_t decoders = 0;
+        size_t pooled_encoders = 0;    // Reset and waiting for reuse
+        size_t pooled_decoders = 0;
+        uint64_t encode_errors = 0;
+        uint64_t decode_errors = 0;
+    };
+
+    OpusCodec();
+    explicit OpusCodec(const Config& config);
+    ~OpusCodec();
+
+    OpusCodec(const OpusCodec&) = delete;
+    OpusCodec& operator=(const OpusCodec&) = delete;
+
+    // New settings reach every encoder before its next frame.
+    void SetConfig(const Config& config);
+    Config GetConfig() const;
+
+    // Encodes one frame (2.5 to 120 ms of mono 48 kHz audio). Returns the
+    // packet size, or 0 when there is nothing to send: an error, or a frame
+    // DTX decided to drop.
+    size_t Encode(uint32_t stream_id, const int16_t* pcm, size_t samples, uint8_t* out, size_t capacity);
+    size_t EncodeFloat(uint32_t stream_id, const float* pcm, size_t samples, uint8_t* out, size_t capacity);
+
+    // Decodes one packet into at most max_samples samples; returns the
+    // number written, 0 on error. data == nullptr conceals a lost frame.
+    // With fec set, `data` is the packet that followed the lost one and the
+    // lost frame is rebuilt from its redundancy (or concealed if it has none).
+    size_t Decode(uint32_t stream_id, const uint8_t* data, size_t size, int16_t* pcm, size_t max_samples,
+                  bool fec = false);
+    size_t DecodeFloat(uint32_t stream_id, const uint8_t* data, size_t size, float* pcm, size_t max_samples);
+
+    void ReleaseEncoder(uint32_t stream_id);
+    void ReleaseDecoder(uint32_t stream_id);
+
+    // States held directly. Take* return false/nullptr if libopus could not
+    // allocate one; Return* accept empty states.
+    bool TakeEncoder(StreamEncoder* stream);
+    void ReturnEncoder(StreamEncoder* stream);
+    OpusDecoder* TakeDecoder();
+    void ReturnDecoder(OpusDecoder* decoder);
+
+    // As above, on a held state; no lock unless the config changed
+    size_t Encode(StreamEncoder& stream, const int16_t* pcm, size_t samples, uint8_t* out, size_t capacity);
+    size_t Decode(OpusDecoder* decoder, const uint8_t* data, size_t size, int16_t* pcm, size_t max_samples,
+                  bool fec = false);
+
+    Stats GetStats() const;
+
+private:
+    mutable std::mutex mutex_;
+    Config config_;
+    std::atomic<uint32_t> generation_;
+
+    std::unordered_map<uint32_t, StreamEncoder> encoders_;
+    std::unordered_map<uint32_t, OpusDecoder*> decoders_;
+    std::vector<OpusEncoder*> free_encoders_;
+    std::vector<OpusDecoder*> free_decoders_;
+    size_t held_encoders_ = 0;
+    size_t held_decoders_ = 0;
+
+    std::atomic<uint64_t> encode_errors_{0};
+    std::atomic<uint64_t> decode_errors_{0};
+
+    // Called with mutex_ held
+    OpusEncoder* NewEncoder();
+    OpusDecoder* NewDecoder();
+    void PoolEncoder(OpusEncoder* encoder);
+    void PoolDecoder(OpusDecoder* decoder);
+    StreamEncoder* AcquireEncoder(uint32_t stream_id);
+    OpusDecoder* AcquireDecoder(uint32_t stream_id);
+
+    void RefreshEncoder(StreamEncoder& stream);
+    size_t FinishEncode(const StreamEncoder& stream, int result);
+    size_t DecodeWith(OpusDecoder* decoder, const uint8_t* data, size_t size, int16_t* pcm, size_t max_samples,
+                      bool fec);
+    size_t FinishDecode(int result);
+};
+
+} // namespace driftway
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "media_buffer.h"
+
+namespace driftway {
+
+// Recycling allocator behind MediaBuffer::Allocate(). Every thread keeps a
+// private free list, so the receive/forward/release cycle of a media worker
+// touches no lock and no malloc. A thread that frees more than it allocates
+// (the owner of handed-off packets, say) passes whole magazines of
+// kMagazineSize buffers to a shared depot, where allocating threads pick
+// them up. Memory beyond the depot's cap goes back to the heap.
+class PacketPool {
+public:
+    static constexpr size_t kMagazineSize = 256;
+    static constexpr size_t kMaxDepotMagazines = 64;
+
+    static MediaBuffer* Acquire();
+    static void Recycle(MediaBuffer* buffer);
+
+    // Pre-allocates buffers into the depot, e.g. before the media loops start
+    static void Reserve(size_t buffers);
+
+    struct Stats {
+        uint64_t buffers_allocated = 0; // From the heap, ever
+        uint64_t buffers_freed = 0;     // Back to the heap, ever
+        uint64_t buffers_in_depot = 0;
+        uint64_t depot_exchanges = 0;   // Magazines moved between threads and depot
+    };
+
+    static Stats GetStats();
+
+private:
+    struct FreeList; // Intrusive list through MediaBuffer::next_free_
+    struct ThreadCache;
+
+    static ThreadCache& LocalCache();
+    static void Push(FreeList& list, MediaBuffer* buffer);
+    static MediaBuffer* Pop(FreeList& list);
+    static FreeList TakeMagazine(FreeList& list);
+    static bool PushMagazine(FreeList magazine);
+    static bool PopMagazine(FreeList* magazine);
+};
+
+} // namespace driftway
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace driftway {
+
+// FFT of real signals whose length is a power of two, built from the
+// dsp:: butterfly kernels. A length-n real transform runs as one n/2-point
+// complex FFT, split "four-step" into two passes of short FFTs that each
+// work across many lanes at once, so every butterfly is a full vector
+// operation.
+//
+// Spectra are split complex: bins 0..n/2 (Bins()) in separate real and
+// imaginary arrays. Twiddle tables are shared per size; the instance owns
+// only scratch space, so Forward/Inverse never allocate but an instance
+// must not be used by two threads at once.
+class RealFft {
+public:
+    struct Tables;
+
+    // size: power of two, at least 32
+    explicit RealFft(size_t size);
+    ~RealFft();
+
+    RealFft(const RealFft&) = delete;
+    RealFft& operator=(const RealFft&) = delete;
+
+    size_t Size() const { return size_; }
+    size_t Bins() const { return size_ / 2 + 1; }
+
+    // X[k] = sum in[t] e^(-2 pi i k t / size), for k < Bins()
+    void Forward(const float* in, float* re, float* im);
+    // Exact inverse of Forward, including the 1/size scale; the imaginary
+    // parts of bins 0 and size/2 are ignored
+    void Inverse(const float* re, const float* im, float* out);
+
+private:
+    size_t size_;
+    std::shared_ptr<const Tables> tables_;
+
+    // Complex work arrays of size/2 points
+    std::vector<float> work_re_;
+    std::vector<float> work_im_;
+    std::vector<float> scratch_re_;
+    std::vector<float> scratch_im_;
+
+    void ComplexForward(float* re, float* im, float* scratch_re, float* scratch_im);
+};
+
+} // namespace driftway
@@ -1,28 +1,177 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+struct redisAsyncContext;
+struct uv_loop_s;
+struct uv_async_s;
+struct uv_timer_s;
+
 namespace driftway {
 
+// Asynchronous Redis client. A dedicated thread runs a libuv loop that owns
+// the hiredis connections; the public methods only queue work under a short
+// lock and wake that thread, so callers never wait on a Redis round-trip.
+// Everything queued between two wake-ups goes out in one pipelined write.
+//
+// Presence and speaking updates are coalesced: changes arriving within
+// kCoalesceWindowMs are folded per channel, last state per user winning,
+// into one PUBLISH on "voice:events:<channel>" of
+//   {"channel":"...","joined":[...],"left":[...],"speaking":[...],"silent":[...]}
+// set()/del() are collapsed per key over the same window and written as one
+// MULTI/EXEC. Lost connections are re-established with jittered
+// exponential backoff; work queued meanwhile is kept, up to a bound.
+//
+// URL: redis://[[user]:password@]host[:port][/db]
 class RedisClient {
 public:
-    RedisClient(const std::string& url);
+    static constexpr uint32_t kCoalesceWindowMs = 50;
+    static constexpr uint32_t kMinBackoffMs = 100;
+    static constexpr uint32_t kMaxBackoffMs = 30000;
+    static constexpr size_t kMaxQueuedCommands = 65536;  // Also bounds keys with a pending write
+    static constexpr size_t kMaxInFlight = 16384;         // Sent and not yet answered
+
+    // ok is false on error replies and when the connection went away first;
+    // value is the string reply, empty for nil
+    using ReplyCallback = std::function<void(bool ok, const std::string& value)>;
+    using MessageHandler = std::function<void(const std::string& channel, const std::string& message)>;
+
+    struct Stats {
+        uint64_t commands_sent = 0;
+        uint64_t commands_failed = 0;
+        uint64_t commands_dropped = 0;   // Queue full
+        uint64_t events_queued = 0;      // publishPresence/publishSpeaking calls
+        uint64_t events_published = 0;   // PUBLISHes they were folded into
+        uint64_t writes_queued = 0;      // set/del calls
+        uint64_t write_batches = 0;      // MULTI/EXEC blocks they were folded into
+        uint64_t reconnects = 0;
+        size_t queued = 0;
+    };
+
+    explicit RedisClient(const std::string& url);
     ~RedisClient();
-    
-    bool IsConnected() const;
+
+    RedisClient(const RedisClient&) = delete;
+    RedisClient& operator=(const RedisClient&) = delete;
+
+    bool IsConnected() const { return connected_.load(std::memory_order_relaxed); }
+    // Flushes what is queued (waiting at most a second for replies) and
+    // stops the loop thread; later calls are dropped
     void disconnect();
+
+    // Queued; false only if the queue is full or the client stopped.
+    // Reply callbacks run on the loop thread.
     bool publish(const std::string& channel, const std::string& message);
-    void subscribe(const std::string& channel);
-    void unsubscribe(const std::string& channel);
-    std::string get(const std::string& key);
+    void get(const std::string& key, ReplyCallback callback);
     bool set(const std::string& key, const std::string& value);
     bool del(const std::string& key);
+
+    // Coalesced channel events
+    void publishPresence(const std::string& channel_id, const std::string& user_id, bool joined);
+    void publishSpeaking(const std::string& channel_id, const std::string& user_id, bool speaking);
+
+    // Subscriptions live on their own connection and survive reconnects.
+    // Messages reach handleMessage() on the loop thread.
+    void subscribe(const std::string& channel);
+    void unsubscribe(const std::string& channel);
+    void setMessageHandler(MessageHandler handler);
     void handleMessage(const std::string& channel, const std::string& message);
 
+    Stats getStats() const;
+
+    // Loop-thread side, public for the C callbacks in redis_client.cpp
+    struct Connection;
+    void onConnected(Connection& connection);
+    void onDisconnected(Connection& connection);
+    void onRetry(Connection& connection);
+    void onReply(bool failed);
+    void onWake();
+    void onWindow();
+
 private:
-    std::string connection_url_;
-    bool connected_;
+    struct Command {
+        std::vector<std::string> args;
+        ReplyCallback callback;
+    };
+
+    struct Write {
+        bool del = false;
+        std::string value;
+    };
+
+    struct ChannelEvents {
+        std::unordered_map<std::string, bool> presence;  // user -> joined
+        std::unordered_map<std::string, bool> speaking;  // user -> speaking
+    };
+
+    struct Endpoint {
+        std::string host = "127.0.0.1";
+        int port = 6379;
+        std::string username;
+        std::string password;
+        int db = 0;
+    };
+
+    Endpoint endpoint_;
+
+    // Queued by any thread, drained by the loop thread
+    mutable std::mutex mutex_;
+    std::deque<Command> commands_;
+    std::unordered_map<std::string, Write> writes_;
+    std::unordered_map<std::string, ChannelEvents> events_;
+    std::vector<std::pair<std::string, bool>> subscription_changes_;
+    MessageHandler message_handler_;
+    bool window_armed_ = false;
+    bool stopping_ = false;
+
+    // Loop thread only
+    uv_loop_s* loop_ = nullptr;
+    uv_async_s* wake_ = nullptr;
+    uv_timer_s* window_ = nullptr;
+    uv_timer_s* deadline_ = nullptr;
+    std::unique_ptr<Connection> command_;
+    std::unique_ptr<Connection> subscriber_;
+    std::unordered_set<std::string> subscriptions_;
+    size_t in_flight_ = 0;
+    bool throttled_ = false;  // commands_ left waiting for replies to come in
+    bool shutting_down_ = false;
+    std::minstd_rand jitter_;
+
+    std::thread thread_;
+    std::atomic<bool> connected_{false};
+
+    mutable std::atomic<uint64_t> commands_sent_{0};
+    mutable std::atomic<uint64_t> commands_failed_{0};
+    mutable std::atomic<uint64_t> commands_dropped_{0};
+    mutable std::atomic<uint64_t> events_queued_{0};
+    mutable std::atomic<uint64_t> events_published_{0};
+    mutable std::atomic<uint64_t> writes_queued_{0};
+    mutable std::atomic<uint64_t> write_batches_{0};
+    mutable std::atomic<uint64_t> reconnects_{0};
+
+    bool Enqueue(Command command);
+    void Wake();
+
+    void Connect(Connection& connection);
+    void ScheduleReconnect(Connection& connection);
+    void Send(const std::vector<std::string>& args, ReplyCallback callback = nullptr);
+    void SendTo(Connection& connection, const std::vector<std::string>& args, ReplyCallback* callback = nullptr);
+    void FlushCommands(bool all = false);
+    void FlushWindow();
+    void ApplySubscriptionChanges(std::vector<std::pair<std::string, bool>> changes);
+    void BeginShutdown();
+    void FinishShutdownIfIdle();
 };
 
-} // namespace driftway
\ No newline at end of file
+} // namespace driftway
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace driftway {
+
+// Streaming polyphase sample-rate converter for mono audio, e.g. between
+// 8/16/24 kHz clients and the 48 kHz mix. The rate ratio is reduced to
+// L/M and each output sample is one dot product of a filter phase with the
+// newest input, so only the outputs actually needed are computed.
+//
+// Filter banks are designed once per rate pair and shared by every
+// resampler using that pair. Each instance keeps its own input history, so
+// a stream must use one instance, driven by one thread at a time. Process
+// never allocates.
+class Resampler {
+public:
+    static constexpr int kMinRate = 8000;
+    static constexpr int kMaxRate = 192000;
+
+    struct Bank;
+
+    Resampler(int in_rate, int out_rate);
+    ~Resampler();
+
+    Resampler(const Resampler&) = delete;
+    Resampler& operator=(const Resampler&) = delete;
+
+    // Rates in [kMinRate, kMaxRate] whose reduced ratio has a filter bank of
+    // reasonable size; the constructor requires this
+    static bool Supports(int in_rate, int out_rate);
+
+    int InRate() const { return in_rate_; }
+    int OutRate() const { return out_rate_; }
+
+    // Upper bound on what Process writes for in_count input samples
+    size_t MaxOutputSamples(size_t in_count) const;
+
+    // Converts in[0..in_count) and returns the number of samples written.
+    // Returns 0 without consuming anything if capacity is below
+    // MaxOutputSamples(in_count). Output lags input by the filter delay.
+    size_t Process(const float* in, size_t in_count, float* out, size_t capacity);
+    size_t Process(const int16_t* in, size_t in_count, int16_t* out, size_t capacity);
+
+    // Forgets the input history, as if newly constructed
+    void Reset();
+
+private:
+    int in_rate_;
+    int out_rate_;
+    std::shared_ptr<const Bank> bank_;
+
+    // [taps - 1 samples of history][up to kChunkSamples new samples]
+    std::vector<float> buffer_;
+    // Float output of one chunk, for the int16 path
+    std::vector<float> scratch_;
+    size_t next_input_; // Newest input sample of the next output, in chunk coordinates
+    uint32_t phase_;    // Filter phase of the next output, 0 to L - 1
+
+    size_t RunChunk(size_t count, float* out);
+};
+
+} // namespace driftway
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace driftway {
+
+// Protocols multiplexed on the RTC port
+enum class RtcPacketType {
+    kStun,
+    kZrtp,
+    kDtls,
+    kTurnChannel,
+    kRtp,
+    kRtcp,
+    kUnknown,
+};
+
+// Tells the protocols apart by their first byte, as RFC 7983 assigns the
+// ranges: 0-3 STUN, 16-19 ZRTP, 20-63 DTLS, 64-79 TURN channel data and
+// 128-191 RTP/RTCP. RTCP multiplexed with RTP is split off by its second
+// byte, the packet type, which RFC 5761 section 4 keeps in 192-223.
+inline RtcPacketType ClassifyRtcPacket(const uint8_t* data, size_t size) {
+    if (size == 0) {
+        return RtcPacketType::kUnknown;
+    }
+    uint8_t first = data[0];
+    if (first <= 3) {
+        return RtcPacketType::kStun;
+    }
+    if (first >= 16 && first <= 19) {
+        return RtcPacketType::kZrtp;
+    }
+    if (first >= 20 && first <= 63) {
+        return RtcPacketType::kDtls;
+    }
+    if (first >= 64 && first <= 79) {
+        return RtcPacketType::kTurnChannel;
+    }
+    if (first >= 128 && first <= 191) {
+        if (size >= 2 && data[1] >= 192 && data[1] <= 223) {
+            return RtcPacketType::kRtcp;
+        }
+        return RtcPacketType::kRtp;
+    }
+    return RtcPacketType::kUnknown;
+}
+
+} // namespace driftway
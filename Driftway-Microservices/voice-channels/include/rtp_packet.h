@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace driftway {
+
+namespace rtp {
+
+constexpr size_t kFixedHeaderSize = 12;
+constexpr size_t kMaxCsrcCount = 15;
+constexpr uint16_t kOneByteExtensionProfile = 0xBEDE;
+constexpr uint16_t kTwoByteExtensionProfile = 0x1000; // Low 4 bits are app bits
+constexpr uint32_t kOpusClockRate = 48000;
+
+inline uint16_t ReadU16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t ReadU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void WriteU16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+inline void WriteU32(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value >> 24);
+    p[1] = static_cast<uint8_t>(value >> 16);
+    p[2] = static_cast<uint8_t>(value >> 8);
+    p[3] = static_cast<uint8_t>(value);
+}
+
+} // namespace rtp
+
+// One RFC 8285 header extension element. `data` points into the packet.
+struct RtpHeaderExtension {
+    uint8_t id = 0;
+    uint8_t size = 0;
+    const uint8_t* data = nullptr;
+};
+
+// Non-owning, allocation-free view over an RTP packet (RFC 3550). Parse()
+// validates the layout once; the accessors then read straight from the
+// receive buffer, which must outlive the view.
+class RtpPacketView {
+public:
+    RtpPacketView() = default;
+
+    bool Parse(const uint8_t* data, size_t size);
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    uint8_t version() const { return data_[0] >> 6; }
+    bool hasPadding() const { return (data_[0] & 0x20) != 0; }
+    bool hasExtension() const { return (data_[0] & 0x10) != 0; }
+    uint8_t csrcCount() const { return data_[0] & 0x0F; }
+    bool marker() const { return (data_[1] & 0x80) != 0; }
+    uint8_t payloadType() const { return data_[1] & 0x7F; }
+    uint16_t sequenceNumber() const { return rtp::ReadU16(data_ + 2); }
+    uint32_t timestamp() const { return rtp::ReadU32(data_ + 4); }
+    uint32_t ssrc() const { return rtp::ReadU32(data_ + 8); }
+    uint32_t csrc(size_t index) const { return rtp::ReadU32(data_ + rtp::kFixedHeaderSize + index * 4); }
+
+    // Extension block (profile-defined header + elements), if present
+    uint16_t extensionProfile() const { return extension_profile_; }
+    const uint8_t* extensionData() const { return data_ + extension_offset_; }
+    size_t extensionSize() const { return extension_size_; }
+
+    // Looks up an RFC 8285 element in one-byte or two-byte form.
+    bool FindExtension(uint8_t id, RtpHeaderExtension* extension) const;
+
+    // Calls fn(const RtpHeaderExtension&) for each element; stops early if
+    // fn returns false.
+    template <typename Fn>
+    void ForEachExtension(Fn&& fn) const;
+
+    size_t headerSize() const { return header_size_; }
+    const uint8_t* payload() const { return data_ + header_size_; }
+    size_t payloadSize() const { return payload_size_; }
+    size_t paddingSize() const { return padding_size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t header_size_ = 0;
+    size_t payload_size_ = 0;
+    size_t padding_size_ = 0;
+    size_t extension_offset_ = 0;
+    size_t extension_size_ = 0;
+    uint16_t extension_profile_ = 0;
+};
+
+// Fields of the fixed header plus CSRC list, for serialization.
+struct RtpHeader {
+    bool marker = false;
+    uint8_t payload_type = 0;
+    uint16_t sequence_number = 0;
+    uint32_t timestamp = 0;
+    uint32_t ssrc = 0;
+    uint8_t csrc_count = 0;
+    uint32_t csrcs[rtp::kMaxCsrcCount] = {};
+};
+
+// Serializes an RTP packet into a caller-supplied buffer. Call order is
+// header, extensions (optional), payload; Finish() returns the total size
+// or 0 if anything overflowed the buffer.
+class RtpPacketWriter {
+public:
+    RtpPacketWriter(uint8_t* buffer, size_t capacity);
+
+    bool WriteHeader(const RtpHeader& header);
+
+    // Extensions use the one-byte form unless two_byte is requested
+    // (required for ids above 14, empty or longer than 16 byte elements).
+    void BeginExtensions(bool two_byte = false);
+    bool AddExtension(uint8_t id, const uint8_t* data, size_t size);
+
+    bool WritePayload(const uint8_t* payload, size_t size);
+    // For encoders writing straight into the packet: reserve space and commit.
+    uint8_t* PayloadBuffer(size_t* available);
+    bool CommitPayload(size_t size);
+
+    size_t Finish();
+
+private:
+    uint8_t* buffer_;
+    size_t capacity_;
+    size_t offset_;
+    size_t extension_start_;
+    bool two_byte_extensions_;
+    bool overflow_;
+
+    void CloseExtensions();
+};
+
+// Send-side state of one outgoing RTP stream. Sequence number and timestamp
+// start at random offsets (RFC 3550 section 5.1) and advance per packet.
+class RtpStream {
+public:
+    RtpStream(uint32_t ssrc, uint8_t payload_type, uint32_t clock_rate = rtp::kOpusClockRate);
+
+    uint32_t ssrc() const { return ssrc_; }
+    uint32_t clockRate() const { return clock_rate_; }
+    uint16_t nextSequenceNumber() const { return next_sequence_; }
+    uint32_t nextTimestamp() const { return next_timestamp_; }
+
+    // Fills the header for the next packet covering `samples` samples and
+    // advances the stream state.
+    void NextHeader(uint32_t samples, RtpHeader* header, bool marker = false);
+
+    // Time passes without a packet (e.g. silence): timestamp only.
+    void AdvanceTimestamp(uint32_t samples) { next_timestamp_ += samples; }
+
+    // Serializes the next packet into `out`; returns its size or 0.
+    size_t WritePacket(const uint8_t* payload, size_t payload_size, uint32_t samples,
+                       uint8_t* out, size_t capacity, bool marker = false);
+
+private:
+    uint32_t ssrc_;
+    uint8_t payload_type_;
+    uint32_t clock_rate_;
+    uint16_t next_sequence_;
+    uint32_t next_timestamp_;
+};
+
+template <typename Fn>
+void RtpPacketView::ForEachExtension(Fn&& fn) const {
+    if (extension_size_ == 0) {
+        return;
+    }
+
+    const uint8_t* p = data_ + extension_offset_;
+    const uint8_t* end = p + extension_size_;
+    bool one_byte = extension_profile_ == rtp::kOneByteExtensionProfile;
+    bool two_byte = (extension_profile_ & 0xFFF0) == rtp::kTwoByteExtensionProfile;
+    if (!one_byte && !two_byte) {
+        return;
+    }
+
+    while (p < end) {
+        if (*p == 0) { // Padding between elements
+            ++p;
+            continue;
+        }
+
+        RtpHeaderExtension element;
+        if (one_byte) {
+            element.id = *p >> 4;
+            element.size = static_cast<uint8_t>((*p & 0x0F) + 1);
+            if (element.id == 15) { // Reserved: stop processing
+                return;
+            }
+            ++p;
+        } else {
+            if (p + 2 > end) {
+                return;
+            }
+            element.id = p[0];
+            element.size = p[1];
+            p += 2;
+        }
+
+        if (p + element.size > end) {
+            return;
+        }
+        element.data = p;
+        p += element.size;
+
+        if (!fn(static_cast<const RtpHeaderExtension&>(element))) {
+            return;
+        }
+    }
+}
+
+} // namespace driftway
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "hmac_sha1.h"
+
+struct evp_cipher_ctx_st; // OpenSSL's EVP_CIPHER_CTX
+
+namespace driftway {
+
+enum class SrtpProfile {
+    kAesCm128HmacSha1_80, // RFC 3711: AES counter mode, 80-bit HMAC-SHA1 tag
+    kAeadAes128Gcm,       // RFC 7714: AES-GCM, 128-bit tag over header and payload
+};
+
+namespace srtp {
+
+constexpr size_t kMasterKeySize = 16;
+constexpr size_t kMaxMasterSaltSize = 14;
+constexpr size_t kMaxOverhead = 16 + 4; // GCM tag plus the SRTCP index word
+
+size_t MasterSaltSize(SrtpProfile profile);
+size_t RtpOverhead(SrtpProfile profile);  // Bytes protection adds to RTP
+size_t RtcpOverhead(SrtpProfile profile); // ... and to RTCP, index word included
+
+// SDES crypto-suite names (RFC 4568, RFC 7714)
+const char* ProfileName(SrtpProfile profile);
+bool ParseProfileName(std::string_view name, SrtpProfile* profile);
+
+// SDES "inline:" key parameter: base64 of master key then master salt
+bool ParseInlineKey(std::string_view base64, SrtpProfile profile, uint8_t* key, uint8_t* salt);
+std::string FormatInlineKey(const uint8_t* key, const uint8_t* salt, SrtpProfile profile);
+
+// Fresh random master key and salt
+bool GenerateMasterKey(SrtpProfile profile, uint8_t* key, uint8_t* salt);
+
+} // namespace srtp
+
+enum class SrtpStatus {
+    kOk,
+    kMalformed,  // Not RTP/RTCP, or too short for the tag
+    kTooLarge,   // No room behind the packet for the tag
+    kAuthFailed, // Tag mismatch
+    kReplayed,   // Index seen before, or older than the replay window
+    kError,      // Cipher failure or session not keyed
+};
+
+class SrtpSession;
+
+// One packet of a batch, transformed in place; size is updated on success.
+struct SrtpBatchItem {
+    SrtpSession* session = nullptr;
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0; // Protection only: bytes available at data
+    SrtpStatus status = SrtpStatus::kOk;
+};
+
+// One direction of SRTP/SRTCP (RFC 3711) under one master key: either the
+// sessions a participant's packets are unprotected with, or those its
+// receivers' copies are protected with. Session keys are derived once, and
+// the cipher contexts are keyed once and only get a new IV per packet.
+// Each SSRC seen gets its own rollover counter and 64-packet replay window.
+//
+// Not thread-safe: a session belongs to the media worker owning its channel.
+// The one exception is RemoveStream(), which signaling calls when a sender
+// leaves; the worker applies it before it next touches a stream.
+class SrtpSession {
+public:
+    enum class Direction { kProtect, kUnprotect };
+
+    // Streams are created on first successful use; the cap bounds what a
+    // peer spraying SSRCs can make us keep. Streams of senders that left
+    // are removed, so it only limits SSRCs active at once.
+    static constexpr size_t kMaxStreams = 512;
+
+    // master_salt is srtp::MasterSaltSize(profile) bytes
+    SrtpSession(SrtpProfile profile, Direction direction, const uint8_t* master_key, const uint8_t* master_salt);
+    ~SrtpSession();
+
+    SrtpSession(const SrtpSession&) = delete;
+    SrtpSession& operator=(const SrtpSession&) = delete;
+
+    bool IsValid() const { return valid_; }
+    SrtpProfile profile() const { return profile_; }
+    Direction direction() const { return direction_; }
+
+    SrtpStatus ProtectRtp(uint8_t* data, size_t* size, size_t capacity);
+    SrtpStatus UnprotectRtp(uint8_t* data, size_t* size);
+    SrtpStatus ProtectRtcp(uint8_t* data, size_t* size, size_t capacity);
+    SrtpStatus UnprotectRtcp(uint8_t* data, size_t* size);
+
+    // Whole batches, e.g. one sendmmsg() worth; each item names its own
+    // session. Packets are processed back to back so the keys, cipher
+    // contexts and AES-NI pipeline stay hot. Returns the number that
+    // succeeded; the rest carry their status.
+    static size_t ProtectRtp(SrtpBatchItem* items, size_t count);
+    static size_t UnprotectRtp(SrtpBatchItem* items, size_t count);
+
+    // Forgets the stream of an SSRC that will not be used again, e.g. a
+    // sender that left the channel. The SSRC is then refused rather than
+    // started over, since a fresh rollover counter could repeat an index
+    // already used under this key. Callable from any thread.
+    void RemoveStream(uint32_t ssrc);
+
+private:
+    // Highest index accepted plus a bitmap of the 63 before it
+    struct ReplayWindow {
+        uint64_t highest = 0;
+        uint64_t seen = 0;
+        bool started = false;
+
+        bool Check(uint64_t index) const;
+        void Accept(uint64_t index);
+    };
+
+    struct Stream {
+        uint32_t roc = 0;            // Rollover counter of the highest sequence number
+        uint16_t highest_sequence = 0;
+        bool started = false;
+        ReplayWindow rtp_replay;
+        uint32_t rtcp_index = 0;     // Last SRTCP index sent
+        ReplayWindow rtcp_replay;
+    };
+
+    struct Keys {
+        evp_cipher_ctx_st* cipher = nullptr;
+        HmacSha1 auth;                  // AES-CM only
+        uint8_t salt[srtp::kMaxMasterSaltSize] = {};
+    };
+
+    SrtpProfile profile_;
+    Direction direction_;
+    bool gcm_;
+    size_t tag_size_;
+    bool valid_;
+    Keys rtp_;
+    Keys rtcp_;
+    std::unordered_map<uint32_t, Stream> streams_;
+
+    // RemoveStream() requests, applied by the owning thread
+    std::mutex removals_mutex_;
+    std::vector<uint32_t> removals_;
+    std::atomic<bool> has_removals_{false};
+    // The last kMaxStreams removed SSRCs, which are not recreated
+    std::vector<uint32_t> retired_;
+    size_t next_retired_ = 0;
+
+    void ApplyRemovals();
+
+    bool DeriveKeys(const uint8_t* master_key, const uint8_t* master_salt, uint8_t first_label, Keys* keys);
+    Stream* FindStream(uint32_t ssrc, bool create);
+    bool EstimateIndex(const Stream& stream, uint16_t sequence, uint32_t* roc, uint64_t* index) const;
+    bool CtrIv(const Keys& keys, uint32_t ssrc, uint64_t index);
+    bool GcmIv(const Keys& keys, uint32_t ssrc, uint64_t index);
+};
+
+// SRTP sessions of one participant: inbound unprotects the media it sends,
+// outbound protects what it is sent. Created unkeyed when the participant
+// joins; keys arrive once from signaling, possibly while media flows, so
+// the media thread reads them through an acquire load. Keys are set once:
+// a client that needs new ones rejoins.
+class SrtpPeer {
+public:
+    // False if the peer was already keyed
+    bool SetSessions(std::unique_ptr<SrtpSession> inbound, std::shared_ptr<SrtpSession> outbound);
+
+    bool IsKeyed() const { return keyed_.load(std::memory_order_acquire); }
+    SrtpSession* inbound() const { return IsKeyed() ? inbound_.get() : nullptr; }
+    // Shared so a queued datagram keeps the session alive until it is sent;
+    // empty while unkeyed
+    const std::shared_ptr<SrtpSession>& outbound() const;
+
+private:
+    std::mutex mutex_; // Serializes SetSessions()
+    std::unique_ptr<SrtpSession> inbound_;
+    std::shared_ptr<SrtpSession> outbound_;
+    std::atomic<bool> keyed_{false};
+};
+
+} // namespace driftway
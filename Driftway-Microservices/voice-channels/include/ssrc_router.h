@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace driftway {
+
+class VoiceChannel;
+class JitterBuffer;
+class VoiceActivityDetector;
+struct Participant;
+
+// Where packets of one SSRC go. The pointers are kept alive by the router
+// and are valid for as long as the caller's epoch::ReadGuard.
+struct SsrcRoute {
+    uint32_t ssrc = 0;
+    VoiceChannel* channel = nullptr;
+    Participant* participant = nullptr;
+    JitterBuffer* jitter_buffer = nullptr;
+    VoiceActivityDetector* voice_activity = nullptr;
+};
+
+// Server-wide SSRC -> route table for the media path. Lookups are lock-free:
+// each shard is an immutable open-addressed table behind an atomic pointer.
+// Joins and leaves copy the one shard they touch, publish the copy and
+// retire the old version through epoch reclamation, so a packet never waits
+// on a join and a join never waits on packets.
+class SsrcRouter {
+public:
+    SsrcRouter();
+    ~SsrcRouter();
+
+    SsrcRouter(const SsrcRouter&) = delete;
+    SsrcRouter& operator=(const SsrcRouter&) = delete;
+
+    // Call inside an epoch::ReadGuard; nullptr if the SSRC is unknown.
+    const SsrcRoute* Find(uint32_t ssrc) const;
+
+    void Add(uint32_t ssrc, std::shared_ptr<VoiceChannel> channel, std::shared_ptr<Participant> participant,
+             std::shared_ptr<JitterBuffer> jitter_buffer, std::shared_ptr<VoiceActivityDetector> voice_activity);
+    bool Remove(uint32_t ssrc);
+    size_t RemoveChannel(const VoiceChannel* channel);
+    void Clear();
+
+    size_t size() const;
+
+private:
+    // SSRCs are handed out sequentially, so the low bits spread them evenly
+    static constexpr size_t kShardCount = 64;
+
+    struct Snapshot;
+
+    // Owning references behind a route; retired with the snapshot that
+    // last pointed at them
+    struct Owner {
+        std::shared_ptr<VoiceChannel> channel;
+        std::shared_ptr<Participant> participant;
+        std::shared_ptr<JitterBuffer> jitter_buffer;
+        std::shared_ptr<VoiceActivityDetector> voice_activity;
+    };
+
+    std::atomic<const Snapshot*> shards_[kShardCount];
+
+    mutable std::mutex write_mutex_;
+    std::unordered_map<uint32_t, Owner> owners_[kShardCount];
+
+    static size_t ShardOf(uint32_t ssrc) { return ssrc & (kShardCount - 1); }
+    void PublishShardLocked(size_t shard);
+};
+
+} // namespace driftway
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "stun_message.h"
+#include "udp_media_engine.h"
+
+namespace driftway {
+
+// ICE-lite responder for the RTC port (RFC 8445 section 2.5). The server
+// has one set of local credentials, advertised in its SDP, and answers the
+// connectivity checks of any peer presenting them; it never sends checks of
+// its own. Which participant a check is from follows from the remote ufrag
+// in its USERNAME, which the participant's offer carried (see IcePeer).
+//
+// Const after construction, so every media worker may use it at once.
+class StunHandler {
+public:
+    // Credentials shorter than RFC 8839 allows (4 and 22 characters) are
+    // replaced by random ones
+    StunHandler(const std::string& ufrag, const std::string& password);
+
+    const std::string& localUfrag() const { return ufrag_; }
+    const std::string& localPassword() const { return password_; }
+
+    enum class Result {
+        kIgnored,   // Not a request we answer: drop it
+        kResponded, // Binding success in `out`
+        kRejected,  // Error response in `out`
+    };
+
+    // Handles one datagram the demultiplexer classified as STUN. On
+    // kResponded and kRejected, *response_size bytes of `out` go back to
+    // `source`. On kResponded, remote_ufrag (if given) is set to the peer's
+    // half of USERNAME, pointing into `data`.
+    Result HandleMessage(const uint8_t* data, size_t size, const MediaEndpoint& source,
+                         uint8_t* out, size_t capacity, size_t* response_size,
+                         std::string_view* remote_ufrag = nullptr) const;
+
+    // Random string of ICE characters (RFC 8839 ice-char)
+    static std::string RandomIceString(size_t length);
+
+private:
+    std::string ufrag_;
+    std::string password_;
+    StunIntegrityKey key_;
+
+    size_t WriteError(const StunMessageView& request, int code, const char* reason,
+                      uint8_t* out, size_t capacity) const;
+};
+
+// ICE state of one participant: the addresses its most recent successful
+// connectivity checks came from. Those checks carried our password and the
+// ufrag from the participant's own offer, so unlike an RTP source address
+// they cannot be forged by someone who merely guessed its SSRC. Checks are
+// answered on whichever worker receives them, while the channel's worker
+// reads, hence the lock; it is only taken when a source address changes.
+class IcePeer {
+public:
+    static constexpr size_t kMaxAddresses = 4; // Candidate pairs remembered
+
+    void RecordCheck(const MediaEndpoint& source);
+    bool IsVerified(const MediaEndpoint& source) const;
+
+private:
+    mutable std::mutex mutex_;
+    MediaEndpoint addresses_[kMaxAddresses];
+    size_t next_ = 0; // Oldest slot, replaced next
+};
+
+} // namespace driftway
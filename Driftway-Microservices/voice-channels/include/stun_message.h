@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "hmac_sha1.h"
+
+namespace driftway {
+
+struct MediaEndpoint;
+
+namespace stun {
+
+constexpr size_t kHeaderSize = 20;
+constexpr size_t kTransactionIdSize = 12;
+constexpr uint32_t kMagicCookie = 0x2112A442;
+constexpr uint32_t kFingerprintXor = 0x5354554E;
+constexpr size_t kMessageIntegritySize = 20; // HMAC-SHA1
+constexpr size_t kMaxMessageSize = 548;      // Without path MTU discovery (RFC 5389 section 7.1)
+
+// Message types (method plus class bits)
+constexpr uint16_t kBindingRequest = 0x0001;
+constexpr uint16_t kBindingIndication = 0x0011;
+constexpr uint16_t kBindingSuccessResponse = 0x0101;
+constexpr uint16_t kBindingErrorResponse = 0x0111;
+constexpr uint16_t kBindingMethod = 0x0001;
+
+// Attributes (RFC 5389, RFC 8445). Types below 0x8000 are comprehension-required.
+constexpr uint16_t kAttrMappedAddress = 0x0001;
+constexpr uint16_t kAttrUsername = 0x0006;
+constexpr uint16_t kAttrMessageIntegrity = 0x0008;
+constexpr uint16_t kAttrErrorCode = 0x0009;
+constexpr uint16_t kAttrUnknownAttributes = 0x000A;
+constexpr uint16_t kAttrRealm = 0x0014;
+constexpr uint16_t kAttrNonce = 0x0015;
+constexpr uint16_t kAttrXorMappedAddress = 0x0020;
+constexpr uint16_t kAttrPriority = 0x0024;
+constexpr uint16_t kAttrUseCandidate = 0x0025;
+constexpr uint16_t kAttrSoftware = 0x8022;
+constexpr uint16_t kAttrFingerprint = 0x8028;
+constexpr uint16_t kAttrIceControlled = 0x8029;
+constexpr uint16_t kAttrIceControlling = 0x802A;
+
+inline bool IsComprehensionRequired(uint16_t attribute) {
+    return attribute < 0x8000;
+}
+
+// The method with the class bits (C1 = 0x0100, C0 = 0x0010) squeezed out
+inline uint16_t Method(uint16_t type) {
+    return static_cast<uint16_t>((type & 0x000F) | ((type & 0x00E0) >> 1) | ((type & 0x3E00) >> 2));
+}
+
+inline bool IsRequest(uint16_t type) {
+    return (type & 0x0110) == 0x0000;
+}
+
+inline bool IsIndication(uint16_t type) {
+    return (type & 0x0110) == 0x0010;
+}
+
+} // namespace stun
+
+// One attribute. `data` points into the message; size excludes padding.
+struct StunAttribute {
+    uint16_t type = 0;
+    uint16_t size = 0;
+    const uint8_t* data = nullptr;
+};
+
+// MESSAGE-INTEGRITY key for ICE short-term credentials: HMAC-SHA1 keyed
+// with the password. Sign() may run on many threads.
+class StunIntegrityKey {
+public:
+    StunIntegrityKey() = default;
+    explicit StunIntegrityKey(std::string_view password);
+
+    bool IsSet() const { return hmac_.IsSet(); }
+
+    // HMAC-SHA1 of message[0, size) read as if its length field held
+    // `length`, which RFC 5389 section 15.4 requires. Writes 20 bytes.
+    bool Sign(const uint8_t* message, size_t size, uint16_t length, uint8_t* mac) const;
+
+private:
+    HmacSha1 hmac_;
+};
+
+// Non-owning, allocation-free view over a STUN message (RFC 5389). Parse()
+// checks the header and walks the attribute list once, remembering where
+// MESSAGE-INTEGRITY and FINGERPRINT sit; lookups read straight from the
+// receive buffer, which must outlive the view. Attributes following
+// MESSAGE-INTEGRITY other than FINGERPRINT are ignored, as the RFC requires.
+class StunMessageView {
+public:
+    StunMessageView() = default;
+
+    bool Parse(const uint8_t* data, size_t size);
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    uint16_t type() const { return static_cast<uint16_t>((data_[0] << 8) | data_[1]); }
+    const uint8_t* transactionId() const { return data_ + 8; }
+
+    bool FindAttribute(uint16_t type, StunAttribute* attribute) const;
+
+    // Calls fn(const StunAttribute&) for each attribute before
+    // MESSAGE-INTEGRITY; stops early if fn returns false.
+    template <typename Fn>
+    void ForEachAttribute(Fn&& fn) const;
+
+    // USERNAME, or empty if absent
+    std::string_view username() const;
+
+    // XOR-MAPPED-ADDRESS, falling back to MAPPED-ADDRESS
+    bool GetMappedAddress(MediaEndpoint* endpoint) const;
+
+    bool hasMessageIntegrity() const { return integrity_offset_ != 0; }
+    bool hasFingerprint() const { return fingerprint_offset_ != 0; }
+
+    // Both return false when the attribute is absent
+    bool VerifyFingerprint() const;
+    bool VerifyMessageIntegrity(const StunIntegrityKey& key) const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t attributes_end_ = 0;
+    size_t integrity_offset_ = 0;
+    size_t fingerprint_offset_ = 0;
+};
+
+// Serializes a STUN message into a caller-supplied buffer. The header's
+// length field is kept current, so MESSAGE-INTEGRITY and FINGERPRINT (in
+// that order, last) cover exactly what precedes them. Finish() returns the
+// total size or 0 if anything overflowed the buffer.
+class StunMessageWriter {
+public:
+    StunMessageWriter(uint8_t* buffer, size_t capacity);
+
+    bool WriteHeader(uint16_t type, const uint8_t* transaction_id);
+
+    bool AddAttribute(uint16_t type, const uint8_t* data, size_t size);
+    bool AddUint32(uint16_t type, uint32_t value);
+    bool AddUint64(uint16_t type, uint64_t value);
+    bool AddXorMappedAddress(const MediaEndpoint& endpoint);
+    bool AddErrorCode(int code, std::string_view reason);
+    bool AddUnknownAttributes(const uint16_t* types, size_t count);
+
+    bool AddMessageIntegrity(const StunIntegrityKey& key);
+    bool AddFingerprint();
+
+    size_t Finish();
+
+private:
+    uint8_t* buffer_;
+    size_t capacity_;
+    size_t offset_;
+    bool overflow_;
+
+    // Appends the attribute header and zeroed, padded value space
+    uint8_t* Reserve(uint16_t type, size_t size);
+};
+
+template <typename Fn>
+void StunMessageView::ForEachAttribute(Fn&& fn) const {
+    size_t offset = stun::kHeaderSize;
+    while (offset + 4 <= attributes_end_) {
+        StunAttribute attribute;
+        attribute.type = static_cast<uint16_t>((data_[offset] << 8) | data_[offset + 1]);
+        attribute.size = static_cast<uint16_t>((data_[offset + 2] << 8) | data_[offset + 3]);
+        attribute.data = data_ + offset + 4;
+        if (!fn(static_cast<const StunAttribute&>(attribute))) {
+            return;
+        }
+        offset += 4 + ((attribute.size + 3u) & ~3u);
+    }
+}
+
+} // namespace driftway
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "media_buffer.h"
+
+namespace driftway {
+
+class SrtpSession;
+struct SrtpBatchItem;
+
+// Transport address of a remote media peer.
+struct MediaEndpoint {
+    sockaddr_storage addr{};
+    socklen_t len = 0;
+
+    bool IsSet() const { return len != 0; }
+    bool operator==(const MediaEndpoint& other) const;
+    bool operator!=(const MediaEndpoint& other) const { return !(*this == other); }
+};
+
+// One received datagram. The pointers stay valid until the next receiveBatch();
+// take a MediaBufferRef on `buffer` to keep the bytes alive beyond that.
+struct MediaDatagram {
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    const MediaEndpoint* source = nullptr;
+    MediaBuffer* buffer = nullptr;
+    uint64_t arrival_us = 0; // Kernel receive time (SO_TIMESTAMPNS, CLOCK_REALTIME)
+};
+
+// Current time on the clock used for MediaDatagram::arrival_us.
+uint64_t MediaClockMicros();
+
+// Batched UDP transport for the RTC port. Datagrams are drained with one
+// recvmmsg() and emitted with one sendmmsg() per batch; every iovec, mmsghdr
+// and buffer is allocated once up front.
+class UdpMediaEngine {
+public:
+    static constexpr size_t kDefaultBatchSize = 64;
+    static constexpr size_t kMaxDatagramSize = MediaBuffer::kCapacity;
+
+    using BatchHandler = std::function<void(MediaDatagram* datagrams, size_t count)>;
+    using TickHandler = std::function<void(uint64_t now_us)>;
+    using WakeHandler = std::function<void()>;
+
+    explicit UdpMediaEngine(int port, size_t batch_size = kDefaultBatchSize);
+    ~UdpMediaEngine();
+
+    UdpMediaEngine(const UdpMediaEngine&) = delete;
+    UdpMediaEngine& operator=(const UdpMediaEngine&) = delete;
+
+    // SO_REUSEPORT lets several engines (one per worker thread) bind the same
+    // port. Must be set before open(); sockets join the group in open() order.
+    void setReusePort(bool reuse_port) { reuse_port_ = reuse_port; }
+
+    bool open();
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+    int port() const { return port_; }
+
+    // Installs a classic BPF program on the reuseport group that steers each
+    // datagram to socket (RTP SSRC % group_size), i.e. to the engine opened
+    // that many places into the group. Datagrams too short to carry an SSRC
+    // go to the first socket.
+    bool attachSsrcSteering(size_t group_size);
+
+    // Waits up to timeout_ms for traffic, then drains up to batch_size
+    // datagrams. Results are available through datagrams().
+    size_t receiveBatch(int timeout_ms);
+    MediaDatagram* datagrams() { return datagrams_.data(); }
+
+    // Copies the datagram into the next free send slot; flushes first when
+    // the batch is full.
+    bool queueSend(const uint8_t* data, size_t size, const MediaEndpoint& destination);
+
+    // Zero-copy send: the slot keeps a reference on `buffer` and transmits
+    // `payload` straight out of it. Only the header is copied into the slot;
+    // the returned pointer lets the caller rewrite that copy in place for
+    // this receiver. Returns nullptr if the datagram was dropped.
+    // A non-zero arrival_us (the ingress datagram's) makes flush() record the
+    // forwarding latency in MediaMetrics.
+    // With an SRTP session the payload is copied into the slot as well, since
+    // every receiver's copy is encrypted differently; flush() then protects
+    // all such slots in one batch just before sendmmsg(), so the header may
+    // still be rewritten until then.
+    uint8_t* queueForward(const MediaBufferRef& buffer,
+                          const uint8_t* header, size_t header_size,
+                          const uint8_t* payload, size_t payload_size,
+                          const MediaEndpoint& destination, uint64_t arrival_us = 0,
+                          const std::shared_ptr<SrtpSession>& srtp = nullptr);
+
+    size_t pendingSends() const { return tx_count_; }
+    size_t flush();
+
+    // Periodic work on the loop thread (e.g. the 20 ms mixer clock). Must be
+    // set before start(). The period is kept on CLOCK_MONOTONIC, so clock
+    // steps don't disturb it; the handler is passed MediaClockMicros().
+    void setTickHandler(TickHandler handler, uint32_t interval_ms);
+
+    // Runs `handler` on the loop thread after any thread calls wake(). Must
+    // be set before start().
+    void setWakeHandler(WakeHandler handler) { wake_handler_ = std::move(handler); }
+    void wake();
+
+    // Pins the loop thread to one CPU (-1: no pinning). Set before start().
+    void setCpuAffinity(int cpu) { cpu_ = cpu; }
+
+    // Runs receive -> handler -> wake -> tick -> flush on a dedicated thread.
+    void start(BatchHandler handler);
+    void stop();
+
+    struct Stats {
+        uint64_t packets_received = 0;
+        uint64_t bytes_received = 0;
+        uint64_t packets_sent = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t receive_batches = 0;
+        uint64_t send_batches = 0;
+        uint64_t send_drops = 0;
+    };
+
+    Stats getStats() const;
+
+private:
+    int port_;
+    size_t batch_size_;
+    int fd_;
+    int wake_fd_;
+    bool reuse_port_;
+    int cpu_;
+
+    // Receive side. A slot whose buffer is still referenced after the batch
+    // was handled gets a fresh buffer before the next recvmmsg().
+    std::vector<MediaBufferRef> rx_buffers_;
+    std::vector<iovec> rx_iov_;
+    std::vector<mmsghdr> rx_msgs_;
+    std::vector<MediaEndpoint> rx_sources_;
+    std::vector<uint8_t> rx_control_;
+    std::vector<MediaDatagram> datagrams_;
+
+    // Send side. Each slot has two iovecs: its own storage (a full copy or a
+    // rewritten header) and an optional payload referenced from tx_refs_.
+    std::vector<uint8_t> tx_storage_;
+    std::vector<iovec> tx_iov_;
+    std::vector<mmsghdr> tx_msgs_;
+    std::vector<MediaEndpoint> tx_destinations_;
+    std::vector<MediaBufferRef> tx_refs_;
+    std::vector<uint64_t> tx_arrival_us_;
+    std::vector<std::shared_ptr<SrtpSession>> tx_srtp_; // Slots to protect at flush()
+    std::unique_ptr<SrtpBatchItem[]> tx_protect_;
+    std::vector<size_t> tx_protect_slots_;
+    size_t tx_count_;
+    size_t tx_srtp_count_;
+
+    std::atomic<bool> running_;
+    std::thread loop_thread_;
+
+    TickHandler tick_handler_;
+    uint64_t tick_interval_us_;
+    WakeHandler wake_handler_;
+    bool wake_pending_;
+
+    std::atomic<uint64_t> packets_received_{0};
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> packets_sent_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> receive_batches_{0};
+    std::atomic<uint64_t> send_batches_{0};
+    std::atomic<uint64_t> send_drops_{0};
+
+    void RunLoop(BatchHandler handler);
+    size_t AcquireTxSlot(const MediaEndpoint& destination);
+    size_t ProtectBatch();
+    void ReleaseTxRefs();
+};
+
+} // namespace driftway
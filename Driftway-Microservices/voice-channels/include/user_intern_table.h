@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace driftway {
+
+// Dense server-wide id for a user, valid while the user is in any channel.
+// Handles of departed users are reused, so they stay small enough to index
+// arrays and bitsets.
+using ParticipantHandle = uint32_t;
+constexpr ParticipantHandle kInvalidParticipantHandle = std::numeric_limits<ParticipantHandle>::max();
+
+// user id <-> ParticipantHandle. Strings are only looked up here, at the
+// signaling edge; everything behind it (channels, routing, the media path)
+// identifies users by handle.
+class UserInternTable {
+public:
+    UserInternTable() = default;
+
+    UserInternTable(const UserInternTable&) = delete;
+    UserInternTable& operator=(const UserInternTable&) = delete;
+
+    // Interns user_id and takes a reference on its handle (one per channel
+    // membership). Release() drops it; the handle is recycled at zero.
+    ParticipantHandle Acquire(const std::string& user_id);
+    void Release(ParticipantHandle handle);
+
+    ParticipantHandle Find(const std::string& user_id) const;
+    std::string GetUserId(ParticipantHandle handle) const; // Empty if unknown
+
+    size_t size() const;
+    size_t capacity() const; // Highest handle ever issued + 1
+
+private:
+    struct Entry {
+        std::string user_id;
+        uint32_t refs = 0;
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, ParticipantHandle> handles_;
+    std::vector<Entry> entries_;                // Indexed by handle
+    std::vector<ParticipantHandle> free_handles_; // Reused lowest-first
+};
+
+} // namespace driftway
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace driftway {
+
+struct RtpHeaderExtension;
+
+// Browsers offer urn:ietf:params:rtp-hdrext:ssrc-audio-level as id 1
+constexpr uint8_t kDefaultAudioLevelExtensionId = 1;
+
+// RFC 6464 levels are -dBov from 0 (loudest) to 127 (digital silence)
+constexpr uint8_t kAudioLevelSilence = 127;
+constexpr uint8_t kNoAudioLevel = 0xFF; // Packet carried no level
+
+// Reads a client-to-mixer audio level element: the V flag and the level.
+bool ParseAudioLevel(const RtpHeaderExtension& element, uint8_t* level, bool* voice);
+
+// Speech detection for one incoming stream, driven by the audio level the
+// sender writes into every RTP header, so no audio is decoded. The level is
+// smoothed with a fast attack and slow release; speech starts once the
+// smoothed level rises above speech_level and ends once it has stayed below
+// silence_level for hangover_ms.
+//
+// Update() and the state accessors belong to the media thread handling the
+// stream; the extension id may be set from any thread.
+class VoiceActivityDetector {
+public:
+    struct Config {
+        uint8_t speech_level = 45;   // -dBov
+        uint8_t silence_level = 55;  // -dBov, quieter than speech_level
+        uint32_t hangover_ms = 400;
+        uint8_t suppress_level = 70; // Packets this quiet outside speech are silent
+        bool trust_voice_flag = false; // Senders negotiated "vad=on"
+    };
+
+    enum class Transition { kNone, kStarted, kStopped };
+
+    VoiceActivityDetector();
+    explicit VoiceActivityDetector(const Config& config);
+
+    // The negotiated RFC 8285 id; 0 disables detection for the stream.
+    void SetExtensionId(uint8_t id) { extension_id_.store(id, std::memory_order_relaxed); }
+    uint8_t extensionId() const { return extension_id_.load(std::memory_order_relaxed); }
+
+    Transition Update(uint8_t level, bool voice, uint64_t arrival_us);
+
+    bool IsSpeaking() const { return speaking_; }
+    // The last packet was quiet and outside speech (and its hangover), so
+    // dropping it loses nothing a listener would hear
+    bool IsSilent() const { return silent_; }
+    float smoothedLevel() const { return smoothed_; }
+
+private:
+    Config config_;
+    std::atomic<uint8_t> extension_id_;
+
+    float smoothed_;
+    bool speaking_;
+    bool silent_;
+    uint64_t last_loud_us_;
+};
+
+} // namespace driftway
@@ -7,29 +7,62 @@
 #include <unordered_map>
 #include <atomic>
 #include <functional>
+#include <utility>
+
+#include "media_buffer.h"
+#include "udp_media_engine.h"
+#include "user_intern_table.h"
 
 namespace driftway {
 
+class JitterBuffer;
+class VoiceActivityDetector;
+class AudioMixer;
+class AudioProcessor;
+class SrtpPeer;
+class SrtpSession;
+class IcePeer;
+
+// Dynamic payload type browsers use for Opus unless the SDP says otherwise
+constexpr uint8_t kDefaultOpusPayloadType = 111;
+
 struct Participant {
-    std::string user_id;
+    ParticipantHandle handle = kInvalidParticipantHandle;
+    std::string user_id; // For the signaling edge; the channel goes by handle
     std::string username;
     bool is_speaking = false;
     bool is_muted = false;
     bool is_deafened = false;
     uint64_t joined_at;
     uint32_t ssrc = 0; // RTP Synchronization Source
+    uint8_t payload_type = kDefaultOpusPayloadType; // Negotiated Opus PT
+    MediaEndpoint endpoint; // Latched from the participant's own authenticated RTP
+    std::shared_ptr<SrtpPeer> srtp; // Unkeyed until signaling negotiates SRTP
+    std::shared_ptr<IcePeer> ice;   // Addresses its ICE checks came from
 };
 
+// One RTP packet as received. The datagram stays in its pooled MediaBuffer
+// and is shared, not copied, by everything the packet is forwarded to; the
+// packet itself owns no heap memory.
 struct AudioPacket {
-    std::string user_id;
-    std::vector<uint8_t> data;
+    MediaBufferRef buffer;
+    ParticipantHandle source = kInvalidParticipantHandle; // Sender, from its SSRC route
+    uint16_t header_size = 0;  // Fixed header + CSRCs + extensions
+    uint16_t payload_size = 0; // Excludes RTP padding
     uint32_t timestamp;
     uint16_t sequence_number;
     uint32_t ssrc;
+    uint64_t arrival_us = 0; // See MediaDatagram::arrival_us
+    uint8_t audio_level = 0xFF; // RFC 6464 -dBov, kNoAudioLevel if absent
+    bool voice = false;         // RFC 6464 V flag
     bool is_opus = true;
+
+    const uint8_t* header() const { return buffer ? buffer->data() : nullptr; }
+    const uint8_t* payload() const { return buffer ? buffer->data() + header_size : nullptr; }
 };
 
 using AudioCallback = std::function<void(const AudioPacket&)>;
+using SpeakingCallback = std::function<void(const std::string& user_id, bool speaking)>;
 
 class VoiceChannel {
 public:
@@ -42,27 +75,87 @@ public:
     size_t GetParticipantCount() const;
     bool IsEmpty() const;
 
-    // Participant management
-    bool AddParticipant(const std::string& user_id, const std::string& username = "");
-    bool RemoveParticipant(const std::string& user_id);
-    bool HasParticipant(const std::string& user_id) const;
+    // Participant management. Handles come from the server's UserInternTable.
+    bool AddParticipant(ParticipantHandle handle, const std::string& user_id, const std::string& username = "");
+    bool RemoveParticipant(ParticipantHandle handle);
+    std::vector<ParticipantHandle> RemoveAllParticipants(); // Returns who was removed
+    bool HasParticipant(ParticipantHandle handle) const;
     std::vector<Participant> GetParticipants() const;
-    std::shared_ptr<Participant> GetParticipant(const std::string& user_id);
+    std::shared_ptr<Participant> GetParticipant(ParticipantHandle handle);
 
     // Audio handling
     void SetAudioCallback(AudioCallback callback);
     bool SendAudio(const AudioPacket& packet);
-    void BroadcastAudio(const AudioPacket& packet, const std::string& exclude_user = "");
+    void BroadcastAudio(const AudioPacket& packet, ParticipantHandle exclude = kInvalidParticipantHandle);
+
+    // Ingress from the media path: receive statistics, voice activity, then
+    // fan-out to everyone but the sender. jitter_buffer and voice_activity
+    // are the sender's, from its route.
+    void ReceiveAudio(const AudioPacket& packet, JitterBuffer* jitter_buffer,
+                      VoiceActivityDetector* voice_activity = nullptr);
+    std::shared_ptr<JitterBuffer> GetJitterBuffer(uint32_t ssrc) const;
+    std::shared_ptr<VoiceActivityDetector> GetVoiceActivity(uint32_t ssrc) const;
+
+    // Silence suppression: packets a sender's audio level marks as silent
+    // outside speech are not forwarded. Receivers see the gap as loss and
+    // conceal it, which at these levels is inaudible.
+    void SetSilenceSuppression(bool enabled) { silence_suppression_.store(enabled, std::memory_order_relaxed); }
+    bool IsSilenceSuppressionEnabled() const { return silence_suppression_.load(std::memory_order_relaxed); }
 
-    // Voice activity
-    void SetSpeaking(const std::string& user_id, bool speaking);
-    void SetMuted(const std::string& user_id, bool muted);
-    void SetDeafened(const std::string& user_id, bool deafened);
+    // Last-N: forward only the n most active speakers, ranked by the audio
+    // level their voice activity detectors track, instead of every stream
+    // to every receiver. Each forwarded speaker occupies one of n virtual
+    // SSRCs whose sequence numbers and timestamps continue across speaker
+    // changes, so receivers see n steady streams. Senders without the audio
+    // level extension are never selected. 0 forwards everyone. Set once,
+    // after SetMediaWorker() and before the first participant joins.
+    void SetLastN(size_t n);
+    size_t GetLastN() const { return last_n_; }
+    // (virtual SSRC, speaker currently on it) per slot; the speaker is
+    // kInvalidParticipantHandle while the slot is empty
+    std::vector<std::pair<uint32_t, ParticipantHandle>> GetForwardedSpeakers() const;
+
+    // MCU mode: instead of forwarding every stream, decode the speakers and
+    // send each participant one mix-minus stream. Takes effect on the media
+    // thread; MixTick() runs there every 20 ms and returns false once mixing
+    // is off and its state has been released.
+    void SetMixingEnabled(bool enabled, AudioProcessor* processor);
+    bool IsMixingEnabled() const { return mixing_enabled_.load(std::memory_order_acquire); }
+    bool MixTick(uint64_t now_us);
+
+    // Media transport. Forwarded packets are queued on this engine's send batch.
+    void SetTransport(UdpMediaEngine* transport) { transport_.store(transport, std::memory_order_release); }
+
+    // The media worker that owns this channel, out of worker_count. Set once,
+    // before the first participant joins: every SSRC the channel allocates is
+    // congruent to index modulo worker_count.
+    void SetMediaWorker(uint32_t index, uint32_t worker_count);
+    uint32_t GetMediaWorker() const { return worker_index_; }
+    // The endpoint is written only by the media loop, which may therefore
+    // compare against it without the lock before calling this
+    void SetParticipantEndpoint(Participant& participant, const MediaEndpoint& endpoint);
+    void SetPayloadType(ParticipantHandle handle, uint8_t payload_type);
+    // Switches the participant to SRTP: inbound unprotects what it sends,
+    // outbound protects what it is sent. Once per participant; false if it
+    // is unknown or already keyed.
+    bool SetSrtpSessions(ParticipantHandle handle, std::unique_ptr<SrtpSession> inbound,
+                         std::shared_ptr<SrtpSession> outbound);
+    // RFC 8285 id the participant negotiated for its audio level extension
+    // (0: none); defaults to kDefaultAudioLevelExtensionId
+    void SetAudioLevelExtensionId(ParticipantHandle handle, uint8_t id);
+
+    // Voice activity; speaking follows the audio level extension automatically
+    void SetSpeaking(ParticipantHandle handle, bool speaking);
+    // Told about speaking changes on the thread making them, outside the
+    // channel lock. Set before the channel is shared.
+    void SetSpeakingCallback(SpeakingCallback callback) { speaking_callback_ = std::move(callback); }
+    void SetMuted(ParticipantHandle handle, bool muted);
+    void SetDeafened(ParticipantHandle handle, bool deafened);
 
     // RTP/SSRC management
-    uint32_t AssignSSRC(const std::string& user_id);
-    uint32_t GetSSRC(const std::string& user_id) const;
-    std::string GetUserBySSRC(uint32_t ssrc) const;
+    uint32_t AssignSSRC(ParticipantHandle handle);
+    uint32_t GetSSRC(ParticipantHandle handle) const;
+    ParticipantHandle GetParticipantBySSRC(uint32_t ssrc) const;
 
     // Channel settings
     void SetMaxParticipants(size_t max_participants);
@@ -76,33 +169,98 @@ public:
         uint64_t total_packets_received = 0;
         uint64_t total_bytes_sent = 0;
         uint64_t total_bytes_received = 0;
-        double average_packet_loss = 0.0;
-        double average_jitter = 0.0;
+        uint64_t total_packets_suppressed = 0; // Silent packets not forwarded
+        double average_packet_loss = 0.0; // Mean loss fraction (0..1) over incoming streams
+        double average_jitter = 0.0;      // Mean interarrival jitter in milliseconds
     };
 
     ChannelStats GetStats() const;
 
+    // Bumped by every change to membership, participant flags or mixing
+    // mode, so views of the channel can be cached; statistics move on
+    // without it
+    uint64_t GetVersion() const { return version_.load(std::memory_order_acquire); }
+
 private:
     std::string channel_id_;
     std::string server_id_;
     size_t max_participants_;
 
-    std::unordered_map<std::string, std::shared_ptr<Participant>> participants_;
-    std::unordered_map<uint32_t, std::string> ssrc_to_user_;
+    std::unordered_map<ParticipantHandle, std::shared_ptr<Participant>> participants_;
+    std::unordered_map<uint32_t, ParticipantHandle> ssrc_to_participant_;
+    std::unordered_map<uint32_t, std::shared_ptr<JitterBuffer>> jitter_buffers_;
+    std::unordered_map<uint32_t, std::shared_ptr<VoiceActivityDetector>> voice_activity_;
     mutable std::mutex participants_mutex_;
 
     AudioCallback audio_callback_;
     std::mutex callback_mutex_;
+    SpeakingCallback speaking_callback_;
+
+    std::atomic<uint64_t> version_{0};
+
+    std::atomic<UdpMediaEngine*> transport_{nullptr};
+    std::atomic<bool> silence_suppression_{false};
+    uint32_t worker_index_ = 0;
+    uint32_t worker_count_ = 1;
+
+    // Mixing (MCU) mode; everything but the flag belongs to the media thread
+    struct MixTarget {
+        uint32_t ssrc;
+        uint8_t payload_type;
+        bool is_muted;
+        bool is_deafened;
+        MediaEndpoint endpoint;
+        std::shared_ptr<JitterBuffer> jitter_buffer;
+        std::shared_ptr<SrtpSession> srtp;
+    };
+
+    std::atomic<bool> mixing_enabled_{false};
+    std::atomic<AudioProcessor*> mixing_processor_{nullptr};
+    std::unique_ptr<AudioMixer> mixer_;
+    std::vector<MixTarget> mix_targets_;
+
+    // Last-N slots; all but `published` belong to the media thread
+    struct LastNSlot {
+        uint32_t virtual_ssrc = 0;
+        ParticipantHandle holder = kInvalidParticipantHandle;
+        uint32_t source_ssrc = 0;     // Stream the offsets below were taken from
+        uint16_t sequence_delta = 0;  // Virtual = source + delta
+        uint32_t timestamp_delta = 0;
+        bool has_output = false;
+        uint16_t last_sequence = 0;   // Highest sent, in virtual numbering
+        uint32_t last_timestamp = 0;
+        uint64_t last_arrival_us = 0;
+        bool keep = false;            // RankSpeakers() scratch
+        std::atomic<ParticipantHandle> published{kInvalidParticipantHandle};
+    };
+
+    // Header fields a forwarded copy gets instead of the sender's
+    struct ForwardRewrite {
+        uint32_t ssrc;
+        uint16_t sequence_number;
+        uint32_t timestamp;
+        bool marker;
+    };
+
+    size_t last_n_ = 0;
+    std::unique_ptr<LastNSlot[]> last_n_slots_;
+    uint64_t next_rank_us_ = 0;
+    std::vector<std::pair<float, ParticipantHandle>> rank_scratch_;
 
     // Statistics
     mutable std::atomic<uint64_t> packets_sent_{0};
     mutable std::atomic<uint64_t> packets_received_{0};
     mutable std::atomic<uint64_t> bytes_sent_{0};
     mutable std::atomic<uint64_t> bytes_received_{0};
+    mutable std::atomic<uint64_t> packets_suppressed_{0};
 
     // SSRC management
-    std::atomic<uint32_t> next_ssrc_{1000};
     uint32_t GenerateSSRC();
+
+    void ForwardAudio(const AudioPacket& packet, ParticipantHandle exclude,
+                      const ForwardRewrite* rewrite = nullptr);
+    void ForwardLastN(const AudioPacket& packet, bool onset);
+    void RankSpeakers();
 };
 
 } // namespace driftway
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <unordered_map>
@@ -9,6 +10,10 @@
 #include <atomic>
 #include <functional>
 
+#include "channel_registry.h"
+#include "ssrc_router.h"
+#include "user_intern_table.h"
+
 namespace driftway {
 
 // Forward declarations
@@ -27,6 +32,37 @@ struct VoiceServerConfig {
     int rtc_port = 3478;
     int max_participants = 50;
     std::string stun_server = "stun:stun.l.google.com:19302";
+
+    // ICE-lite credentials answered on the RTC port; generated at startup
+    // when empty
+    std::string ice_ufrag;
+    std::string ice_password;
+
+    // Opus encoder settings for mixed streams
+    int opus_complexity = 5;
+    int opus_bitrate = 32000;
+    bool opus_fec = true;
+    bool opus_dtx = true;
+
+    // Pinned media threads sharing the RTC port; 0 = one per available CPU
+    int media_workers = 0;
+
+    // Drop packets whose RFC 6464 audio level marks them silent instead of
+    // forwarding them
+    bool silence_suppression = false;
+
+    // Denoise each speaker before it is mixed (MCU channels); adds
+    // about 11 ms of delay
+    bool noise_suppression = false;
+
+    // Forward only the N most active speakers per channel on N stable
+    // virtual SSRCs; 0 forwards every speaker to every receiver
+    int last_n = 0;
+
+    // Serve POST /channels/{id}/join, /leave and /mixing. Nothing
+    // authenticates them, so they are for trusted networks and
+    // voice_loadgen only; clients join over the authenticated WebSocket.
+    bool http_signaling = false;
 };
 
 class VoiceServer {
@@ -42,20 +78,36 @@ public:
     std::shared_ptr<VoiceChannel> CreateChannel(const std::string& channel_id, const std::string& server_id);
     std::shared_ptr<VoiceChannel> GetChannel(const std::string& channel_id);
     bool RemoveChannel(const std::string& channel_id);
+    std::vector<std::shared_ptr<VoiceChannel>> GetChannels() const { return channels_.Snapshot(); }
 
-    // User management
-    bool JoinChannel(const std::string& channel_id, const std::string& user_id);
+    // User management. ssrc, if given, receives the SSRC the participant
+    // must send its RTP with.
+    bool JoinChannel(const std::string& channel_id, const std::string& user_id, uint32_t* ssrc = nullptr);
     bool LeaveChannel(const std::string& channel_id, const std::string& user_id);
     std::vector<std::string> GetChannelParticipants(const std::string& channel_id);
 
-    // WebRTC signaling
-    bool HandleOffer(const std::string& channel_id, const std::string& user_id, const std::string& sdp);
+    // Switches a channel between forwarding (SFU) and server-side mixing
+    bool SetChannelMixing(const std::string& channel_id, bool enabled);
+
+    // Media routing: where an incoming RTP stream goes. Lock-free; the
+    // caller holds an epoch::ReadGuard for as long as it uses the route.
+    const SsrcRoute* FindRoute(uint32_t ssrc) const { return ssrc_router_.Find(ssrc); }
+
+    // WebRTC signaling. An offer with SDES "a=crypto" lines keys the
+    // participant's SRTP, and its a=ice-ufrag identifies the participant's
+    // connectivity checks; answer_sdp, if given, receives the attribute
+    // lines to answer with (ICE-lite credentials and our crypto line).
+    bool HandleOffer(const std::string& channel_id, const std::string& user_id, const std::string& sdp,
+                     std::string* answer_sdp = nullptr);
     bool HandleAnswer(const std::string& channel_id, const std::string& user_id, const std::string& sdp);
     bool HandleIceCandidate(const std::string& channel_id, const std::string& user_id, const std::string& candidate);
 
     // Health check
     bool IsHealthy() const;
 
+    // Server, media-path and per-channel metrics in Prometheus text format
+    std::string RenderMetrics() const;
+
 private:
     VoiceServerConfig config_;
     std::atomic<bool> running_;
@@ -66,13 +118,15 @@ private:
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<WebRTCHandler> webrtc_handler_;
 
-    std::unordered_map<std::string, std::shared_ptr<VoiceChannel>> channels_;
-    mutable std::mutex channels_mutex_;
+    ChannelRegistry channels_;
+
+    // User ids are interned here on join; channels and media use the handles
+    UserInternTable users_;
+
+    SsrcRouter ssrc_router_;
 
-    std::thread server_thread_;
     std::thread cleanup_thread_;
 
-    void ServerLoop();
     void CleanupLoop();
     void InitializeComponents();
     void ShutdownComponents();
@@ -2,15 +2,32 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
 #include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "media_worker.h"
+#include "stun_handler.h"
+#include "udp_media_engine.h"
 
 namespace driftway {
 
 class VoiceServer; // Forward declaration
+class VoiceChannel;
+class IcePeer;
+struct SsrcRoute;
+struct SrtpBatchItem;
 
 class WebRTCHandler {
 public:
-    WebRTCHandler(int rtc_port, VoiceServer* voice_server);
+    // media_workers: number of pinned media threads sharing the RTC port;
+    // 0 starts one per CPU this process may run on. Empty ICE credentials
+    // are generated.
+    WebRTCHandler(int rtc_port, VoiceServer* voice_server, size_t media_workers = 0,
+                  const std::string& ice_ufrag = "", const std::string& ice_password = "");
     ~WebRTCHandler();
     
     void initialize();
@@ -20,13 +37,67 @@ public:
     void setLocalDescription(const std::string& sdp);
     void setRemoteDescription(const std::string& sdp);
     void addIceCandidate(const std::string& candidate);
-    void handleIncomingMedia(const std::vector<uint8_t>& data);
-    void sendMedia(const std::vector<uint8_t>& data, const std::string& destination);
+
+    // Media path, driven by each worker's engine one recvmmsg batch at a time.
+    // STUN, DTLS, RTP and RTCP share the port and are told apart per
+    // datagram; RTP and RTCP for a channel owned by another worker are
+    // handed off to it. SRTP
+    // from keyed participants is unprotected in chunks before delivery.
+    void handleIncomingMedia(MediaWorker& worker, MediaDatagram* datagrams, size_t count, bool handed_off);
+
+    // Queues into the channel's worker batch; must run on that worker's loop.
+    bool sendMedia(const VoiceChannel& channel, const uint8_t* data, size_t size, const MediaEndpoint& destination);
+
+    // Gives a new channel to a worker (round-robin) before any participant
+    // joins: its SSRCs are allocated so the kernel steers them to that worker.
+    void assignWorker(VoiceChannel& channel);
+
+    // Channels in mixing mode are ticked every 20 ms on their worker's loop
+    void addMixingChannel(const std::shared_ptr<VoiceChannel>& channel);
+
+    // ICE-lite credentials clients must use in their connectivity checks
+    const std::string& iceUfrag() const { return stun_handler_.localUfrag(); }
+    const std::string& icePassword() const { return stun_handler_.localPassword(); }
+
+    // Ties checks carrying remote_ufrag (the a=ice-ufrag of a participant's
+    // offer) to its IcePeer. Entries die with the participant. False if the
+    // ufrag already belongs to another live participant.
+    bool addIcePeer(const std::string& remote_ufrag, const std::shared_ptr<IcePeer>& peer);
+
+    size_t workerCount() const { return workers_.size(); }
+    UdpMediaEngine::Stats getMediaStats() const; // Summed over workers
+    uint64_t getDroppedPackets() const;
+    uint64_t getHandoffs() const;
+    uint64_t getHandoffDrops() const;
 
 private:
+    static constexpr size_t kSrtpChunkSize = 64;
+    static constexpr size_t kRtcpHeaderSize = 8; // Up to and including the sender SSRC
+
     int rtc_port_;
     VoiceServer* voice_server_;
     bool initialized_;
+
+    StunHandler stun_handler_;
+
+    std::vector<std::unique_ptr<MediaWorker>> workers_;
+    std::atomic<uint32_t> next_worker_{0};
+
+    // Remote ufrag -> peer; taken per successful check, not per packet
+    std::mutex ice_mutex_;
+    std::unordered_map<std::string, std::weak_ptr<IcePeer>> ice_peers_;
+    size_t ice_prune_at_ = 64; // Expired entries are swept when the map grows past this
+
+    void HandleStun(MediaWorker& worker, const MediaDatagram& datagram);
+    // Authenticates SRTCP on the owning worker and consumes the reports
+    void HandleRtcp(MediaWorker& worker, const MediaDatagram& datagram, bool handed_off);
+    void RecordIceCheck(std::string_view remote_ufrag, const MediaEndpoint& source);
+    void UnprotectAndDeliver(SrtpBatchItem* items, const SsrcRoute* const* routes,
+                             const MediaDatagram* const* datagrams, size_t count, uint64_t now_us);
+    // Parses and delivers size bytes of plain RTP from the datagram;
+    // authenticated if it passed SRTP
+    void DeliverRtp(const SsrcRoute& route, const MediaDatagram& datagram, size_t size, uint64_t now_us,
+                    bool authenticated);
 };
 
-} // namespace driftway
\ No newline at end of file
+} // namespace driftway
@@ -0,0 +1,186 @@
+#include "audio_mixer.h"
+#include "audio_processor.h"
+#include "dsp_kernels.h"
+#include "noise_suppressor.h"
+
+#include <algorithm>
+
+namespace driftway {
+
+namespace {
+
+// Codec and RTP state of a stream is released after this many frames
+// without activity (5 s of 20 ms frames)
+constexpr uint64_t kIdleFrames = 250;
+
+} // namespace
+
+AudioMixer::AudioMixer(AudioProcessor* processor, uint32_t output_ssrc)
+    : processor_(processor), output_ssrc_(output_ssrc), frame_counter_(0),
+      speaker_count_(0), full_mix_encoded_(false) {
+    accumulator_.fill(0);
+    output_.fill(0);
+}
+
+AudioMixer::~AudioMixer() {
+    if (!processor_) {
+        return;
+    }
+    for (auto& pair : inputs_) {
+        ReleaseInput(pair.second);
+    }
+    for (auto& pair : listeners_) {
+        processor_->codec().ReturnEncoder(&pair.second.encoder);
+    }
+    processor_->codec().ReturnEncoder(&full_mix_encoder_);
+}
+
+void AudioMixer::ReleaseInput(Input& input) {
+    processor_->codec().ReturnDecoder(input.decoder);
+    input.decoder = nullptr;
+}
+
+void AudioMixer::BeginFrame() {
+    frame_counter_++;
+    accumulator_.fill(0);
+    speaker_count_ = 0;
+    full_mix_.reset();
+    full_mix_encoded_ = false;
+}
+
+bool AudioMixer::AddSpeaker(uint32_t ssrc, const uint8_t* data, size_t size, bool fec) {
+    if (!processor_ || FindSpeaker(ssrc)) {
+        return false;
+    }
+
+    if (speaker_count_ == frames_.size()) {
+        frames_.emplace_back();
+        speakers_.push_back(Speaker{0, speakers_.size()});
+    }
+
+    Input& input = inputs_[ssrc];
+    if (!input.decoder) {
+        input.decoder = processor_->codec().TakeDecoder();
+    }
+    input.last_frame = frame_counter_;
+
+    Speaker& speaker = speakers_[speaker_count_];
+    int16_t* pcm = frames_[speaker.frame].data();
+    size_t decoded = processor_->codec().Decode(input.decoder, data, size, pcm, kFrameSamples, fec);
+    if (decoded == 0) {
+        return false;
+    }
+    if (decoded < kFrameSamples) {
+        std::fill(pcm + decoded, pcm + kFrameSamples, 0);
+    }
+    if (processor_->isNoiseSuppressionEnabled()) {
+        if (!input.suppressor) {
+            input.suppressor = std::make_unique<NoiseSuppressor>();
+        }
+        input.suppressor->Process(pcm, kFrameSamples);
+    }
+
+    dsp::Active().accumulate_s16(accumulator_.data(), pcm, kFrameSamples);
+    speaker.ssrc = ssrc;
+    speaker_count_++;
+    return true;
+}
+
+const AudioMixer::Speaker* AudioMixer::FindSpeaker(uint32_t ssrc) const {
+    for (size_t i = 0; i < speaker_count_; ++i) {
+        if (speakers_[i].ssrc == ssrc) {
+            return &speakers_[i];
+        }
+    }
+    return nullptr;
+}
+
+MediaBufferRef AudioMixer::Encode(OpusCodec::StreamEncoder& encoder) {
+    if (!encoder.encoder && !processor_->codec().TakeEncoder(&encoder)) {
+        return MediaBufferRef();
+    }
+
+    MediaBufferRef buffer = MediaBuffer::Allocate();
+    size_t size = processor_->codec().Encode(encoder, output_.data(), kFrameSamples, buffer->data(),
+                                             MediaBuffer::kCapacity);
+    if (size == 0) {
+        return MediaBufferRef();
+    }
+    buffer->setSize(size);
+    return buffer;
+}
+
+MediaBufferRef AudioMixer::EncodeFor(uint32_t listener_ssrc) {
+    if (speaker_count_ == 0 || !processor_) {
+        return MediaBufferRef();
+    }
+
+    const Speaker* self = FindSpeaker(listener_ssrc);
+    if (!self) {
+        // Everyone who stayed quiet hears the same mix: encode it once.
+        // Switching a listener between this shared encoder and its own one
+        // when it starts or stops talking is inaudible in practice.
+        if (!full_mix_encoded_) {
+            dsp::Active().mix_minus_s16(output_.data(), accumulator_.data(), nullptr, kFrameSamples);
+            full_mix_ = Encode(full_mix_encoder_);
+            full_mix_encoded_ = true;
+        }
+        return full_mix_;
+    }
+
+    if (speaker_count_ == 1) {
+        return MediaBufferRef(); // Only itself is talking
+    }
+
+    dsp::Active().mix_minus_s16(output_.data(), accumulator_.data(), frames_[self->frame].data(), kFrameSamples);
+    Listener& listener = listeners_[listener_ssrc];
+    listener.last_frame = frame_counter_;
+    return Encode(listener.encoder);
+}
+
+void AudioMixer::NextHeader(uint32_t listener_ssrc, uint8_t payload_type, RtpHeader* header) {
+    Listener& listener = listeners_[listener_ssrc];
+    if (!listener.stream) {
+        listener.stream = std::make_unique<RtpStream>(output_ssrc_, payload_type);
+    }
+
+    // Marker flags the first packet of a talkspurt (RFC 3551 section 4.1)
+    listener.stream->NextHeader(static_cast<uint32_t>(kFrameSamples), header, !listener.sent_last_frame);
+    header->payload_type = payload_type;
+    listener.sent_this_frame = true;
+    listener.last_frame = frame_counter_;
+}
+
+void AudioMixer::EndFrame() {
+    for (auto& pair : listeners_) {
+        Listener& listener = pair.second;
+        if (!listener.sent_this_frame && listener.stream) {
+            listener.stream->AdvanceTimestamp(static_cast<uint32_t>(kFrameSamples));
+        }
+        listener.sent_last_frame = listener.sent_this_frame;
+        listener.sent_this_frame = false;
+    }
+
+    if (frame_counter_ % kIdleFrames != 0) {
+        return;
+    }
+
+    for (auto it = listeners_.begin(); it != listeners_.end();) {
+        if (frame_counter_ - it->second.last_frame >= kIdleFrames) {
+            processor_->codec().ReturnEncoder(&it->second.encoder);
+            it = listeners_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = inputs_.begin(); it != inputs_.end();) {
+        if (frame_counter_ - it->second.last_frame >= kIdleFrames) {
+            ReleaseInput(it->second);
+            it = inputs_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+} // namespace driftway
@@ -1,47 +1,136 @@
-#include <iostream>
 #include <vector>
 #include <cstring>
 #include "audio_processor.h"
+#include "dsp_kernels.h"
+#include "logger.h"
 
 namespace driftway {
 
-AudioProcessor::AudioProcessor() {
-    std::cout << "AudioProcessor initialized" << std::endl;
+namespace {
+
+// Stream id of the vector-based encodeOpus()/decodeOpus(); SSRCs handed
+// out to participants never take this value
+constexpr uint32_t kLegacyStreamId = 0;
+
+} // namespace
+
+AudioProcessor::AudioProcessor(const OpusCodec::Config& codec_config) : codec_(codec_config) {
+    LOG_INFO << "AudioProcessor initialized";
 }
 
 AudioProcessor::~AudioProcessor() {
-    std::cout << "AudioProcessor destroyed" << std::endl;
+    LOG_INFO << "AudioProcessor destroyed";
 }
 
 void AudioProcessor::processAudioFrame(const std::vector<uint8_t>& frame) {
-    std::cout << "Processing audio frame of size: " << frame.size() << std::endl;
+    LOG_DEBUG << "Processing audio frame of size: " << frame.size();
 }
 
+// audio_data must be one Opus frame (2.5 to 120 ms of mono 48 kHz audio)
 std::vector<uint8_t> AudioProcessor::encodeOpus(const std::vector<float>& audio_data) {
-    std::cout << "Encoding " << audio_data.size() << " samples to Opus" << std::endl;
-    // Mock encoding - return dummy data
-    return std::vector<uint8_t>(audio_data.size(), 0x42);
+    std::vector<uint8_t> encoded(OpusCodec::kMaxPacketSize);
+    size_t size = codec_.EncodeFloat(kLegacyStreamId, audio_data.data(), audio_data.size(), encoded.data(), encoded.size());
+    encoded.resize(size);
+    return encoded;
 }
 
 std::vector<float> AudioProcessor::decodeOpus(const std::vector<uint8_t>& encoded_data) {
-    std::cout << "Decoding " << encoded_data.size() << " bytes from Opus" << std::endl;
-    // Mock decoding - return dummy data
-    return std::vector<float>(encoded_data.size(), 0.5f);
+    std::vector<float> decoded(OpusCodec::kMaxFrameSamples);
+    size_t samples = codec_.DecodeFloat(kLegacyStreamId, encoded_data.data(), encoded_data.size(), decoded.data(), decoded.size());
+    decoded.resize(samples);
+    return decoded;
+}
+
+size_t AudioProcessor::decodeOpusFrame(uint32_t stream_id, const uint8_t* data, size_t size, int16_t* pcm, size_t max_samples,
+                                       bool fec) {
+    return codec_.Decode(stream_id, data, size, pcm, max_samples, fec);
+}
+
+size_t AudioProcessor::encodeOpusFrame(uint32_t stream_id, const int16_t* pcm, size_t samples, uint8_t* out, size_t capacity) {
+    return codec_.Encode(stream_id, pcm, samples, out, capacity);
+}
+
+void AudioProcessor::releaseEncoder(uint32_t stream_id) {
+    codec_.ReleaseEncoder(stream_id);
+}
+
+void AudioProcessor::releaseDecoder(uint32_t stream_id) {
+    codec_.ReleaseDecoder(stream_id);
+}
+
+void AudioProcessor::releaseStream(uint32_t stream_id) {
+    codec_.ReleaseEncoder(stream_id);
+    codec_.ReleaseDecoder(stream_id);
+    releaseResampler(stream_id);
+    releaseNoiseSuppressor(stream_id);
+}
+
+size_t AudioProcessor::resample(uint32_t stream_id, int in_rate, int out_rate, const int16_t* in, size_t in_count,
+                                int16_t* out, size_t capacity) {
+    if (!Resampler::Supports(in_rate, out_rate)) {
+        return 0;
+    }
+    Resampler* resampler = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(resamplers_mutex_);
+        std::unique_ptr<Resampler>& slot = resamplers_[stream_id];
+        if (!slot || slot->InRate() != in_rate || slot->OutRate() != out_rate) {
+            slot = std::make_unique<Resampler>(in_rate, out_rate);
+        }
+        resampler = slot.get();
+    }
+    // Only this stream's thread uses its resampler
+    return resampler->Process(in, in_count, out, capacity);
+}
+
+void AudioProcessor::releaseResampler(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(resamplers_mutex_);
+    resamplers_.erase(stream_id);
 }
 
 void AudioProcessor::applyEchoCancellation(std::vector<float>& audio_data) {
-    std::cout << "Applying echo cancellation to " << audio_data.size() << " samples" << std::endl;
+    LOG_DEBUG << "Applying echo cancellation to " << audio_data.size() << " samples";
 }
 
 void AudioProcessor::applyNoiseReduction(std::vector<float>& audio_data) {
-    std::cout << "Applying noise reduction to " << audio_data.size() << " samples" << std::endl;
+    applyNoiseReduction(kLegacyStreamId, audio_data.data(), audio_data.size());
+}
+
+void AudioProcessor::applyNoiseReduction(uint32_t stream_id, float* data, size_t count) {
+    // Only this stream's thread uses its suppressor
+    acquireNoiseSuppressor(stream_id)->Process(data, count);
+}
+
+void AudioProcessor::applyNoiseReduction(uint32_t stream_id, int16_t* pcm, size_t count) {
+    acquireNoiseSuppressor(stream_id)->Process(pcm, count);
+}
+
+void AudioProcessor::releaseNoiseSuppressor(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(suppressors_mutex_);
+    suppressors_.erase(stream_id);
+}
+
+NoiseSuppressor* AudioProcessor::acquireNoiseSuppressor(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(suppressors_mutex_);
+    std::unique_ptr<NoiseSuppressor>& slot = suppressors_[stream_id];
+    if (!slot) {
+        slot = std::make_unique<NoiseSuppressor>();
+    }
+    return slot.get();
 }
 
 void AudioProcessor::applyVolumeControl(std::vector<float>& audio_data, float volume_level) {
-    std::cout << "Applying volume control (" << volume_level << ") to " << audio_data.size() << " samples" << std::endl;
-    for (auto& sample : audio_data) {
-        sample *= volume_level;
+    applyVolumeRamp(audio_data, volume_level, volume_level);
+}
+
+void AudioProcessor::applyVolumeRamp(std::vector<float>& audio_data, float from_level, float to_level) {
+    if (audio_data.empty()) {
+        return;
     }
+    const dsp::Kernels& kernels = dsp::Active();
+    float step = (to_level - from_level) / static_cast<float>(audio_data.size());
+    kernels.gain_ramp_f32(audio_data.data(), audio_data.size(), from_level, step);
+    kernels.clip_f32(audio_data.data(), audio_data.size(), 1.0f);
 }
 
 } // namespace driftway
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "channel_registry.h"
+#include "voice_channel.h"
+
+namespace driftway {
+
+ChannelRegistry::ChannelRegistry(size_t shard_count) : shard_bits_(0) {
+    while ((size_t{1} << shard_bits_) < shard_count) {
+        shard_bits_++;
+    }
+    shards_ = std::vector<Shard>(size_t{1} << shard_bits_);
+}
+
+ChannelRegistry::Shard& ChannelRegistry::ShardFor(const std::string& channel_id) {
+    return const_cast<Shard&>(static_cast<const ChannelRegistry*>(this)->ShardFor(channel_id));
+}
+
+const ChannelRegistry::Shard& ChannelRegistry::ShardFor(const std::string& channel_id) const {
+    if (shard_bits_ == 0) {
+        return shards_[0];
+    }
+    // Top bits of a multiplicative mix: the maps inside use the low bits
+    uint64_t hash = static_cast<uint64_t>(std::hash<std::string>{}(channel_id)) * 0x9E3779B97F4A7C15ULL;
+    return shards_[hash >> (64 - shard_bits_)];
+}
+
+std::shared_ptr<VoiceChannel> ChannelRegistry::Find(const std::string& channel_id) const {
+    const Shard& shard = ShardFor(channel_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.channels.find(channel_id);
+    if (it != shard.channels.end()) {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<VoiceChannel> ChannelRegistry::GetOrCreate(const std::string& channel_id, const Factory& factory,
+                                                           bool* created) {
+    Shard& shard = ShardFor(channel_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (created) {
+        *created = false;
+    }
+
+    auto it = shard.channels.find(channel_id);
+    if (it != shard.channels.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<VoiceChannel> channel = factory();
+    if (channel) {
+        shard.channels.emplace(channel_id, channel);
+        if (created) {
+            *created = true;
+        }
+    }
+    return channel;
+}
+
+std::shared_ptr<VoiceChannel> ChannelRegistry::Remove(const std::string& channel_id) {
+    return RemoveIf(channel_id, [](const VoiceChannel&) { return true; });
+}
+
+std::vector<std::shared_ptr<VoiceChannel>> ChannelRegistry::Snapshot() const {
+    std::vector<std::shared_ptr<VoiceChannel>> channels;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& entry : shard.channels) {
+            channels.push_back(entry.second);
+        }
+    }
+    return channels;
+}
+
+void ChannelRegistry::Clear() {
+    Sweep([](const VoiceChannel&) { return true; });
+}
+
+size_t ChannelRegistry::size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.channels.size();
+    }
+    return total;
+}
+
+} // namespace driftway
@@ -1,45 +1,366 @@
-#include <iostream>
-#include <vector>
-#include <cstdint>
-
-class OpusCodec {
-public:
-    static bool initialize() {
-        std::cout << "Opus codec initialized" << std::endl;
-        return true;
-    }
-    
-    static std::vector<uint8_t> encode(const std::vector<int16_t>& pcm_data) {
-        std::cout << "Encoding PCM data of size: " << pcm_data.size() << std::endl;
-        
-        // Mock encoding - just convert to bytes
-        std::vector<uint8_t> encoded;
-        encoded.reserve(pcm_data.size() * 2);
-        
-        for (int16_t sample : pcm_data) {
-            encoded.push_back(static_cast<uint8_t>(sample & 0xFF));
-            encoded.push_back(static_cast<uint8_t>((sample >> 8) & 0xFF));
-        }
-        
-        return encoded;
-    }
-    
-    static std::vector<int16_t> decode(const std::vector<uint8_t>& opus_data) {
-        std::cout << "Decoding Opus data of size: " << opus_data.size() << std::endl;
-        
-        // Mock decoding - convert bytes back to int16
-        std::vector<int16_t> decoded;
-        decoded.reserve(opus_data.size() / 2);
-        
-        for (size_t i = 0; i < opus_data.size() - 1; i += 2) {
-            int16_t sample = static_cast<int16_t>(opus_data[i] | (opus_data[i + 1] << 8));
-            decoded.push_back(sample);
-        }
-        
-        return decoded;
-    }
-    
-    static void cleanup() {
-        std::cout << "Opus codec cleanup" << std::endl;
-    }
-};
\ No newline at end of file
+#include "opus_codec.h"
+#include "logger.h"
+
+#include <opus.h>
+
+#include <algorithm>
+
+namespace driftway {
+
+namespace {
+
+// Released states kept for reuse beyond this are destroyed
+constexpr size_t kMaxPooledStates = 256;
+
+// Frame size assumed for concealment before a stream decoded anything
+constexpr int kDefaultFrameSamples = 960;
+
+void ApplyConfig(OpusEncoder* encoder, const OpusCodec::Config& config) {
+    opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(std::min(std::max(config.complexity, 0), 10)));
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(config.bitrate));
+    opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(config.fec ? 1 : 0));
+    opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(std::min(std::max(config.expected_loss_percent, 0), 100)));
+    opus_encoder_ctl(encoder, OPUS_SET_DTX(config.dtx ? 1 : 0));
+}
+
+} // namespace
+
+OpusCodec::OpusCodec() : OpusCodec(Config()) {
+}
+
+OpusCodec::OpusCodec(const Config& config) : config_(config), generation_(0) {
+    LOG_INFO << "Opus codec initialized (" << opus_get_version_string() << ", complexity " << config_.complexity
+              << ", " << config_.bitrate << " bps, FEC " << (config_.fec ? "on" : "off") << ", DTX "
+              << (config_.dtx ? "on" : "off") << ")";
+}
+
+OpusCodec::~OpusCodec() {
+    for (auto& pair : encoders_) {
+        opus_encoder_destroy(pair.second.encoder);
+    }
+    for (auto& pair : decoders_) {
+        opus_decoder_destroy(pair.second);
+    }
+    for (OpusEncoder* encoder : free_encoders_) {
+        opus_encoder_destroy(encoder);
+    }
+    for (OpusDecoder* decoder : free_decoders_) {
+        opus_decoder_destroy(decoder);
+    }
+}
+
+void OpusCodec::SetConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+OpusCodec::Config OpusCodec::GetConfig() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+OpusEncoder* OpusCodec::NewEncoder() {
+    if (!free_encoders_.empty()) {
+        OpusEncoder* encoder = free_encoders_.back();
+        free_encoders_.pop_back();
+        return encoder;
+    }
+
+    int error = OPUS_OK;
+    OpusEncoder* encoder = opus_encoder_create(kSampleRate, kChannels, OPUS_APPLICATION_VOIP, &error);
+    if (error != OPUS_OK || !encoder) {
+        LOG_ERROR << "Failed to create Opus encoder: " << opus_strerror(error);
+        return nullptr;
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+    return encoder;
+}
+
+OpusDecoder* OpusCodec::NewDecoder() {
+    if (!free_decoders_.empty()) {
+        OpusDecoder* decoder = free_decoders_.back();
+        free_decoders_.pop_back();
+        return decoder;
+    }
+
+    int error = OPUS_OK;
+    OpusDecoder* decoder = opus_decoder_create(kSampleRate, kChannels, &error);
+    if (error != OPUS_OK || !decoder) {
+        LOG_ERROR << "Failed to create Opus decoder: " << opus_strerror(error);
+        return nullptr;
+    }
+    return decoder;
+}
+
+void OpusCodec::PoolEncoder(OpusEncoder* encoder) {
+    if (free_encoders_.size() < kMaxPooledStates) {
+        opus_encoder_ctl(encoder, OPUS_RESET_STATE);
+        free_encoders_.push_back(encoder);
+    } else {
+        opus_encoder_destroy(encoder);
+    }
+}
+
+void OpusCodec::PoolDecoder(OpusDecoder* decoder) {
+    if (free_decoders_.size() < kMaxPooledStates) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        free_decoders_.push_back(decoder);
+    } else {
+        opus_decoder_destroy(decoder);
+    }
+}
+
+OpusCodec::StreamEncoder* OpusCodec::AcquireEncoder(uint32_t stream_id) {
+    auto it = encoders_.find(stream_id);
+    if (it != encoders_.end()) {
+        return &it->second;
+    }
+
+    OpusEncoder* encoder = NewEncoder();
+    if (!encoder) {
+        return nullptr;
+    }
+
+    // Done once per stream, so the lock is held for it
+    ApplyConfig(encoder, config_);
+    StreamEncoder& stream = encoders_[stream_id];
+    stream.encoder = encoder;
+    stream.generation = generation_.load(std::memory_order_relaxed);
+    stream.dtx = config_.dtx;
+    return &stream;
+}
+
+OpusDecoder* OpusCodec::AcquireDecoder(uint32_t stream_id) {
+    auto it = decoders_.find(stream_id);
+    if (it != decoders_.end()) {
+        return it->second;
+    }
+
+    OpusDecoder* decoder = NewDecoder();
+    if (decoder) {
+        decoders_[stream_id] = decoder;
+    }
+    return decoder;
+}
+
+bool OpusCodec::TakeEncoder(StreamEncoder* stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    OpusEncoder* encoder = NewEncoder();
+    if (!encoder) {
+        return false;
+    }
+    ApplyConfig(encoder, config_);
+    stream->encoder = encoder;
+    stream->generation = generation_.load(std::memory_order_relaxed);
+    stream->dtx = config_.dtx;
+    held_encoders_++;
+    return true;
+}
+
+void OpusCodec::ReturnEncoder(StreamEncoder* stream) {
+    if (!stream->encoder) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    PoolEncoder(stream->encoder);
+    stream->encoder = nullptr;
+    held_encoders_--;
+}
+
+OpusDecoder* OpusCodec::TakeDecoder() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    OpusDecoder* decoder = NewDecoder();
+    if (decoder) {
+        held_decoders_++;
+    }
+    return decoder;
+}
+
+void OpusCodec::ReturnDecoder(OpusDecoder* decoder) {
+    if (!decoder) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    PoolDecoder(decoder);
+    held_decoders_--;
+}
+
+// Applies settings changed since the stream's encoder last saw them. Only
+// the stream's thread touches its state, so ApplyConfig runs unlocked.
+void OpusCodec::RefreshEncoder(StreamEncoder& stream) {
+    if (stream.generation == generation_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    Config config;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config = config_;
+        stream.generation = generation_.load(std::memory_order_relaxed);
+    }
+    stream.dtx = config.dtx;
+    ApplyConfig(stream.encoder, config);
+}
+
+size_t OpusCodec::FinishEncode(const StreamEncoder& stream, int result) {
+    if (result < 0) {
+        encode_errors_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    // With DTX on, a 1-2 byte packet only says "still silent": not worth sending
+    if (stream.dtx && result <= 2) {
+        return 0;
+    }
+    return static_cast<size_t>(result);
+}
+
+size_t OpusCodec::Encode(uint32_t stream_id, const int16_t* pcm, size_t samples, uint8_t* out, size_t capacity) {
+    StreamEncoder* stream = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stream = AcquireEncoder(stream_id);
+    }
+    if (!stream) {
+        encode_errors_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    // Map nodes are stable, and only this stream's thread touches its state
+    return Encode(*stream, pcm, samples, out, capacity);
+}
+
+size_t OpusCodec::Encode(StreamEncoder& stream, const int16_t* pcm, size_t samples, uint8_t* out, size_t capacity) {
+    if (!stream.encoder) {
+        encode_errors_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    RefreshEncoder(stream);
+
+    int result = opus_encode(stream.encoder, pcm, static_cast<int>(samples), out,
+                             static_cast<opus_int32>(std::min(capacity, kMaxPacketSize)));
+    return FinishEncode(stream, result);
+}
+
+size_t OpusCodec::EncodeFloat(uint32_t stream_id, const float* pcm, size_t samples, uint8_t* out, size_t capacity) {
+    StreamEncoder* stream = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stream = AcquireEncoder(stream_id);
+    }
+    if (!stream) {
+        encode_errors_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    RefreshEncoder(*stream);
+
+    int result = opus_encode_float(stream->encoder, pcm, static_cast<int>(samples), out,
+                                   static_cast<opus_int32>(std::min(capacity, kMaxPacketSize)));
+    return FinishEncode(*stream, result);
+}
+
+size_t OpusCodec::FinishDecode(int result) {
+    if (result < 0) {
+        decode_errors_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    return static_cast<size_t>(result);
+}
+
+size_t OpusCodec::Decode(uint32_t stream_id, const uint8_t* data, size_t size, int16_t* pcm, size_t max_samples,
+                         bool fec) {
+    OpusDecoder* decoder = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoder = AcquireDecoder(stream_id);
+    }
+    return DecodeWith(decoder, data, size, pcm, max_samples, fec);
+}
+
+size_t OpusCodec::Decode(OpusDecoder* decoder, const uint8_t* data, size_t size, int16_t* pcm, size_t max_samples,
+                         bool fec) {
+    return DecodeWith(decoder, data, size, pcm, max_samples, fec);
+}
+
+size_t OpusCodec::DecodeWith(OpusDecoder* decoder, const uint8_t* data, size_t size, int16_t* pcm,
+                             size_t max_samples, bool fec) {
+    if (!decoder) {
+        decode_errors_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    int frame_size = static_cast<int>(std::min(max_samples, kMaxFrameSamples));
+    if (!data || fec) {
+        // Concealment and FEC must produce exactly the missing duration,
+        // which is taken to be that of the previous packet
+        opus_int32 last = 0;
+        opus_decoder_ctl(decoder, OPUS_GET_LAST_PACKET_DURATION(&last));
+        frame_size = std::min(frame_size, last > 0 ? static_cast<int>(last) : kDefaultFrameSamples);
+    }
+
+    int result = opus_decode(decoder, data, data ? static_cast<opus_int32>(size) : 0, pcm, frame_size,
+                             data && fec ? 1 : 0);
+    return FinishDecode(result);
+}
+
+size_t OpusCodec::DecodeFloat(uint32_t stream_id, const uint8_t* data, size_t size, float* pcm, size_t max_samples) {
+    OpusDecoder* decoder = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoder = AcquireDecoder(stream_id);
+    }
+    if (!decoder) {
+        decode_errors_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    int frame_size = static_cast<int>(std::min(max_samples, kMaxFrameSamples));
+    if (!data) {
+        opus_int32 last = 0;
+        opus_decoder_ctl(decoder, OPUS_GET_LAST_PACKET_DURATION(&last));
+        frame_size = std::min(frame_size, last > 0 ? static_cast<int>(last) : kDefaultFrameSamples);
+    }
+
+    int result = opus_decode_float(decoder, data, data ? static_cast<opus_int32>(size) : 0, pcm, frame_size, 0);
+    return FinishDecode(result);
+}
+
+void OpusCodec::ReleaseEncoder(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = encoders_.find(stream_id);
+    if (it == encoders_.end()) {
+        return;
+    }
+
+    OpusEncoder* encoder = it->second.encoder;
+    encoders_.erase(it);
+    PoolEncoder(encoder);
+}
+
+void OpusCodec::ReleaseDecoder(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = decoders_.find(stream_id);
+    if (it == decoders_.end()) {
+        return;
+    }
+
+    OpusDecoder* decoder = it->second;
+    decoders_.erase(it);
+    PoolDecoder(decoder);
+}
+
+OpusCodec::Stats OpusCodec::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Stats stats;
+    stats.encoders = encoders_.size() + held_encoders_;
+    stats.decoders = decoders_.size() + held_decoders_;
+    stats.pooled_encoders = free_encoders_.size();
+    stats.pooled_decoders = free_decoders_.size();
+    stats.encode_errors = encode_errors_.load(std::memory_order_relaxed);
+    stats.decode_errors = decode_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace driftway
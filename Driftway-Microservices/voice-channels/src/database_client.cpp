@@ -1,13 +1,35 @@
-#include <iostream>
 #include <string>
 #include <vector>
 #include "database_client.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 
 namespace driftway {
 
-DatabaseClient::DatabaseClient(const std::string& uri) : connection_uri_(uri), connected_(false) {
-    std::cout << "Connecting to database: " << uri << std::endl;
+namespace {
+
+// Retry delay after a failed bulk write, doubling per failure
+constexpr uint32_t kMinRetryMs = 100;
+constexpr uint32_t kMaxRetryMs = 5000;
+
+uint64_t UnixMillis() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::system_clock::now().time_since_epoch())
+                                     .count());
+}
+
+} // namespace
+
+DatabaseClient::DatabaseClient(const std::string& uri, size_t batch_size, uint32_t flush_interval_ms,
+                               size_t max_queued)
+    : connection_uri_(uri), batch_size_(std::max<size_t>(batch_size, 1)), flush_interval_ms_(flush_interval_ms),
+      max_queued_(max_queued) {
+    LOG_INFO << "Connecting to database: " << uri;
     connected_ = true;  // Simulate successful connection
+    flusher_ = std::thread(&DatabaseClient::FlushLoop, this);
 }
 
 DatabaseClient::~DatabaseClient() {
@@ -15,43 +37,200 @@ DatabaseClient::~DatabaseClient() {
 }
 
 bool DatabaseClient::IsConnected() const {
-    return connected_;
+    return connected_.load(std::memory_order_relaxed);
 }
 
 void DatabaseClient::disconnect() {
-    if (connected_) {
-        std::cout << "Disconnecting from database" << std::endl;
-        connected_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    if (connected_.exchange(false)) {
+        LOG_INFO << "Disconnecting from database";
     }
 }
 
 bool DatabaseClient::createChannel(const std::string& channel_name, int owner_id) {
-    std::cout << "Creating channel: " << channel_name << " for owner: " << owner_id << std::endl;
+    LOG_INFO << "Creating channel: " << channel_name << " for owner: " << owner_id;
     return true;
 }
 
 bool DatabaseClient::deleteChannel(int channel_id) {
-    std::cout << "Deleting channel: " << channel_id << std::endl;
+    LOG_INFO << "Deleting channel: " << channel_id;
     return true;
 }
 
 std::vector<int> DatabaseClient::getChannelParticipants(int channel_id) {
-    std::cout << "Getting participants for channel: " << channel_id << std::endl;
+    LOG_DEBUG << "Getting participants for channel: " << channel_id;
     return std::vector<int>{1, 2, 3}; // Mock data
 }
 
-bool DatabaseClient::addParticipant(int channel_id, int user_id) {
-    std::cout << "Adding participant " << user_id << " to channel " << channel_id << std::endl;
+bool DatabaseClient::addParticipant(const std::string& channel_id, const std::string& user_id) {
+    return QueueParticipant(channel_id, user_id, true);
+}
+
+bool DatabaseClient::removeParticipant(const std::string& channel_id, const std::string& user_id) {
+    return QueueParticipant(channel_id, user_id, false);
+}
+
+bool DatabaseClient::QueueParticipant(const std::string& channel_id, const std::string& user_id, bool joined) {
+    std::string key = channel_id + '\n' + user_id;
+    uint64_t now_ms = UnixMillis();
+    WriteType type = joined ? WriteType::kAddParticipant : WriteType::kRemoveParticipant;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        dropped_++;
+        return false;
+    }
+
+    auto it = participants_.find(key);
+    if (it != participants_.end()) {
+        // Changes to a pending key never add to the queue, so they are
+        // accepted even when it is full
+        accepted_++;
+        collapsed_++;
+        if (!joined && it->second.cancellable && it->second.write.type == WriteType::kAddParticipant) {
+            // Joined and left again before the join was written
+            participants_.erase(it);
+        } else {
+            it->second.write.type = type;
+            it->second.write.time_ms = now_ms;
+            it->second.cancellable = false;
+        }
+        return true;
+    }
+
+    if (QueuedLocked() >= max_queued_) {
+        dropped_++;
+        return false;
+    }
+    participants_.emplace(std::move(key), PendingParticipant{Write{type, channel_id, user_id, {}, now_ms}, joined});
+    accepted_++;
+    size_t queued = QueuedLocked();
+    queued_peak_ = std::max(queued_peak_, queued);
+    if (queued == batch_size_) {
+        wake_.notify_one();
+    }
     return true;
 }
 
-bool DatabaseClient::removeParticipant(int channel_id, int user_id) {
-    std::cout << "Removing participant " << user_id << " from channel " << channel_id << std::endl;
+bool DatabaseClient::logActivity(const std::string& activity) {
+    LOG_DEBUG << "Database activity: " << activity;
+    uint64_t now_ms = UnixMillis();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Activity is shed first, leaving the last quarter for participants
+    if (stopping_ || QueuedLocked() >= max_queued_ - max_queued_ / 4) {
+        dropped_++;
+        return false;
+    }
+    activity_.push_back(Write{WriteType::kActivity, {}, {}, activity, now_ms});
+    accepted_++;
+    size_t queued = QueuedLocked();
+    queued_peak_ = std::max(queued_peak_, queued);
+    if (queued == batch_size_) {
+        wake_.notify_one();
+    }
     return true;
 }
 
-void DatabaseClient::logActivity(const std::string& activity) {
-    std::cout << "Database activity: " << activity << std::endl;
+DatabaseClient::Stats DatabaseClient::getStats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.queued = QueuedLocked();
+        stats.queued_peak = queued_peak_;
+    }
+    stats.accepted = accepted_.load(std::memory_order_relaxed);
+    stats.collapsed = collapsed_.load(std::memory_order_relaxed);
+    stats.written = written_.load(std::memory_order_relaxed);
+    stats.batches = batches_.load(std::memory_order_relaxed);
+    stats.failed_batches = failed_batches_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Up to batch_size_ records: a failed batch first, as it was, then
+// participant changes, then activity. Called with mutex_ held.
+void DatabaseClient::TakeBatch(std::vector<Write>* batch) {
+    batch->swap(retry_);
+    for (auto it = participants_.begin(); it != participants_.end() && batch->size() < batch_size_;) {
+        batch->push_back(std::move(it->second.write));
+        it = participants_.erase(it);
+    }
+    size_t take = std::min(activity_.size(), batch_size_ - std::min(batch->size(), batch_size_));
+    std::move(activity_.begin(), activity_.begin() + take, std::back_inserter(*batch));
+    activity_.erase(activity_.begin(), activity_.begin() + take);
+}
+
+bool DatabaseClient::WriteBatch(const std::vector<Write>& batch) {
+    bool ok;
+    if (writer_) {
+        ok = writer_(batch);
+    } else {
+        LOG_DEBUG << "Bulk write of " << batch.size() << " records";
+        ok = true;
+    }
+
+    if (ok) {
+        written_ += batch.size();
+        batches_++;
+    } else {
+        failed_batches_++;
+    }
+    if (connected_.exchange(ok) != ok) {
+        if (ok) {
+            LOG_INFO << "Database writes recovered";
+        } else {
+            LOG_WARN << "Bulk write of " << batch.size() << " records failed, retrying";
+        }
+    }
+    return ok;
+}
+
+// Sleeps until a batch fills up or the flush interval passes, then writes
+// everything queued. After a failure the batch is kept and retried after a
+// growing delay, while newer records keep coalescing behind it.
+void DatabaseClient::FlushLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint32_t retry_ms = 0;
+
+    while (true) {
+        auto wait = std::chrono::milliseconds(retry_ms != 0 ? retry_ms : flush_interval_ms_);
+        wake_.wait_for(lock, wait, [&]() { return stopping_ || (retry_ms == 0 && QueuedLocked() >= batch_size_); });
+        bool stopping = stopping_;
+
+        while (QueuedLocked() > 0) {
+            std::vector<Write> batch;
+            TakeBatch(&batch);
+            lock.unlock();
+            bool ok = WriteBatch(batch);
+            lock.lock();
+            if (!ok) {
+                retry_.swap(batch);
+                retry_ms = retry_ms == 0 ? kMinRetryMs : std::min(retry_ms * 2, kMaxRetryMs);
+                break;
+            }
+            retry_ms = 0;
+        }
+
+        if (stopping) {
+            size_t lost = QueuedLocked();
+            if (lost > 0) {
+                LOG_WARN << "Dropping " << lost << " database writes at shutdown";
+                dropped_ += lost;
+                participants_.clear();
+                activity_.clear();
+                retry_.clear();
+            }
+            return;
+        }
+    }
 }
 
-} // namespace driftway
\ No newline at end of file
+} // namespace driftway
@@ -0,0 +1,217 @@
+#include "dsp_kernels.h"
+#include "kernels_internal.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace driftway {
+namespace dsp {
+
+namespace scalar {
+
+void AccumulateS16(int32_t* acc, const int16_t* in, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] += in[i];
+    }
+}
+
+void MixMinusS16(int16_t* out, const int32_t* acc, const int16_t* self, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        int32_t sample = self ? acc[i] - self[i] : acc[i];
+        out[i] = static_cast<int16_t>(std::min(std::max(sample, -32768), 32767));
+    }
+}
+
+void S16ToF32(float* out, const int16_t* in, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<float>(in[i]) * kS16ToFloat;
+    }
+}
+
+void F32ToS16(int16_t* out, const float* in, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        float sample = std::min(std::max(in[i] * kFloatToS16, -32768.0f), 32767.0f);
+        out[i] = static_cast<int16_t>(std::nearbyint(sample));
+    }
+}
+
+void GainRampF32(float* data, size_t count, float start, float step) {
+    for (size_t i = 0; i < count; ++i) {
+        data[i] *= start + step * static_cast<float>(i);
+    }
+}
+
+void MixF32(float* acc, const float* in, size_t count, float gain) {
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] += in[i] * gain;
+    }
+}
+
+void ClipF32(float* data, size_t count, float limit) {
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = std::min(std::max(data[i], -limit), limit);
+    }
+}
+
+float PeakF32(const float* in, size_t count) {
+    float peak = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        peak = std::max(peak, std::fabs(in[i]));
+    }
+    return peak;
+}
+
+float SumSquaresF32(const float* in, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        sum += in[i] * in[i];
+    }
+    return sum;
+}
+
+float DotF32(const float* a, const float* b, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void FftButterflyF32(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count, size_t x_stride,
+                     size_t y_stride, float w_re, float w_im) {
+    for (size_t i = 0; i < count; ++i) {
+        float a_re = x_re[i];
+        float a_im = x_im[i];
+        float b_re = x_re[i + x_stride];
+        float b_im = x_im[i + x_stride];
+        y_re[i] = a_re + b_re;
+        y_im[i] = a_im + b_im;
+        float d_re = a_re - b_re;
+        float d_im = a_im - b_im;
+        y_re[i + y_stride] = d_re * w_re - d_im * w_im;
+        y_im[i + y_stride] = d_re * w_im + d_im * w_re;
+    }
+}
+
+void ComplexMulF32(float* re, float* im, const float* w_re, const float* w_im, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        float r = re[i] * w_re[i] - im[i] * w_im[i];
+        im[i] = re[i] * w_im[i] + im[i] * w_re[i];
+        re[i] = r;
+    }
+}
+
+} // namespace scalar
+
+namespace {
+
+const Kernels kScalarKernels = {
+    Isa::kScalar, "scalar",
+    scalar::AccumulateS16,
+    scalar::MixMinusS16,
+    scalar::S16ToF32,
+    scalar::F32ToS16,
+    scalar::GainRampF32,
+    scalar::MixF32,
+    scalar::ClipF32,
+    scalar::PeakF32,
+    scalar::SumSquaresF32,
+    scalar::DotF32,
+    scalar::FftButterflyF32,
+    scalar::ComplexMulF32,
+};
+
+const Kernels kSse42Kernels = {
+    Isa::kSse42, "sse4.2",
+    sse42::AccumulateS16,
+    sse42::MixMinusS16,
+    sse42::S16ToF32,
+    sse42::F32ToS16,
+    sse42::GainRampF32,
+    sse42::MixF32,
+    sse42::ClipF32,
+    sse42::PeakF32,
+    sse42::SumSquaresF32,
+    sse42::DotF32,
+    sse42::FftButterflyF32,
+    sse42::ComplexMulF32,
+};
+
+const Kernels kAvx2Kernels = {
+    Isa::kAvx2, "avx2",
+    avx2::AccumulateS16,
+    avx2::MixMinusS16,
+    avx2::S16ToF32,
+    avx2::F32ToS16,
+    avx2::GainRampF32,
+    avx2::MixF32,
+    avx2::ClipF32,
+    avx2::PeakF32,
+    avx2::SumSquaresF32,
+    avx2::DotF32,
+    avx2::FftButterflyF32,
+    avx2::ComplexMulF32,
+};
+
+const Kernels kAvx512Kernels = {
+    Isa::kAvx512, "avx512",
+    avx512::AccumulateS16,
+    avx512::MixMinusS16,
+    avx512::S16ToF32,
+    avx512::F32ToS16,
+    avx512::GainRampF32,
+    avx512::MixF32,
+    avx512::ClipF32,
+    avx512::PeakF32,
+    avx512::SumSquaresF32,
+    avx512::DotF32,
+    avx512::FftButterflyF32,
+    avx512::ComplexMulF32,
+};
+
+bool HasAvx512() {
+    return __builtin_cpu_supports("avx512f");
+}
+
+const Kernels& Select() {
+    __builtin_cpu_init();
+    if (HasAvx512()) {
+        return kAvx512Kernels;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return kAvx2Kernels;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return kSse42Kernels;
+    }
+    return kScalarKernels;
+}
+
+} // namespace
+
+const Kernels& Active() {
+    static const Kernels& active = Select();
+    return active;
+}
+
+const Kernels* ForIsa(Isa isa) {
+    __builtin_cpu_init();
+    switch (isa) {
+    case Isa::kScalar:
+        return &kScalarKernels;
+    case Isa::kSse42:
+        return __builtin_cpu_supports("sse4.2") ? &kSse42Kernels : nullptr;
+    case Isa::kAvx2:
+        return __builtin_cpu_supports("avx2") ? &kAvx2Kernels : nullptr;
+    case Isa::kAvx512:
+        return HasAvx512() ? &kAvx512Kernels : nullptr;
+    }
+    return nullptr;
+}
+
+float Rms(const float* in, size_t count) {
+    return count == 0 ? 0.0f : std::sqrt(Active().sum_squares_f32(in, count) / static_cast<float>(count));
+}
+
+} // namespace dsp
+} // namespace driftway
@@ -0,0 +1,186 @@
+#include "kernels_internal.h"
+
+#include <immintrin.h>
+
+namespace driftway {
+namespace dsp {
+namespace avx2 {
+
+void AccumulateS16(int32_t* acc, const int16_t* in, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i samples = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(samples));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(samples, 1));
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), lo));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), hi));
+    }
+    sse42::AccumulateS16(acc + i, in + i, count - i);
+}
+
+void MixMinusS16(int16_t* out, const int32_t* acc, const int16_t* self, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i + 8));
+        if (self) {
+            __m256i own = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(self + i));
+            lo = _mm256_sub_epi32(lo, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(own)));
+            hi = _mm256_sub_epi32(hi, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(own, 1)));
+        }
+        // packs works per 128-bit lane; restore sample order afterwards
+        __m256i packed = _mm256_packs_epi32(lo, hi);
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    sse42::MixMinusS16(out + i, acc + i, self ? self + i : nullptr, count - i);
+}
+
+void S16ToF32(float* out, const int16_t* in, size_t count) {
+    const __m256 scale = _mm256_set1_ps(kS16ToFloat);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i samples = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(samples)));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(samples, 1)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(lo, scale));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(hi, scale));
+    }
+    sse42::S16ToF32(out + i, in + i, count - i);
+}
+
+void F32ToS16(int16_t* out, const float* in, size_t count) {
+    const __m256 scale = _mm256_set1_ps(kFloatToS16);
+    const __m256 low = _mm256_set1_ps(-32768.0f);
+    const __m256 high = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        // Clamp first: out-of-range floats convert to INT32_MIN
+        __m256 lo = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), low), high);
+        __m256 hi = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale), low), high);
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    sse42::F32ToS16(out + i, in + i, count - i);
+}
+
+void GainRampF32(float* data, size_t count, float start, float step) {
+    const __m256 lanes = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    const __m256 base = _mm256_set1_ps(start);
+    const __m256 slope = _mm256_set1_ps(step);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 index = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lanes);
+        __m256 gain = _mm256_add_ps(base, _mm256_mul_ps(slope, index));
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), gain));
+    }
+    for (; i < count; ++i) {
+        data[i] *= start + step * static_cast<float>(i);
+    }
+}
+
+void MixF32(float* acc, const float* in, size_t count, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(in + i), g));
+        _mm256_storeu_ps(acc + i, sum);
+    }
+    sse42::MixF32(acc + i, in + i, count - i, gain);
+}
+
+void ClipF32(float* data, size_t count, float limit) {
+    const __m256 low = _mm256_set1_ps(-limit);
+    const __m256 high = _mm256_set1_ps(limit);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(data + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(data + i), low), high));
+    }
+    sse42::ClipF32(data + i, count - i, limit);
+}
+
+float PeakF32(const float* in, size_t count) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 peak = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        peak = _mm256_max_ps(peak, _mm256_andnot_ps(sign, _mm256_loadu_ps(in + i)));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, peak);
+    float result = sse42::PeakF32(lanes, 8);
+    float tail = sse42::PeakF32(in + i, count - i);
+    return tail > result ? tail : result;
+}
+
+float SumSquaresF32(const float* in, size_t count) {
+    // Two accumulators hide the add latency
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 x0 = _mm256_loadu_ps(in + i);
+        __m256 x1 = _mm256_loadu_ps(in + i + 8);
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(x0, x0));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(x1, x1));
+    }
+    __m256 sum = _mm256_add_ps(sum0, sum1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half) + sse42::SumSquaresF32(in + i, count - i);
+}
+
+float DotF32(const float* a, const float* b, size_t count) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    __m256 sum = _mm256_add_ps(sum0, sum1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half) + sse42::DotF32(a + i, b + i, count - i);
+}
+
+void FftButterflyF32(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count, size_t x_stride,
+                     size_t y_stride, float w_re, float w_im) {
+    const __m256 wr = _mm256_set1_ps(w_re);
+    const __m256 wi = _mm256_set1_ps(w_im);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 a_re = _mm256_loadu_ps(x_re + i);
+        __m256 a_im = _mm256_loadu_ps(x_im + i);
+        __m256 b_re = _mm256_loadu_ps(x_re + i + x_stride);
+        __m256 b_im = _mm256_loadu_ps(x_im + i + x_stride);
+        _mm256_storeu_ps(y_re + i, _mm256_add_ps(a_re, b_re));
+        _mm256_storeu_ps(y_im + i, _mm256_add_ps(a_im, b_im));
+        __m256 d_re = _mm256_sub_ps(a_re, b_re);
+        __m256 d_im = _mm256_sub_ps(a_im, b_im);
+        _mm256_storeu_ps(y_re + i + y_stride, _mm256_sub_ps(_mm256_mul_ps(d_re, wr), _mm256_mul_ps(d_im, wi)));
+        _mm256_storeu_ps(y_im + i + y_stride, _mm256_add_ps(_mm256_mul_ps(d_re, wi), _mm256_mul_ps(d_im, wr)));
+    }
+    sse42::FftButterflyF32(y_re + i, y_im + i, x_re + i, x_im + i, count - i, x_stride, y_stride, w_re, w_im);
+}
+
+void ComplexMulF32(float* re, float* im, const float* w_re, const float* w_im, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 r = _mm256_loadu_ps(re + i);
+        __m256 m = _mm256_loadu_ps(im + i);
+        __m256 wr = _mm256_loadu_ps(w_re + i);
+        __m256 wi = _mm256_loadu_ps(w_im + i);
+        _mm256_storeu_ps(re + i, _mm256_sub_ps(_mm256_mul_ps(r, wr), _mm256_mul_ps(m, wi)));
+        _mm256_storeu_ps(im + i, _mm256_add_ps(_mm256_mul_ps(r, wi), _mm256_mul_ps(m, wr)));
+    }
+    sse42::ComplexMulF32(re + i, im + i, w_re + i, w_im + i, count - i);
+}
+
+} // namespace avx2
+} // namespace dsp
+} // namespace driftway
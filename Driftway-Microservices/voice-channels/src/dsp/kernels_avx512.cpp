@@ -0,0 +1,186 @@
+#include "kernels_internal.h"
+
+#include <immintrin.h>
+
+namespace driftway {
+namespace dsp {
+namespace avx512 {
+
+namespace {
+
+// Lanes [0, count) of a 16-lane vector, for float tails
+__mmask16 TailMask(size_t count) {
+    return static_cast<__mmask16>((1u << count) - 1);
+}
+
+} // namespace
+
+void AccumulateS16(int32_t* acc, const int16_t* in, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i samples = _mm512_loadu_si512(in + i);
+        __m512i lo = _mm512_cvtepi16_epi32(_mm512_castsi512_si256(samples));
+        __m512i hi = _mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(samples, 1));
+        _mm512_storeu_si512(acc + i, _mm512_add_epi32(_mm512_loadu_si512(acc + i), lo));
+        _mm512_storeu_si512(acc + i + 16, _mm512_add_epi32(_mm512_loadu_si512(acc + i + 16), hi));
+    }
+    avx2::AccumulateS16(acc + i, in + i, count - i);
+}
+
+void MixMinusS16(int16_t* out, const int32_t* acc, const int16_t* self, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i sum = _mm512_loadu_si512(acc + i);
+        if (self) {
+            __m256i own = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(self + i));
+            sum = _mm512_sub_epi32(sum, _mm512_cvtepi16_epi32(own));
+        }
+        // Saturating narrow keeps sample order, unlike packs
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm512_cvtsepi32_epi16(sum));
+    }
+    avx2::MixMinusS16(out + i, acc + i, self ? self + i : nullptr, count - i);
+}
+
+void S16ToF32(float* out, const int16_t* in, size_t count) {
+    const __m512 scale = _mm512_set1_ps(kS16ToFloat);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i samples = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(samples)), scale));
+    }
+    avx2::S16ToF32(out + i, in + i, count - i);
+}
+
+void F32ToS16(int16_t* out, const float* in, size_t count) {
+    const __m512 scale = _mm512_set1_ps(kFloatToS16);
+    const __m512 low = _mm512_set1_ps(-32768.0f);
+    const __m512 high = _mm512_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        // Clamp first: out-of-range floats convert to INT32_MIN
+        __m512 x = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(in + i), scale), low), high);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(x)));
+    }
+    avx2::F32ToS16(out + i, in + i, count - i);
+}
+
+void GainRampF32(float* data, size_t count, float start, float step) {
+    const __m512 lanes = _mm512_set_ps(15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f,
+                                       7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    const __m512 base = _mm512_set1_ps(start);
+    const __m512 slope = _mm512_set1_ps(step);
+    for (size_t i = 0; i < count; i += 16) {
+        __mmask16 mask = count - i >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(count - i);
+        __m512 index = _mm512_add_ps(_mm512_set1_ps(static_cast<float>(i)), lanes);
+        __m512 gain = _mm512_add_ps(base, _mm512_mul_ps(slope, index));
+        _mm512_mask_storeu_ps(data + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, data + i), gain));
+    }
+}
+
+void MixF32(float* acc, const float* in, size_t count, float gain) {
+    const __m512 g = _mm512_set1_ps(gain);
+    for (size_t i = 0; i < count; i += 16) {
+        __mmask16 mask = count - i >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(count - i);
+        __m512 sum = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, acc + i),
+                                   _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, in + i), g));
+        _mm512_mask_storeu_ps(acc + i, mask, sum);
+    }
+}
+
+void ClipF32(float* data, size_t count, float limit) {
+    const __m512 low = _mm512_set1_ps(-limit);
+    const __m512 high = _mm512_set1_ps(limit);
+    for (size_t i = 0; i < count; i += 16) {
+        __mmask16 mask = count - i >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(count - i);
+        __m512 x = _mm512_maskz_loadu_ps(mask, data + i);
+        _mm512_mask_storeu_ps(data + i, mask, _mm512_min_ps(_mm512_max_ps(x, low), high));
+    }
+}
+
+float PeakF32(const float* in, size_t count) {
+    // Masked-off lanes load as 0, which never raises the peak
+    __m512 peak = _mm512_setzero_ps();
+    for (size_t i = 0; i < count; i += 16) {
+        __mmask16 mask = count - i >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(count - i);
+        peak = _mm512_max_ps(peak, _mm512_abs_ps(_mm512_maskz_loadu_ps(mask, in + i)));
+    }
+    float lanes[16];
+    _mm512_storeu_ps(lanes, peak);
+    return avx2::PeakF32(lanes, 16);
+}
+
+float SumSquaresF32(const float* in, size_t count) {
+    // Two accumulators hide the add latency
+    __m512 sum0 = _mm512_setzero_ps();
+    __m512 sum1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512 x0 = _mm512_loadu_ps(in + i);
+        __m512 x1 = _mm512_loadu_ps(in + i + 16);
+        sum0 = _mm512_add_ps(sum0, _mm512_mul_ps(x0, x0));
+        sum1 = _mm512_add_ps(sum1, _mm512_mul_ps(x1, x1));
+    }
+    for (; i < count; i += 16) {
+        __mmask16 mask = count - i >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(count - i);
+        __m512 x = _mm512_maskz_loadu_ps(mask, in + i);
+        sum0 = _mm512_add_ps(sum0, _mm512_mul_ps(x, x));
+    }
+    float lanes[16];
+    _mm512_storeu_ps(lanes, _mm512_add_ps(sum0, sum1));
+    float total = 0.0f;
+    for (float lane : lanes) {
+        total += lane;
+    }
+    return total;
+}
+
+float DotF32(const float* a, const float* b, size_t count) {
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t i = 0; i < count; i += 16) {
+        __mmask16 mask = count - i >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(count - i);
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i)));
+    }
+    float lanes[16];
+    _mm512_storeu_ps(lanes, sum);
+    float total = 0.0f;
+    for (float lane : lanes) {
+        total += lane;
+    }
+    return total;
+}
+
+void FftButterflyF32(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count, size_t x_stride,
+                     size_t y_stride, float w_re, float w_im) {
+    const __m512 wr = _mm512_set1_ps(w_re);
+    const __m512 wi = _mm512_set1_ps(w_im);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 a_re = _mm512_loadu_ps(x_re + i);
+        __m512 a_im = _mm512_loadu_ps(x_im + i);
+        __m512 b_re = _mm512_loadu_ps(x_re + i + x_stride);
+        __m512 b_im = _mm512_loadu_ps(x_im + i + x_stride);
+        _mm512_storeu_ps(y_re + i, _mm512_add_ps(a_re, b_re));
+        _mm512_storeu_ps(y_im + i, _mm512_add_ps(a_im, b_im));
+        __m512 d_re = _mm512_sub_ps(a_re, b_re);
+        __m512 d_im = _mm512_sub_ps(a_im, b_im);
+        _mm512_storeu_ps(y_re + i + y_stride, _mm512_fmsub_ps(d_re, wr, _mm512_mul_ps(d_im, wi)));
+        _mm512_storeu_ps(y_im + i + y_stride, _mm512_fmadd_ps(d_re, wi, _mm512_mul_ps(d_im, wr)));
+    }
+    avx2::FftButterflyF32(y_re + i, y_im + i, x_re + i, x_im + i, count - i, x_stride, y_stride, w_re, w_im);
+}
+
+void ComplexMulF32(float* re, float* im, const float* w_re, const float* w_im, size_t count) {
+    for (size_t i = 0; i < count; i += 16) {
+        __mmask16 mask = count - i >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(count - i);
+        __m512 r = _mm512_maskz_loadu_ps(mask, re + i);
+        __m512 m = _mm512_maskz_loadu_ps(mask, im + i);
+        __m512 wr = _mm512_maskz_loadu_ps(mask, w_re + i);
+        __m512 wi = _mm512_maskz_loadu_ps(mask, w_im + i);
+        _mm512_mask_storeu_ps(re + i, mask, _mm512_fmsub_ps(r, wr, _mm512_mul_ps(m, wi)));
+        _mm512_mask_storeu_ps(im + i, mask, _mm512_fmadd_ps(r, wi, _mm512_mul_ps(m, wr)));
+    }
+}
+
+} // namespace avx512
+} // namespace dsp
+} // namespace driftway
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Per-instruction-set kernel entry points. Each group lives in its own
+// translation unit, compiled with only that instruction set enabled.
+
+namespace driftway {
+namespace dsp {
+
+// int16 <-> float scale; float samples are full scale at +-1.0
+constexpr float kFloatToS16 = 32768.0f;
+constexpr float kS16ToFloat = 1.0f / 32768.0f;
+
+namespace scalar {
+void AccumulateS16(int32_t* acc, const int16_t* in, size_t count);
+void MixMinusS16(int16_t* out, const int32_t* acc, const int16_t* self, size_t count);
+void S16ToF32(float* out, const int16_t* in, size_t count);
+void F32ToS16(int16_t* out, const float* in, size_t count);
+void GainRampF32(float* data, size_t count, float start, float step);
+void MixF32(float* acc, const float* in, size_t count, float gain);
+void ClipF32(float* data, size_t count, float limit);
+float PeakF32(const float* in, size_t count);
+float SumSquaresF32(const float* in, size_t count);
+float DotF32(const float* a, const float* b, size_t count);
+void FftButterflyF32(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count, size_t x_stride,
+                     size_t y_stride, float w_re, float w_im);
+void ComplexMulF32(float* re, float* im, const float* w_re, const float* w_im, size_t count);
+} // namespace scalar
+
+namespace sse42 {
+void AccumulateS16(int32_t* acc, const int16_t* in, size_t count);
+void MixMinusS16(int16_t* out, const int32_t* acc, const int16_t* self, size_t count);
+void S16ToF32(float* out, const int16_t* in, size_t count);
+void F32ToS16(int16_t* out, const float* in, size_t count);
+void GainRampF32(float* data, size_t count, float start, float step);
+void MixF32(float* acc, const float* in, size_t count, float gain);
+void ClipF32(float* data, size_t count, float limit);
+float PeakF32(const float* in, size_t count);
+float SumSquaresF32(const float* in, size_t count);
+float DotF32(const float* a, const float* b, size_t count);
+void FftButterflyF32(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count, size_t x_stride,
+                     size_t y_stride, float w_re, float w_im);
+void ComplexMulF32(float* re, float* im, const float* w_re, const float* w_im, size_t count);
+} // namespace sse42
+
+namespace avx2 {
+void AccumulateS16(int32_t* acc, const int16_t* in, size_t count);
+void MixMinusS16(int16_t* out, const int32_t* acc, const int16_t* self, size_t count);
+void S16ToF32(float* out, const int16_t* in, size_t count);
+void F32ToS16(int16_t* out, const float* in, size_t count);
+void GainRampF32(float* data, size_t count, float start, float step);
+void MixF32(float* acc, const float* in, size_t count, float gain);
+void ClipF32(float* data, size_t count, float limit);
+float PeakF32(const float* in, size_t count);
+float SumSquaresF32(const float* in, size_t count);
+float DotF32(const float* a, const float* b, size_t count);
+void FftButterflyF32(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count, size_t x_stride,
+                     size_t y_stride, float w_re, float w_im);
+void ComplexMulF32(float* re, float* im, const float* w_re, const float* w_im, size_t count);
+} // namespace avx2
+
+namespace avx512 {
+void AccumulateS16(int32_t* acc, const int16_t* in, size_t count);
+void MixMinusS16(int16_t* out, const int32_t* acc, const int16_t* self, size_t count);
+void S16ToF32(float* out, const int16_t* in, size_t count);
+void F32ToS16(int16_t* out, const float* in, size_t count);
+void GainRampF32(float* data, size_t count, float start, float step);
+void MixF32(float* acc, const float* in, size_t count, float gain);
+void ClipF32(float* data, size_t count, float limit);
+float PeakF32(const float* in, size_t count);
+float SumSquaresF32(const float* in, size_t count);
+float DotF32(const float* a, const float* b, size_t count);
+void FftButterflyF32(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count, size_t x_stride,
+                     size_t y_stride, float w_re, float w_im);
+void ComplexMulF32(float* re, float* im, const float* w_re, const float* w_im, size_t count);
+} // namespace avx512
+
+} // namespace dsp
+} // namespace driftway
@@ -0,0 +1,177 @@
+#include "kernels_internal.h"
+
+#include <smmintrin.h>
+
+namespace driftway {
+namespace dsp {
+namespace sse42 {
+
+void AccumulateS16(int32_t* acc, const int16_t* in, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i lo = _mm_cvtepi16_epi32(samples);
+        __m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(samples, 8));
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), lo));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), hi));
+    }
+    for (; i < count; ++i) {
+        acc[i] += in[i];
+    }
+}
+
+void MixMinusS16(int16_t* out, const int32_t* acc, const int16_t* self, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i + 4));
+        if (self) {
+            __m128i own = _mm_loadu_si128(reinterpret_cast<const __m128i*>(self + i));
+            lo = _mm_sub_epi32(lo, _mm_cvtepi16_epi32(own));
+            hi = _mm_sub_epi32(hi, _mm_cvtepi16_epi32(_mm_srli_si128(own, 8)));
+        }
+        // packs saturates each lane to int16
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+    }
+    scalar::MixMinusS16(out + i, acc + i, self ? self + i : nullptr, count - i);
+}
+
+void S16ToF32(float* out, const int16_t* in, size_t count) {
+    const __m128 scale = _mm_set1_ps(kS16ToFloat);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(samples));
+        __m128 hi = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(samples, 8)));
+        _mm_storeu_ps(out + i, _mm_mul_ps(lo, scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(hi, scale));
+    }
+    scalar::S16ToF32(out + i, in + i, count - i);
+}
+
+void F32ToS16(int16_t* out, const float* in, size_t count) {
+    const __m128 scale = _mm_set1_ps(kFloatToS16);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Clamp first: out-of-range floats convert to INT32_MIN
+        __m128 lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), low), high);
+        __m128 hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), low), high);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+    scalar::F32ToS16(out + i, in + i, count - i);
+}
+
+void GainRampF32(float* data, size_t count, float start, float step) {
+    const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 base = _mm_set1_ps(start);
+    const __m128 slope = _mm_set1_ps(step);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 index = _mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lanes);
+        __m128 gain = _mm_add_ps(base, _mm_mul_ps(slope, index));
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), gain));
+    }
+    for (; i < count; ++i) {
+        data[i] *= start + step * static_cast<float>(i);
+    }
+}
+
+void MixF32(float* acc, const float* in, size_t count, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(in + i), g)));
+    }
+    scalar::MixF32(acc + i, in + i, count - i, gain);
+}
+
+void ClipF32(float* data, size_t count, float limit) {
+    const __m128 low = _mm_set1_ps(-limit);
+    const __m128 high = _mm_set1_ps(limit);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(data + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(data + i), low), high));
+    }
+    scalar::ClipF32(data + i, count - i, limit);
+}
+
+float PeakF32(const float* in, size_t count) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 peak = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        peak = _mm_max_ps(peak, _mm_andnot_ps(sign, _mm_loadu_ps(in + i)));
+    }
+    peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+    peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+    float tail = scalar::PeakF32(in + i, count - i);
+    float lanes = _mm_cvtss_f32(peak);
+    return tail > lanes ? tail : lanes;
+}
+
+float SumSquaresF32(const float* in, size_t count) {
+    __m128 sum = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(in + i);
+        sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+    }
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum) + scalar::SumSquaresF32(in + i, count - i);
+}
+
+float DotF32(const float* a, const float* b, size_t count) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum) + scalar::DotF32(a + i, b + i, count - i);
+}
+
+void FftButterflyF32(float* y_re, float* y_im, const float* x_re, const float* x_im, size_t count, size_t x_stride,
+                     size_t y_stride, float w_re, float w_im) {
+    const __m128 wr = _mm_set1_ps(w_re);
+    const __m128 wi = _mm_set1_ps(w_im);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 a_re = _mm_loadu_ps(x_re + i);
+        __m128 a_im = _mm_loadu_ps(x_im + i);
+        __m128 b_re = _mm_loadu_ps(x_re + i + x_stride);
+        __m128 b_im = _mm_loadu_ps(x_im + i + x_stride);
+        _mm_storeu_ps(y_re + i, _mm_add_ps(a_re, b_re));
+        _mm_storeu_ps(y_im + i, _mm_add_ps(a_im, b_im));
+        __m128 d_re = _mm_sub_ps(a_re, b_re);
+        __m128 d_im = _mm_sub_ps(a_im, b_im);
+        _mm_storeu_ps(y_re + i + y_stride, _mm_sub_ps(_mm_mul_ps(d_re, wr), _mm_mul_ps(d_im, wi)));
+        _mm_storeu_ps(y_im + i + y_stride, _mm_add_ps(_mm_mul_ps(d_re, wi), _mm_mul_ps(d_im, wr)));
+    }
+    scalar::FftButterflyF32(y_re + i, y_im + i, x_re + i, x_im + i, count - i, x_stride, y_stride, w_re, w_im);
+}
+
+void ComplexMulF32(float* re, float* im, const float* w_re, const float* w_im, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 r = _mm_loadu_ps(re + i);
+        __m128 m = _mm_loadu_ps(im + i);
+        __m128 wr = _mm_loadu_ps(w_re + i);
+        __m128 wi = _mm_loadu_ps(w_im + i);
+        _mm_storeu_ps(re + i, _mm_sub_ps(_mm_mul_ps(r, wr), _mm_mul_ps(m, wi)));
+        _mm_storeu_ps(im + i, _mm_add_ps(_mm_mul_ps(r, wi), _mm_mul_ps(m, wr)));
+    }
+    scalar::ComplexMulF32(re + i, im + i, w_re + i, w_im + i, count - i);
+}
+
+} // namespace sse42
+} // namespace dsp
+} // namespace driftway
@@ -0,0 +1,162 @@
+#include "noise_suppressor.h"
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace driftway {
+
+namespace {
+
+// Blocks whose average power seeds the noise estimate (about 100 ms)
+constexpr uint32_t kWarmupBlocks = 20;
+
+// Weight of the previous value in the recursive power average
+constexpr float kPowerSmoothing = 0.7f;
+
+// Growth of the noise floor per block while the power stays above it;
+// about 4 dB per second, so a louder noise is adopted within seconds but
+// a sentence of speech barely moves it
+constexpr float kNoiseRise = 1.005f;
+
+// The minimum of the smoothed power sits below the mean noise power
+constexpr float kNoiseBias = 1.5f;
+
+// Decision-directed weight of last block's clean estimate in the a priori
+// SNR; close to 1 keeps residual noise from "warbling"
+constexpr float kPriorWeight = 0.98f;
+
+// Gain floor (-20 dB): deeper suppression sounds unnatural
+constexpr float kMinGain = 0.1f;
+
+// Keeps the SNR finite on digital silence
+constexpr float kPowerFloor = 1e-12f;
+
+// sqrt of a periodic Hann window, applied before analysis and again after
+// synthesis: the product overlap-adds to exactly 1 at a hop of half a block
+const float* Window() {
+    static const float* window = [] {
+        float* values = new float[NoiseSuppressor::kFftSize];
+        for (size_t i = 0; i < NoiseSuppressor::kFftSize; ++i) {
+            double phase = 2.0 * M_PI * static_cast<double>(i) / NoiseSuppressor::kFftSize;
+            values[i] = static_cast<float>(std::sqrt(0.5 - 0.5 * std::cos(phase)));
+        }
+        return values;
+    }();
+    return window;
+}
+
+// Decision-directed (Ephraim-Malah) a priori SNR and the Wiener gain
+// derived from it, applied to the spectrum. The outputs never alias the
+// inputs; saying so (and building this file without trapping math) lets
+// the compiler vectorize the loop.
+void WienerGains(float* __restrict re, float* __restrict im, float* __restrict gain, float* __restrict snr,
+                 const float* power, const float* noise, size_t bins) {
+    for (size_t k = 0; k < bins; ++k) {
+        float posterior = power[k] / (kNoiseBias * noise[k] + kPowerFloor);
+        float prior = kPriorWeight * gain[k] * gain[k] * snr[k] +
+                      (1.0f - kPriorWeight) * std::max(posterior - 1.0f, 0.0f);
+        float g = std::max(prior / (1.0f + prior), kMinGain);
+        gain[k] = g;
+        snr[k] = posterior;
+        re[k] *= g;
+        im[k] *= g;
+    }
+}
+
+} // namespace
+
+NoiseSuppressor::NoiseSuppressor()
+    : fft_(kFftSize), input_(kFftSize), output_(kHop), overlap_(kFftSize - kHop), block_(kFftSize), re_(kBins),
+      im_(kBins), scratch_(kHop), power_(kBins), smoothed_(kBins), noise_(kBins), gain_(kBins), snr_(kBins), fill_(0), blocks_(0) {
+    Reset();
+}
+
+NoiseSuppressor::~NoiseSuppressor() = default;
+
+void NoiseSuppressor::Reset() {
+    std::fill(input_.begin(), input_.end(), 0.0f);
+    std::fill(output_.begin(), output_.end(), 0.0f);
+    std::fill(overlap_.begin(), overlap_.end(), 0.0f);
+    std::fill(smoothed_.begin(), smoothed_.end(), 0.0f);
+    std::fill(noise_.begin(), noise_.end(), 0.0f);
+    std::fill(gain_.begin(), gain_.end(), 1.0f);
+    std::fill(snr_.begin(), snr_.end(), 1.0f);
+    fill_ = 0;
+    blocks_ = 0;
+}
+
+void NoiseSuppressor::Process(float* data, size_t count) {
+    size_t done = 0;
+    while (done < count) {
+        size_t take = std::min(count - done, kHop - fill_);
+        // The newest hop of input_ and output_ line up sample for sample
+        std::memcpy(input_.data() + (kFftSize - kHop) + fill_, data + done, take * sizeof(float));
+        std::memcpy(data + done, output_.data() + fill_, take * sizeof(float));
+        fill_ += take;
+        done += take;
+        if (fill_ == kHop) {
+            ProcessBlock();
+            fill_ = 0;
+        }
+    }
+}
+
+void NoiseSuppressor::Process(int16_t* data, size_t count) {
+    const dsp::Kernels& kernels = dsp::Active();
+    for (size_t done = 0; done < count; done += kHop) {
+        size_t take = std::min(count - done, kHop);
+        kernels.s16_to_f32(scratch_.data(), data + done, take);
+        Process(scratch_.data(), take);
+        kernels.f32_to_s16(data + done, scratch_.data(), take);
+    }
+}
+
+void NoiseSuppressor::ProcessBlock() {
+    const float* window = Window();
+    for (size_t i = 0; i < kFftSize; ++i) {
+        block_[i] = input_[i] * window[i];
+    }
+    fft_.Forward(block_.data(), re_.data(), im_.data());
+
+    float* re = re_.data();
+    float* im = im_.data();
+    float* power = power_.data();
+    float* smoothed = smoothed_.data();
+    float* noise = noise_.data();
+    float* gain = gain_.data();
+    float* snr = snr_.data();
+
+    float keep = blocks_ == 0 ? 0.0f : kPowerSmoothing;
+    for (size_t k = 0; k < kBins; ++k) {
+        power[k] = re[k] * re[k] + im[k] * im[k];
+        smoothed[k] = keep * smoothed[k] + (1.0f - keep) * power[k];
+    }
+
+    if (blocks_ < kWarmupBlocks) {
+        // The first ~100 ms are assumed to be background and averaged
+        float weight = 1.0f / static_cast<float>(blocks_ + 1);
+        for (size_t k = 0; k < kBins; ++k) {
+            noise[k] += (power[k] - noise[k]) * weight;
+        }
+        blocks_++;
+    } else {
+        for (size_t k = 0; k < kBins; ++k) {
+            noise[k] = std::min(smoothed[k], noise[k] * kNoiseRise);
+        }
+    }
+
+    WienerGains(re, im, gain, snr, power, noise, kBins);
+
+    fft_.Inverse(re_.data(), im_.data(), block_.data());
+    for (size_t i = 0; i < kHop; ++i) {
+        output_[i] = overlap_[i] + block_[i] * window[i];
+    }
+    for (size_t i = kHop; i < kFftSize; ++i) {
+        overlap_[i - kHop] = block_[i] * window[i];
+    }
+    std::memmove(input_.data(), input_.data() + kHop, (kFftSize - kHop) * sizeof(float));
+}
+
+} // namespace driftway
@@ -0,0 +1,224 @@
+#include "real_fft.h"
+#include "dsp_kernels.h"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace driftway {
+
+// Immutable twiddle tables for one size. The size/2-point complex FFT is
+// viewed as a cols x rows matrix, x[n1 + cols * n2]: first `cols` FFTs of
+// `rows` points, one per lane, then a twiddle multiply and transpose, then
+// `rows` FFTs of `cols` points.
+struct RealFft::Tables {
+    size_t points; // size / 2
+    size_t rows;
+    size_t cols;
+    // Butterfly twiddles for the two passes, stage after stage
+    std::vector<float> rows_re, rows_im;
+    std::vector<float> cols_re, cols_im;
+    // W^(n1 * k2) between the passes, at n1 + cols * k2
+    std::vector<float> step_re, step_im;
+    // e^(-i pi k / points) for splitting the real spectrum, k <= points
+    std::vector<float> split_re, split_im;
+};
+
+namespace {
+
+void StageTwiddles(size_t length, std::vector<float>* re, std::vector<float>* im) {
+    for (size_t m = length / 2; m >= 1; m /= 2) {
+        for (size_t p = 0; p < m; ++p) {
+            double angle = -M_PI * static_cast<double>(p) / static_cast<double>(m);
+            re->push_back(static_cast<float>(std::cos(angle)));
+            im->push_back(static_cast<float>(std::sin(angle)));
+        }
+    }
+}
+
+std::shared_ptr<const RealFft::Tables> BuildTables(size_t size) {
+    auto tables = std::make_shared<RealFft::Tables>();
+    size_t points = size / 2;
+    size_t rows = 1;
+    while (rows * rows * 2 <= points) {
+        rows *= 2;
+    }
+    tables->points = points;
+    tables->rows = rows;
+    tables->cols = points / rows;
+    StageTwiddles(tables->rows, &tables->rows_re, &tables->rows_im);
+    StageTwiddles(tables->cols, &tables->cols_re, &tables->cols_im);
+
+    tables->step_re.resize(points);
+    tables->step_im.resize(points);
+    for (size_t k2 = 0; k2 < rows; ++k2) {
+        for (size_t n1 = 0; n1 < tables->cols; ++n1) {
+            double angle = -2.0 * M_PI * static_cast<double>(n1 * k2) / static_cast<double>(points);
+            tables->step_re[n1 + tables->cols * k2] = static_cast<float>(std::cos(angle));
+            tables->step_im[n1 + tables->cols * k2] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+    tables->split_re.resize(points + 1);
+    tables->split_im.resize(points + 1);
+    for (size_t k = 0; k <= points; ++k) {
+        double angle = -M_PI * static_cast<double>(k) / static_cast<double>(points);
+        tables->split_re[k] = static_cast<float>(std::cos(angle));
+        tables->split_im[k] = static_cast<float>(std::sin(angle));
+    }
+    return tables;
+}
+
+std::shared_ptr<const RealFft::Tables> GetTables(size_t size) {
+    static std::mutex* mutex = new std::mutex();
+    static auto* cache = new std::map<size_t, std::shared_ptr<const RealFft::Tables>>();
+
+    std::lock_guard<std::mutex> lock(*mutex);
+    auto& tables = (*cache)[size];
+    if (!tables) {
+        tables = BuildTables(size);
+    }
+    return tables;
+}
+
+// Stockham autosort FFTs of `length` points on each of `lanes` interleaved
+// sequences x[q + lanes * p]. Ping-pongs between x and y; returns true when
+// the result, in natural order, ended up in y.
+bool Stockham(const dsp::Kernels& kernels, size_t length, size_t lanes, const float* tw_re, const float* tw_im,
+              float* x_re, float* x_im, float* y_re, float* y_im) {
+    bool in_y = false;
+    size_t stride = lanes;
+    for (size_t m = length / 2; m >= 1; m /= 2) {
+        for (size_t p = 0; p < m; ++p) {
+            kernels.fft_butterfly_f32(y_re + 2 * stride * p, y_im + 2 * stride * p, x_re + stride * p,
+                                      x_im + stride * p, stride, stride * m, stride, *tw_re++, *tw_im++);
+        }
+        std::swap(x_re, y_re);
+        std::swap(x_im, y_im);
+        in_y = !in_y;
+        stride *= 2;
+    }
+    return in_y;
+}
+
+// Separates the spectra of the even and odd samples, packed as the real
+// and imaginary parts of Z, into bins 1..n-1 of the real FFT:
+// X[k] = E[k] + e^(-i pi k / n) O[k]. The outputs never alias the inputs;
+// saying so lets the compiler vectorize the mirrored Z[n - k] loads.
+void SplitSpectrum(float* __restrict re, float* __restrict im, const float* z_re, const float* z_im,
+                   const float* w_re, const float* w_im, size_t n) {
+    for (size_t k = 1; k < n; ++k) {
+        float even_re = 0.5f * (z_re[k] + z_re[n - k]);
+        float even_im = 0.5f * (z_im[k] - z_im[n - k]);
+        float odd_re = 0.5f * (z_im[k] + z_im[n - k]);
+        float odd_im = -0.5f * (z_re[k] - z_re[n - k]);
+        re[k] = even_re + w_re[k] * odd_re - w_im[k] * odd_im;
+        im[k] = even_im + w_re[k] * odd_im + w_im[k] * odd_re;
+    }
+}
+
+// The reverse: Z[k] = E[k] + i O[k] for k in 1..n-1, times `scale`
+void MergeSpectrum(float* __restrict z_re, float* __restrict z_im, const float* re, const float* im,
+                   const float* w_re, const float* w_im, size_t n, float scale) {
+    for (size_t k = 1; k < n; ++k) {
+        float even_re = scale * (re[k] + re[n - k]);
+        float even_im = scale * (im[k] - im[n - k]);
+        float diff_re = scale * (re[k] - re[n - k]);
+        float diff_im = scale * (im[k] + im[n - k]);
+        // O = diff * e^(+i pi k / n)
+        float odd_re = diff_re * w_re[k] + diff_im * w_im[k];
+        float odd_im = diff_im * w_re[k] - diff_re * w_im[k];
+        z_re[k] = even_re - odd_im;
+        z_im[k] = even_im + odd_re;
+    }
+}
+
+} // namespace
+
+RealFft::RealFft(size_t size) : size_(size), tables_(GetTables(size)) {
+    work_re_.resize(size / 2);
+    work_im_.resize(size / 2);
+    scratch_re_.resize(size / 2);
+    scratch_im_.resize(size / 2);
+}
+
+RealFft::~RealFft() = default;
+
+// In-place complex FFT of size/2 points; passing the real and imaginary
+// arrays swapped computes the unscaled inverse instead
+void RealFft::ComplexForward(float* re, float* im, float* scratch_re, float* scratch_im) {
+    const dsp::Kernels& kernels = dsp::Active();
+    const Tables& t = *tables_;
+
+    float* a_re = re;
+    float* a_im = im;
+    float* b_re = scratch_re;
+    float* b_im = scratch_im;
+    if (Stockham(kernels, t.rows, t.cols, t.rows_re.data(), t.rows_im.data(), a_re, a_im, b_re, b_im)) {
+        std::swap(a_re, b_re);
+        std::swap(a_im, b_im);
+    }
+    kernels.complex_mul_f32(a_re, a_im, t.step_re.data(), t.step_im.data(), t.points);
+
+    // [n1 + cols * k2] -> [k2 + rows * n1], so the second pass also runs
+    // across contiguous lanes
+    for (size_t k2 = 0; k2 < t.rows; ++k2) {
+        for (size_t n1 = 0; n1 < t.cols; ++n1) {
+            b_re[k2 + t.rows * n1] = a_re[n1 + t.cols * k2];
+            b_im[k2 + t.rows * n1] = a_im[n1 + t.cols * k2];
+        }
+    }
+    std::swap(a_re, b_re);
+    std::swap(a_im, b_im);
+
+    if (Stockham(kernels, t.cols, t.rows, t.cols_re.data(), t.cols_im.data(), a_re, a_im, b_re, b_im)) {
+        std::swap(a_re, b_re);
+        std::swap(a_im, b_im);
+    }
+    if (a_re != re) {
+        std::memcpy(re, a_re, t.points * sizeof(float));
+        std::memcpy(im, a_im, t.points * sizeof(float));
+    }
+}
+
+void RealFft::Forward(const float* in, float* re, float* im) {
+    const Tables& t = *tables_;
+    size_t n = t.points;
+
+    // Even samples as the real part, odd as the imaginary part
+    for (size_t j = 0; j < n; ++j) {
+        work_re_[j] = in[2 * j];
+        work_im_[j] = in[2 * j + 1];
+    }
+    ComplexForward(work_re_.data(), work_im_.data(), scratch_re_.data(), scratch_im_.data());
+
+    // Bins 0 and n only see Z[0]
+    re[0] = work_re_[0] + work_im_[0];
+    im[0] = 0.0f;
+    re[n] = work_re_[0] - work_im_[0];
+    im[n] = 0.0f;
+    SplitSpectrum(re, im, work_re_.data(), work_im_.data(), t.split_re.data(), t.split_im.data(), n);
+}
+
+void RealFft::Inverse(const float* re, const float* im, float* out) {
+    const Tables& t = *tables_;
+    size_t n = t.points;
+    float scale = 0.5f / static_cast<float>(n);
+    float* z_re = work_re_.data();
+    float* z_im = work_im_.data();
+
+    MergeSpectrum(z_re, z_im, re, im, t.split_re.data(), t.split_im.data(), n, scale);
+    // Bins 0 and n are real by definition
+    z_re[0] = scale * (re[0] + re[n]);
+    z_im[0] = scale * (re[0] - re[n]);
+    ComplexForward(z_im, z_re, scratch_im_.data(), scratch_re_.data());
+
+    for (size_t j = 0; j < n; ++j) {
+        out[2 * j] = work_re_[j];
+        out[2 * j + 1] = work_im_[j];
+    }
+}
+
+} // namespace driftway
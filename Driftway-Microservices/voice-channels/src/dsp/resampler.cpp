@@ -0,0 +1,191 @@
+#include "resampler.h"
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <utility>
+
+namespace driftway {
+
+namespace {
+
+// Input samples converted per pass; 20 ms at 48 kHz
+constexpr size_t kChunkSamples = 960;
+
+// Phases beyond this make the bank large for little benefit (44.1 <-> 48
+// kHz needs 160)
+constexpr uint32_t kMaxPhases = 1024;
+
+// Zero crossings of the windowed sinc, counted at the slower rate. More
+// gives a sharper transition band at a linear cost per output sample.
+constexpr uint32_t kZeroCrossings = 64;
+
+// Kaiser window shape; about 80 dB of stopband attenuation
+constexpr double kKaiserBeta = 8.0;
+
+// Passband edge as a fraction of the lower Nyquist frequency. The
+// transition band sits just under Nyquist so nothing aliases back.
+constexpr double kCutoff = 0.91;
+
+// Zeroth-order modified Bessel function of the first kind
+double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+} // namespace
+
+// Immutable filter bank for one reduced ratio L/M
+struct Resampler::Bank {
+    uint32_t up;   // L
+    uint32_t down; // M
+    size_t taps;   // Per phase, a multiple of 8 so vector loops have no tail
+    // Phase-major; each row is time-reversed so that one output is
+    // dot(row(phase), newest `taps` inputs in order)
+    std::vector<float> coeffs;
+
+    const float* Row(uint32_t phase) const { return coeffs.data() + phase * taps; }
+};
+
+namespace {
+
+std::shared_ptr<const Resampler::Bank> DesignBank(uint32_t up, uint32_t down) {
+    auto bank = std::make_shared<Resampler::Bank>();
+    bank->up = up;
+    bank->down = down;
+    size_t taps = (kZeroCrossings * std::max(up, down) + up - 1) / up;
+    bank->taps = (taps + 7) & ~static_cast<size_t>(7);
+
+    // Prototype lowpass at the upsampled rate in * L
+    size_t length = bank->taps * up;
+    double cutoff = 0.5 * kCutoff / std::max(up, down); // Cycles per upsampled sample
+    double center = (static_cast<double>(length) - 1.0) / 2.0;
+    double norm = BesselI0(kKaiserBeta);
+    std::vector<double> prototype(length);
+    double sum = 0.0;
+    for (size_t n = 0; n < length; ++n) {
+        double t = static_cast<double>(n) - center;
+        double sinc = t == 0.0 ? 2.0 * cutoff : std::sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+        double r = t / (center + 0.5);
+        double window = BesselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - r * r))) / norm;
+        prototype[n] = sinc * window;
+        sum += prototype[n];
+    }
+
+    // Unity gain at DC: each phase sees 1/L of the prototype
+    double scale = static_cast<double>(up) / sum;
+    bank->coeffs.resize(length);
+    for (uint32_t phase = 0; phase < up; ++phase) {
+        for (size_t j = 0; j < bank->taps; ++j) {
+            bank->coeffs[phase * bank->taps + (bank->taps - 1 - j)] =
+                static_cast<float>(prototype[phase + j * up] * scale);
+        }
+    }
+    return bank;
+}
+
+std::shared_ptr<const Resampler::Bank> GetBank(uint32_t up, uint32_t down) {
+    static std::mutex* mutex = new std::mutex();
+    static auto* banks = new std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<const Resampler::Bank>>();
+
+    std::lock_guard<std::mutex> lock(*mutex);
+    auto& bank = (*banks)[{up, down}];
+    if (!bank) {
+        bank = DesignBank(up, down);
+    }
+    return bank;
+}
+
+} // namespace
+
+Resampler::Resampler(int in_rate, int out_rate)
+    : in_rate_(in_rate), out_rate_(out_rate), next_input_(0), phase_(0) {
+    uint32_t divisor = static_cast<uint32_t>(std::gcd(in_rate, out_rate));
+    bank_ = GetBank(static_cast<uint32_t>(out_rate) / divisor, static_cast<uint32_t>(in_rate) / divisor);
+    buffer_.assign(bank_->taps - 1 + kChunkSamples, 0.0f);
+    scratch_.resize(MaxOutputSamples(kChunkSamples));
+}
+
+Resampler::~Resampler() = default;
+
+bool Resampler::Supports(int in_rate, int out_rate) {
+    if (in_rate < kMinRate || in_rate > kMaxRate || out_rate < kMinRate || out_rate > kMaxRate) {
+        return false;
+    }
+    return static_cast<uint32_t>(out_rate / std::gcd(in_rate, out_rate)) <= kMaxPhases;
+}
+
+size_t Resampler::MaxOutputSamples(size_t in_count) const {
+    return (in_count * bank_->up + bank_->down - 1) / bank_->down + 1;
+}
+
+void Resampler::Reset() {
+    std::fill(buffer_.begin(), buffer_.end(), 0.0f);
+    next_input_ = 0;
+    phase_ = 0;
+}
+
+// buffer_ holds the history followed by `count` new samples. Computes every
+// output whose newest input is among them, then keeps the last taps - 1
+// samples as history for the next chunk.
+size_t Resampler::RunChunk(size_t count, float* out) {
+    const dsp::Kernels& kernels = dsp::Active();
+    const Bank& bank = *bank_;
+    const float* window = buffer_.data();
+    size_t written = 0;
+    while (next_input_ < count) {
+        // Row covers inputs next_input_ - taps + 1 .. next_input_
+        out[written++] = kernels.dot_f32(bank.Row(phase_), window + next_input_, bank.taps);
+        phase_ += bank.down;
+        next_input_ += phase_ / bank.up;
+        phase_ %= bank.up;
+    }
+    next_input_ -= count;
+    std::memmove(buffer_.data(), buffer_.data() + count, (bank.taps - 1) * sizeof(float));
+    return written;
+}
+
+size_t Resampler::Process(const float* in, size_t in_count, float* out, size_t capacity) {
+    if (capacity < MaxOutputSamples(in_count)) {
+        return 0;
+    }
+    float* chunk = buffer_.data() + bank_->taps - 1;
+    size_t written = 0;
+    for (size_t offset = 0; offset < in_count; offset += kChunkSamples) {
+        size_t count = std::min(kChunkSamples, in_count - offset);
+        std::memcpy(chunk, in + offset, count * sizeof(float));
+        written += RunChunk(count, out + written);
+    }
+    return written;
+}
+
+size_t Resampler::Process(const int16_t* in, size_t in_count, int16_t* out, size_t capacity) {
+    if (capacity < MaxOutputSamples(in_count)) {
+        return 0;
+    }
+    const dsp::Kernels& kernels = dsp::Active();
+    float* chunk = buffer_.data() + bank_->taps - 1;
+    size_t written = 0;
+    for (size_t offset = 0; offset < in_count; offset += kChunkSamples) {
+        size_t count = std::min(kChunkSamples, in_count - offset);
+        kernels.s16_to_f32(chunk, in + offset, count);
+        size_t produced = RunChunk(count, scratch_.data());
+        kernels.f32_to_s16(out + written, scratch_.data(), produced);
+        written += produced;
+    }
+    return written;
+}
+
+} // namespace driftway
@@ -0,0 +1,175 @@
+#include "epoch.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace driftway {
+namespace epoch {
+
+namespace {
+
+// Threads that read concurrently; beyond this readers share one counter
+// that holds back all reclamation while it is non-zero
+constexpr size_t kMaxReaderThreads = 256;
+
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{0}; // Epoch seen on entry; 0 when not reading
+    std::atomic<bool> claimed{false};
+};
+
+struct RetiredObject {
+    void* object;
+    void (*deleter)(void*);
+    uint64_t epoch; // Global epoch when it was unlinked
+};
+
+struct Domain {
+    std::atomic<uint64_t> global_epoch{1};
+    ReaderSlot slots[kMaxReaderThreads];
+    std::atomic<uint32_t> overflow_readers{0};
+
+    std::mutex retired_mutex;
+    std::vector<RetiredObject> retired;
+};
+
+Domain& GetDomain() {
+    // Never destroyed: reader threads may outlive static destruction
+    static Domain* domain = new Domain();
+    return *domain;
+}
+
+struct ThreadState {
+    ReaderSlot* slot = nullptr;
+    bool claim_attempted = false;
+    uint32_t depth = 0;
+
+    ~ThreadState() {
+        if (slot) {
+            slot->claimed.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadState t_state;
+
+ReaderSlot* ClaimSlot(Domain& domain) {
+    for (ReaderSlot& slot : domain.slots) {
+        bool expected = false;
+        if (!slot.claimed.load(std::memory_order_relaxed) &&
+            slot.claimed.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+// Moves objects no active reader can still hold into `ready`.
+// Caller holds retired_mutex.
+void CollectLocked(Domain& domain, std::vector<RetiredObject>* ready) {
+    if (domain.retired.empty()) {
+        return;
+    }
+
+    // Pairs with the fence in ReadGuard: either the reader's epoch is seen
+    // here, or the reader sees the unlinked version's replacement
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (domain.overflow_readers.load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (const ReaderSlot& slot : domain.slots) {
+        uint64_t epoch = slot.epoch.load(std::memory_order_acquire);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    // A reader that entered at epoch E may hold anything unlinked at E or later
+    auto keep = domain.retired.begin();
+    for (auto it = domain.retired.begin(); it != domain.retired.end(); ++it) {
+        if (it->epoch < oldest) {
+            ready->push_back(*it);
+        } else {
+            *keep++ = *it;
+        }
+    }
+    domain.retired.erase(keep, domain.retired.end());
+}
+
+void Delete(const std::vector<RetiredObject>& ready) {
+    for (const RetiredObject& retired : ready) {
+        retired.deleter(retired.object);
+    }
+}
+
+} // namespace
+
+ReadGuard::ReadGuard() {
+    ThreadState& state = t_state;
+    if (state.depth++ > 0) {
+        return;
+    }
+
+    Domain& domain = GetDomain();
+    if (!state.slot && !state.claim_attempted) {
+        state.slot = ClaimSlot(domain);
+        state.claim_attempted = true;
+    }
+
+    if (state.slot) {
+        state.slot->epoch.store(domain.global_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    } else {
+        domain.overflow_readers.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Announce before any protected pointer is loaded
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+ReadGuard::~ReadGuard() {
+    ThreadState& state = t_state;
+    if (--state.depth > 0) {
+        return;
+    }
+
+    if (state.slot) {
+        state.slot->epoch.store(0, std::memory_order_release);
+    } else {
+        GetDomain().overflow_readers.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void Retire(void* object, void (*deleter)(void*)) {
+    Domain& domain = GetDomain();
+    std::vector<RetiredObject> ready;
+    {
+        std::lock_guard<std::mutex> lock(domain.retired_mutex);
+        uint64_t epoch = domain.global_epoch.fetch_add(1, std::memory_order_acq_rel);
+        domain.retired.push_back(RetiredObject{object, deleter, epoch});
+        CollectLocked(domain, &ready);
+    }
+    // Deleters run unlocked: they may release objects that retire others
+    Delete(ready);
+}
+
+void Reclaim() {
+    Domain& domain = GetDomain();
+    std::vector<RetiredObject> ready;
+    {
+        std::lock_guard<std::mutex> lock(domain.retired_mutex);
+        CollectLocked(domain, &ready);
+    }
+    Delete(ready);
+}
+
+size_t PendingCount() {
+    Domain& domain = GetDomain();
+    std::lock_guard<std::mutex> lock(domain.retired_mutex);
+    return domain.retired.size();
+}
+
+} // namespace epoch
+} // namespace driftway
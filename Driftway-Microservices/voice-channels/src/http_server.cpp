@@ -1,18 +1,85 @@
 #include "http_server.h"
 #include "voice_server.h"
+#include "voice_channel.h"
+#include "logger.h"
 #include "../third_party/httplib.h"
-#include <iostream>
 #include <string>
 #include <thread>
 #include <functional>
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <ctime>
+#include <random>
 
 namespace driftway {
 
-HttpServer::HttpServer(int port, VoiceServer* voice_server)
-    : port_(port), voice_server_(voice_server), server_(new httplib::Server()) {
-    std::cout << "HttpServer created on port " << port << std::endl;
+namespace {
+
+// For strings that end up inside JSON responses (SDP has CRLFs)
+std::string JsonEscape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+// Longest a cached channel's statistics are served before a rebuild
+constexpr std::chrono::seconds kChannelStatsMaxAge(1);
+
+std::string ChannelJson(const VoiceChannel& channel) {
+    std::vector<Participant> participants = channel.GetParticipants();
+    VoiceChannel::ChannelStats stats = channel.GetStats();
+
+    std::string json = "{\"id\":\"" + JsonEscape(channel.GetChannelId()) + "\",\"server_id\":\"" +
+                       JsonEscape(channel.GetServerId()) + "\",\"participants\":" +
+                       std::to_string(participants.size()) + ",\"max_participants\":" +
+                       std::to_string(channel.GetMaxParticipants()) + ",\"mixing\":" +
+                       (channel.IsMixingEnabled() ? "true" : "false") + ",\"members\":[";
+    for (size_t i = 0; i < participants.size(); ++i) {
+        const Participant& participant = participants[i];
+        if (i > 0) {
+            json += ",";
+        }
+        json += "{\"user_id\":\"" + JsonEscape(participant.user_id) + "\",\"username\":\"" +
+                JsonEscape(participant.username) + "\",\"speaking\":" + (participant.is_speaking ? "true" : "false") +
+                ",\"muted\":" + (participant.is_muted ? "true" : "false") +
+                ",\"deafened\":" + (participant.is_deafened ? "true" : "false") + "}";
+    }
+    json += "],\"stats\":{\"active_speakers\":" + std::to_string(stats.active_speakers) +
+            ",\"packets_sent\":" + std::to_string(stats.total_packets_sent) +
+            ",\"packets_received\":" + std::to_string(stats.total_packets_received) +
+            ",\"bytes_sent\":" + std::to_string(stats.total_bytes_sent) +
+            ",\"bytes_received\":" + std::to_string(stats.total_bytes_received) +
+            ",\"packets_suppressed\":" + std::to_string(stats.total_packets_suppressed) +
+            ",\"packet_loss\":" + std::to_string(stats.average_packet_loss) +
+            ",\"jitter_ms\":" + std::to_string(stats.average_jitter) + "}}";
+    return json;
+}
+
+} // namespace
+
+HttpServer::HttpServer(int port, VoiceServer* voice_server, bool http_signaling)
+    : port_(port), voice_server_(voice_server), http_signaling_(http_signaling), server_(new httplib::Server()) {
+    std::random_device device;
+    channels_etag_nonce_ = (static_cast<uint64_t>(device()) << 32) | device();
+    LOG_INFO << "HttpServer created on port " << port;
 }
 
 HttpServer::~HttpServer() {
@@ -22,16 +89,16 @@ HttpServer::~HttpServer() {
 void HttpServer::start() {
     setup_routes();
     server_thread_ = std::thread([this]() {
-        std::cout << "Starting HTTP server on port " << port_ << std::endl;
+        LOG_INFO << "Starting HTTP server on port " << port_;
         
         server_->set_logger([](const httplib::Request& req, const httplib::Response& res) {
-            std::cout << "HTTP " << req.method << " " << req.path << " -> " << res.status << std::endl;
+            LOG_DEBUG << "HTTP " << req.method << " " << req.path << " -> " << res.status;
         });
         
         if (!server_->listen("0.0.0.0", port_)) {
-            std::cerr << "Error starting HTTP server on port " << port_ << std::endl;
+            LOG_ERROR << "Error starting HTTP server on port " << port_;
         } else {
-            std::cout << "HTTP server started successfully on port " << port_ << std::endl;
+            LOG_INFO << "HTTP server started successfully on port " << port_;
         }
     });
     
@@ -39,19 +106,82 @@ void HttpServer::start() {
 }
 
 void HttpServer::stop() {
-    std::cout << "Stopping HTTP server..." << std::endl;
+    LOG_INFO << "Stopping HTTP server...";
     if (server_ && server_->is_running()) {
         server_->stop();
     }
     if (server_thread_.joinable()) {
         server_thread_.join();
     }
-    std::cout << "HTTP server stopped" << std::endl;
+    LOG_INFO << "HTTP server stopped";
+}
+
+std::shared_ptr<const std::string> HttpServer::render_channels(std::string* etag) {
+    std::vector<std::shared_ptr<VoiceChannel>> channels = voice_server_->GetChannels();
+    std::sort(channels.begin(), channels.end(),
+              [](const std::shared_ptr<VoiceChannel>& a, const std::shared_ptr<VoiceChannel>& b) {
+                  return a->GetChannelId() < b->GetChannelId();
+              });
+
+    std::lock_guard<std::mutex> lock(channels_mutex_);
+    uint64_t poll = ++channels_polls_;
+    auto now = std::chrono::steady_clock::now();
+
+    // The ETag hashes (FNV-1a) the process nonce and the generations of
+    // the listed channels
+    uint64_t hash = 14695981039346656037ULL;
+    for (int shift = 0; shift < 64; shift += 8) {
+        hash = (hash ^ ((channels_etag_nonce_ >> shift) & 0xff)) * 1099511628211ULL;
+    }
+    std::vector<const std::string*> parts;
+    parts.reserve(channels.size());
+    for (const auto& channel : channels) {
+        CachedChannel& entry = channel_cache_[channel->GetChannelId()];
+        uint64_t version = channel->GetVersion();
+        if (entry.generation == 0 || entry.version != version || now - entry.built >= kChannelStatsMaxAge ||
+            entry.channel.lock() != channel) {
+            std::string json = ChannelJson(*channel);
+            if (entry.generation == 0 || json != entry.json) {
+                entry.json = std::move(json);
+                entry.generation = ++channel_cache_generation_;
+            }
+            entry.channel = channel;
+            entry.version = version;
+            entry.built = now;
+        }
+        entry.seen = poll;
+        parts.push_back(&entry.json);
+        for (int shift = 0; shift < 64; shift += 8) {
+            hash = (hash ^ ((entry.generation >> shift) & 0xff)) * 1099511628211ULL;
+        }
+    }
+
+    // Forget channels that are gone
+    for (auto it = channel_cache_.begin(); it != channel_cache_.end();) {
+        it = it->second.seen == poll ? std::next(it) : channel_cache_.erase(it);
+    }
+
+    char tag[24];
+    std::snprintf(tag, sizeof(tag), "\"%016llx\"", static_cast<unsigned long long>(hash));
+    if (!channels_body_ || channels_etag_ != tag) {
+        auto body = std::make_shared<std::string>("{\"channels\":[");
+        for (size_t i = 0; i < parts.size(); ++i) {
+            if (i > 0) {
+                *body += ",";
+            }
+            *body += *parts[i];
+        }
+        *body += "]}";
+        channels_body_ = std::move(body);
+        channels_etag_ = tag;
+    }
+    *etag = channels_etag_;
+    return channels_body_;
 }
 
 void HttpServer::setup_routes() {
     server_->Get("/health", [this](const httplib::Request &req, httplib::Response &res) {
-        std::cout << "Health check called" << std::endl;
+        LOG_DEBUG << "Health check called";
         std::time_t t = std::time(nullptr);
         std::string json = "{\"status\":\"healthy\",\"service\":\"Voice Channels\",\"timestamp\":\"" + std::to_string(t) + "\"}";
         res.status = 200;
@@ -59,18 +189,40 @@ void HttpServer::setup_routes() {
         res.set_header("Access-Control-Allow-Origin", "*");
         res.set_header("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
         res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
-        std::cout << "Health check response sent" << std::endl;
+        LOG_DEBUG << "Health check response sent";
     });
 
-    server_->Get("/channels", [this](const httplib::Request &req, httplib::Response &res) {
-        std::cout << "Channels endpoint called" << std::endl;
-        std::string json = "{\"channels\":[{\"id\":\"1\",\"name\":\"General Voice\",\"participants\":0}]}";
+    server_->Get("/metrics", [this](const httplib::Request &req, httplib::Response &res) {
+        if (!voice_server_) {
+            res.status = 503;
+            return;
+        }
         res.status = 200;
-        res.set_content(json, "application/json");
+        res.set_content(voice_server_->RenderMetrics(), "text/plain; version=0.0.4; charset=utf-8");
+    });
+
+    server_->Get("/channels", [this](const httplib::Request &req, httplib::Response &res) {
+        LOG_DEBUG << "Channels endpoint called";
         res.set_header("Access-Control-Allow-Origin", "*");
         res.set_header("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
         res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
-        std::cout << "Channels response sent" << std::endl;
+        if (!voice_server_) {
+            res.status = 503;
+            return;
+        }
+
+        std::string etag;
+        std::shared_ptr<const std::string> body = render_channels(&etag);
+        res.set_header("ETag", etag);
+        res.set_header("Cache-Control", "no-cache");
+        std::string if_none_match = req.get_header_value("If-None-Match");
+        if (if_none_match == "*" || if_none_match.find(etag) != std::string::npos) {
+            res.status = 304;
+            return;
+        }
+        res.status = 200;
+        res.set_content(*body, "application/json");
+        LOG_DEBUG << "Channels response sent";
     });
     
     server_->Options("/.*", [](const httplib::Request &, httplib::Response &res) {
@@ -79,6 +231,80 @@ void HttpServer::setup_routes() {
         res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
         res.status = 200;
     });
+
+    // Signaling and channel control over plain HTTP, for voice_loadgen and
+    // trusted tools. Nothing authenticates the caller, so these routes exist
+    // only with http_signaling, and their responses carry no CORS headers.
+    if (!http_signaling_) {
+        return;
+    }
+
+    server_->Post(R"(/channels/([^/]+)/mixing)", [this](const httplib::Request &req, httplib::Response &res) {
+        std::string channel_id = req.matches[1];
+        std::string value = req.get_param_value("enabled");
+        bool enabled = value == "true";
+        LOG_INFO << "Mixing endpoint called for channel " << channel_id;
+
+        std::string json;
+        if (value != "true" && value != "false") {
+            json = "{\"error\":\"enabled must be true or false\"}";
+            res.status = 400;
+        } else if (voice_server_ && voice_server_->SetChannelMixing(channel_id, enabled)) {
+            json = "{\"channel\":\"" + JsonEscape(channel_id) + "\",\"mixing\":" + (enabled ? "true" : "false") + "}";
+            res.status = 200;
+        } else {
+            json = "{\"error\":\"channel not found\"}";
+            res.status = 404;
+        }
+        res.set_content(json, "application/json");
+    });
+
+    // Joining creates the channel on first use; an SDP offer in the body is
+    // handled like a signaled one and answered in "answer". The client then
+    // sends RTP to the RTC port with the returned SSRC.
+    server_->Post(R"(/channels/([^/]+)/join)", [this](const httplib::Request &req, httplib::Response &res) {
+        std::string channel_id = req.matches[1];
+        std::string user_id = req.get_param_value("user_id");
+        std::string server_id = req.has_param("server_id") ? req.get_param_value("server_id") : "default";
+
+        std::string json;
+        uint32_t ssrc = 0;
+        if (!voice_server_) {
+            json = "{\"error\":\"unavailable\"}";
+            res.status = 503;
+        } else if (user_id.empty()) {
+            json = "{\"error\":\"user_id required\"}";
+            res.status = 400;
+        } else if (!voice_server_->CreateChannel(channel_id, server_id) ||
+                   !voice_server_->JoinChannel(channel_id, user_id, &ssrc)) {
+            json = "{\"error\":\"join failed\"}"; // Full, or already in it
+            res.status = 409;
+        } else {
+            std::string answer;
+            if (!req.body.empty()) {
+                voice_server_->HandleOffer(channel_id, user_id, req.body, &answer);
+            }
+            json = "{\"channel\":\"" + JsonEscape(channel_id) + "\",\"user_id\":\"" + JsonEscape(user_id) +
+                   "\",\"ssrc\":" + std::to_string(ssrc) + ",\"answer\":\"" + JsonEscape(answer) + "\"}";
+            res.status = 200;
+        }
+        res.set_content(json, "application/json");
+    });
+
+    server_->Post(R"(/channels/([^/]+)/leave)", [this](const httplib::Request &req, httplib::Response &res) {
+        std::string channel_id = req.matches[1];
+        std::string user_id = req.get_param_value("user_id");
+
+        std::string json;
+        if (voice_server_ && voice_server_->LeaveChannel(channel_id, user_id)) {
+            json = "{\"channel\":\"" + JsonEscape(channel_id) + "\",\"user_id\":\"" + JsonEscape(user_id) + "\"}";
+            res.status = 200;
+        } else {
+            json = "{\"error\":\"not in channel\"}";
+            res.status = 404;
+        }
+        res.set_content(json, "application/json");
+    });
 }
 
 } // namespace driftway
@@ -0,0 +1,494 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace driftway {
+namespace log {
+
+namespace detail {
+
+std::atomic<uint8_t> g_level{static_cast<uint8_t>(Level::kInfo)};
+
+struct Record {
+    std::atomic<bool> ready{false}; // Set by the producer, cleared by the writer
+    Level level = Level::kInfo;
+    uint16_t length = 0;
+    uint32_t line = 0;
+    uint32_t thread = 0;
+    const char* file = nullptr;
+    uint64_t time_us = 0;
+    uint64_t suppressed = 0;
+    char text[LogLine::kMaxMessage];
+};
+
+} // namespace detail
+
+using detail::Record;
+
+namespace {
+
+constexpr size_t kRingSlots = 512;
+constexpr auto kWriterIdle = std::chrono::milliseconds(10);
+
+// Single-producer ring owned by one thread. Slots are claimed in order and
+// published individually through Record::ready, so a record started while
+// another is still being formatted (logging inside a << argument) is fine:
+// the writer stops at the first slot that is not ready yet.
+struct Ring {
+    Record slots[kRingSlots];
+    uint64_t reserve = 0; // Producer-only
+    alignas(64) std::atomic<uint64_t> tail{0};
+    std::atomic<bool> retired{false};
+    uint32_t thread = 0;
+};
+
+struct Writer {
+    std::mutex rings_mutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::atomic<uint32_t> next_thread{1};
+
+    std::mutex state_mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::thread thread;
+    bool started = false;
+    bool running = false;
+    uint64_t passes_started = 0;
+    uint64_t passes_done = 0;
+    std::atomic<bool> stopped{false};
+
+    std::mutex io_mutex; // Writer output vs. synchronous fallback
+    std::atomic<uint8_t> format{static_cast<uint8_t>(Format::kText)};
+    std::atomic<uint64_t> dropped{0};
+};
+
+Writer& GetWriter() {
+    // Never destroyed: threads may log during static destruction
+    static Writer* writer = new Writer();
+    return *writer;
+}
+
+uint64_t NowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+const char* LevelName(Level level) {
+    switch (level) {
+    case Level::kDebug: return "DEBUG";
+    case Level::kInfo: return "INFO";
+    case Level::kWarn: return "WARN";
+    case Level::kError: return "ERROR";
+    default: return "OFF";
+    }
+}
+
+const char* BaseName(const char* path) {
+    const char* slash = path ? std::strrchr(path, '/') : nullptr;
+    return slash ? slash + 1 : (path ? path : "");
+}
+
+void AppendJsonEscaped(std::string& out, const char* text, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        char c = text[i];
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+    }
+}
+
+void FormatRecord(const Record& record, Format format, std::string& out) {
+    time_t seconds = static_cast<time_t>(record.time_us / 1000000);
+    tm utc{};
+    gmtime_r(&seconds, &utc);
+    char timestamp[64];
+    std::snprintf(timestamp, sizeof(timestamp), "%04d-%02d-%02dT%02d:%02d:%02d.%06uZ", utc.tm_year + 1900,
+                  utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec,
+                  static_cast<unsigned>(record.time_us % 1000000));
+
+    char prefix[160];
+    if (format == Format::kJson) {
+        std::snprintf(prefix, sizeof(prefix), "{\"ts\":\"%s\",\"level\":\"%s\",\"thread\":%u,\"src\":\"", timestamp,
+                      LevelName(record.level), record.thread);
+        out += prefix;
+        AppendJsonEscaped(out, BaseName(record.file), std::strlen(BaseName(record.file)));
+        out += ':';
+        out += std::to_string(record.line);
+        out += "\",\"msg\":\"";
+        AppendJsonEscaped(out, record.text, record.length);
+        out += '"';
+        if (record.suppressed > 0) {
+            out += ",\"suppressed\":";
+            out += std::to_string(record.suppressed);
+        }
+        out += "}\n";
+        return;
+    }
+
+    std::snprintf(prefix, sizeof(prefix), "%s %-5s [t%u] ", timestamp, LevelName(record.level), record.thread);
+    out += prefix;
+    out += BaseName(record.file);
+    out += ':';
+    out += std::to_string(record.line);
+    out += ' ';
+    out.append(record.text, record.length);
+    if (record.suppressed > 0) {
+        out += " (";
+        out += std::to_string(record.suppressed);
+        out += " similar suppressed)";
+    }
+    out += '\n';
+}
+
+void WriteOut(const std::string& text) {
+    if (text.empty()) {
+        return;
+    }
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fflush(stdout);
+}
+
+// Writes every published record, oldest first per thread, and forgets the
+// rings of threads that have exited once they are empty.
+void DrainOnce(std::string& out) {
+    Writer& writer = GetWriter();
+    Format format = static_cast<Format>(writer.format.load(std::memory_order_relaxed));
+
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(writer.rings_mutex);
+        rings = writer.rings;
+    }
+
+    out.clear();
+    bool any_retired = false;
+    for (const auto& ring : rings) {
+        // Read before draining: a retired ring has no producer left, so
+        // whatever this pass leaves behind was never going to be published
+        bool retired = ring->retired.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Record& record = ring->slots[tail % kRingSlots];
+            if (!record.ready.load(std::memory_order_acquire)) {
+                break;
+            }
+            FormatRecord(record, format, out);
+            record.ready.store(false, std::memory_order_relaxed);
+            ring->tail.store(++tail, std::memory_order_release);
+        }
+        any_retired |= retired;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(writer.io_mutex);
+        WriteOut(out);
+    }
+
+    if (any_retired) {
+        std::lock_guard<std::mutex> lock(writer.rings_mutex);
+        for (auto it = writer.rings.begin(); it != writer.rings.end();) {
+            if ((*it)->retired.load(std::memory_order_acquire) &&
+                !(*it)->slots[(*it)->tail.load(std::memory_order_relaxed) % kRingSlots].ready.load(
+                    std::memory_order_acquire)) {
+                it = writer.rings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void WriterLoop() {
+    Writer& writer = GetWriter();
+    std::string out;
+
+    std::unique_lock<std::mutex> lock(writer.state_mutex);
+    while (writer.running) {
+        uint64_t pass = ++writer.passes_started;
+        lock.unlock();
+        DrainOnce(out);
+        lock.lock();
+        writer.passes_done = pass;
+        writer.drained.notify_all();
+
+        if (writer.running && writer.passes_started == pass) {
+            writer.wake.wait_for(lock, kWriterIdle);
+        }
+    }
+}
+
+void StartWriter() {
+    Writer& writer = GetWriter();
+    std::lock_guard<std::mutex> lock(writer.state_mutex);
+    if (writer.started || writer.stopped.load(std::memory_order_relaxed)) {
+        return;
+    }
+    writer.started = true;
+    writer.running = true;
+    writer.thread = std::thread(WriterLoop);
+    std::atexit(Shutdown);
+}
+
+// Marks the thread's ring retired when the thread exits
+struct ThreadRing {
+    std::shared_ptr<Ring> ring;
+    ~ThreadRing();
+};
+
+thread_local bool t_ring_destroyed = false;
+thread_local ThreadRing t_ring;
+
+ThreadRing::~ThreadRing() {
+    t_ring_destroyed = true;
+    if (ring) {
+        ring->retired.store(true, std::memory_order_release);
+    }
+}
+
+Ring* LocalRing() {
+    if (t_ring_destroyed) {
+        return nullptr;
+    }
+    if (!t_ring.ring) {
+        Writer& writer = GetWriter();
+        auto ring = std::make_shared<Ring>();
+        ring->thread = writer.next_thread.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(writer.rings_mutex);
+            writer.rings.push_back(ring);
+        }
+        t_ring.ring = std::move(ring);
+        StartWriter();
+    }
+    return t_ring.ring.get();
+}
+
+uint32_t ThreadIndex() {
+    return t_ring.ring && !t_ring_destroyed ? t_ring.ring->thread : 0;
+}
+
+} // namespace
+
+void SetLevel(Level level) {
+    detail::g_level.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+Level GetLevel() {
+    return static_cast<Level>(detail::g_level.load(std::memory_order_relaxed));
+}
+
+void SetFormat(Format format) {
+    GetWriter().format.store(static_cast<uint8_t>(format), std::memory_order_relaxed);
+}
+
+bool ParseLevel(std::string_view name, Level* level) {
+    static const std::pair<std::string_view, Level> kNames[] = {
+        {"debug", Level::kDebug}, {"info", Level::kInfo}, {"warn", Level::kWarn},
+        {"warning", Level::kWarn}, {"error", Level::kError}, {"off", Level::kOff},
+    };
+    for (const auto& entry : kNames) {
+        if (entry.first == name) {
+            *level = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Flush() {
+    Writer& writer = GetWriter();
+    std::unique_lock<std::mutex> lock(writer.state_mutex);
+    if (!writer.running) {
+        return;
+    }
+    // The first pass to start after this point sees everything logged before it
+    uint64_t target = writer.passes_started + 1;
+    writer.wake.notify_one();
+    writer.drained.wait(lock, [&]() { return !writer.running || writer.passes_done >= target; });
+}
+
+void Shutdown() {
+    Writer& writer = GetWriter();
+    {
+        std::lock_guard<std::mutex> lock(writer.state_mutex);
+        if (writer.stopped.exchange(true)) {
+            return;
+        }
+        writer.running = false;
+        writer.wake.notify_one();
+        writer.drained.notify_all();
+    }
+    if (writer.thread.joinable()) {
+        writer.thread.join();
+    }
+
+    std::string out;
+    DrainOnce(out);
+}
+
+uint64_t DroppedRecords() {
+    return GetWriter().dropped.load(std::memory_order_relaxed);
+}
+
+LogLine::LogLine(Level level, const char* file, int line) : record_(nullptr), length_(0) {
+    Begin(level, file, line, 0);
+}
+
+LogLine::LogLine(RateLimiter* limiter, Level level, const char* file, int line) : record_(nullptr), length_(0) {
+    if (limiter->Allow()) {
+        Begin(level, file, line, limiter->TakeSuppressed());
+    }
+}
+
+void LogLine::Begin(Level level, const char* file, int line, uint64_t suppressed) {
+    Writer& writer = GetWriter();
+    Ring* ring = writer.stopped.load(std::memory_order_acquire) ? nullptr : LocalRing();
+
+    if (ring) {
+        if (ring->reserve - ring->tail.load(std::memory_order_acquire) >= kRingSlots) {
+            writer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        record_ = &ring->slots[ring->reserve++ % kRingSlots];
+
+        // Half full: don't wait out the writer's idle period
+        if (ring->reserve - ring->tail.load(std::memory_order_relaxed) == kRingSlots / 2) {
+            writer.wake.notify_one();
+        }
+    } else {
+        // No writer (shut down, or this thread is exiting): write synchronously
+        record_ = new Record();
+    }
+
+    record_->level = level;
+    record_->file = file;
+    record_->line = static_cast<uint32_t>(line);
+    record_->thread = ThreadIndex();
+    record_->time_us = NowMicros();
+    record_->suppressed = suppressed;
+}
+
+LogLine::~LogLine() {
+    if (!record_) {
+        return;
+    }
+    record_->length = static_cast<uint16_t>(length_);
+
+    Writer& writer = GetWriter();
+    bool in_ring = !t_ring_destroyed && t_ring.ring && record_ >= t_ring.ring->slots &&
+                   record_ < t_ring.ring->slots + kRingSlots;
+    if (in_ring) {
+        record_->ready.store(true, std::memory_order_release);
+        return;
+    }
+
+    std::string out;
+    FormatRecord(*record_, static_cast<Format>(writer.format.load(std::memory_order_relaxed)), out);
+    {
+        std::lock_guard<std::mutex> lock(writer.io_mutex);
+        WriteOut(out);
+    }
+    delete record_;
+}
+
+LogLine& LogLine::operator<<(const char* text) {
+    if (text) {
+        Append(text, std::strlen(text));
+    }
+    return *this;
+}
+
+LogLine& LogLine::operator<<(double value) {
+    char buffer[32];
+    int written = std::snprintf(buffer, sizeof(buffer), "%g", value);
+    if (written > 0) {
+        Append(buffer, std::min(static_cast<size_t>(written), sizeof(buffer) - 1));
+    }
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const void* pointer) {
+    char buffer[24];
+    int written = std::snprintf(buffer, sizeof(buffer), "%p", pointer);
+    if (written > 0) {
+        Append(buffer, std::min(static_cast<size_t>(written), sizeof(buffer) - 1));
+    }
+    return *this;
+}
+
+void LogLine::Append(const char* data, size_t size) {
+    if (!record_ || length_ >= kMaxMessage) {
+        return;
+    }
+    // Long messages are truncated, never split
+    size_t room = kMaxMessage - length_;
+    if (size > room) {
+        size = room;
+    }
+    std::memcpy(record_->text + length_, data, size);
+    length_ += size;
+}
+
+void LogLine::AppendSigned(int64_t value) {
+    if (value < 0) {
+        Append("-", 1);
+        AppendUnsigned(static_cast<uint64_t>(-(value + 1)) + 1);
+    } else {
+        AppendUnsigned(static_cast<uint64_t>(value));
+    }
+}
+
+void LogLine::AppendUnsigned(uint64_t value) {
+    char buffer[20];
+    size_t position = sizeof(buffer);
+    do {
+        buffer[--position] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    Append(buffer + position, sizeof(buffer) - position);
+}
+
+bool RateLimiter::Allow() {
+    // The coarse clock (jiffy resolution) is plenty for one-second windows
+    // and keeps suppressed calls cheap
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    uint64_t now_us = static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + static_cast<uint64_t>(ts.tv_nsec) / 1000ULL;
+
+    uint64_t window_start = window_start_us_.load(std::memory_order_relaxed);
+    if (now_us - window_start >= 1000000 &&
+        window_start_us_.compare_exchange_strong(window_start, now_us, std::memory_order_relaxed)) {
+        count_.store(0, std::memory_order_relaxed);
+    }
+
+    if (count_.fetch_add(1, std::memory_order_relaxed) < per_second_) {
+        return true;
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+} // namespace log
+} // namespace driftway
@@ -1,7 +1,10 @@
 #include "voice_server.h"
+#include "dsp_kernels.h"
+#include "logger.h"
 #include <iostream>
 #include <csignal>
 #include <cstdlib>
+#include <string>
 #include <thread>
 #include <chrono>
 
@@ -15,6 +18,7 @@ void SignalHandler(int signal) {
     if (g_server) {
         g_server->Stop();
     }
+    log::Shutdown();
     exit(0);
 }
 
@@ -59,14 +63,95 @@ int main(int argc, char* argv[]) {
         config.max_participants = std::atoi(max_participants);
     }
 
+    if (const char* complexity = std::getenv("VOICE_OPUS_COMPLEXITY")) {
+        config.opus_complexity = std::atoi(complexity);
+    }
+
+    if (const char* bitrate = std::getenv("VOICE_OPUS_BITRATE")) {
+        config.opus_bitrate = std::atoi(bitrate);
+    }
+
+    if (const char* fec = std::getenv("VOICE_OPUS_FEC")) {
+        config.opus_fec = std::atoi(fec) != 0;
+    }
+
+    if (const char* dtx = std::getenv("VOICE_OPUS_DTX")) {
+        config.opus_dtx = std::atoi(dtx) != 0;
+    }
+
+    if (const char* workers = std::getenv("VOICE_MEDIA_WORKERS")) {
+        config.media_workers = std::atoi(workers);
+    }
+
+    if (const char* last_n = std::getenv("VOICE_LAST_N")) {
+        config.last_n = std::atoi(last_n);
+    }
+
+    if (const char* suppression = std::getenv("VOICE_SILENCE_SUPPRESSION")) {
+        config.silence_suppression = std::atoi(suppression) != 0;
+    }
+
+    if (const char* noise = std::getenv("VOICE_NOISE_SUPPRESSION")) {
+        config.noise_suppression = std::atoi(noise) != 0;
+    }
+
+    if (const char* signaling = std::getenv("VOICE_HTTP_SIGNALING")) {
+        config.http_signaling = std::atoi(signaling) != 0;
+    }
+
+    if (const char* ufrag = std::getenv("VOICE_ICE_UFRAG")) {
+        config.ice_ufrag = ufrag;
+    }
+
+    if (const char* password = std::getenv("VOICE_ICE_PASSWORD")) {
+        config.ice_password = password;
+    }
+
+    std::string log_level = "info";
+    if (const char* level = std::getenv("VOICE_LOG_LEVEL")) {
+        log::Level parsed;
+        if (log::ParseLevel(level, &parsed)) {
+            log::SetLevel(parsed);
+            log_level = level;
+        } else {
+            std::cerr << "Ignoring unknown VOICE_LOG_LEVEL: " << level << std::endl;
+        }
+    }
+
+    bool log_json = false;
+    if (const char* format = std::getenv("VOICE_LOG_FORMAT")) {
+        log_json = std::string(format) == "json";
+        log::SetFormat(log_json ? log::Format::kJson : log::Format::kText);
+    }
+
     // Print configuration
     std::cout << "Configuration:" << std::endl;
     std::cout << "  MongoDB URI: " << config.mongo_uri << std::endl;
     std::cout << "  Redis URL: " << config.redis_url << std::endl;
     std::cout << "  API Gateway: " << config.api_gateway_url << std::endl;
     std::cout << "  HTTP Port: " << config.http_port << std::endl;
-    std::cout << "  RTC Port: " << config.rtc_port << std::endl;
+    std::cout << "  RTC Port: " << config.rtc_port << " (STUN, DTLS and RTP)" << std::endl;
+    std::cout << "  ICE: lite, " << (config.ice_ufrag.empty() ? "generated credentials" : "ufrag " + config.ice_ufrag)
+              << std::endl;
     std::cout << "  Max Participants: " << config.max_participants << std::endl;
+    std::cout << "  Media Workers: ";
+    if (config.media_workers > 0) {
+        std::cout << config.media_workers << std::endl;
+    } else {
+        std::cout << "one per CPU" << std::endl;
+    }
+    std::cout << "  Opus: complexity " << config.opus_complexity << ", " << config.opus_bitrate << " bps, FEC "
+              << (config.opus_fec ? "on" : "off") << ", DTX " << (config.opus_dtx ? "on" : "off") << std::endl;
+    std::cout << "  Last-N: ";
+    if (config.last_n > 0) {
+        std::cout << config.last_n << " speakers" << std::endl;
+    } else {
+        std::cout << "off" << std::endl;
+    }
+    std::cout << "  Silence Suppression: " << (config.silence_suppression ? "on" : "off") << std::endl;
+    std::cout << "  Noise Suppression: " << (config.noise_suppression ? "on" : "off") << std::endl;
+    std::cout << "  DSP Kernels: " << dsp::Active().name << std::endl;
+    std::cout << "  Logging: " << log_level << (log_json ? " (json)" : "") << std::endl;
     std::cout << std::endl;
 
     // Create and start server
@@ -78,6 +163,7 @@ int main(int argc, char* argv[]) {
         
         if (!server.Start()) {
             std::cerr << "Failed to start voice server!" << std::endl;
+            log::Shutdown();
             return 1;
         }
 
@@ -98,8 +184,10 @@ int main(int argc, char* argv[]) {
 
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
+        log::Shutdown();
         return 1;
     }
 
+    log::Shutdown();
     return 0;
 }
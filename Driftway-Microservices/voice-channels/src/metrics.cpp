@@ -0,0 +1,238 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace driftway {
+
+namespace detail {
+
+uint32_t NextMetricsShard() {
+    static std::atomic<uint32_t> next{0};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+uint64_t ShardedCounter::Value() const {
+    uint64_t total = 0;
+    for (const Cell& cell : cells_) {
+        total += cell.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+HdrHistogram::HdrHistogram() {
+    for (auto& shard : shards_) {
+        shard.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+HdrHistogram::~HdrHistogram() {
+    for (auto& shard : shards_) {
+        delete shard.load(std::memory_order_acquire);
+    }
+}
+
+size_t HdrHistogram::BucketIndex(uint64_t value) {
+    value = std::min<uint64_t>(value, std::numeric_limits<uint32_t>::max());
+    if (value < (1u << kSubBucketBits)) {
+        return static_cast<size_t>(value);
+    }
+    // Keep the top kSubBucketBits bits: the shift picks the power of two,
+    // the remaining bits (64..127) the sub-bucket within it
+    uint32_t msb = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+    uint32_t shift = msb - (kSubBucketBits - 1);
+    return (static_cast<size_t>(shift) << (kSubBucketBits - 1)) + static_cast<size_t>(value >> shift);
+}
+
+uint64_t HdrHistogram::BucketUpperBound(size_t index) {
+    if (index < (1u << kSubBucketBits)) {
+        return index;
+    }
+    const size_t half = size_t{1} << (kSubBucketBits - 1);
+    uint32_t shift = static_cast<uint32_t>(index / half - 1);
+    uint64_t sub_bucket = index % half + half;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+HdrHistogram::Shard* HdrHistogram::LocalShard() {
+    std::atomic<Shard*>& slot = shards_[MetricsShard()];
+    Shard* shard = slot.load(std::memory_order_acquire);
+    if (shard) {
+        return shard;
+    }
+
+    // Value-initialized, so every count starts at zero. Two threads sharing
+    // a slot may race here; the loser's array is discarded.
+    Shard* fresh = new Shard();
+    if (slot.compare_exchange_strong(shard, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return fresh;
+    }
+    delete fresh;
+    return shard;
+}
+
+void HdrHistogram::Record(uint64_t value) {
+    Shard* shard = LocalShard();
+    shard->counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    shard->sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+HdrHistogram::Snapshot HdrHistogram::GetSnapshot() const {
+    Snapshot snapshot;
+    snapshot.counts.assign(kBuckets, 0);
+
+    for (const auto& slot : shards_) {
+        const Shard* shard = slot.load(std::memory_order_acquire);
+        if (!shard) {
+            continue;
+        }
+        for (size_t i = 0; i < kBuckets; ++i) {
+            uint64_t count = shard->counts[i].load(std::memory_order_relaxed);
+            snapshot.counts[i] += count;
+            snapshot.count += count;
+        }
+        snapshot.sum += shard->sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+uint64_t HdrHistogram::Snapshot::ValueAtQuantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    q = std::min(std::max(q, 0.0), 1.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return BucketUpperBound(i);
+        }
+    }
+    return BucketUpperBound(counts.size() - 1);
+}
+
+uint64_t HdrHistogram::Snapshot::CountAtOrBelow(uint64_t value) const {
+    if (counts.empty()) {
+        return 0;
+    }
+    size_t last = std::min(BucketIndex(value), counts.size() - 1);
+    uint64_t total = 0;
+    for (size_t i = 0; i <= last; ++i) {
+        total += counts[i];
+    }
+    return total;
+}
+
+MediaMetrics& GetMediaMetrics() {
+    // Never destroyed: media threads may still record during static destruction
+    static MediaMetrics* metrics = new MediaMetrics();
+    return *metrics;
+}
+
+void PrometheusWriter::Family(std::string_view name, std::string_view type, std::string_view help) {
+    out_.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out_.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void PrometheusWriter::BeginSample(std::string_view name, Labels labels) {
+    out_.append(name);
+    if (labels.size() > 0) {
+        out_.push_back('{');
+        bool first = true;
+        for (const auto& label : labels) {
+            if (!first) {
+                out_.push_back(',');
+            }
+            first = false;
+            out_.append(label.first).append("=\"");
+            AppendLabelValue(label.second);
+            out_.push_back('"');
+        }
+        out_.push_back('}');
+    }
+    out_.push_back(' ');
+}
+
+void PrometheusWriter::AppendLabelValue(std::string_view value) {
+    for (char c : value) {
+        switch (c) {
+        case '\\':
+            out_.append("\\\\");
+            break;
+        case '"':
+            out_.append("\\\"");
+            break;
+        case '\n':
+            out_.append("\\n");
+            break;
+        default:
+            out_.push_back(c);
+        }
+    }
+}
+
+void PrometheusWriter::AppendDouble(double value) {
+    if (std::isnan(value)) {
+        out_.append("NaN");
+    } else if (std::isinf(value)) {
+        out_.append(value > 0 ? "+Inf" : "-Inf");
+    } else {
+        // Whole numbers (counts exported through gauges) keep every digit
+        char buffer[32];
+        bool whole = value == std::floor(value) && std::fabs(value) < 9007199254740992.0;
+        int length = std::snprintf(buffer, sizeof(buffer), whole ? "%.0f" : "%.9g", value);
+        out_.append(buffer, static_cast<size_t>(length));
+    }
+}
+
+void PrometheusWriter::Sample(std::string_view name, uint64_t value, Labels labels) {
+    BeginSample(name, labels);
+    out_.append(std::to_string(value)).push_back('\n');
+}
+
+void PrometheusWriter::Sample(std::string_view name, double value, Labels labels) {
+    BeginSample(name, labels);
+    AppendDouble(value);
+    out_.push_back('\n');
+}
+
+void PrometheusWriter::Histogram(std::string_view name, std::string_view help,
+                                 const HdrHistogram::Snapshot& snapshot, const std::vector<double>& bounds,
+                                 double scale) {
+    Family(name, "histogram", help);
+
+    std::string bucket(name);
+    bucket.append("_bucket");
+    char le[32];
+    for (double bound : bounds) {
+        std::snprintf(le, sizeof(le), "%.9g", bound);
+        // Bucket boundaries fall inside HDR buckets; values sharing the
+        // bound's HDR bucket are counted as below it
+        uint64_t recorded_bound = static_cast<uint64_t>(std::floor(bound / scale + 1e-9));
+        Sample(bucket, snapshot.CountAtOrBelow(recorded_bound), {{"le", le}});
+    }
+    Sample(bucket, snapshot.count, {{"le", "+Inf"}});
+
+    Sample(std::string(name) + "_sum", static_cast<double>(snapshot.sum) * scale);
+    Sample(std::string(name) + "_count", snapshot.count);
+}
+
+void PrometheusWriter::Quantiles(std::string_view name, std::string_view help,
+                                 const HdrHistogram::Snapshot& snapshot, double scale) {
+    static const std::pair<const char*, double> kQuantiles[] = {
+        {"0.5", 0.5}, {"0.9", 0.9}, {"0.99", 0.99}, {"0.999", 0.999}};
+
+    Family(name, "gauge", help);
+    for (const auto& quantile : kQuantiles) {
+        Sample(name, static_cast<double>(snapshot.ValueAtQuantile(quantile.second)) * scale,
+               {{"quantile", quantile.first}});
+    }
+}
+
+} // namespace driftway
@@ -0,0 +1,80 @@
+#include "crc32.h"
+#include "crc32_internal.h"
+
+#include <cstring>
+
+namespace driftway {
+
+namespace {
+
+struct Tables {
+    uint32_t t[8][256];
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+            }
+            t[0][i] = crc;
+        }
+        // t[k][i]: CRC of byte i followed by k zero bytes
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k) {
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+const Tables& GetTables() {
+    static const Tables tables;
+    return tables;
+}
+
+uint32_t UpdateSliceBy8(const uint8_t* data, size_t size, uint32_t state) {
+    const auto& t = GetTables().t;
+
+    while (size >= 8) {
+        // Bytes are consumed in stream order, so this is endian-independent
+        uint32_t lo = state ^ (static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                               (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24));
+        state = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        state = (state >> 8) ^ t[0][(state ^ *data++) & 0xFF];
+    }
+    return state;
+}
+
+bool DetectPclmul() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+
+} // namespace
+
+uint32_t Crc32SliceBy8(const uint8_t* data, size_t size, uint32_t crc) {
+    return ~UpdateSliceBy8(data, size, ~crc);
+}
+
+bool Crc32HasPclmul() {
+    static const bool supported = DetectPclmul();
+    return supported;
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    uint32_t state = ~crc;
+    if (size >= detail::kCrc32PclmulMinSize && Crc32HasPclmul()) {
+        size_t folded = size & ~size_t{15};
+        state = detail::Crc32FoldPclmul(data, folded, state);
+        data += folded;
+        size -= folded;
+    }
+    return ~UpdateSliceBy8(data, size, state);
+}
+
+} // namespace driftway
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace driftway {
+namespace detail {
+
+// Folds whole 16-byte blocks with PCLMULQDQ; size must be a multiple of 16
+// and at least kCrc32PclmulMinSize. Works on the raw register: the caller does
+// the pre- and post-inversion. Built with -mpclmul -msse4.1 and only called
+// after a runtime CPU check.
+constexpr size_t kCrc32PclmulMinSize = 64;
+uint32_t Crc32FoldPclmul(const uint8_t* data, size_t size, uint32_t state);
+
+} // namespace detail
+} // namespace driftway
@@ -0,0 +1,80 @@
+#include "crc32_internal.h"
+
+#include <smmintrin.h>
+#include <wmmintrin.h>
+
+namespace driftway {
+namespace detail {
+
+namespace {
+
+// Folding constants for the reflected polynomial, x^n mod P(x) bit-reversed
+// (Intel, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ")
+alignas(16) const uint64_t kFold4[2] = {0x0154442bd4, 0x01c6e41596}; // 512-bit stride
+alignas(16) const uint64_t kFold1[2] = {0x01751997d0, 0x00ccaa009e}; // 128-bit stride
+alignas(16) const uint64_t kFold64[2] = {0x0163cd6124, 0};           // 64 to 32 bits
+alignas(16) const uint64_t kBarrett[2] = {0x01db710641, 0x01f7011641}; // P(x), floor(x^64 / P(x))
+
+inline __m128i Fold(__m128i acc, __m128i k, __m128i next) {
+    __m128i lo = _mm_clmulepi64_si128(acc, k, 0x00);
+    __m128i hi = _mm_clmulepi64_si128(acc, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+}
+
+inline __m128i Load(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+} // namespace
+
+uint32_t Crc32FoldPclmul(const uint8_t* data, size_t size, uint32_t state) {
+    __m128i x1 = _mm_xor_si128(Load(data), _mm_cvtsi32_si128(static_cast<int>(state)));
+    __m128i x2 = Load(data + 16);
+    __m128i x3 = Load(data + 32);
+    __m128i x4 = Load(data + 48);
+    data += 64;
+    size -= 64;
+
+    // Four independent lanes keep the multiplier pipeline full
+    __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(kFold4));
+    while (size >= 64) {
+        x1 = Fold(x1, k, Load(data));
+        x2 = Fold(x2, k, Load(data + 16));
+        x3 = Fold(x3, k, Load(data + 32));
+        x4 = Fold(x4, k, Load(data + 48));
+        data += 64;
+        size -= 64;
+    }
+
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(kFold1));
+    x1 = Fold(x1, k, x2);
+    x1 = Fold(x1, k, x3);
+    x1 = Fold(x1, k, x4);
+    while (size >= 16) {
+        x1 = Fold(x1, k, Load(data));
+        data += 16;
+        size -= 16;
+    }
+
+    // 128 -> 64 bits
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    // 64 -> 32 bits
+    k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(kFold64));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to the 32-bit remainder
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(kBarrett));
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+} // namespace detail
+} // namespace driftway
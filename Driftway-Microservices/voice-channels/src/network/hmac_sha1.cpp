@@ -0,0 +1,123 @@
+#include "hmac_sha1.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+#include <cstring>
+
+namespace driftway {
+
+namespace {
+
+constexpr size_t kSha1BlockSize = 64;
+
+const EVP_MD* Sha1() {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    // Fetched once; EVP_sha1() would look up the provider on every init
+    static EVP_MD* md = EVP_MD_fetch(nullptr, "SHA1", nullptr);
+    return md;
+#else
+    return EVP_sha1();
+#endif
+}
+
+// One digest context per thread, reused for every MAC it computes
+EVP_MD_CTX* ThreadDigest() {
+    struct Context {
+        EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+        ~Context() { EVP_MD_CTX_free(ctx); }
+    };
+    thread_local Context context;
+    return context.ctx;
+}
+
+} // namespace
+
+HmacSha1::HmacSha1(const uint8_t* key, size_t size) {
+    const EVP_MD* md = Sha1();
+    if (!md) {
+        return;
+    }
+
+    uint8_t block[kSha1BlockSize] = {};
+    if (size > kSha1BlockSize) {
+        unsigned int digest_size = 0;
+        if (!EVP_Digest(key, size, block, &digest_size, md, nullptr)) {
+            return;
+        }
+    } else if (size > 0) {
+        std::memcpy(block, key, size);
+    }
+
+    uint8_t inner_pad[kSha1BlockSize];
+    uint8_t outer_pad[kSha1BlockSize];
+    for (size_t i = 0; i < kSha1BlockSize; ++i) {
+        inner_pad[i] = block[i] ^ 0x36;
+        outer_pad[i] = block[i] ^ 0x5C;
+    }
+
+    inner_ = EVP_MD_CTX_new();
+    outer_ = EVP_MD_CTX_new();
+    bool ok = inner_ && outer_ &&
+              EVP_DigestInit_ex(inner_, md, nullptr) &&
+              EVP_DigestUpdate(inner_, inner_pad, sizeof(inner_pad)) &&
+              EVP_DigestInit_ex(outer_, md, nullptr) &&
+              EVP_DigestUpdate(outer_, outer_pad, sizeof(outer_pad));
+
+    OPENSSL_cleanse(block, sizeof(block));
+    OPENSSL_cleanse(inner_pad, sizeof(inner_pad));
+    OPENSSL_cleanse(outer_pad, sizeof(outer_pad));
+    if (!ok) {
+        Reset();
+    }
+}
+
+HmacSha1::~HmacSha1() {
+    Reset();
+}
+
+HmacSha1::HmacSha1(HmacSha1&& other) noexcept : inner_(other.inner_), outer_(other.outer_) {
+    other.inner_ = nullptr;
+    other.outer_ = nullptr;
+}
+
+HmacSha1& HmacSha1::operator=(HmacSha1&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        inner_ = other.inner_;
+        outer_ = other.outer_;
+        other.inner_ = nullptr;
+        other.outer_ = nullptr;
+    }
+    return *this;
+}
+
+void HmacSha1::Reset() {
+    EVP_MD_CTX_free(inner_);
+    EVP_MD_CTX_free(outer_);
+    inner_ = nullptr;
+    outer_ = nullptr;
+}
+
+bool HmacSha1::Compute(std::initializer_list<Piece> pieces, uint8_t* mac) const {
+    EVP_MD_CTX* ctx = ThreadDigest();
+    if (!IsSet() || !ctx || !EVP_MD_CTX_copy_ex(ctx, inner_)) {
+        return false;
+    }
+    for (const Piece& piece : pieces) {
+        if (piece.second > 0 && !EVP_DigestUpdate(ctx, piece.first, piece.second)) {
+            return false;
+        }
+    }
+
+    uint8_t inner[EVP_MAX_MD_SIZE];
+    unsigned int inner_size = 0;
+    unsigned int mac_size = 0;
+    bool ok = EVP_DigestFinal_ex(ctx, inner, &inner_size) &&
+              EVP_MD_CTX_copy_ex(ctx, outer_) &&
+              EVP_DigestUpdate(ctx, inner, inner_size) &&
+              EVP_DigestFinal_ex(ctx, mac, &mac_size);
+    return ok && mac_size == kSize;
+}
+
+} // namespace driftway
@@ -0,0 +1,313 @@
+#include "jitter_buffer.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace driftway {
+
+namespace {
+
+// RFC 3550 A.1 thresholds
+constexpr uint32_t kMaxDropout = 3000;
+constexpr uint32_t kMaxMisorder = 100;
+constexpr uint32_t kSequenceMod = 1u << 16;
+
+// Consecutive packets wanting a lower delay before the target shrinks by
+// one frame (about a second of 20 ms audio)
+constexpr uint32_t kShrinkAfterPackets = 50;
+
+size_t RoundUpPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+JitterBuffer::JitterBuffer(uint32_t ssrc) : JitterBuffer(ssrc, Config()) {
+}
+
+JitterBuffer::JitterBuffer(uint32_t ssrc, const Config& config)
+    : ssrc_(ssrc), config_(config), playout_enabled_(false),
+      initialized_(false), base_ext_seq_(0), max_ext_seq_(0), bad_seq_(kSequenceMod + 1),
+      received_(0), duplicates_(0), reordered_(0), late_discarded_(0), received_window_(0),
+      has_transit_(false), last_transit_(0), jitter_(0.0),
+      depth_(0), playout_started_(false), next_play_ext_seq_(0), next_play_timestamp_(0),
+      playout_base_us_(0), playout_base_timestamp_(0),
+      target_delay_ms_(config.min_delay_ms), shrink_credit_(0) {
+    config_.capacity = RoundUpPowerOfTwo(std::max<size_t>(config_.capacity, 2));
+    mask_ = config_.capacity - 1;
+    if (config_.frame_ms == 0) {
+        config_.frame_ms = 20;
+    }
+    published_target_ms_.store(target_delay_ms_, std::memory_order_relaxed);
+}
+
+void JitterBuffer::SetPlayoutEnabled(bool enabled) {
+    if (playout_enabled_ == enabled) {
+        return;
+    }
+
+    playout_enabled_ = enabled;
+    if (enabled) {
+        slots_.assign(config_.capacity, AudioPacket());
+        occupied_.assign(config_.capacity, false);
+    } else {
+        slots_.clear();
+        occupied_.clear();
+    }
+    depth_ = 0;
+    playout_started_ = false;
+    Publish();
+}
+
+void JitterBuffer::ResetSequence(uint16_t seq) {
+    // Extended numbers start one cycle in so early reordering cannot underflow
+    base_ext_seq_ = kSequenceMod + seq;
+    max_ext_seq_ = base_ext_seq_;
+    bad_seq_ = kSequenceMod + 1;
+    received_ = 0;
+    received_window_ = 0;
+    initialized_ = true;
+}
+
+uint64_t JitterBuffer::ExtendSequence(uint16_t seq) const {
+    int16_t delta = static_cast<int16_t>(seq - static_cast<uint16_t>(max_ext_seq_));
+    return static_cast<uint64_t>(static_cast<int64_t>(max_ext_seq_) + delta);
+}
+
+bool JitterBuffer::UpdateSequence(uint16_t seq, uint64_t* ext_seq) {
+    if (!initialized_) {
+        ResetSequence(seq);
+        received_window_ = 1;
+        received_++;
+        *ext_seq = max_ext_seq_;
+        return true;
+    }
+
+    uint16_t udelta = static_cast<uint16_t>(seq - static_cast<uint16_t>(max_ext_seq_));
+
+    if (udelta == 0) {
+        duplicates_++;
+        return false;
+    }
+
+    if (udelta < kMaxDropout) {
+        // In order, with a permissible gap
+        max_ext_seq_ += udelta;
+        received_window_ = udelta >= 64 ? 0 : received_window_ << udelta;
+        received_window_ |= 1;
+        *ext_seq = max_ext_seq_;
+    } else if (udelta <= kSequenceMod - kMaxMisorder) {
+        // A very large jump. Two sequential packets mean the source restarted.
+        if (seq != bad_seq_) {
+            bad_seq_ = (seq + 1u) & (kSequenceMod - 1);
+            return false;
+        }
+        ResetSequence(seq);
+        received_window_ = 1;
+        *ext_seq = max_ext_seq_;
+        if (playout_enabled_) {
+            std::fill(occupied_.begin(), occupied_.end(), false);
+            std::fill(slots_.begin(), slots_.end(), AudioPacket());
+            depth_ = 0;
+            playout_started_ = false;
+        }
+    } else {
+        // Reordered within the misorder window
+        uint32_t back = kSequenceMod - udelta;
+        if (back < 64) {
+            uint64_t bit = 1ULL << back;
+            if (received_window_ & bit) {
+                duplicates_++;
+                return false;
+            }
+            received_window_ |= bit;
+        }
+        *ext_seq = max_ext_seq_ - back;
+        reordered_++;
+    }
+
+    received_++;
+    return true;
+}
+
+void JitterBuffer::UpdateJitter(uint32_t rtp_timestamp, uint64_t arrival_us) {
+    // Arrival in timestamp units; only differences matter, so wrap is fine
+    uint32_t arrival = static_cast<uint32_t>(arrival_us * config_.clock_rate / 1000000ULL);
+    int64_t transit = static_cast<int32_t>(arrival - rtp_timestamp);
+
+    if (has_transit_) {
+        int64_t d = static_cast<int32_t>(static_cast<uint32_t>(transit - last_transit_));
+        jitter_ += (static_cast<double>(std::llabs(d)) - jitter_) / 16.0;
+    }
+    last_transit_ = transit;
+    has_transit_ = true;
+}
+
+void JitterBuffer::AdaptTargetDelay() {
+    double jitter_ms = jitter_ * 1000.0 / config_.clock_rate;
+
+    // Three jitter deviations of headroom, in whole frames
+    uint32_t desired = config_.min_delay_ms + static_cast<uint32_t>(3.0 * jitter_ms);
+    desired = ((desired + config_.frame_ms - 1) / config_.frame_ms) * config_.frame_ms;
+    desired = std::min(std::max(desired, config_.min_delay_ms), config_.max_delay_ms);
+
+    if (desired > target_delay_ms_) {
+        // Grow at once: push the schedule back so upcoming packets make it
+        playout_base_us_ += static_cast<uint64_t>(desired - target_delay_ms_) * 1000;
+        target_delay_ms_ = desired;
+        shrink_credit_ = 0;
+    } else if (desired < target_delay_ms_) {
+        // Shrink one frame at a time, only after the jitter stayed low
+        if (++shrink_credit_ >= kShrinkAfterPackets) {
+            uint32_t step = std::min(config_.frame_ms, target_delay_ms_ - desired);
+            target_delay_ms_ -= step;
+            playout_base_us_ -= static_cast<uint64_t>(step) * 1000;
+            shrink_credit_ = 0;
+        }
+    } else {
+        shrink_credit_ = 0;
+    }
+}
+
+uint64_t JitterBuffer::DueTime(uint32_t rtp_timestamp) const {
+    int64_t offset = static_cast<int32_t>(rtp_timestamp - playout_base_timestamp_);
+    int64_t offset_us = offset * 1000000 / static_cast<int64_t>(config_.clock_rate);
+    return static_cast<uint64_t>(static_cast<int64_t>(playout_base_us_) + offset_us);
+}
+
+void JitterBuffer::Store(const AudioPacket& packet, uint64_t ext_seq, uint64_t arrival_us) {
+    bool reanchor = !playout_started_;
+    if (playout_started_ && depth_ == 0 && ext_seq >= next_play_ext_seq_ &&
+        DueTime(packet.timestamp) < arrival_us) {
+        // Underrun or DTX silence: restart the schedule from this packet
+        reanchor = true;
+    }
+
+    if (reanchor) {
+        playout_started_ = true;
+        next_play_ext_seq_ = ext_seq;
+        next_play_timestamp_ = packet.timestamp;
+        playout_base_us_ = arrival_us + static_cast<uint64_t>(target_delay_ms_) * 1000;
+        playout_base_timestamp_ = packet.timestamp;
+    }
+
+    if (ext_seq < next_play_ext_seq_) {
+        late_discarded_++;
+        return;
+    }
+
+    // Make room: frames that fall off the front are lost to playout
+    uint32_t frame_samples = config_.clock_rate / 1000 * config_.frame_ms;
+    if (ext_seq - next_play_ext_seq_ >= config_.capacity) {
+        uint64_t new_front = ext_seq - config_.capacity + 1;
+        for (uint64_t seq = next_play_ext_seq_; seq < new_front && depth_ > 0; ++seq) {
+            size_t index = seq & mask_;
+            if (occupied_[index]) {
+                occupied_[index] = false;
+                slots_[index] = AudioPacket();
+                depth_--;
+            }
+        }
+        next_play_timestamp_ += static_cast<uint32_t>((new_front - next_play_ext_seq_) * frame_samples);
+        next_play_ext_seq_ = new_front;
+    }
+
+    size_t index = ext_seq & mask_;
+    if (!occupied_[index]) {
+        depth_++;
+    }
+    slots_[index] = packet;
+    occupied_[index] = true;
+}
+
+void JitterBuffer::Insert(const AudioPacket& packet, uint64_t arrival_us) {
+    uint64_t ext_seq = 0;
+    if (!UpdateSequence(packet.sequence_number, &ext_seq)) {
+        Publish();
+        return;
+    }
+
+    UpdateJitter(packet.timestamp, arrival_us);
+    AdaptTargetDelay();
+
+    if (playout_enabled_) {
+        Store(packet, ext_seq, arrival_us);
+        GetMediaMetrics().jitter_buffer_depth.Record(depth_);
+    }
+
+    Publish();
+}
+
+JitterBuffer::PopResult JitterBuffer::Pop(uint64_t now_us, AudioPacket* packet) {
+    if (!playout_enabled_ || !playout_started_ || depth_ == 0) {
+        return PopResult::kEmpty;
+    }
+
+    if (now_us < DueTime(next_play_timestamp_)) {
+        return PopResult::kNotReady;
+    }
+
+    size_t index = next_play_ext_seq_ & mask_;
+    next_play_ext_seq_++;
+
+    if (!occupied_[index]) {
+        next_play_timestamp_ += config_.clock_rate / 1000 * config_.frame_ms;
+        return PopResult::kLost;
+    }
+
+    *packet = std::move(slots_[index]);
+    slots_[index] = AudioPacket();
+    occupied_[index] = false;
+    depth_--;
+    next_play_timestamp_ = packet->timestamp + config_.clock_rate / 1000 * config_.frame_ms;
+    Publish();
+    return PopResult::kPacket;
+}
+
+const AudioPacket* JitterBuffer::PeekNext() const {
+    if (!playout_enabled_ || !playout_started_ || depth_ == 0) {
+        return nullptr;
+    }
+
+    size_t index = next_play_ext_seq_ & mask_;
+    return occupied_[index] ? &slots_[index] : nullptr;
+}
+
+void JitterBuffer::Publish() {
+    published_received_.store(received_, std::memory_order_relaxed);
+    published_expected_.store(initialized_ ? max_ext_seq_ - base_ext_seq_ + 1 : 0, std::memory_order_relaxed);
+    published_duplicates_.store(duplicates_, std::memory_order_relaxed);
+    published_reordered_.store(reordered_, std::memory_order_relaxed);
+    published_late_.store(late_discarded_, std::memory_order_relaxed);
+    published_highest_.store(static_cast<uint32_t>(max_ext_seq_ - (initialized_ ? kSequenceMod : 0)),
+                             std::memory_order_relaxed);
+    published_jitter_us_.store(static_cast<uint32_t>(jitter_ * 1000000.0 / config_.clock_rate),
+                               std::memory_order_relaxed);
+    published_depth_.store(static_cast<uint32_t>(depth_), std::memory_order_relaxed);
+    published_target_ms_.store(target_delay_ms_, std::memory_order_relaxed);
+}
+
+JitterBuffer::Stats JitterBuffer::GetStats() const {
+    Stats stats;
+    stats.packets_received = published_received_.load(std::memory_order_relaxed);
+    stats.packets_expected = published_expected_.load(std::memory_order_relaxed);
+    stats.packets_lost = static_cast<int64_t>(stats.packets_expected) - static_cast<int64_t>(stats.packets_received);
+    if (stats.packets_expected > 0 && stats.packets_lost > 0) {
+        stats.loss_fraction = static_cast<double>(stats.packets_lost) / static_cast<double>(stats.packets_expected);
+    }
+    stats.jitter_ms = published_jitter_us_.load(std::memory_order_relaxed) / 1000.0;
+    stats.extended_highest_sequence = published_highest_.load(std::memory_order_relaxed);
+    stats.duplicates = published_duplicates_.load(std::memory_order_relaxed);
+    stats.reordered = published_reordered_.load(std::memory_order_relaxed);
+    stats.late_discarded = published_late_.load(std::memory_order_relaxed);
+    stats.depth = published_depth_.load(std::memory_order_relaxed);
+    stats.target_delay_ms = published_target_ms_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace driftway
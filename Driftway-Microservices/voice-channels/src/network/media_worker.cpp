@@ -0,0 +1,128 @@
+#include "media_worker.h"
+#include "voice_channel.h"
+
+#include <algorithm>
+
+namespace driftway {
+
+MediaWorker::MediaWorker(uint32_t index, int port, int cpu)
+    : index_(index), cpu_(cpu), engine_(std::make_unique<UdpMediaEngine>(port)) {
+    engine_->setReusePort(true);
+    engine_->setCpuAffinity(cpu);
+    inbox_.reserve(kInboxCapacity);
+    drain_.reserve(kInboxCapacity);
+    drain_datagrams_.reserve(kInboxCapacity);
+}
+
+MediaWorker::~MediaWorker() {
+    stop();
+    close();
+}
+
+void MediaWorker::start(PacketHandler handler) {
+    handler_ = std::move(handler);
+    engine_->setTickHandler([this](uint64_t now_us) { OnTick(now_us); }, 20);
+    engine_->setWakeHandler([this]() { DrainInbox(); });
+    engine_->start([this](MediaDatagram* datagrams, size_t count) {
+        handler_(*this, datagrams, count, false);
+    });
+}
+
+void MediaWorker::stop() {
+    engine_->stop();
+
+    std::lock_guard<std::mutex> lock(inbox_mutex_);
+    inbox_.clear();
+}
+
+bool MediaWorker::handOff(const MediaDatagram& datagram) {
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(inbox_mutex_);
+        if (inbox_.size() >= kInboxCapacity) {
+            handoff_drops_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        was_empty = inbox_.empty();
+
+        Handoff& handoff = inbox_.emplace_back();
+        handoff.buffer = MediaBufferRef(datagram.buffer);
+        handoff.source = *datagram.source;
+        handoff.data = datagram.data;
+        handoff.size = datagram.size;
+        handoff.arrival_us = datagram.arrival_us;
+    }
+
+    handoffs_.fetch_add(1, std::memory_order_relaxed);
+
+    // One wake per empty -> non-empty transition; the loop drains everything
+    if (was_empty) {
+        engine_->wake();
+    }
+    return true;
+}
+
+void MediaWorker::DrainInbox() {
+    {
+        std::lock_guard<std::mutex> lock(inbox_mutex_);
+        inbox_.swap(drain_);
+    }
+    if (drain_.empty()) {
+        return;
+    }
+
+    drain_datagrams_.resize(drain_.size());
+    for (size_t i = 0; i < drain_.size(); ++i) {
+        MediaDatagram& datagram = drain_datagrams_[i];
+        datagram.data = drain_[i].data;
+        datagram.size = drain_[i].size;
+        datagram.source = &drain_[i].source;
+        datagram.buffer = drain_[i].buffer.get();
+        datagram.arrival_us = drain_[i].arrival_us;
+    }
+
+    handler_(*this, drain_datagrams_.data(), drain_datagrams_.size(), true);
+
+    // Drops the buffer references; anything the handler kept holds its own
+    drain_.clear();
+}
+
+void MediaWorker::addMixingChannel(const std::shared_ptr<VoiceChannel>& channel) {
+    std::lock_guard<std::mutex> lock(mixing_mutex_);
+
+    for (const auto& existing : mixing_channels_) {
+        if (existing.lock() == channel) {
+            return;
+        }
+    }
+    mixing_channels_.push_back(channel);
+}
+
+void MediaWorker::OnTick(uint64_t now_us) {
+    {
+        std::lock_guard<std::mutex> lock(mixing_mutex_);
+        if (mixing_channels_.empty()) {
+            return;
+        }
+        mixing_scratch_ = mixing_channels_;
+    }
+
+    bool any_finished = false;
+    for (const auto& weak_channel : mixing_scratch_) {
+        auto channel = weak_channel.lock();
+        if (!channel || !channel->MixTick(now_us)) {
+            any_finished = true;
+        }
+    }
+
+    if (any_finished) {
+        std::lock_guard<std::mutex> lock(mixing_mutex_);
+        mixing_channels_.erase(std::remove_if(mixing_channels_.begin(), mixing_channels_.end(),
+            [](const std::weak_ptr<VoiceChannel>& weak_channel) {
+                auto channel = weak_channel.lock();
+                return !channel || !channel->IsMixingEnabled();
+            }), mixing_channels_.end());
+    }
+}
+
+} // namespace driftway
@@ -0,0 +1,187 @@
+#include "packet_pool.h"
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace driftway {
+
+struct PacketPool::FreeList {
+    MediaBuffer* head = nullptr;
+    size_t count = 0;
+};
+
+// Returns its buffers to the depot when the thread exits
+struct PacketPool::ThreadCache {
+    FreeList local;
+    ~ThreadCache();
+};
+
+namespace {
+
+struct Depot {
+    std::mutex mutex;
+    std::vector<std::pair<MediaBuffer*, size_t>> magazines; // Head, count
+    size_t buffers = 0;
+
+    std::atomic<uint64_t> buffers_allocated{0};
+    std::atomic<uint64_t> buffers_freed{0};
+    std::atomic<uint64_t> exchanges{0};
+};
+
+Depot& GetDepot() {
+    // Never destroyed: buffers may be released during static destruction
+    static Depot* depot = new Depot();
+    return *depot;
+}
+
+// Set once this thread's cache is gone; later releases bypass it
+thread_local bool t_cache_destroyed = false;
+
+} // namespace
+
+PacketPool::ThreadCache::~ThreadCache() {
+    t_cache_destroyed = true;
+    while (local.count > 0) {
+        PushMagazine(TakeMagazine(local));
+    }
+}
+
+PacketPool::ThreadCache& PacketPool::LocalCache() {
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+void PacketPool::Push(FreeList& list, MediaBuffer* buffer) {
+    buffer->next_free_ = list.head;
+    list.head = buffer;
+    list.count++;
+}
+
+MediaBuffer* PacketPool::Pop(FreeList& list) {
+    MediaBuffer* buffer = list.head;
+    if (buffer) {
+        list.head = buffer->next_free_;
+        list.count--;
+    }
+    return buffer;
+}
+
+PacketPool::FreeList PacketPool::TakeMagazine(FreeList& list) {
+    FreeList magazine;
+    while (magazine.count < kMagazineSize && list.head) {
+        Push(magazine, Pop(list));
+    }
+    return magazine;
+}
+
+// Whole magazines move between threads; buffers past the depot cap go back
+// to the heap. Returns false if the depot had no room.
+bool PacketPool::PushMagazine(FreeList magazine) {
+    Depot& depot = GetDepot();
+    {
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        if (depot.magazines.size() < kMaxDepotMagazines) {
+            depot.buffers += magazine.count;
+            depot.magazines.emplace_back(magazine.head, magazine.count);
+            depot.exchanges.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    depot.buffers_freed.fetch_add(magazine.count, std::memory_order_relaxed);
+    while (MediaBuffer* buffer = Pop(magazine)) {
+        delete buffer;
+    }
+    return false;
+}
+
+bool PacketPool::PopMagazine(FreeList* magazine) {
+    Depot& depot = GetDepot();
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    if (depot.magazines.empty()) {
+        return false;
+    }
+    magazine->head = depot.magazines.back().first;
+    magazine->count = depot.magazines.back().second;
+    depot.magazines.pop_back();
+    depot.buffers -= magazine->count;
+    depot.exchanges.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+MediaBuffer* PacketPool::Acquire() {
+    MediaBuffer* buffer = nullptr;
+
+    if (!t_cache_destroyed) {
+        FreeList& local = LocalCache().local;
+        if (!local.head) {
+            PopMagazine(&local);
+        }
+        buffer = Pop(local);
+    }
+
+    if (!buffer) {
+        buffer = new MediaBuffer();
+        GetDepot().buffers_allocated.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    buffer->next_free_ = nullptr;
+    buffer->size_ = 0;
+    return buffer;
+}
+
+void PacketPool::Recycle(MediaBuffer* buffer) {
+    if (t_cache_destroyed) {
+        GetDepot().buffers_freed.fetch_add(1, std::memory_order_relaxed);
+        delete buffer;
+        return;
+    }
+
+    FreeList& local = LocalCache().local;
+    Push(local, buffer);
+
+    // Keep a magazine of slack so a thread hovering around the boundary
+    // does not take the depot lock on every other packet
+    if (local.count >= 2 * kMagazineSize) {
+        PushMagazine(TakeMagazine(local));
+    }
+}
+
+void PacketPool::Reserve(size_t buffers) {
+    while (buffers > 0) {
+        FreeList magazine;
+        while (magazine.count < kMagazineSize && magazine.count < buffers) {
+            Push(magazine, new MediaBuffer());
+        }
+        GetDepot().buffers_allocated.fetch_add(magazine.count, std::memory_order_relaxed);
+        buffers -= magazine.count;
+        if (!PushMagazine(magazine)) {
+            break;
+        }
+    }
+}
+
+PacketPool::Stats PacketPool::GetStats() {
+    Depot& depot = GetDepot();
+    Stats stats;
+    stats.buffers_allocated = depot.buffers_allocated.load(std::memory_order_relaxed);
+    stats.buffers_freed = depot.buffers_freed.load(std::memory_order_relaxed);
+    stats.depot_exchanges = depot.exchanges.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        stats.buffers_in_depot = depot.buffers;
+    }
+    return stats;
+}
+
+MediaBufferRef MediaBuffer::Allocate() {
+    return MediaBufferRef(PacketPool::Acquire());
+}
+
+void MediaBuffer::Recycle(MediaBuffer* buffer) {
+    PacketPool::Recycle(buffer);
+}
+
+} // namespace driftway
@@ -1,46 +1,30 @@
-#include <iostream>
-#include <vector>
 #include <cstdint>
+#include <cstddef>
+#include "rtp_packet.h"
+#include "logger.h"
+
+using driftway::RtpPacketView;
+using driftway::RtpStream;
 
 class RTPHandler {
 public:
-    struct RTPPacket {
-        uint32_t timestamp;
-        uint16_t sequence;
-        uint32_t ssrc;
-        std::vector<uint8_t> payload;
-    };
-    
     static void initialize() {
-        std::cout << "RTP Handler initialized" << std::endl;
-    }
-    
-    static RTPPacket createPacket(const std::vector<uint8_t>& audio_data, uint32_t timestamp) {
-        RTPPacket packet;
-        packet.timestamp = timestamp;
-        packet.sequence = ++sequence_number;
-        packet.ssrc = 12345; // Mock SSRC
-        packet.payload = audio_data;
-        
-        std::cout << "Created RTP packet: seq=" << packet.sequence << ", timestamp=" << timestamp << std::endl;
-        return packet;
+        LOG_INFO << "RTP Handler initialized";
     }
     
-    static std::vector<uint8_t> parsePacket(const RTPPacket& packet) {
-        std::cout << "Parsing RTP packet: seq=" << packet.sequence << std::endl;
-        return packet.payload;
+    // Serializes audio_data as the next packet of `stream` into `out`.
+    // Returns the packet size, or 0 if it does not fit.
+    static size_t createPacket(RtpStream& stream, const uint8_t* audio_data, size_t size,
+                               uint32_t samples, uint8_t* out, size_t capacity) {
+        return stream.WritePacket(audio_data, size, samples, out, capacity);
     }
     
-    static void sendPacket(const RTPPacket& packet, const std::string& destination) {
-        std::cout << "Sending RTP packet to " << destination << ", size: " << packet.payload.size() << std::endl;
+    // Parses in place; the view points into `data` and copies nothing.
+    static bool parsePacket(const uint8_t* data, size_t size, RtpPacketView& packet) {
+        return packet.Parse(data, size);
     }
     
     static void cleanup() {
-        std::cout << "RTP Handler cleanup" << std::endl;
+        LOG_INFO << "RTP Handler cleanup";
     }
-
-private:
-    static uint16_t sequence_number;
 };
-
-uint16_t RTPHandler::sequence_number = 0;
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "rtp_packet.h"
+
+#include <cstring>
+#include <random>
+
+namespace driftway {
+
+bool RtpPacketView::Parse(const uint8_t* data, size_t size) {
+    if (size < rtp::kFixedHeaderSize || (data[0] >> 6) != 2) {
+        return false;
+    }
+
+    size_t offset = rtp::kFixedHeaderSize + 4 * static_cast<size_t>(data[0] & 0x0F);
+    if (offset > size) {
+        return false;
+    }
+
+    extension_offset_ = 0;
+    extension_size_ = 0;
+    extension_profile_ = 0;
+    if (data[0] & 0x10) {
+        if (offset + 4 > size) {
+            return false;
+        }
+        extension_profile_ = rtp::ReadU16(data + offset);
+        size_t extension_bytes = 4 * static_cast<size_t>(rtp::ReadU16(data + offset + 2));
+        offset += 4;
+        if (offset + extension_bytes > size) {
+            return false;
+        }
+        extension_offset_ = offset;
+        extension_size_ = extension_bytes;
+        offset += extension_bytes;
+    }
+
+    size_t padding = 0;
+    if (data[0] & 0x20) {
+        padding = data[size - 1];
+        if (padding == 0 || offset + padding > size) {
+            return false;
+        }
+    }
+
+    data_ = data;
+    size_ = size;
+    header_size_ = offset;
+    padding_size_ = padding;
+    payload_size_ = size - offset - padding;
+    return true;
+}
+
+bool RtpPacketView::FindExtension(uint8_t id, RtpHeaderExtension* extension) const {
+    bool found = false;
+    ForEachExtension([&](const RtpHeaderExtension& element) {
+        if (element.id != id) {
+            return true;
+        }
+        *extension = element;
+        found = true;
+        return false;
+    });
+    return found;
+}
+
+RtpPacketWriter::RtpPacketWriter(uint8_t* buffer, size_t capacity)
+    : buffer_(buffer), capacity_(capacity), offset_(0), extension_start_(0),
+      two_byte_extensions_(false), overflow_(false) {
+}
+
+bool RtpPacketWriter::WriteHeader(const RtpHeader& header) {
+    size_t csrc_count = header.csrc_count > rtp::kMaxCsrcCount ? rtp::kMaxCsrcCount : header.csrc_count;
+    size_t header_size = rtp::kFixedHeaderSize + 4 * csrc_count;
+    if (header_size > capacity_) {
+        overflow_ = true;
+        return false;
+    }
+
+    buffer_[0] = static_cast<uint8_t>(0x80 | csrc_count);
+    buffer_[1] = static_cast<uint8_t>((header.marker ? 0x80 : 0x00) | (header.payload_type & 0x7F));
+    rtp::WriteU16(buffer_ + 2, header.sequence_number);
+    rtp::WriteU32(buffer_ + 4, header.timestamp);
+    rtp::WriteU32(buffer_ + 8, header.ssrc);
+    for (size_t i = 0; i < csrc_count; ++i) {
+        rtp::WriteU32(buffer_ + rtp::kFixedHeaderSize + i * 4, header.csrcs[i]);
+    }
+
+    offset_ = header_size;
+    extension_start_ = 0;
+    return true;
+}
+
+void RtpPacketWriter::BeginExtensions(bool two_byte) {
+    if (offset_ < rtp::kFixedHeaderSize || offset_ + 4 > capacity_) {
+        overflow_ = true;
+        return;
+    }
+
+    buffer_[0] |= 0x10;
+    two_byte_extensions_ = two_byte;
+    rtp::WriteU16(buffer_ + offset_, two_byte ? rtp::kTwoByteExtensionProfile : rtp::kOneByteExtensionProfile);
+    extension_start_ = offset_;
+    offset_ += 4;
+}
+
+bool RtpPacketWriter::AddExtension(uint8_t id, const uint8_t* data, size_t size) {
+    if (extension_start_ == 0 || id == 0) {
+        return false;
+    }
+
+    size_t element_header = two_byte_extensions_ ? 2 : 1;
+    if (!two_byte_extensions_ && (id > 14 || size == 0 || size > 16)) {
+        return false;
+    }
+    if (two_byte_extensions_ && size > 255) {
+        return false;
+    }
+    if (offset_ + element_header + size > capacity_) {
+        overflow_ = true;
+        return false;
+    }
+
+    if (two_byte_extensions_) {
+        buffer_[offset_] = id;
+        buffer_[offset_ + 1] = static_cast<uint8_t>(size);
+    } else {
+        buffer_[offset_] = static_cast<uint8_t>((id << 4) | (size - 1));
+    }
+    std::memcpy(buffer_ + offset_ + element_header, data, size);
+    offset_ += element_header + size;
+    return true;
+}
+
+void RtpPacketWriter::CloseExtensions() {
+    if (extension_start_ == 0) {
+        return;
+    }
+
+    // Pad the element list to a 32-bit boundary and record its length
+    size_t body = offset_ - extension_start_ - 4;
+    size_t padded = (body + 3) & ~static_cast<size_t>(3);
+    if (extension_start_ + 4 + padded > capacity_) {
+        overflow_ = true;
+        return;
+    }
+    std::memset(buffer_ + offset_, 0, padded - body);
+    offset_ = extension_start_ + 4 + padded;
+    rtp::WriteU16(buffer_ + extension_start_ + 2, static_cast<uint16_t>(padded / 4));
+    extension_start_ = 0;
+}
+
+bool RtpPacketWriter::WritePayload(const uint8_t* payload, size_t size) {
+    size_t available = 0;
+    uint8_t* out = PayloadBuffer(&available);
+    if (!out || size > available) {
+        overflow_ = true;
+        return false;
+    }
+    std::memcpy(out, payload, size);
+    return CommitPayload(size);
+}
+
+uint8_t* RtpPacketWriter::PayloadBuffer(size_t* available) {
+    CloseExtensions();
+    if (overflow_ || offset_ < rtp::kFixedHeaderSize) {
+        *available = 0;
+        return nullptr;
+    }
+    *available = capacity_ - offset_;
+    return buffer_ + offset_;
+}
+
+bool RtpPacketWriter::CommitPayload(size_t size) {
+    if (overflow_ || offset_ + size > capacity_) {
+        overflow_ = true;
+        return false;
+    }
+    offset_ += size;
+    return true;
+}
+
+size_t RtpPacketWriter::Finish() {
+    CloseExtensions();
+    return overflow_ || offset_ < rtp::kFixedHeaderSize ? 0 : offset_;
+}
+
+RtpStream::RtpStream(uint32_t ssrc, uint8_t payload_type, uint32_t clock_rate)
+    : ssrc_(ssrc), payload_type_(payload_type), clock_rate_(clock_rate) {
+    thread_local std::mt19937 rng{std::random_device{}()};
+    next_sequence_ = static_cast<uint16_t>(rng());
+    next_timestamp_ = static_cast<uint32_t>(rng());
+}
+
+void RtpStream::NextHeader(uint32_t samples, RtpHeader* header, bool marker) {
+    header->marker = marker;
+    header->payload_type = payload_type_;
+    header->sequence_number = next_sequence_++;
+    header->timestamp = next_timestamp_;
+    header->ssrc = ssrc_;
+    header->csrc_count = 0;
+    next_timestamp_ += samples;
+}
+
+size_t RtpStream::WritePacket(const uint8_t* payload, size_t payload_size, uint32_t samples,
+                              uint8_t* out, size_t capacity, bool marker) {
+    if (rtp::kFixedHeaderSize + payload_size > capacity) {
+        return 0;
+    }
+
+    RtpHeader header;
+    NextHeader(samples, &header, marker);
+
+    RtpPacketWriter writer(out, capacity);
+    writer.WriteHeader(header);
+    writer.WritePayload(payload, payload_size);
+    return writer.Finish();
+}
+
+} // namespace driftway
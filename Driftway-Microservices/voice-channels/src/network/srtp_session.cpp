@@ -0,0 +1,575 @@
+#include "srtp_session.h"
+#include "rtp_packet.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace driftway {
+
+namespace {
+
+constexpr size_t kCmTagSize = 10;  // HMAC-SHA1 truncated to 80 bits
+constexpr size_t kGcmTagSize = 16;
+constexpr size_t kAuthKeySize = 20;
+constexpr size_t kRtcpIndexSize = 4; // E flag and 31-bit SRTCP index
+constexpr size_t kRtcpHeaderSize = 8;
+constexpr uint32_t kRtcpEncryptedFlag = 0x80000000u;
+constexpr uint64_t kReplayWindowSize = 64;
+
+// RFC 3711 section 4.3.1 labels; RTCP's are the RTP ones plus 3
+constexpr uint8_t kLabelEncryption = 0x00;
+constexpr uint8_t kLabelAuthentication = 0x01;
+constexpr uint8_t kLabelSalt = 0x02;
+constexpr uint8_t kRtcpLabelOffset = 0x03;
+
+// Fixed header, CSRCs and extension block, or 0 if that is not RTP
+size_t RtpHeaderSize(const uint8_t* data, size_t size) {
+    if (size < rtp::kFixedHeaderSize || (data[0] >> 6) != 2) {
+        return 0;
+    }
+    size_t header = rtp::kFixedHeaderSize + 4 * static_cast<size_t>(data[0] & 0x0F);
+    if (data[0] & 0x10) {
+        if (header + 4 > size) {
+            return 0;
+        }
+        header += 4 + 4 * static_cast<size_t>(rtp::ReadU16(data + header + 2));
+    }
+    return header <= size ? header : 0;
+}
+
+// Runs the cipher, as keyed and IV'd, over [in, in + size) into out
+bool Crypt(EVP_CIPHER_CTX* ctx, uint8_t* out, const uint8_t* in, size_t size) {
+    int length = 0;
+    return size == 0 || (EVP_CipherUpdate(ctx, out, &length, in, static_cast<int>(size)) &&
+                         static_cast<size_t>(length) == size);
+}
+
+bool AddAad(EVP_CIPHER_CTX* ctx, const uint8_t* aad, size_t size) {
+    int length = 0;
+    return EVP_CipherUpdate(ctx, nullptr, &length, aad, static_cast<int>(size)) != 0;
+}
+
+bool FinishGcm(EVP_CIPHER_CTX* ctx, bool encrypt, uint8_t* tag) {
+    uint8_t unused[16];
+    int length = 0;
+    if (!encrypt && !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, kGcmTagSize, tag)) {
+        return false;
+    }
+    if (EVP_CipherFinal_ex(ctx, unused, &length) <= 0) {
+        return false;
+    }
+    return !encrypt || EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, kGcmTagSize, tag);
+}
+
+} // namespace
+
+namespace srtp {
+
+size_t MasterSaltSize(SrtpProfile profile) {
+    return profile == SrtpProfile::kAeadAes128Gcm ? 12 : 14;
+}
+
+size_t RtpOverhead(SrtpProfile profile) {
+    return profile == SrtpProfile::kAeadAes128Gcm ? kGcmTagSize : kCmTagSize;
+}
+
+size_t RtcpOverhead(SrtpProfile profile) {
+    return RtpOverhead(profile) + kRtcpIndexSize;
+}
+
+const char* ProfileName(SrtpProfile profile) {
+    return profile == SrtpProfile::kAeadAes128Gcm ? "AEAD_AES_128_GCM" : "AES_CM_128_HMAC_SHA1_80";
+}
+
+bool ParseProfileName(std::string_view name, SrtpProfile* profile) {
+    if (name == "AES_CM_128_HMAC_SHA1_80") {
+        *profile = SrtpProfile::kAesCm128HmacSha1_80;
+        return true;
+    }
+    if (name == "AEAD_AES_128_GCM") {
+        *profile = SrtpProfile::kAeadAes128Gcm;
+        return true;
+    }
+    return false;
+}
+
+bool ParseInlineKey(std::string_view base64, SrtpProfile profile, uint8_t* key, uint8_t* salt) {
+    // Lifetime and MKI parameters ("|2^31|1:1") may follow the key
+    base64 = base64.substr(0, base64.find('|'));
+    size_t expected = kMasterKeySize + MasterSaltSize(profile);
+    if (base64.size() != (expected + 2) / 3 * 4 || base64.size() > 64) {
+        return false;
+    }
+
+    uint8_t decoded[48];
+    int length = EVP_DecodeBlock(decoded, reinterpret_cast<const unsigned char*>(base64.data()),
+                                 static_cast<int>(base64.size()));
+    // EVP_DecodeBlock counts '=' padding as zero bytes
+    if (length < static_cast<int>(expected)) {
+        return false;
+    }
+    std::memcpy(key, decoded, kMasterKeySize);
+    std::memcpy(salt, decoded + kMasterKeySize, MasterSaltSize(profile));
+    OPENSSL_cleanse(decoded, sizeof(decoded));
+    return true;
+}
+
+std::string FormatInlineKey(const uint8_t* key, const uint8_t* salt, SrtpProfile profile) {
+    uint8_t material[kMasterKeySize + kMaxMasterSaltSize];
+    size_t size = kMasterKeySize + MasterSaltSize(profile);
+    std::memcpy(material, key, kMasterKeySize);
+    std::memcpy(material + kMasterKeySize, salt, MasterSaltSize(profile));
+
+    char encoded[64];
+    int length = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(encoded), material, static_cast<int>(size));
+    OPENSSL_cleanse(material, sizeof(material));
+    return std::string(encoded, static_cast<size_t>(length));
+}
+
+bool GenerateMasterKey(SrtpProfile profile, uint8_t* key, uint8_t* salt) {
+    return RAND_bytes(key, static_cast<int>(kMasterKeySize)) == 1 &&
+           RAND_bytes(salt, static_cast<int>(MasterSaltSize(profile))) == 1;
+}
+
+} // namespace srtp
+
+bool SrtpSession::ReplayWindow::Check(uint64_t index) const {
+    if (!started || index > highest) {
+        return true;
+    }
+    uint64_t age = highest - index;
+    return age < kReplayWindowSize && (seen & (uint64_t{1} << age)) == 0;
+}
+
+void SrtpSession::ReplayWindow::Accept(uint64_t index) {
+    if (!started) {
+        started = true;
+        highest = index;
+        seen = 1;
+    } else if (index > highest) {
+        uint64_t shift = index - highest;
+        seen = shift >= kReplayWindowSize ? 1 : (seen << shift) | 1;
+        highest = index;
+    } else {
+        seen |= uint64_t{1} << (highest - index);
+    }
+}
+
+SrtpSession::SrtpSession(SrtpProfile profile, Direction direction, const uint8_t* master_key,
+                         const uint8_t* master_salt)
+    : profile_(profile), direction_(direction), gcm_(profile == SrtpProfile::kAeadAes128Gcm),
+      tag_size_(srtp::RtpOverhead(profile)), valid_(false) {
+    valid_ = DeriveKeys(master_key, master_salt, 0, &rtp_) &&
+             DeriveKeys(master_key, master_salt, kRtcpLabelOffset, &rtcp_);
+}
+
+SrtpSession::~SrtpSession() {
+    EVP_CIPHER_CTX_free(rtp_.cipher);
+    EVP_CIPHER_CTX_free(rtcp_.cipher);
+    OPENSSL_cleanse(rtp_.salt, sizeof(rtp_.salt));
+    OPENSSL_cleanse(rtcp_.salt, sizeof(rtcp_.salt));
+}
+
+bool SrtpSession::DeriveKeys(const uint8_t* master_key, const uint8_t* master_salt, uint8_t first_label,
+                             Keys* keys) {
+    size_t salt_size = srtp::MasterSaltSize(profile_);
+
+    // AES-CM PRF with a key derivation rate of 0: the keystream under the
+    // master key at IV (master salt XOR label << 48) << 16. A 96-bit GCM
+    // master salt is zero-extended to 112 bits (RFC 7714 section 11).
+    auto derive = [&](uint8_t label, uint8_t* out, size_t size) {
+        uint8_t iv[16] = {};
+        std::memcpy(iv, master_salt, salt_size);
+        iv[7] ^= label;
+        uint8_t zeros[kAuthKeySize] = {};
+
+        EVP_CIPHER_CTX* prf = EVP_CIPHER_CTX_new();
+        bool ok = prf && EVP_EncryptInit_ex(prf, EVP_aes_128_ctr(), nullptr, master_key, iv) &&
+                  Crypt(prf, out, zeros, size);
+        EVP_CIPHER_CTX_free(prf);
+        return ok;
+    };
+
+    uint8_t session_key[srtp::kMasterKeySize];
+    uint8_t auth_key[kAuthKeySize];
+    bool ok = derive(static_cast<uint8_t>(first_label + kLabelEncryption), session_key, sizeof(session_key)) &&
+              derive(static_cast<uint8_t>(first_label + kLabelSalt), keys->salt, salt_size);
+    if (ok && !gcm_) {
+        ok = derive(static_cast<uint8_t>(first_label + kLabelAuthentication), auth_key, sizeof(auth_key));
+        if (ok) {
+            keys->auth = HmacSha1(auth_key, sizeof(auth_key));
+            ok = keys->auth.IsSet();
+        }
+    }
+
+    // Keyed once here; packets only set their IV
+    if (ok) {
+        keys->cipher = EVP_CIPHER_CTX_new();
+        int encrypt = direction_ == Direction::kProtect ? 1 : 0;
+        ok = keys->cipher &&
+             EVP_CipherInit_ex(keys->cipher, gcm_ ? EVP_aes_128_gcm() : EVP_aes_128_ctr(), nullptr, session_key,
+                               nullptr, encrypt);
+    }
+
+    OPENSSL_cleanse(session_key, sizeof(session_key));
+    OPENSSL_cleanse(auth_key, sizeof(auth_key));
+    return ok;
+}
+
+void SrtpSession::RemoveStream(uint32_t ssrc) {
+    std::lock_guard<std::mutex> lock(removals_mutex_);
+    removals_.push_back(ssrc);
+    has_removals_.store(true, std::memory_order_release);
+}
+
+void SrtpSession::ApplyRemovals() {
+    std::vector<uint32_t> removals;
+    {
+        std::lock_guard<std::mutex> lock(removals_mutex_);
+        removals.swap(removals_);
+        has_removals_.store(false, std::memory_order_relaxed);
+    }
+    for (uint32_t ssrc : removals) {
+        streams_.erase(ssrc);
+        if (retired_.size() < kMaxStreams) {
+            retired_.push_back(ssrc);
+        } else {
+            retired_[next_retired_] = ssrc;
+            next_retired_ = (next_retired_ + 1) % kMaxStreams;
+        }
+    }
+}
+
+SrtpSession::Stream* SrtpSession::FindStream(uint32_t ssrc, bool create) {
+    if (has_removals_.load(std::memory_order_acquire)) {
+        ApplyRemovals();
+    }
+    auto it = streams_.find(ssrc);
+    if (it != streams_.end()) {
+        return &it->second;
+    }
+    if (!create || streams_.size() >= kMaxStreams ||
+        std::find(retired_.begin(), retired_.end(), ssrc) != retired_.end()) {
+        return nullptr;
+    }
+    return &streams_[ssrc];
+}
+
+bool SrtpSession::EstimateIndex(const Stream& stream, uint16_t sequence, uint32_t* roc, uint64_t* index) const {
+    // RFC 3711 section 3.3.1: pick the rollover counter that puts the
+    // sequence number closest to the highest one seen
+    int64_t v = stream.roc;
+    if (stream.started) {
+        if (stream.highest_sequence < 32768) {
+            if (static_cast<int>(sequence) - stream.highest_sequence > 32768) {
+                --v;
+            }
+        } else if (stream.highest_sequence - 32768 > sequence) {
+            ++v;
+        }
+    }
+    if (v < 0 || v > 0xFFFFFFFF) {
+        return false;
+    }
+    *roc = static_cast<uint32_t>(v);
+    *index = (static_cast<uint64_t>(v) << 16) | sequence;
+    return true;
+}
+
+bool SrtpSession::CtrIv(const Keys& keys, uint32_t ssrc, uint64_t index) {
+    // IV = (salt << 16) XOR (SSRC << 64) XOR (index << 16)
+    uint8_t iv[16] = {};
+    std::memcpy(iv, keys.salt, srtp::kMaxMasterSaltSize);
+    for (int i = 0; i < 4; ++i) {
+        iv[4 + i] ^= static_cast<uint8_t>(ssrc >> (24 - 8 * i));
+    }
+    for (int i = 0; i < 6; ++i) {
+        iv[8 + i] ^= static_cast<uint8_t>(index >> (40 - 8 * i));
+    }
+    return EVP_CipherInit_ex(keys.cipher, nullptr, nullptr, nullptr, iv, -1) != 0;
+}
+
+bool SrtpSession::GcmIv(const Keys& keys, uint32_t ssrc, uint64_t index) {
+    // IV = (00 00 || SSRC || 48-bit index) XOR salt, where the index is
+    // ROC || SEQ for RTP and the 31-bit SRTCP index for RTCP
+    uint8_t iv[12] = {};
+    rtp::WriteU32(iv + 2, ssrc);
+    for (int i = 0; i < 6; ++i) {
+        iv[6 + i] = static_cast<uint8_t>(index >> (40 - 8 * i));
+    }
+    for (int i = 0; i < 12; ++i) {
+        iv[i] ^= keys.salt[i];
+    }
+    return EVP_CipherInit_ex(keys.cipher, nullptr, nullptr, nullptr, iv, -1) != 0;
+}
+
+SrtpStatus SrtpSession::ProtectRtp(uint8_t* data, size_t* size, size_t capacity) {
+    if (!valid_ || direction_ != Direction::kProtect) {
+        return SrtpStatus::kError;
+    }
+    size_t header = RtpHeaderSize(data, *size);
+    if (header == 0) {
+        return SrtpStatus::kMalformed;
+    }
+    if (*size + tag_size_ > capacity) {
+        return SrtpStatus::kTooLarge;
+    }
+
+    uint32_t ssrc = rtp::ReadU32(data + 8);
+    uint16_t sequence = rtp::ReadU16(data + 2);
+    Stream* stream = FindStream(ssrc, true);
+    uint32_t roc = 0;
+    uint64_t index = 0;
+    if (!stream || !EstimateIndex(*stream, sequence, &roc, &index)) {
+        return SrtpStatus::kError;
+    }
+
+    size_t payload = *size - header;
+    if (gcm_) {
+        if (!GcmIv(rtp_, ssrc, index) || !AddAad(rtp_.cipher, data, header) ||
+            !Crypt(rtp_.cipher, data + header, data + header, payload) ||
+            !FinishGcm(rtp_.cipher, true, data + *size)) {
+            return SrtpStatus::kError;
+        }
+    } else {
+        // Encrypt, then authenticate header || ciphertext || ROC
+        uint8_t roc_bytes[4];
+        rtp::WriteU32(roc_bytes, roc);
+        uint8_t mac[HmacSha1::kSize];
+        if (!CtrIv(rtp_, ssrc, index) || !Crypt(rtp_.cipher, data + header, data + header, payload) ||
+            !rtp_.auth.Compute({{data, *size}, {roc_bytes, 4}}, mac)) {
+            return SrtpStatus::kError;
+        }
+        std::memcpy(data + *size, mac, tag_size_);
+    }
+    *size += tag_size_;
+
+    // Forwarded packets may be reordered; only a newer one moves the counter
+    if (!stream->started || index > ((static_cast<uint64_t>(stream->roc) << 16) | stream->highest_sequence)) {
+        stream->started = true;
+        stream->roc = roc;
+        stream->highest_sequence = sequence;
+    }
+    return SrtpStatus::kOk;
+}
+
+SrtpStatus SrtpSession::UnprotectRtp(uint8_t* data, size_t* size) {
+    if (!valid_ || direction_ != Direction::kUnprotect) {
+        return SrtpStatus::kError;
+    }
+    size_t header = RtpHeaderSize(data, *size);
+    if (header == 0 || *size < header + tag_size_) {
+        return SrtpStatus::kMalformed;
+    }
+
+    uint32_t ssrc = rtp::ReadU32(data + 8);
+    uint16_t sequence = rtp::ReadU16(data + 2);
+
+    // Unknown SSRCs are tried with fresh state and kept only once a
+    // packet authenticates
+    Stream fresh;
+    Stream* stream = FindStream(ssrc, false);
+    Stream& state = stream ? *stream : fresh;
+
+    uint32_t roc = 0;
+    uint64_t index = 0;
+    if (!EstimateIndex(state, sequence, &roc, &index) || !state.rtp_replay.Check(index)) {
+        return SrtpStatus::kReplayed;
+    }
+
+    size_t payload = *size - header - tag_size_;
+    uint8_t* tag = data + *size - tag_size_;
+    if (gcm_) {
+        if (!GcmIv(rtp_, ssrc, index) || !AddAad(rtp_.cipher, data, header) ||
+            !Crypt(rtp_.cipher, data + header, data + header, payload)) {
+            return SrtpStatus::kError;
+        }
+        if (!FinishGcm(rtp_.cipher, false, tag)) {
+            return SrtpStatus::kAuthFailed;
+        }
+    } else {
+        uint8_t roc_bytes[4];
+        rtp::WriteU32(roc_bytes, roc);
+        uint8_t mac[HmacSha1::kSize];
+        if (!rtp_.auth.Compute({{data, *size - tag_size_}, {roc_bytes, 4}}, mac)) {
+            return SrtpStatus::kError;
+        }
+        if (CRYPTO_memcmp(mac, tag, tag_size_) != 0) {
+            return SrtpStatus::kAuthFailed;
+        }
+        if (!CtrIv(rtp_, ssrc, index) || !Crypt(rtp_.cipher, data + header, data + header, payload)) {
+            return SrtpStatus::kError;
+        }
+    }
+
+    if (!stream) {
+        stream = FindStream(ssrc, true);
+        if (!stream) {
+            return SrtpStatus::kError;
+        }
+        *stream = fresh;
+    }
+    stream->rtp_replay.Accept(index);
+    if (!stream->started || index > ((static_cast<uint64_t>(stream->roc) << 16) | stream->highest_sequence)) {
+        stream->started = true;
+        stream->roc = roc;
+        stream->highest_sequence = sequence;
+    }
+    *size -= tag_size_;
+    return SrtpStatus::kOk;
+}
+
+SrtpStatus SrtpSession::ProtectRtcp(uint8_t* data, size_t* size, size_t capacity) {
+    if (!valid_ || direction_ != Direction::kProtect) {
+        return SrtpStatus::kError;
+    }
+    if (*size < kRtcpHeaderSize || (data[0] >> 6) != 2) {
+        return SrtpStatus::kMalformed;
+    }
+    if (*size + kRtcpIndexSize + tag_size_ > capacity) {
+        return SrtpStatus::kTooLarge;
+    }
+
+    uint32_t ssrc = rtp::ReadU32(data + 4);
+    Stream* stream = FindStream(ssrc, true);
+    if (!stream) {
+        return SrtpStatus::kError;
+    }
+    uint32_t index = (stream->rtcp_index + 1) & 0x7FFFFFFF;
+    uint8_t index_word[kRtcpIndexSize];
+    rtp::WriteU32(index_word, kRtcpEncryptedFlag | index);
+
+    size_t body = *size - kRtcpHeaderSize;
+    uint8_t* end = data + *size;
+    if (gcm_) {
+        // header || ciphertext || tag || E+index, with E+index as AAD too
+        if (!GcmIv(rtcp_, ssrc, index) || !AddAad(rtcp_.cipher, data, kRtcpHeaderSize) ||
+            !AddAad(rtcp_.cipher, index_word, kRtcpIndexSize) ||
+            !Crypt(rtcp_.cipher, data + kRtcpHeaderSize, data + kRtcpHeaderSize, body) ||
+            !FinishGcm(rtcp_.cipher, true, end)) {
+            return SrtpStatus::kError;
+        }
+        std::memcpy(end + tag_size_, index_word, kRtcpIndexSize);
+    } else {
+        // header || ciphertext || E+index || tag over all that precedes it
+        uint8_t mac[HmacSha1::kSize];
+        if (!CtrIv(rtcp_, ssrc, index) ||
+            !Crypt(rtcp_.cipher, data + kRtcpHeaderSize, data + kRtcpHeaderSize, body)) {
+            return SrtpStatus::kError;
+        }
+        std::memcpy(end, index_word, kRtcpIndexSize);
+        if (!rtcp_.auth.Compute({{data, *size + kRtcpIndexSize}}, mac)) {
+            return SrtpStatus::kError;
+        }
+        std::memcpy(end + kRtcpIndexSize, mac, tag_size_);
+    }
+
+    stream->rtcp_index = index;
+    *size += kRtcpIndexSize + tag_size_;
+    return SrtpStatus::kOk;
+}
+
+SrtpStatus SrtpSession::UnprotectRtcp(uint8_t* data, size_t* size) {
+    if (!valid_ || direction_ != Direction::kUnprotect) {
+        return SrtpStatus::kError;
+    }
+    if (*size < kRtcpHeaderSize + kRtcpIndexSize + tag_size_ || (data[0] >> 6) != 2) {
+        return SrtpStatus::kMalformed;
+    }
+
+    uint32_t ssrc = rtp::ReadU32(data + 4);
+    size_t body = *size - kRtcpHeaderSize - kRtcpIndexSize - tag_size_;
+    const uint8_t* index_word = gcm_ ? data + *size - kRtcpIndexSize
+                                     : data + *size - tag_size_ - kRtcpIndexSize;
+    uint8_t* tag = gcm_ ? data + *size - kRtcpIndexSize - tag_size_ : data + *size - tag_size_;
+    uint32_t word = rtp::ReadU32(index_word);
+    uint32_t index = word & 0x7FFFFFFF;
+    bool encrypted = (word & kRtcpEncryptedFlag) != 0;
+
+    Stream fresh;
+    Stream* stream = FindStream(ssrc, false);
+    Stream& state = stream ? *stream : fresh;
+    if (!state.rtcp_replay.Check(index)) {
+        return SrtpStatus::kReplayed;
+    }
+
+    uint8_t* payload = data + kRtcpHeaderSize;
+    if (gcm_) {
+        // Unencrypted SRTCP would carry the body as AAD instead
+        if (!encrypted) {
+            return SrtpStatus::kMalformed;
+        }
+        if (!GcmIv(rtcp_, ssrc, index) || !AddAad(rtcp_.cipher, data, kRtcpHeaderSize) ||
+            !AddAad(rtcp_.cipher, index_word, kRtcpIndexSize) || !Crypt(rtcp_.cipher, payload, payload, body)) {
+            return SrtpStatus::kError;
+        }
+        if (!FinishGcm(rtcp_.cipher, false, tag)) {
+            return SrtpStatus::kAuthFailed;
+        }
+    } else {
+        uint8_t mac[HmacSha1::kSize];
+        if (!rtcp_.auth.Compute({{data, *size - tag_size_}}, mac)) {
+            return SrtpStatus::kError;
+        }
+        if (CRYPTO_memcmp(mac, tag, tag_size_) != 0) {
+            return SrtpStatus::kAuthFailed;
+        }
+        if (encrypted && (!CtrIv(rtcp_, ssrc, index) || !Crypt(rtcp_.cipher, payload, payload, body))) {
+            return SrtpStatus::kError;
+        }
+    }
+
+    if (!stream) {
+        stream = FindStream(ssrc, true);
+        if (!stream) {
+            return SrtpStatus::kError;
+        }
+        *stream = fresh;
+    }
+    stream->rtcp_replay.Accept(index);
+    *size = kRtcpHeaderSize + body;
+    return SrtpStatus::kOk;
+}
+
+size_t SrtpSession::ProtectRtp(SrtpBatchItem* items, size_t count) {
+    size_t protected_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        SrtpBatchItem& item = items[i];
+        item.status = item.session ? item.session->ProtectRtp(item.data, &item.size, item.capacity)
+                                   : SrtpStatus::kError;
+        protected_count += item.status == SrtpStatus::kOk;
+    }
+    return protected_count;
+}
+
+size_t SrtpSession::UnprotectRtp(SrtpBatchItem* items, size_t count) {
+    size_t unprotected_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        SrtpBatchItem& item = items[i];
+        item.status = item.session ? item.session->UnprotectRtp(item.data, &item.size) : SrtpStatus::kError;
+        unprotected_count += item.status == SrtpStatus::kOk;
+    }
+    return unprotected_count;
+}
+
+bool SrtpPeer::SetSessions(std::unique_ptr<SrtpSession> inbound, std::shared_ptr<SrtpSession> outbound) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (keyed_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    inbound_ = std::move(inbound);
+    outbound_ = std::move(outbound);
+    keyed_.store(true, std::memory_order_release);
+    return true;
+}
+
+const std::shared_ptr<SrtpSession>& SrtpPeer::outbound() const {
+    static const std::shared_ptr<SrtpSession> kUnkeyed;
+    return IsKeyed() ? outbound_ : kUnkeyed;
+}
+
+} // namespace driftway
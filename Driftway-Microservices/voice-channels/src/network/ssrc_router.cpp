@@ -0,0 +1,180 @@
+#include "ssrc_router.h"
+#include "epoch.h"
+
+#include <vector>
+
+namespace driftway {
+
+struct SsrcRouter::Snapshot {
+    uint32_t shift = 32;
+    uint32_t mask = 0;
+    std::vector<uint32_t> keys; // 0 marks an empty slot
+    std::vector<SsrcRoute> routes;
+
+    uint32_t SlotOf(uint32_t ssrc) const {
+        // Fibonacci hashing; the shard already consumed the low bits
+        return static_cast<uint32_t>((ssrc * 0x9E3779B1u) >> shift) & mask;
+    }
+};
+
+SsrcRouter::SsrcRouter() {
+    for (auto& shard : shards_) {
+        shard.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+SsrcRouter::~SsrcRouter() {
+    // No readers remain by now
+    for (auto& shard : shards_) {
+        delete shard.load(std::memory_order_acquire);
+    }
+}
+
+const SsrcRoute* SsrcRouter::Find(uint32_t ssrc) const {
+    const Snapshot* snapshot = shards_[ShardOf(ssrc)].load(std::memory_order_acquire);
+    if (!snapshot || ssrc == 0) {
+        return nullptr;
+    }
+
+    // At most half full, so the probe always reaches an empty slot
+    for (uint32_t slot = snapshot->SlotOf(ssrc);; slot = (slot + 1) & snapshot->mask) {
+        uint32_t key = snapshot->keys[slot];
+        if (key == ssrc) {
+            return &snapshot->routes[slot];
+        }
+        if (key == 0) {
+            return nullptr;
+        }
+    }
+}
+
+void SsrcRouter::PublishShardLocked(size_t shard) {
+    const auto& owners = owners_[shard];
+
+    Snapshot* snapshot = nullptr;
+    if (!owners.empty()) {
+        uint32_t bits = 3;
+        while ((size_t{1} << bits) < owners.size() * 2) {
+            bits++;
+        }
+
+        snapshot = new Snapshot();
+        snapshot->shift = 32 - bits;
+        snapshot->mask = (1u << bits) - 1;
+        snapshot->keys.assign(size_t{1} << bits, 0);
+        snapshot->routes.resize(size_t{1} << bits);
+
+        for (const auto& pair : owners) {
+            uint32_t slot = snapshot->SlotOf(pair.first);
+            while (snapshot->keys[slot] != 0) {
+                slot = (slot + 1) & snapshot->mask;
+            }
+            snapshot->keys[slot] = pair.first;
+            SsrcRoute& route = snapshot->routes[slot];
+            route.ssrc = pair.first;
+            route.channel = pair.second.channel.get();
+            route.participant = pair.second.participant.get();
+            route.jitter_buffer = pair.second.jitter_buffer.get();
+            route.voice_activity = pair.second.voice_activity.get();
+        }
+    }
+
+    const Snapshot* previous = shards_[shard].exchange(snapshot, std::memory_order_acq_rel);
+    if (previous) {
+        epoch::Retire(const_cast<Snapshot*>(previous));
+    }
+}
+
+void SsrcRouter::Add(uint32_t ssrc, std::shared_ptr<VoiceChannel> channel, std::shared_ptr<Participant> participant,
+                     std::shared_ptr<JitterBuffer> jitter_buffer,
+                     std::shared_ptr<VoiceActivityDetector> voice_activity) {
+    if (ssrc == 0 || !channel || !participant) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    size_t shard = ShardOf(ssrc);
+
+    Owner* replaced = nullptr;
+    auto it = owners_[shard].find(ssrc);
+    if (it != owners_[shard].end()) {
+        replaced = new Owner(std::move(it->second));
+    }
+
+    owners_[shard][ssrc] = Owner{std::move(channel), std::move(participant), std::move(jitter_buffer),
+                                 std::move(voice_activity)};
+    PublishShardLocked(shard);
+    if (replaced) {
+        epoch::Retire(replaced);
+    }
+}
+
+bool SsrcRouter::Remove(uint32_t ssrc) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    size_t shard = ShardOf(ssrc);
+
+    auto it = owners_[shard].find(ssrc);
+    if (it == owners_[shard].end()) {
+        return false;
+    }
+
+    // Readers of the old snapshot may still use these: keep them alive
+    Owner* removed = new Owner(std::move(it->second));
+    owners_[shard].erase(it);
+    PublishShardLocked(shard);
+    epoch::Retire(removed);
+    return true;
+}
+
+size_t SsrcRouter::RemoveChannel(const VoiceChannel* channel) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    size_t removed = 0;
+    for (size_t shard = 0; shard < kShardCount; ++shard) {
+        std::vector<Owner>* retired = nullptr;
+        for (auto it = owners_[shard].begin(); it != owners_[shard].end();) {
+            if (it->second.channel.get() != channel) {
+                ++it;
+                continue;
+            }
+            if (!retired) {
+                retired = new std::vector<Owner>();
+            }
+            retired->push_back(std::move(it->second));
+            it = owners_[shard].erase(it);
+        }
+
+        if (retired) {
+            removed += retired->size();
+            PublishShardLocked(shard);
+            epoch::Retire(retired);
+        }
+    }
+    return removed;
+}
+
+void SsrcRouter::Clear() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    for (size_t shard = 0; shard < kShardCount; ++shard) {
+        if (owners_[shard].empty()) {
+            continue;
+        }
+        auto* retired = new std::unordered_map<uint32_t, Owner>(std::move(owners_[shard]));
+        owners_[shard].clear();
+        PublishShardLocked(shard);
+        epoch::Retire(retired);
+    }
+}
+
+size_t SsrcRouter::size() const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    size_t total = 0;
+    for (const auto& owners : owners_) {
+        total += owners.size();
+    }
+    return total;
+}
+
+} // namespace driftway
@@ -1,65 +1,171 @@
-#include <iostream>
-#include <string>
-#include <map>
-#include <vector>
-
-class STUNHandler {
-public:
-    struct STUNMessage {
-        uint16_t message_type;
-        uint16_t message_length;
-        uint32_t magic_cookie;
-        std::string transaction_id;
-        std::map<std::string, std::string> attributes;
-    };
-    
-    static void initialize(int port) {
-        std::cout << "STUN Handler initialized on port " << port << std::endl;
-        stun_port = port;
-    }
-    
-    static STUNMessage createBindingRequest() {
-        STUNMessage msg;
-        msg.message_type = 0x0001; // Binding Request
-        msg.message_length = 0;
-        msg.magic_cookie = 0x2112A442;
-        msg.transaction_id = "driftway12345";
-        
-        std::cout << "Created STUN binding request" << std::endl;
-        return msg;
-    }
-    
-    static STUNMessage createBindingResponse(const STUNMessage& request, const std::string& mapped_address) {
-        STUNMessage response;
-        response.message_type = 0x0101; // Binding Success Response
-        response.message_length = 0;
-        response.magic_cookie = request.magic_cookie;
-        response.transaction_id = request.transaction_id;
-        response.attributes["MAPPED-ADDRESS"] = mapped_address;
-        
-        std::cout << "Created STUN binding response for " << mapped_address << std::endl;
-        return response;
-    }
-    
-    static void handleSTUNPacket(const std::vector<uint8_t>& packet, const std::string& sender_address) {
-        std::cout << "Handling STUN packet from " << sender_address << ", size: " << packet.size() << std::endl;
-        
-        // Mock STUN processing
-        if (packet.size() >= 20) { // Minimum STUN header size
-            std::cout << "Valid STUN packet received" << std::endl;
+#include "stun_handler.h"
+#include "udp_media_engine.h"
+#include "logger.h"
+
+#include <openssl/rand.h>
+
+#include <random>
+
+namespace driftway {
+
+namespace {
+
+constexpr size_t kMinUfragLength = 4;
+constexpr size_t kMinPasswordLength = 22;
+constexpr size_t kMaxUnknownAttributes = 8;
+
+bool IsKnownAttribute(uint16_t type) {
+    switch (type) {
+    case stun::kAttrMappedAddress:
+    case stun::kAttrUsername:
+    case stun::kAttrMessageIntegrity:
+    case stun::kAttrErrorCode:
+    case stun::kAttrUnknownAttributes:
+    case stun::kAttrRealm:
+    case stun::kAttrNonce:
+    case stun::kAttrXorMappedAddress:
+    case stun::kAttrPriority:
+    case stun::kAttrUseCandidate:
+        return true;
+    default:
+        return !stun::IsComprehensionRequired(type);
+    }
+}
+
+} // namespace
+
+StunHandler::StunHandler(const std::string& ufrag, const std::string& password)
+    : ufrag_(ufrag), password_(password) {
+    if (ufrag_.size() < kMinUfragLength) {
+        if (!ufrag_.empty()) {
+            LOG_WARN << "ICE ufrag shorter than " << kMinUfragLength << " characters; using a random one";
+        }
+        ufrag_ = RandomIceString(8);
+    }
+    if (password_.size() < kMinPasswordLength) {
+        if (!password_.empty()) {
+            LOG_WARN << "ICE password shorter than " << kMinPasswordLength << " characters; using a random one";
+        }
+        password_ = RandomIceString(24);
+    }
+    key_ = StunIntegrityKey(password_);
+}
+
+std::string StunHandler::RandomIceString(size_t length) {
+    static const char kIceChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string bytes(length, '\0');
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(&bytes[0]), static_cast<int>(length)) != 1) {
+        std::random_device device;
+        for (char& byte : bytes) {
+            byte = static_cast<char>(device());
+        }
+    }
+
+    std::string result(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        result[i] = kIceChars[static_cast<unsigned char>(bytes[i]) & 63];
+    }
+    return result;
+}
+
+size_t StunHandler::WriteError(const StunMessageView& request, int code, const char* reason,
+                               uint8_t* out, size_t capacity) const {
+    StunMessageWriter writer(out, capacity);
+    writer.WriteHeader(static_cast<uint16_t>(request.type() | 0x0110), request.transactionId());
+    writer.AddErrorCode(code, reason);
+    writer.AddFingerprint();
+    return writer.Finish();
+}
+
+StunHandler::Result StunHandler::HandleMessage(const uint8_t* data, size_t size, const MediaEndpoint& source,
+                                               uint8_t* out, size_t capacity, size_t* response_size,
+                                               std::string_view* remote_ufrag) const {
+    *response_size = 0;
+
+    // ICE agents always add FINGERPRINT; without a valid one this is not a
+    // connectivity check, and answering it would only help reflection
+    StunMessageView request;
+    if (!request.Parse(data, size) || !request.VerifyFingerprint()) {
+        return Result::kIgnored;
+    }
+
+    // Binding indications are keepalives; responses answer checks we never send
+    if (!stun::IsRequest(request.type())) {
+        return Result::kIgnored;
+    }
+    if (stun::Method(request.type()) != stun::kBindingMethod) {
+        *response_size = WriteError(request, 400, "Bad Request", out, capacity);
+        return *response_size ? Result::kRejected : Result::kIgnored;
+    }
+
+    // Short-term credentials (RFC 5389 section 10.1.2): USERNAME is
+    // "<our ufrag>:<their ufrag>" and the HMAC is keyed with our password
+    std::string_view username = request.username();
+    if (username.empty() || !request.hasMessageIntegrity()) {
+        *response_size = WriteError(request, 400, "Bad Request", out, capacity);
+        return *response_size ? Result::kRejected : Result::kIgnored;
+    }
+    if (username.size() <= ufrag_.size() || username.compare(0, ufrag_.size(), ufrag_) != 0 ||
+        username[ufrag_.size()] != ':' || !request.VerifyMessageIntegrity(key_)) {
+        LOG_DEBUG << "STUN check with bad credentials, username " << username;
+        *response_size = WriteError(request, 401, "Unauthorized", out, capacity);
+        return *response_size ? Result::kRejected : Result::kIgnored;
+    }
+
+    uint16_t unknown[kMaxUnknownAttributes];
+    size_t unknown_count = 0;
+    request.ForEachAttribute([&](const StunAttribute& attribute) {
+        if (!IsKnownAttribute(attribute.type)) {
+            unknown[unknown_count++] = attribute.type;
         }
+        return unknown_count < kMaxUnknownAttributes;
+    });
+
+    StunMessageWriter writer(out, capacity);
+    if (unknown_count > 0) {
+        writer.WriteHeader(stun::kBindingErrorResponse, request.transactionId());
+        writer.AddErrorCode(420, "Unknown Attribute");
+        writer.AddUnknownAttributes(unknown, unknown_count);
+    } else {
+        writer.WriteHeader(stun::kBindingSuccessResponse, request.transactionId());
+        writer.AddXorMappedAddress(source);
     }
-    
-    static void sendSTUNResponse(const STUNMessage& response, const std::string& destination) {
-        std::cout << "Sending STUN response to " << destination << std::endl;
+    writer.AddMessageIntegrity(key_);
+    writer.AddFingerprint();
+
+    *response_size = writer.Finish();
+    if (*response_size == 0) {
+        return Result::kIgnored;
     }
-    
-    static void cleanup() {
-        std::cout << "STUN Handler cleanup" << std::endl;
+    if (unknown_count > 0) {
+        return Result::kRejected;
     }
+    if (remote_ufrag) {
+        *remote_ufrag = username.substr(ufrag_.size() + 1);
+    }
+    return Result::kResponded;
+}
 
-private:
-    static int stun_port;
-};
+void IcePeer::RecordCheck(const MediaEndpoint& source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const MediaEndpoint& address : addresses_) {
+        if (address == source) {
+            return;
+        }
+    }
+    addresses_[next_] = source;
+    next_ = (next_ + 1) % kMaxAddresses;
+}
+
+bool IcePeer::IsVerified(const MediaEndpoint& source) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const MediaEndpoint& address : addresses_) {
+        if (address.IsSet() && address == source) {
+            return true;
+        }
+    }
+    return false;
+}
 
-int STUNHandler::stun_port = 3478;
\ No newline at end of file
+} // namespace driftway
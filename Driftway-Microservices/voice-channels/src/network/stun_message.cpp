@@ -0,0 +1,317 @@
+#include "stun_message.h"
+#include "crc32.h"
+#include "rtp_packet.h"
+#include "udp_media_engine.h"
+
+#include <openssl/crypto.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace driftway {
+
+StunIntegrityKey::StunIntegrityKey(std::string_view password)
+    : hmac_(reinterpret_cast<const uint8_t*>(password.data()), password.size()) {}
+
+bool StunIntegrityKey::Sign(const uint8_t* message, size_t size, uint16_t length, uint8_t* mac) const {
+    if (size < stun::kHeaderSize) {
+        return false;
+    }
+    // The length field is substituted without copying the message
+    uint8_t length_field[2];
+    rtp::WriteU16(length_field, length);
+    return hmac_.Compute({{message, 2}, {length_field, 2}, {message + 4, size - 4}}, mac);
+}
+
+bool StunMessageView::Parse(const uint8_t* data, size_t size) {
+    // Top two bits zero, a 4-byte aligned length that covers the datagram
+    // exactly, and the magic cookie: anything else is not STUN
+    if (size < stun::kHeaderSize || (data[0] & 0xC0) != 0 || rtp::ReadU32(data + 4) != stun::kMagicCookie) {
+        return false;
+    }
+    size_t length = rtp::ReadU16(data + 2);
+    if ((length & 3) != 0 || stun::kHeaderSize + length != size) {
+        return false;
+    }
+
+    size_t integrity = 0;
+    size_t fingerprint = 0;
+    size_t attributes_end = size;
+    size_t offset = stun::kHeaderSize;
+    while (offset < size) {
+        if (offset + 4 > size) {
+            return false;
+        }
+        uint16_t type = rtp::ReadU16(data + offset);
+        size_t value_size = rtp::ReadU16(data + offset + 2);
+        size_t next = offset + 4 + ((value_size + 3) & ~size_t{3});
+        if (next > size) {
+            return false;
+        }
+
+        if (fingerprint != 0) {
+            return false; // FINGERPRINT must be last
+        }
+        if (type == stun::kAttrFingerprint) {
+            if (value_size != 4) {
+                return false;
+            }
+            fingerprint = offset;
+            attributes_end = std::min(attributes_end, offset);
+        } else if (type == stun::kAttrMessageIntegrity && integrity == 0) {
+            if (value_size != stun::kMessageIntegritySize) {
+                return false;
+            }
+            integrity = offset;
+            attributes_end = offset;
+        }
+        offset = next;
+    }
+
+    data_ = data;
+    size_ = size;
+    attributes_end_ = attributes_end;
+    integrity_offset_ = integrity;
+    fingerprint_offset_ = fingerprint;
+    return true;
+}
+
+bool StunMessageView::FindAttribute(uint16_t type, StunAttribute* attribute) const {
+    bool found = false;
+    ForEachAttribute([&](const StunAttribute& candidate) {
+        if (candidate.type != type) {
+            return true;
+        }
+        *attribute = candidate;
+        found = true;
+        return false;
+    });
+    return found;
+}
+
+std::string_view StunMessageView::username() const {
+    StunAttribute attribute;
+    if (!FindAttribute(stun::kAttrUsername, &attribute)) {
+        return {};
+    }
+    return std::string_view(reinterpret_cast<const char*>(attribute.data), attribute.size);
+}
+
+bool StunMessageView::GetMappedAddress(MediaEndpoint* endpoint) const {
+    StunAttribute attribute;
+    bool xored = FindAttribute(stun::kAttrXorMappedAddress, &attribute);
+    if (!xored && !FindAttribute(stun::kAttrMappedAddress, &attribute)) {
+        return false;
+    }
+    if (attribute.size < 8) {
+        return false;
+    }
+
+    // Port and address are XORed with the magic cookie, IPv6 addresses
+    // continuing into the transaction id (which follows the cookie)
+    const uint8_t* mask = data_ + 4;
+    uint16_t port = rtp::ReadU16(attribute.data + 2);
+    if (xored) {
+        port ^= static_cast<uint16_t>(stun::kMagicCookie >> 16);
+    }
+
+    *endpoint = MediaEndpoint();
+    if (attribute.data[1] == 0x01) {
+        auto* in = reinterpret_cast<sockaddr_in*>(&endpoint->addr);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(port);
+        uint8_t* address = reinterpret_cast<uint8_t*>(&in->sin_addr);
+        for (size_t i = 0; i < 4; ++i) {
+            address[i] = attribute.data[4 + i] ^ (xored ? mask[i] : 0);
+        }
+        endpoint->len = sizeof(sockaddr_in);
+        return true;
+    }
+    if (attribute.data[1] == 0x02 && attribute.size >= 20) {
+        auto* in6 = reinterpret_cast<sockaddr_in6*>(&endpoint->addr);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        uint8_t* address = reinterpret_cast<uint8_t*>(&in6->sin6_addr);
+        for (size_t i = 0; i < 16; ++i) {
+            address[i] = attribute.data[4 + i] ^ (xored ? mask[i] : 0);
+        }
+        endpoint->len = sizeof(sockaddr_in6);
+        return true;
+    }
+    return false;
+}
+
+bool StunMessageView::VerifyFingerprint() const {
+    if (fingerprint_offset_ == 0) {
+        return false;
+    }
+    uint32_t expected = Crc32(data_, fingerprint_offset_) ^ stun::kFingerprintXor;
+    return rtp::ReadU32(data_ + fingerprint_offset_ + 4) == expected;
+}
+
+bool StunMessageView::VerifyMessageIntegrity(const StunIntegrityKey& key) const {
+    if (integrity_offset_ == 0) {
+        return false;
+    }
+    // The HMAC covers everything before the attribute, with the length
+    // field counting up to and including it (so not any FINGERPRINT)
+    uint16_t length = static_cast<uint16_t>(integrity_offset_ + 4 + stun::kMessageIntegritySize - stun::kHeaderSize);
+    uint8_t mac[stun::kMessageIntegritySize];
+    if (!key.Sign(data_, integrity_offset_, length, mac)) {
+        return false;
+    }
+    return CRYPTO_memcmp(mac, data_ + integrity_offset_ + 4, sizeof(mac)) == 0;
+}
+
+StunMessageWriter::StunMessageWriter(uint8_t* buffer, size_t capacity)
+    : buffer_(buffer), capacity_(capacity), offset_(0), overflow_(false) {
+}
+
+bool StunMessageWriter::WriteHeader(uint16_t type, const uint8_t* transaction_id) {
+    if (capacity_ < stun::kHeaderSize) {
+        overflow_ = true;
+        return false;
+    }
+    rtp::WriteU16(buffer_, type & 0x3FFF);
+    rtp::WriteU16(buffer_ + 2, 0);
+    rtp::WriteU32(buffer_ + 4, stun::kMagicCookie);
+    std::memcpy(buffer_ + 8, transaction_id, stun::kTransactionIdSize);
+    offset_ = stun::kHeaderSize;
+    return true;
+}
+
+uint8_t* StunMessageWriter::Reserve(uint16_t type, size_t size) {
+    size_t padded = (size + 3) & ~size_t{3};
+    if (overflow_ || offset_ < stun::kHeaderSize || size > 0xFFFF || offset_ + 4 + padded > capacity_) {
+        overflow_ = true;
+        return nullptr;
+    }
+
+    uint8_t* attribute = buffer_ + offset_;
+    rtp::WriteU16(attribute, type);
+    rtp::WriteU16(attribute + 2, static_cast<uint16_t>(size));
+    std::memset(attribute + 4, 0, padded);
+    offset_ += 4 + padded;
+    rtp::WriteU16(buffer_ + 2, static_cast<uint16_t>(offset_ - stun::kHeaderSize));
+    return attribute + 4;
+}
+
+bool StunMessageWriter::AddAttribute(uint16_t type, const uint8_t* data, size_t size) {
+    uint8_t* value = Reserve(type, size);
+    if (!value) {
+        return false;
+    }
+    if (size > 0) {
+        std::memcpy(value, data, size);
+    }
+    return true;
+}
+
+bool StunMessageWriter::AddUint32(uint16_t type, uint32_t value) {
+    uint8_t* out = Reserve(type, 4);
+    if (!out) {
+        return false;
+    }
+    rtp::WriteU32(out, value);
+    return true;
+}
+
+bool StunMessageWriter::AddUint64(uint16_t type, uint64_t value) {
+    uint8_t* out = Reserve(type, 8);
+    if (!out) {
+        return false;
+    }
+    rtp::WriteU32(out, static_cast<uint32_t>(value >> 32));
+    rtp::WriteU32(out + 4, static_cast<uint32_t>(value));
+    return true;
+}
+
+bool StunMessageWriter::AddXorMappedAddress(const MediaEndpoint& endpoint) {
+    const uint8_t* mask = buffer_ + 4; // Cookie then transaction id, as written
+    const uint8_t* address = nullptr;
+    size_t address_size = 0;
+    uint16_t port = 0;
+    uint8_t family = 0;
+
+    if (endpoint.addr.ss_family == AF_INET) {
+        const auto* in = reinterpret_cast<const sockaddr_in*>(&endpoint.addr);
+        address = reinterpret_cast<const uint8_t*>(&in->sin_addr);
+        address_size = 4;
+        port = ntohs(in->sin_port);
+        family = 0x01;
+    } else if (endpoint.addr.ss_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const sockaddr_in6*>(&endpoint.addr);
+        address = reinterpret_cast<const uint8_t*>(&in6->sin6_addr);
+        address_size = 16;
+        port = ntohs(in6->sin6_port);
+        family = 0x02;
+    } else {
+        return false;
+    }
+
+    uint8_t* value = Reserve(stun::kAttrXorMappedAddress, 4 + address_size);
+    if (!value) {
+        return false;
+    }
+    value[1] = family;
+    rtp::WriteU16(value + 2, port ^ static_cast<uint16_t>(stun::kMagicCookie >> 16));
+    for (size_t i = 0; i < address_size; ++i) {
+        value[4 + i] = address[i] ^ mask[i];
+    }
+    return true;
+}
+
+bool StunMessageWriter::AddErrorCode(int code, std::string_view reason) {
+    if (code < 300 || code > 699) {
+        return false;
+    }
+    uint8_t* value = Reserve(stun::kAttrErrorCode, 4 + reason.size());
+    if (!value) {
+        return false;
+    }
+    value[2] = static_cast<uint8_t>(code / 100);
+    value[3] = static_cast<uint8_t>(code % 100);
+    std::memcpy(value + 4, reason.data(), reason.size());
+    return true;
+}
+
+bool StunMessageWriter::AddUnknownAttributes(const uint16_t* types, size_t count) {
+    uint8_t* value = Reserve(stun::kAttrUnknownAttributes, 2 * count);
+    if (!value) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        rtp::WriteU16(value + 2 * i, types[i]);
+    }
+    return true;
+}
+
+bool StunMessageWriter::AddMessageIntegrity(const StunIntegrityKey& key) {
+    size_t covered = offset_;
+    uint8_t* value = Reserve(stun::kAttrMessageIntegrity, stun::kMessageIntegritySize);
+    if (!value) {
+        return false;
+    }
+    // The length field already counts this attribute
+    if (!key.Sign(buffer_, covered, rtp::ReadU16(buffer_ + 2), value)) {
+        overflow_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool StunMessageWriter::AddFingerprint() {
+    size_t covered = offset_;
+    uint8_t* value = Reserve(stun::kAttrFingerprint, 4);
+    if (!value) {
+        return false;
+    }
+    rtp::WriteU32(value, Crc32(buffer_, covered) ^ stun::kFingerprintXor);
+    return true;
+}
+
+size_t StunMessageWriter::Finish() {
+    return overflow_ || offset_ < stun::kHeaderSize ? 0 : offset_;
+}
+
+} // namespace driftway
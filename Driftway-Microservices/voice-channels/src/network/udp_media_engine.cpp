@@ -0,0 +1,546 @@
+#include "udp_media_engine.h"
+#include "logger.h"
+#include "metrics.h"
+#include "srtp_session.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/filter.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace driftway {
+
+namespace {
+
+constexpr int kSocketBufferBytes = 4 * 1024 * 1024;
+constexpr size_t kControlBytes = CMSG_SPACE(sizeof(timespec));
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+uint64_t ToMicros(const timespec& ts) {
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + static_cast<uint64_t>(ts.tv_nsec) / 1000ULL;
+}
+
+// Tick schedule clock: unlike the media clock it never steps, so a clock
+// adjustment can neither stall the mixer nor make it burst
+uint64_t MonotonicMicros() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ToMicros(ts);
+}
+
+} // namespace
+
+uint64_t MediaClockMicros() {
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ToMicros(ts);
+}
+
+bool MediaEndpoint::operator==(const MediaEndpoint& other) const {
+    if (len != other.len || addr.ss_family != other.addr.ss_family) {
+        return false;
+    }
+    if (addr.ss_family == AF_INET) {
+        const auto* a = reinterpret_cast<const sockaddr_in*>(&addr);
+        const auto* b = reinterpret_cast<const sockaddr_in*>(&other.addr);
+        return a->sin_port == b->sin_port && a->sin_addr.s_addr == b->sin_addr.s_addr;
+    }
+    if (addr.ss_family == AF_INET6) {
+        const auto* a = reinterpret_cast<const sockaddr_in6*>(&addr);
+        const auto* b = reinterpret_cast<const sockaddr_in6*>(&other.addr);
+        return a->sin6_port == b->sin6_port &&
+               std::memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0;
+    }
+    return std::memcmp(&addr, &other.addr, len) == 0;
+}
+
+UdpMediaEngine::UdpMediaEngine(int port, size_t batch_size)
+    : port_(port), batch_size_(batch_size == 0 ? 1 : batch_size), fd_(-1), wake_fd_(-1), reuse_port_(false),
+      cpu_(-1), tx_count_(0), tx_srtp_count_(0), running_(false), tick_interval_us_(0), wake_pending_(false) {
+    rx_buffers_.resize(batch_size_);
+    rx_iov_.resize(batch_size_);
+    rx_msgs_.resize(batch_size_);
+    rx_sources_.resize(batch_size_);
+    rx_control_.resize(batch_size_ * kControlBytes);
+    datagrams_.resize(batch_size_);
+
+    tx_storage_.resize(batch_size_ * kMaxDatagramSize);
+    tx_iov_.resize(batch_size_ * 2);
+    tx_msgs_.resize(batch_size_);
+    tx_destinations_.resize(batch_size_);
+    tx_refs_.resize(batch_size_);
+    tx_arrival_us_.resize(batch_size_);
+    tx_srtp_.resize(batch_size_);
+    tx_protect_.reset(new SrtpBatchItem[batch_size_]);
+    tx_protect_slots_.resize(batch_size_);
+
+    for (size_t i = 0; i < batch_size_; ++i) {
+        rx_buffers_[i] = MediaBuffer::Allocate();
+        rx_iov_[i].iov_base = rx_buffers_[i]->data();
+        rx_iov_[i].iov_len = kMaxDatagramSize;
+
+        std::memset(&rx_msgs_[i], 0, sizeof(mmsghdr));
+        rx_msgs_[i].msg_hdr.msg_iov = &rx_iov_[i];
+        rx_msgs_[i].msg_hdr.msg_iovlen = 1;
+
+        tx_iov_[i * 2].iov_base = tx_storage_.data() + i * kMaxDatagramSize;
+        tx_iov_[i * 2].iov_len = 0;
+
+        std::memset(&tx_msgs_[i], 0, sizeof(mmsghdr));
+        tx_msgs_[i].msg_hdr.msg_iov = &tx_iov_[i * 2];
+        tx_msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+UdpMediaEngine::~UdpMediaEngine() {
+    stop();
+    close();
+}
+
+bool UdpMediaEngine::open() {
+    if (fd_ >= 0) {
+        return true;
+    }
+
+    int fd = ::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR << "Failed to create RTC socket: " << std::strerror(errno);
+        return false;
+    }
+
+    // Accept IPv4 peers on the same socket as v4-mapped addresses
+    int off = 0;
+    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (reuse_port_ && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        LOG_ERROR << "Failed to enable SO_REUSEPORT on RTC socket: " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    // Kernel receive timestamps keep jitter measurements free of our own
+    // queueing delay
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+    int buffer_bytes = kSocketBufferBytes;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_bytes, sizeof(buffer_bytes));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer_bytes, sizeof(buffer_bytes));
+
+    sockaddr_in6 addr{};
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(static_cast<uint16_t>(port_));
+
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        LOG_ERROR << "Failed to bind RTC port " << port_ << ": " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        LOG_ERROR << "Failed to create media engine wake fd: " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    LOG_INFO << "UDP media engine bound to port " << port_ << " (batch size " << batch_size_
+              << (reuse_port_ ? ", reuseport" : "") << ")";
+    return true;
+}
+
+void UdpMediaEngine::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+bool UdpMediaEngine::attachSsrcSteering(size_t group_size) {
+    if (fd_ < 0 || group_size == 0) {
+        return false;
+    }
+
+    // The program sees the UDP payload: the SSRC is the word at offset 8.
+    // A failed load (runt datagram) returns 0, the first socket.
+    sock_filter code[] = {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, 8},
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(group_size)},
+        {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    sock_fprog program{static_cast<unsigned short>(sizeof(code) / sizeof(code[0])), code};
+
+    if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0) {
+        LOG_ERROR << "Failed to attach SSRC steering on RTC port " << port_ << ": " << std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void UdpMediaEngine::wake() {
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+        (void)written; // Counter saturation still leaves the fd readable
+    }
+}
+
+size_t UdpMediaEngine::receiveBatch(int timeout_ms) {
+    if (fd_ < 0) {
+        return 0;
+    }
+
+    pollfd pfds[2] = {};
+    pfds[0].fd = fd_;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = wake_fd_;
+    pfds[1].events = POLLIN;
+    int ready = ::poll(pfds, wake_fd_ >= 0 ? 2 : 1, timeout_ms);
+    if (ready > 0 && (pfds[1].revents & POLLIN)) {
+        uint64_t count = 0;
+        ssize_t drained = ::read(wake_fd_, &count, sizeof(count));
+        (void)drained;
+        wake_pending_ = true;
+    }
+    if (ready <= 0 || !(pfds[0].revents & POLLIN)) {
+        return 0;
+    }
+
+    // msg_namelen and iov_len are in/out parameters and must be re-armed
+    for (size_t i = 0; i < batch_size_; ++i) {
+        if (!rx_buffers_[i].unique()) {
+            rx_buffers_[i] = MediaBuffer::Allocate();
+            rx_iov_[i].iov_base = rx_buffers_[i]->data();
+        }
+        rx_msgs_[i].msg_hdr.msg_name = &rx_sources_[i].addr;
+        rx_msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        rx_msgs_[i].msg_hdr.msg_control = rx_control_.data() + i * kControlBytes;
+        rx_msgs_[i].msg_hdr.msg_controllen = kControlBytes;
+        rx_iov_[i].iov_len = kMaxDatagramSize;
+    }
+
+    int received = ::recvmmsg(fd_, rx_msgs_.data(), static_cast<unsigned int>(batch_size_), MSG_DONTWAIT, nullptr);
+    if (received <= 0) {
+        if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            LOG_RATE_LIMITED(kError, 1) << "recvmmsg failed on RTC port " << port_ << ": " << std::strerror(errno);
+        }
+        return 0;
+    }
+
+    uint64_t batch_time_us = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < received; ++i) {
+        uint64_t arrival_us = 0;
+        msghdr& hdr = rx_msgs_[i].msg_hdr;
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                arrival_us = ToMicros(ts);
+            }
+        }
+        if (arrival_us == 0) {
+            if (batch_time_us == 0) {
+                batch_time_us = MediaClockMicros();
+            }
+            arrival_us = batch_time_us;
+        }
+        datagrams_[i].arrival_us = arrival_us;
+
+        rx_sources_[i].len = rx_msgs_[i].msg_hdr.msg_namelen;
+        rx_buffers_[i]->setSize(rx_msgs_[i].msg_len);
+        datagrams_[i].data = rx_buffers_[i]->data();
+        datagrams_[i].size = rx_msgs_[i].msg_len;
+        datagrams_[i].source = &rx_sources_[i];
+        datagrams_[i].buffer = rx_buffers_[i].get();
+        bytes += rx_msgs_[i].msg_len;
+    }
+
+    packets_received_.fetch_add(static_cast<uint64_t>(received), std::memory_order_relaxed);
+    bytes_received_.fetch_add(bytes, std::memory_order_relaxed);
+    receive_batches_.fetch_add(1, std::memory_order_relaxed);
+
+    return static_cast<size_t>(received);
+}
+
+bool UdpMediaEngine::queueSend(const uint8_t* data, size_t size, const MediaEndpoint& destination) {
+    if (size > kMaxDatagramSize || !destination.IsSet()) {
+        send_drops_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t slot = AcquireTxSlot(destination);
+    iovec* iov = &tx_iov_[slot * 2];
+    std::memcpy(iov[0].iov_base, data, size);
+    iov[0].iov_len = size;
+    tx_msgs_[slot].msg_hdr.msg_iovlen = 1;
+    tx_arrival_us_[slot] = 0;
+    return true;
+}
+
+uint8_t* UdpMediaEngine::queueForward(const MediaBufferRef& buffer,
+                                      const uint8_t* header, size_t header_size,
+                                      const uint8_t* payload, size_t payload_size,
+                                      const MediaEndpoint& destination, uint64_t arrival_us,
+                                      const std::shared_ptr<SrtpSession>& srtp) {
+    size_t overhead = srtp ? srtp::RtpOverhead(srtp->profile()) : 0;
+    if (!buffer || header_size + payload_size + overhead > kMaxDatagramSize || !destination.IsSet()) {
+        send_drops_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    size_t slot = AcquireTxSlot(destination);
+    iovec* iov = &tx_iov_[slot * 2];
+    uint8_t* slot_header = static_cast<uint8_t*>(iov[0].iov_base);
+    std::memcpy(slot_header, header, header_size);
+    if (srtp) {
+        std::memcpy(slot_header + header_size, payload, payload_size);
+        iov[0].iov_len = header_size + payload_size;
+        tx_msgs_[slot].msg_hdr.msg_iovlen = 1;
+        tx_srtp_[slot] = srtp;
+        tx_srtp_count_++;
+    } else {
+        iov[0].iov_len = header_size;
+        iov[1].iov_base = const_cast<uint8_t*>(payload);
+        iov[1].iov_len = payload_size;
+        tx_msgs_[slot].msg_hdr.msg_iovlen = 2;
+        tx_refs_[slot] = buffer;
+    }
+    tx_arrival_us_[slot] = arrival_us;
+    return slot_header;
+}
+
+size_t UdpMediaEngine::AcquireTxSlot(const MediaEndpoint& destination) {
+    if (tx_count_ == batch_size_) {
+        flush();
+    }
+
+    // ProtectBatch() may have moved another slot's header here
+    size_t slot = tx_count_++;
+    tx_destinations_[slot] = destination;
+    tx_msgs_[slot].msg_hdr.msg_iov = &tx_iov_[slot * 2];
+    tx_msgs_[slot].msg_hdr.msg_name = &tx_destinations_[slot].addr;
+    tx_msgs_[slot].msg_hdr.msg_namelen = destination.len;
+    return slot;
+}
+
+size_t UdpMediaEngine::flush() {
+    if (tx_count_ == 0) {
+        return 0;
+    }
+    if (fd_ < 0) {
+        send_drops_.fetch_add(tx_count_, std::memory_order_relaxed);
+        ReleaseTxRefs();
+        return 0;
+    }
+
+    size_t count = tx_srtp_count_ > 0 ? ProtectBatch() : tx_count_;
+
+    size_t sent = 0;
+    while (sent < count) {
+        int result = ::sendmmsg(fd_, &tx_msgs_[sent], static_cast<unsigned int>(count - sent), MSG_DONTWAIT);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Socket buffer full or peer unreachable: drop the rest of the
+            // batch rather than stall the media loop. sendmmsg reports an
+            // error for the first datagram only, so skip past it.
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                send_drops_.fetch_add(1, std::memory_order_relaxed);
+                ++sent;
+                continue;
+            }
+            break;
+        }
+        send_batches_.fetch_add(1, std::memory_order_relaxed);
+
+        HdrHistogram& latency = GetMediaMetrics().forward_latency_us;
+        uint64_t now_us = MediaClockMicros();
+        uint64_t bytes = 0;
+        for (size_t i = sent; i < sent + static_cast<size_t>(result); ++i) {
+            bytes += tx_msgs_[i].msg_len;
+            // arrival_us is a kernel wall-clock stamp; skip it if the clock stepped back
+            if (tx_arrival_us_[i] != 0 && now_us >= tx_arrival_us_[i]) {
+                latency.Record(now_us - tx_arrival_us_[i]);
+            }
+        }
+        packets_sent_.fetch_add(static_cast<uint64_t>(result), std::memory_order_relaxed);
+        bytes_sent_.fetch_add(bytes, std::memory_order_relaxed);
+        sent += static_cast<size_t>(result);
+    }
+
+    if (sent < count) {
+        send_drops_.fetch_add(count - sent, std::memory_order_relaxed);
+    }
+
+    ReleaseTxRefs();
+    return sent;
+}
+
+size_t UdpMediaEngine::ProtectBatch() {
+    size_t items = 0;
+    for (size_t i = 0; i < tx_count_; ++i) {
+        if (!tx_srtp_[i]) {
+            continue;
+        }
+        iovec& iov = *tx_msgs_[i].msg_hdr.msg_iov;
+        SrtpBatchItem& item = tx_protect_[items];
+        item.session = tx_srtp_[i].get();
+        item.data = static_cast<uint8_t*>(iov.iov_base);
+        item.size = iov.iov_len;
+        item.capacity = kMaxDatagramSize;
+        tx_protect_slots_[items++] = i;
+    }
+
+    size_t protected_count = SrtpSession::ProtectRtp(tx_protect_.get(), items);
+    for (size_t j = 0; j < items; ++j) {
+        tx_msgs_[tx_protect_slots_[j]].msg_hdr.msg_iov->iov_len = tx_protect_[j].size;
+    }
+    if (protected_count == items) {
+        return tx_count_;
+    }
+
+    // Move the slots that failed behind the ones to send. The mmsghdr moves
+    // with its iovecs; AcquireTxSlot() points it back at its own.
+    size_t count = 0;
+    for (size_t i = 0, j = 0; i < tx_count_; ++i) {
+        bool failed = false;
+        if (j < items && tx_protect_slots_[j] == i) {
+            failed = tx_protect_[j++].status != SrtpStatus::kOk;
+        }
+        if (failed) {
+            continue;
+        }
+        if (count != i) {
+            std::swap(tx_msgs_[count], tx_msgs_[i]);
+            std::swap(tx_arrival_us_[count], tx_arrival_us_[i]);
+        }
+        count++;
+    }
+
+    uint64_t dropped = items - protected_count;
+    send_drops_.fetch_add(dropped, std::memory_order_relaxed);
+    LOG_RATE_LIMITED(kWarn, 1) << "SRTP protection failed for " << dropped << " datagrams on RTC port " << port_;
+    return count;
+}
+
+void UdpMediaEngine::ReleaseTxRefs() {
+    for (size_t i = 0; i < tx_count_; ++i) {
+        tx_refs_[i].reset();
+        tx_srtp_[i].reset();
+    }
+    tx_count_ = 0;
+    tx_srtp_count_ = 0;
+}
+
+void UdpMediaEngine::setTickHandler(TickHandler handler, uint32_t interval_ms) {
+    tick_handler_ = std::move(handler);
+    tick_interval_us_ = static_cast<uint64_t>(interval_ms) * 1000;
+}
+
+void UdpMediaEngine::start(BatchHandler handler) {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+    loop_thread_ = std::thread(&UdpMediaEngine::RunLoop, this, std::move(handler));
+}
+
+void UdpMediaEngine::stop() {
+    running_.store(false);
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
+}
+
+void UdpMediaEngine::RunLoop(BatchHandler handler) {
+    if (cpu_ >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu_, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            LOG_ERROR << "Failed to pin UDP media loop to CPU " << cpu_;
+        }
+    }
+
+    if (cpu_ >= 0) {
+        LOG_INFO << "UDP media loop started on port " << port_ << " (CPU " << cpu_ << ")";
+    } else {
+        LOG_INFO << "UDP media loop started on port " << port_;
+    }
+
+    // Ticks are scheduled on CLOCK_MONOTONIC; the handler still gets the
+    // media clock, which jitter buffer deadlines are kept in
+    bool ticking = tick_handler_ && tick_interval_us_ > 0;
+    uint64_t next_tick_us = MonotonicMicros() + tick_interval_us_;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        // Short poll timeout so stop() is honoured promptly and ticks are on time
+        int timeout_ms = 100;
+        if (ticking) {
+            uint64_t now_us = MonotonicMicros();
+            timeout_ms = now_us >= next_tick_us ? 0 : static_cast<int>((next_tick_us - now_us + 999) / 1000);
+        }
+
+        size_t count = receiveBatch(timeout_ms);
+        if (count > 0 && handler) {
+            handler(datagrams_.data(), count);
+        }
+
+        if (wake_pending_) {
+            wake_pending_ = false;
+            if (wake_handler_) {
+                wake_handler_();
+            }
+        }
+
+        if (ticking) {
+            uint64_t now_us = MonotonicMicros();
+            if (now_us >= next_tick_us) {
+                tick_handler_(MediaClockMicros());
+                next_tick_us += tick_interval_us_;
+                if (next_tick_us <= now_us) {
+                    // Fell behind by more than a period: skip, don't burst
+                    next_tick_us = now_us + tick_interval_us_;
+                }
+            }
+        }
+
+        flush();
+    }
+
+    LOG_INFO << "UDP media loop stopped on port " << port_;
+}
+
+UdpMediaEngine::Stats UdpMediaEngine::getStats() const {
+    Stats stats;
+    stats.packets_received = packets_received_.load(std::memory_order_relaxed);
+    stats.bytes_received = bytes_received_.load(std::memory_order_relaxed);
+    stats.packets_sent = packets_sent_.load(std::memory_order_relaxed);
+    stats.bytes_sent = bytes_sent_.load(std::memory_order_relaxed);
+    stats.receive_batches = receive_batches_.load(std::memory_order_relaxed);
+    stats.send_batches = send_batches_.load(std::memory_order_relaxed);
+    stats.send_drops = send_drops_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace driftway
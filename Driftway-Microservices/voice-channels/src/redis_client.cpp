@@ -1,59 +1,694 @@
-#include <iostream>
 #include <string>
 #include "redis_client.h"
+#include "logger.h"
+
+#include <hiredis/hiredis.h>
+#include <hiredis/async.h>
+#include <hiredis/adapters/libuv.h>
+
+#include <algorithm>
+#include <cstdlib>
 
 namespace driftway {
 
-RedisClient::RedisClient(const std::string& url) : connection_url_(url), connected_(false) {
-    std::cout << "Connecting to Redis: " << url << std::endl;
-    connected_ = true; // Simulate successful connection
+struct RedisClient::Connection {
+    Connection(RedisClient* owner, bool subscriber) : owner(owner), subscriber(subscriber) {}
+
+    RedisClient* owner;
+    bool subscriber;
+    redisAsyncContext* context = nullptr;
+    bool ready = false;  // Connected, AUTH and SELECT sent ahead of everything else
+    uv_timer_t retry;
+    uint32_t backoff_ms = 0;
+};
+
+namespace {
+
+constexpr char kEventsChannelPrefix[] = "voice:events:";
+
+// Time the last replies get at shutdown before the connections are cut
+constexpr uint64_t kShutdownDeadlineMs = 1000;
+
+std::string JsonEscape(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static const char kHex[] = "0123456789abcdef";
+                    out += "\\u00";
+                    out += kHex[(c >> 4) & 0xf];
+                    out += kHex[c & 0xf];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
 }
 
-RedisClient::~RedisClient() {
-    disconnect();
+// ,"name":[users whose state is `wanted`]
+void AppendUsers(std::string* out, const char* name, const std::unordered_map<std::string, bool>& states,
+                 bool wanted) {
+    *out += ",\"";
+    *out += name;
+    *out += "\":[";
+    bool first = true;
+    for (const auto& state : states) {
+        if (state.second != wanted) {
+            continue;
+        }
+        if (!first) {
+            *out += ',';
+        }
+        *out += '"';
+        *out += JsonEscape(state.first);
+        *out += '"';
+        first = false;
+    }
+    *out += ']';
 }
 
-bool RedisClient::IsConnected() const {
-    return connected_;
+RedisClient::Connection* ConnectionOf(const redisAsyncContext* context) {
+    return static_cast<RedisClient::Connection*>(context->data);
+}
+
+void OnConnect(const redisAsyncContext* context, int status) {
+    RedisClient::Connection* connection = ConnectionOf(context);
+    if (connection->context != context) {
+        return;  // Abandoned at shutdown
+    }
+    if (status != REDIS_OK) {
+        // hiredis frees the context after this returns
+        LOG_WARN << "Redis connection failed: " << context->errstr;
+        connection->context = nullptr;
+        connection->owner->onDisconnected(*connection);
+        return;
+    }
+    connection->owner->onConnected(*connection);
+}
+
+void OnDisconnect(const redisAsyncContext* context, int status) {
+    RedisClient::Connection* connection = ConnectionOf(context);
+    if (connection->context != context) {
+        return;
+    }
+    if (status != REDIS_OK) {
+        LOG_WARN << "Redis connection lost: " << context->errstr;
+    }
+    connection->context = nullptr;
+    connection->owner->onDisconnected(*connection);
+}
+
+void OnCommandReply(redisAsyncContext* context, void* r, void* privdata) {
+    RedisClient::Connection* connection = ConnectionOf(context);
+    auto* reply = static_cast<redisReply*>(r);
+    std::unique_ptr<RedisClient::ReplyCallback> callback(static_cast<RedisClient::ReplyCallback*>(privdata));
+
+    // A null reply means the connection went away with the command in
+    // flight; nothing more is sent on it
+    if (!reply) {
+        connection->ready = false;
+    }
+    bool failed = reply == nullptr || reply->type == REDIS_REPLY_ERROR;
+    if (reply && reply->type == REDIS_REPLY_ERROR) {
+        LOG_WARN << "Redis error: " << std::string(reply->str, reply->len);
+    } else if (reply && reply->type == REDIS_REPLY_ARRAY) {
+        // EXEC reports failures of the queued commands one by one
+        for (size_t i = 0; i < reply->elements; ++i) {
+            if (reply->element[i]->type == REDIS_REPLY_ERROR) {
+                LOG_WARN << "Redis error in transaction: "
+                         << std::string(reply->element[i]->str, reply->element[i]->len);
+                failed = true;
+            }
+        }
+    }
+
+    if (callback && *callback) {
+        std::string value;
+        if (reply && (reply->type == REDIS_REPLY_STRING || reply->type == REDIS_REPLY_STATUS)) {
+            value.assign(reply->str, reply->len);
+        }
+        (*callback)(!failed, value);
+    }
+    connection->owner->onReply(failed);
+}
+
+// Confirmations and messages of the subscriber connection:
+// ["message", channel, payload]
+void OnSubscriberReply(redisAsyncContext* context, void* r, void*) {
+    auto* reply = static_cast<redisReply*>(r);
+    if (!reply || reply->type != REDIS_REPLY_ARRAY || reply->elements < 3) {
+        return;
+    }
+    const redisReply* kind = reply->element[0];
+    const redisReply* channel = reply->element[1];
+    const redisReply* message = reply->element[2];
+    if (kind->type == REDIS_REPLY_STRING && std::string(kind->str, kind->len) == "message" &&
+        channel->type == REDIS_REPLY_STRING && message->type == REDIS_REPLY_STRING) {
+        ConnectionOf(context)->owner->handleMessage(std::string(channel->str, channel->len),
+                                                    std::string(message->str, message->len));
+    }
+}
+
+void OnWake(uv_async_t* handle) {
+    static_cast<RedisClient*>(handle->data)->onWake();
+}
+
+void OnWindow(uv_timer_t* handle) {
+    static_cast<RedisClient*>(handle->data)->onWindow();
+}
+
+void OnRetry(uv_timer_t* handle) {
+    auto* connection = static_cast<RedisClient::Connection*>(handle->data);
+    connection->owner->onRetry(*connection);
+}
+
+void OnClosed(uv_handle_t*) {}
+
+void CloseHandle(uv_handle_t* handle) {
+    if (!uv_is_closing(handle)) {
+        uv_close(handle, OnClosed);
+    }
+}
+
+} // namespace
+
+RedisClient::RedisClient(const std::string& url)
+    : loop_(new uv_loop_t()), wake_(new uv_async_t()), window_(new uv_timer_t()), deadline_(new uv_timer_t()),
+      command_(new Connection(this, false)), subscriber_(new Connection(this, true)),
+      jitter_(std::random_device()()) {
+    // redis://[[user]:password@]host[:port][/db]
+    std::string rest = url;
+    size_t scheme = rest.find("://");
+    if (scheme != std::string::npos) {
+        if (rest.compare(0, scheme, "redis") != 0) {
+            LOG_WARN << "Unsupported Redis URL scheme, connecting without TLS: " << rest.substr(0, scheme);
+        }
+        rest = rest.substr(scheme + 3);
+    }
+    size_t at = rest.rfind('@');
+    if (at != std::string::npos) {
+        std::string credentials = rest.substr(0, at);
+        size_t colon = credentials.find(':');
+        if (colon == std::string::npos) {
+            endpoint_.password = credentials;
+        } else {
+            endpoint_.username = credentials.substr(0, colon);
+            endpoint_.password = credentials.substr(colon + 1);
+        }
+        rest = rest.substr(at + 1);
+    }
+    size_t slash = rest.find('/');
+    if (slash != std::string::npos) {
+        endpoint_.db = std::atoi(rest.c_str() + slash + 1);
+        rest.resize(slash);
+    }
+    size_t colon = rest.rfind(':');
+    size_t bracket = rest.rfind(']');  // [IPv6]:port
+    if (colon != std::string::npos && (bracket == std::string::npos || colon > bracket)) {
+        endpoint_.port = std::atoi(rest.c_str() + colon + 1);
+        rest.resize(colon);
+    }
+    if (rest.size() >= 2 && rest.front() == '[' && rest.back() == ']') {
+        rest = rest.substr(1, rest.size() - 2);
+    }
+    if (!rest.empty()) {
+        endpoint_.host = rest == "localhost" ? "127.0.0.1" : rest;
+    }
+
+    uv_loop_init(loop_);
+    uv_async_init(loop_, wake_, OnWake);
+    wake_->data = this;
+    uv_timer_init(loop_, window_);
+    window_->data = this;
+    uv_timer_init(loop_, deadline_);
+    deadline_->data = this;
+    for (Connection* connection : {command_.get(), subscriber_.get()}) {
+        uv_timer_init(loop_, &connection->retry);
+        connection->retry.data = connection;
+    }
+
+    LOG_INFO << "Connecting to Redis at " << endpoint_.host << ":" << endpoint_.port;
+    thread_ = std::thread([this]() {
+        Connect(*command_);
+        uv_run(loop_, UV_RUN_DEFAULT);
+    });
+}
+
+RedisClient::~RedisClient() {
+    disconnect();
+    uv_loop_close(loop_);
+    delete deadline_;
+    delete window_;
+    delete wake_;
+    delete loop_;
 }
 
 void RedisClient::disconnect() {
-    if (connected_) {
-        std::cout << "Disconnecting from Redis" << std::endl;
-        connected_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopping_) {
+            stopping_ = true;
+            Wake();
+        }
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+        LOG_INFO << "Disconnected from Redis";
     }
 }
 
-bool RedisClient::publish(const std::string& channel, const std::string& message) {
-    std::cout << "Publishing to channel " << channel << ": " << message << std::endl;
-    return true;
+// Callers hold mutex_: the loop thread closes the async handle only after
+// seeing stopping_ under the same lock
+void RedisClient::Wake() {
+    uv_async_send(wake_);
 }
 
-void RedisClient::subscribe(const std::string& channel) {
-    std::cout << "Subscribing to channel: " << channel << std::endl;
+bool RedisClient::Enqueue(Command command) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || commands_.size() >= kMaxQueuedCommands) {
+        commands_dropped_++;
+        return false;
+    }
+    commands_.push_back(std::move(command));
+    Wake();
+    return true;
 }
 
-void RedisClient::unsubscribe(const std::string& channel) {
-    std::cout << "Unsubscribing from channel: " << channel << std::endl;
+bool RedisClient::publish(const std::string& channel, const std::string& message) {
+    return Enqueue(Command{{"PUBLISH", channel, message}, nullptr});
 }
 
-std::string RedisClient::get(const std::string& key) {
-    std::cout << "Getting key: " << key << std::endl;
-    return "mock_value";
+void RedisClient::get(const std::string& key, ReplyCallback callback) {
+    if (!Enqueue(Command{{"GET", key}, callback}) && callback) {
+        callback(false, std::string());
+    }
 }
 
 bool RedisClient::set(const std::string& key, const std::string& value) {
-    std::cout << "Setting key " << key << " to: " << value << std::endl;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || (writes_.size() >= kMaxQueuedCommands && writes_.find(key) == writes_.end())) {
+        commands_dropped_++;
+        return false;
+    }
+    Write& write = writes_[key];
+    write.del = false;
+    write.value = value;
+    writes_queued_++;
+    if (!window_armed_) {
+        window_armed_ = true;
+        Wake();
+    }
     return true;
 }
 
 bool RedisClient::del(const std::string& key) {
-    std::cout << "Deleting key: " << key << std::endl;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || (writes_.size() >= kMaxQueuedCommands && writes_.find(key) == writes_.end())) {
+        commands_dropped_++;
+        return false;
+    }
+    Write& write = writes_[key];
+    write.del = true;
+    write.value.clear();
+    writes_queued_++;
+    if (!window_armed_) {
+        window_armed_ = true;
+        Wake();
+    }
     return true;
 }
 
+void RedisClient::publishPresence(const std::string& channel_id, const std::string& user_id, bool joined) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        return;
+    }
+    events_[channel_id].presence[user_id] = joined;
+    events_queued_++;
+    if (!window_armed_) {
+        window_armed_ = true;
+        Wake();
+    }
+}
+
+void RedisClient::publishSpeaking(const std::string& channel_id, const std::string& user_id, bool speaking) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        return;
+    }
+    events_[channel_id].speaking[user_id] = speaking;
+    events_queued_++;
+    if (!window_armed_) {
+        window_armed_ = true;
+        Wake();
+    }
+}
+
+void RedisClient::subscribe(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopping_) {
+        LOG_INFO << "Subscribing to channel: " << channel;
+        subscription_changes_.emplace_back(channel, true);
+        Wake();
+    }
+}
+
+void RedisClient::unsubscribe(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopping_) {
+        LOG_INFO << "Unsubscribing from channel: " << channel;
+        subscription_changes_.emplace_back(channel, false);
+        Wake();
+    }
+}
+
+void RedisClient::setMessageHandler(MessageHandler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    message_handler_ = std::move(handler);
+}
+
 void RedisClient::handleMessage(const std::string& channel, const std::string& message) {
-    std::cout << "Received message on channel " << channel << ": " << message << std::endl;
+    LOG_DEBUG << "Received message on channel " << channel << ": " << message;
+    MessageHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handler = message_handler_;
+    }
+    if (handler) {
+        handler(channel, message);
+    }
+}
+
+RedisClient::Stats RedisClient::getStats() const {
+    Stats stats;
+    stats.commands_sent = commands_sent_.load(std::memory_order_relaxed);
+    stats.commands_failed = commands_failed_.load(std::memory_order_relaxed);
+    stats.commands_dropped = commands_dropped_.load(std::memory_order_relaxed);
+    stats.events_queued = events_queued_.load(std::memory_order_relaxed);
+    stats.events_published = events_published_.load(std::memory_order_relaxed);
+    stats.writes_queued = writes_queued_.load(std::memory_order_relaxed);
+    stats.write_batches = write_batches_.load(std::memory_order_relaxed);
+    stats.reconnects = reconnects_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.queued = commands_.size() + writes_.size();
+    return stats;
+}
+
+// Loop thread from here on
+
+void RedisClient::Connect(Connection& connection) {
+    redisAsyncContext* context = redisAsyncConnect(endpoint_.host.c_str(), endpoint_.port);
+    if (!context || context->err) {
+        LOG_WARN << "Redis connection failed: " << (context ? context->errstr : "out of memory");
+        if (context) {
+            redisAsyncFree(context);
+        }
+        ScheduleReconnect(connection);
+        return;
+    }
+    context->data = &connection;
+    connection.context = context;
+    redisLibuvAttach(context, loop_);
+    redisAsyncSetConnectCallback(context, OnConnect);
+    redisAsyncSetDisconnectCallback(context, OnDisconnect);
+}
+
+void RedisClient::ScheduleReconnect(Connection& connection) {
+    if (shutting_down_) {
+        return;
+    }
+    // Full backoff doubles per failure; the delay is drawn from its upper half
+    connection.backoff_ms = connection.backoff_ms == 0
+                                ? kMinBackoffMs
+                                : std::min(connection.backoff_ms * 2, kMaxBackoffMs);
+    uint32_t delay = connection.backoff_ms / 2 + static_cast<uint32_t>(jitter_() % (connection.backoff_ms / 2 + 1));
+    uv_timer_start(&connection.retry, OnRetry, delay, 0);
+}
+
+void RedisClient::onConnected(Connection& connection) {
+    connection.backoff_ms = 0;
+    connection.ready = true;
+    if (!endpoint_.password.empty()) {
+        if (endpoint_.username.empty()) {
+            SendTo(connection, {"AUTH", endpoint_.password});
+        } else {
+            SendTo(connection, {"AUTH", endpoint_.username, endpoint_.password});
+        }
+    }
+
+    if (connection.subscriber) {
+        if (!subscriptions_.empty()) {
+            std::vector<std::string> args{"SUBSCRIBE"};
+            args.insert(args.end(), subscriptions_.begin(), subscriptions_.end());
+            SendTo(connection, args);
+        }
+        return;
+    }
+
+    if (endpoint_.db != 0) {
+        SendTo(connection, {"SELECT", std::to_string(endpoint_.db)});
+    }
+    connected_.store(true, std::memory_order_relaxed);
+    LOG_INFO << "Connected to Redis at " << endpoint_.host << ":" << endpoint_.port;
+    FlushCommands();
+    FlushWindow();
+}
+
+void RedisClient::onDisconnected(Connection& connection) {
+    bool was_ready = connection.ready;
+    connection.ready = false;
+    if (!connection.subscriber) {
+        connected_.store(false, std::memory_order_relaxed);
+        in_flight_ = 0;
+        throttled_ = false;
+    }
+    if (shutting_down_) {
+        FinishShutdownIfIdle();
+        return;
+    }
+    if (was_ready) {
+        reconnects_++;
+    }
+    if (!connection.subscriber || !subscriptions_.empty()) {
+        ScheduleReconnect(connection);
+    }
+}
+
+void RedisClient::onRetry(Connection& connection) {
+    if (!shutting_down_ && !connection.context && (!connection.subscriber || !subscriptions_.empty())) {
+        Connect(connection);
+    }
+}
+
+void RedisClient::onReply(bool failed) {
+    if (failed) {
+        commands_failed_++;
+    }
+    if (in_flight_ > 0) {
+        in_flight_--;
+    }
+    if (throttled_ && in_flight_ <= kMaxInFlight / 2) {
+        FlushCommands();
+    }
+}
+
+void RedisClient::onWake() {
+    std::vector<std::pair<std::string, bool>> changes;
+    bool stopping;
+    bool arm;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        changes.swap(subscription_changes_);
+        stopping = stopping_;
+        arm = window_armed_;
+    }
+
+    ApplySubscriptionChanges(std::move(changes));
+    if (stopping) {
+        BeginShutdown();
+        return;
+    }
+    FlushCommands();
+    if (arm && command_->ready && !uv_is_active(reinterpret_cast<uv_handle_t*>(window_))) {
+        uv_timer_start(window_, OnWindow, kCoalesceWindowMs, 0);
+    }
+}
+
+void RedisClient::onWindow() {
+    FlushWindow();
+}
+
+void RedisClient::SendTo(Connection& connection, const std::vector<std::string>& args, ReplyCallback* callback) {
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    argv.reserve(args.size());
+    argvlen.reserve(args.size());
+    for (const std::string& arg : args) {
+        argv.push_back(arg.data());
+        argvlen.push_back(arg.size());
+    }
+
+    redisCallbackFn* fn = connection.subscriber ? OnSubscriberReply : OnCommandReply;
+    int status = connection.context
+                     ? redisAsyncCommandArgv(connection.context, fn, callback, static_cast<int>(args.size()),
+                                             argv.data(), argvlen.data())
+                     : REDIS_ERR;
+    if (connection.subscriber) {
+        return;
+    }
+    commands_sent_++;
+    if (status != REDIS_OK) {
+        commands_failed_++;
+        if (callback) {
+            (*callback)(false, std::string());
+            delete callback;
+        }
+        return;
+    }
+    in_flight_++;
+}
+
+void RedisClient::Send(const std::vector<std::string>& args, ReplyCallback callback) {
+    SendTo(*command_, args, callback ? new ReplyCallback(std::move(callback)) : nullptr);
+}
+
+// Hands queued commands to hiredis, which writes them out back to back.
+// Past kMaxInFlight unanswered commands the rest waits for replies, so a
+// slow server fills our bounded queue rather than the output buffer.
+void RedisClient::FlushCommands(bool all) {
+    if (!command_->ready) {
+        return;
+    }
+    std::vector<Command> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t room = in_flight_ < kMaxInFlight ? kMaxInFlight - in_flight_ : 0;
+        size_t count = all ? commands_.size() : std::min(room, commands_.size());
+        batch.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            batch.push_back(std::move(commands_.front()));
+            commands_.pop_front();
+        }
+        throttled_ = !commands_.empty();
+    }
+    for (Command& command : batch) {
+        Send(command.args, std::move(command.callback));
+    }
+}
+
+// One PUBLISH per channel with events, then every pending write in one
+// MULTI/EXEC. While disconnected everything stays queued, and keeps
+// coalescing, until the connection is back.
+void RedisClient::FlushWindow() {
+    if (!command_->ready) {
+        return;
+    }
+    std::unordered_map<std::string, ChannelEvents> events;
+    std::unordered_map<std::string, Write> writes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events.swap(events_);
+        writes.swap(writes_);
+        window_armed_ = false;
+    }
+
+    for (const auto& entry : events) {
+        std::string message = "{\"channel\":\"" + JsonEscape(entry.first) + "\"";
+        AppendUsers(&message, "joined", entry.second.presence, true);
+        AppendUsers(&message, "left", entry.second.presence, false);
+        AppendUsers(&message, "speaking", entry.second.speaking, true);
+        AppendUsers(&message, "silent", entry.second.speaking, false);
+        message += '}';
+        Send({"PUBLISH", kEventsChannelPrefix + entry.first, message});
+        events_published_++;
+    }
+
+    if (writes.empty()) {
+        return;
+    }
+    Send({"MULTI"});
+    for (const auto& entry : writes) {
+        if (entry.second.del) {
+            Send({"DEL", entry.first});
+        } else {
+            Send({"SET", entry.first, entry.second.value});
+        }
+    }
+    Send({"EXEC"});
+    write_batches_++;
+}
+
+void RedisClient::ApplySubscriptionChanges(std::vector<std::pair<std::string, bool>> changes) {
+    for (const auto& change : changes) {
+        if (change.second) {
+            if (subscriptions_.insert(change.first).second && subscriber_->ready) {
+                SendTo(*subscriber_, {"SUBSCRIBE", change.first});
+            }
+        } else if (subscriptions_.erase(change.first) > 0 && subscriber_->ready) {
+            SendTo(*subscriber_, {"UNSUBSCRIBE", change.first});
+        }
+    }
+    // The subscriber connection is opened with the first subscription
+    if (!subscriptions_.empty() && !subscriber_->context && !shutting_down_ &&
+        !uv_is_active(reinterpret_cast<uv_handle_t*>(&subscriber_->retry))) {
+        Connect(*subscriber_);
+    }
+}
+
+// Flushes what is queued, asks both connections to close once their
+// replies are in, and cuts them at the deadline. uv_run() returns when the
+// last handle is closed.
+void RedisClient::BeginShutdown() {
+    if (shutting_down_) {
+        return;
+    }
+    FlushCommands(true);
+    FlushWindow();
+    shutting_down_ = true;
+
+    CloseHandle(reinterpret_cast<uv_handle_t*>(wake_));
+    CloseHandle(reinterpret_cast<uv_handle_t*>(window_));
+    for (Connection* connection : {command_.get(), subscriber_.get()}) {
+        CloseHandle(reinterpret_cast<uv_handle_t*>(&connection->retry));
+        redisAsyncContext* context = connection->context;
+        if (!context) {
+            continue;
+        }
+        if (connection->ready) {
+            redisAsyncDisconnect(context);  // Reports back through OnDisconnect
+        } else {
+            connection->context = nullptr;
+            redisAsyncFree(context);
+        }
+    }
+
+    uv_timer_start(deadline_, [](uv_timer_t* handle) {
+        auto* self = static_cast<RedisClient*>(handle->data);
+        for (Connection* connection : {self->command_.get(), self->subscriber_.get()}) {
+            if (redisAsyncContext* context = connection->context) {
+                LOG_WARN << "Redis replies still outstanding at shutdown, closing";
+                connection->context = nullptr;
+                redisAsyncFree(context);
+            }
+        }
+        self->FinishShutdownIfIdle();
+    }, kShutdownDeadlineMs, 0);
+    FinishShutdownIfIdle();
+}
+
+void RedisClient::FinishShutdownIfIdle() {
+    if (!command_->context && !subscriber_->context) {
+        connected_.store(false, std::memory_order_relaxed);
+        CloseHandle(reinterpret_cast<uv_handle_t*>(deadline_));
+    }
 }
 
-} // namespace driftway
\ No newline at end of file
+} // namespace driftway
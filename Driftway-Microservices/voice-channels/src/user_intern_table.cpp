@@ -0,0 +1,76 @@
+#include "user_intern_table.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace driftway {
+
+ParticipantHandle UserInternTable::Acquire(const std::string& user_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = handles_.find(user_id);
+    if (it != handles_.end()) {
+        entries_[it->second].refs++;
+        return it->second;
+    }
+
+    ParticipantHandle handle;
+    if (!free_handles_.empty()) {
+        // free_handles_ is a min-heap, so reuse keeps handles packed low
+        std::pop_heap(free_handles_.begin(), free_handles_.end(), std::greater<ParticipantHandle>());
+        handle = free_handles_.back();
+        free_handles_.pop_back();
+    } else {
+        handle = static_cast<ParticipantHandle>(entries_.size());
+        entries_.emplace_back();
+    }
+
+    entries_[handle].user_id = user_id;
+    entries_[handle].refs = 1;
+    handles_.emplace(user_id, handle);
+    return handle;
+}
+
+void UserInternTable::Release(ParticipantHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (handle >= entries_.size() || entries_[handle].refs == 0) {
+        return;
+    }
+
+    Entry& entry = entries_[handle];
+    if (--entry.refs == 0) {
+        handles_.erase(entry.user_id);
+        entry.user_id.clear();
+        free_handles_.push_back(handle);
+        std::push_heap(free_handles_.begin(), free_handles_.end(), std::greater<ParticipantHandle>());
+    }
+}
+
+ParticipantHandle UserInternTable::Find(const std::string& user_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = handles_.find(user_id);
+    return it != handles_.end() ? it->second : kInvalidParticipantHandle;
+}
+
+std::string UserInternTable::GetUserId(ParticipantHandle handle) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (handle < entries_.size() && entries_[handle].refs > 0) {
+        return entries_[handle].user_id;
+    }
+    return "";
+}
+
+size_t UserInternTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return handles_.size();
+}
+
+size_t UserInternTable::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+} // namespace driftway
@@ -0,0 +1,60 @@
+#include "voice_activity.h"
+#include "rtp_packet.h"
+
+#include <algorithm>
+
+namespace driftway {
+
+namespace {
+
+// Per-packet smoothing weights: a louder packet pulls the average half way
+// towards it, a quieter one a tenth, so onsets register within a few
+// packets and short pauses between words do not end speech
+constexpr float kAttack = 0.5f;
+constexpr float kRelease = 0.1f;
+
+} // namespace
+
+bool ParseAudioLevel(const RtpHeaderExtension& element, uint8_t* level, bool* voice) {
+    if (element.size < 1 || !element.data) {
+        return false;
+    }
+    *voice = (element.data[0] & 0x80) != 0;
+    *level = element.data[0] & 0x7F;
+    return true;
+}
+
+VoiceActivityDetector::VoiceActivityDetector() : VoiceActivityDetector(Config()) {}
+
+VoiceActivityDetector::VoiceActivityDetector(const Config& config)
+    : config_(config), extension_id_(kDefaultAudioLevelExtensionId), smoothed_(kAudioLevelSilence),
+      speaking_(false), silent_(false), last_loud_us_(0) {}
+
+VoiceActivityDetector::Transition VoiceActivityDetector::Update(uint8_t level, bool voice, uint64_t arrival_us) {
+    level = std::min(level, kAudioLevelSilence);
+    bool flagged = config_.trust_voice_flag && voice;
+
+    // Lower -dBov is louder
+    float alpha = level < smoothed_ ? kAttack : kRelease;
+    smoothed_ += alpha * (static_cast<float>(level) - smoothed_);
+
+    bool loud = flagged || smoothed_ <= config_.silence_level;
+    if (loud) {
+        last_loud_us_ = arrival_us;
+    }
+
+    Transition transition = Transition::kNone;
+    if (!speaking_ && (flagged || smoothed_ <= config_.speech_level)) {
+        speaking_ = true;
+        transition = Transition::kStarted;
+    } else if (speaking_ && !loud && arrival_us >= last_loud_us_ &&
+               arrival_us - last_loud_us_ >= static_cast<uint64_t>(config_.hangover_ms) * 1000) {
+        speaking_ = false;
+        transition = Transition::kStopped;
+    }
+
+    silent_ = !speaking_ && !flagged && level >= config_.suppress_level;
+    return transition;
+}
+
+} // namespace driftway
@@ -1,19 +1,38 @@
-#include <iostream>
 #include <vector>
 #include <algorithm>
 #include <memory>
 #include <ctime>
 #include "voice_channel.h"
+#include "jitter_buffer.h"
+#include "audio_mixer.h"
+#include "voice_activity.h"
+#include "rtp_packet.h"
+#include "srtp_session.h"
+#include "stun_handler.h"
+#include "logger.h"
+#include "metrics.h"
 
 namespace driftway {
 
+namespace {
+
+// SSRCs are routed server-wide, so they must not repeat across channels.
+// Each allocation takes a block of worker_count values and uses the one
+// matching the channel's worker.
+std::atomic<uint32_t> g_next_ssrc_block{1000};
+
+// Last-N re-ranks this often, and whenever a sender starts speaking
+constexpr uint64_t kRankIntervalUs = 200000;
+
+} // namespace
+
 VoiceChannel::VoiceChannel(const std::string& channel_id, const std::string& server_id)
     : channel_id_(channel_id), server_id_(server_id), max_participants_(50) {
-    std::cout << "Created VoiceChannel " << channel_id << " on server " << server_id << std::endl;
+    LOG_INFO << "Created VoiceChannel " << channel_id << " on server " << server_id;
 }
 
 VoiceChannel::~VoiceChannel() {
-    std::cout << "Destroying VoiceChannel " << channel_id_ << std::endl;
+    LOG_INFO << "Destroying VoiceChannel " << channel_id_;
 }
 
 size_t VoiceChannel::GetParticipantCount() const {
@@ -26,49 +45,84 @@ bool VoiceChannel::IsEmpty() const {
     return participants_.empty();
 }
 
-bool VoiceChannel::AddParticipant(const std::string& user_id, const std::string& username) {
+bool VoiceChannel::AddParticipant(ParticipantHandle handle, const std::string& user_id, const std::string& username) {
     std::lock_guard<std::mutex> lock(participants_mutex_);
     
-    if (participants_.size() >= max_participants_) {
+    if (participants_.size() >= max_participants_ || handle == kInvalidParticipantHandle) {
         return false;
     }
     
-    if (participants_.find(user_id) != participants_.end()) {
+    if (participants_.find(handle) != participants_.end()) {
         return false; // Already in channel
     }
     
     auto participant = std::make_shared<Participant>();
+    participant->handle = handle;
     participant->user_id = user_id;
     participant->username = username.empty() ? user_id : username;
     participant->joined_at = static_cast<uint64_t>(std::time(nullptr));
     participant->ssrc = GenerateSSRC();
+    participant->srtp = std::make_shared<SrtpPeer>();
+    participant->ice = std::make_shared<IcePeer>();
     
-    participants_[user_id] = participant;
-    ssrc_to_user_[participant->ssrc] = user_id;
+    participants_[handle] = participant;
+    ssrc_to_participant_[participant->ssrc] = handle;
+    jitter_buffers_[participant->ssrc] = std::make_shared<JitterBuffer>(participant->ssrc);
+    voice_activity_[participant->ssrc] = std::make_shared<VoiceActivityDetector>();
+    version_.fetch_add(1, std::memory_order_release);
     
-    std::cout << "Added participant " << user_id << " to channel " << channel_id_ << std::endl;
+    LOG_INFO << "Added participant " << user_id << " to channel " << channel_id_;
     return true;
 }
 
-bool VoiceChannel::RemoveParticipant(const std::string& user_id) {
+bool VoiceChannel::RemoveParticipant(ParticipantHandle handle) {
     std::lock_guard<std::mutex> lock(participants_mutex_);
     
-    auto it = participants_.find(user_id);
+    auto it = participants_.find(handle);
     if (it == participants_.end()) {
         return false;
     }
     
+    // The receivers' outbound SRTP sessions drop the stream they protected
+    // the leaver's packets with; SSRCs are not reused
+    uint32_t ssrc = it->second->ssrc;
+    for (const auto& pair : participants_) {
+        if (pair.first != handle && pair.second->srtp->outbound()) {
+            pair.second->srtp->outbound()->RemoveStream(ssrc);
+        }
+    }
+
     // Remove from SSRC mapping
-    ssrc_to_user_.erase(it->second->ssrc);
-    participants_.erase(it);
+    ssrc_to_participant_.erase(it->second->ssrc);
+    jitter_buffers_.erase(it->second->ssrc);
+    voice_activity_.erase(it->second->ssrc);
     
-    std::cout << "Removed participant " << user_id << " from channel " << channel_id_ << std::endl;
+    LOG_INFO << "Removed participant " << it->second->user_id << " from channel " << channel_id_;
+    participants_.erase(it);
+    version_.fetch_add(1, std::memory_order_release);
     return true;
 }
 
-bool VoiceChannel::HasParticipant(const std::string& user_id) const {
+std::vector<ParticipantHandle> VoiceChannel::RemoveAllParticipants() {
     std::lock_guard<std::mutex> lock(participants_mutex_);
-    return participants_.find(user_id) != participants_.end();
+
+    std::vector<ParticipantHandle> removed;
+    removed.reserve(participants_.size());
+    for (const auto& pair : participants_) {
+        removed.push_back(pair.first);
+    }
+
+    participants_.clear();
+    ssrc_to_participant_.clear();
+    jitter_buffers_.clear();
+    voice_activity_.clear();
+    version_.fetch_add(1, std::memory_order_release);
+    return removed;
+}
+
+bool VoiceChannel::HasParticipant(ParticipantHandle handle) const {
+    std::lock_guard<std::mutex> lock(participants_mutex_);
+    return participants_.find(handle) != participants_.end();
 }
 
 std::vector<Participant> VoiceChannel::GetParticipants() const {
@@ -82,10 +136,10 @@ std::vector<Participant> VoiceChannel::GetParticipants() const {
     return result;
 }
 
-std::shared_ptr<Participant> VoiceChannel::GetParticipant(const std::string& user_id) {
+std::shared_ptr<Participant> VoiceChannel::GetParticipant(ParticipantHandle handle) {
     std::lock_guard<std::mutex> lock(participants_mutex_);
     
-    auto it = participants_.find(user_id);
+    auto it = participants_.find(handle);
     if (it != participants_.end()) {
         return it->second;
     }
@@ -100,7 +154,7 @@ void VoiceChannel::SetAudioCallback(AudioCallback callback) {
 
 bool VoiceChannel::SendAudio(const AudioPacket& packet) {
     packets_sent_++;
-    bytes_sent_ += packet.data.size();
+    bytes_sent_ += packet.payload_size;
     
     std::lock_guard<std::mutex> lock(callback_mutex_);
     if (audio_callback_) {
@@ -111,55 +165,454 @@ bool VoiceChannel::SendAudio(const AudioPacket& packet) {
     return false;
 }
 
-void VoiceChannel::BroadcastAudio(const AudioPacket& packet, const std::string& exclude_user) {
+void VoiceChannel::BroadcastAudio(const AudioPacket& packet, ParticipantHandle exclude) {
+    ForwardAudio(packet, exclude);
+}
+
+void VoiceChannel::ForwardAudio(const AudioPacket& packet, ParticipantHandle exclude,
+                                const ForwardRewrite* rewrite) {
+    UdpMediaEngine* transport = transport_.load(std::memory_order_acquire);
+    if (!transport || !packet.buffer) {
+        return;
+    }
+
+    const uint8_t* header = packet.header();
+    const uint8_t* payload = packet.payload();
+    uint64_t forwarded = 0;
+
     std::lock_guard<std::mutex> lock(participants_mutex_);
-    
+
     for (const auto& pair : participants_) {
-        if (pair.first != exclude_user) {
-            std::cout << "Broadcasting audio to " << pair.first << std::endl;
+        const Participant& receiver = *pair.second;
+        if (receiver.handle == exclude || receiver.is_deafened || !receiver.endpoint.IsSet()) {
+            continue;
         }
+
+        uint8_t* out = transport->queueForward(packet.buffer, header, packet.header_size,
+                                               payload, packet.payload_size, receiver.endpoint,
+                                               packet.arrival_us, receiver.srtp->outbound());
+        if (!out) {
+            continue;
+        }
+
+        // Per-receiver rewrite of the slot's header copy: padding is not
+        // forwarded, and the payload type becomes the one this receiver
+        // negotiated for Opus (marker bit kept).
+        out[0] &= static_cast<uint8_t>(~0x20);
+        out[1] = static_cast<uint8_t>((out[1] & 0x80) | (receiver.payload_type & 0x7F));
+        if (rewrite) {
+            if (rewrite->marker) {
+                out[1] |= 0x80;
+            }
+            rtp::WriteU16(out + 2, rewrite->sequence_number);
+            rtp::WriteU32(out + 4, rewrite->timestamp);
+            rtp::WriteU32(out + 8, rewrite->ssrc);
+        }
+        forwarded++;
     }
-    
-    packets_sent_++;
-    bytes_sent_ += packet.data.size();
+
+    packets_sent_ += forwarded;
+    bytes_sent_ += forwarded * (packet.header_size + packet.payload_size);
+
+    MediaMetrics& metrics = GetMediaMetrics();
+    metrics.packets_forwarded.Add();
+    metrics.copies_forwarded.Add(forwarded);
+    metrics.bytes_forwarded.Add(forwarded * (packet.header_size + packet.payload_size));
 }
 
-void VoiceChannel::SetSpeaking(const std::string& user_id, bool speaking) {
-    auto participant = GetParticipant(user_id);
-    if (participant) {
-        participant->is_speaking = speaking;
-        std::cout << "Set speaking status for " << user_id << ": " << speaking << std::endl;
+void VoiceChannel::ReceiveAudio(const AudioPacket& packet, JitterBuffer* jitter_buffer,
+                                VoiceActivityDetector* voice_activity) {
+    packets_received_++;
+    bytes_received_ += packet.header_size + packet.payload_size;
+
+    bool silent = false;
+    bool onset = false;
+    if (voice_activity && packet.audio_level != kNoAudioLevel) {
+        VoiceActivityDetector::Transition transition =
+            voice_activity->Update(packet.audio_level, packet.voice, packet.arrival_us);
+        if (transition != VoiceActivityDetector::Transition::kNone) {
+            onset = transition == VoiceActivityDetector::Transition::kStarted;
+            SetSpeaking(packet.source, onset);
+        }
+        silent = voice_activity->IsSilent();
+    }
+
+    bool mixing = IsMixingEnabled();
+
+    if (jitter_buffer) {
+        // The mixer consumes audio through the jitter buffer's playout
+        if (jitter_buffer->IsPlayoutEnabled() != mixing) {
+            jitter_buffer->SetPlayoutEnabled(mixing);
+        }
+        jitter_buffer->Insert(packet, packet.arrival_us);
+    }
+
+    if (mixing) {
+        return;
+    }
+    if (silent && IsSilenceSuppressionEnabled()) {
+        packets_suppressed_++;
+        GetMediaMetrics().packets_suppressed.Add();
+        return;
     }
+    if (last_n_ > 0) {
+        ForwardLastN(packet, onset);
+        return;
+    }
+    ForwardAudio(packet, packet.source);
 }
 
-void VoiceChannel::SetMuted(const std::string& user_id, bool muted) {
-    auto participant = GetParticipant(user_id);
-    if (participant) {
-        participant->is_muted = muted;
-        std::cout << "Set muted status for " << user_id << ": " << muted << std::endl;
+void VoiceChannel::ForwardLastN(const AudioPacket& packet, bool onset) {
+    // Wall-clock arrival times may step back; re-rank then rather than stall
+    if (onset || packet.arrival_us >= next_rank_us_ || packet.arrival_us + kRankIntervalUs < next_rank_us_) {
+        RankSpeakers();
+        next_rank_us_ = packet.arrival_us + kRankIntervalUs;
+    }
+
+    LastNSlot* slot = nullptr;
+    for (size_t i = 0; i < last_n_; ++i) {
+        if (last_n_slots_[i].holder == packet.source) {
+            slot = &last_n_slots_[i];
+            break;
+        }
+    }
+    if (!slot) {
+        GetMediaMetrics().packets_unselected.Add();
+        return;
     }
+
+    ForwardRewrite rewrite;
+    rewrite.ssrc = slot->virtual_ssrc;
+    rewrite.marker = false;
+
+    // A new speaker on the slot continues its numbering: the next sequence
+    // number, and a timestamp advanced by the wall time since the last packet
+    if (slot->source_ssrc != packet.ssrc) {
+        uint16_t next_sequence = packet.sequence_number;
+        uint32_t next_timestamp = packet.timestamp;
+        if (slot->has_output) {
+            uint64_t elapsed_us = packet.arrival_us > slot->last_arrival_us
+                                      ? packet.arrival_us - slot->last_arrival_us
+                                      : 0;
+            uint32_t elapsed = static_cast<uint32_t>(elapsed_us * rtp::kOpusClockRate / 1000000);
+            next_sequence = static_cast<uint16_t>(slot->last_sequence + 1);
+            next_timestamp = slot->last_timestamp + std::max<uint32_t>(elapsed, 1);
+        }
+        slot->source_ssrc = packet.ssrc;
+        slot->sequence_delta = static_cast<uint16_t>(next_sequence - packet.sequence_number);
+        slot->timestamp_delta = next_timestamp - packet.timestamp;
+        rewrite.marker = true; // Start of a talkspurt on this stream
+    }
+
+    rewrite.sequence_number = static_cast<uint16_t>(packet.sequence_number + slot->sequence_delta);
+    rewrite.timestamp = packet.timestamp + slot->timestamp_delta;
+
+    // Reordered packets keep their place but do not move the slot back
+    if (!slot->has_output || static_cast<int16_t>(rewrite.sequence_number - slot->last_sequence) > 0) {
+        slot->last_sequence = rewrite.sequence_number;
+        slot->last_timestamp = rewrite.timestamp;
+        slot->last_arrival_us = packet.arrival_us;
+        slot->has_output = true;
+    }
+
+    ForwardAudio(packet, packet.source, &rewrite);
 }
 
-void VoiceChannel::SetDeafened(const std::string& user_id, bool deafened) {
-    auto participant = GetParticipant(user_id);
-    if (participant) {
-        participant->is_deafened = deafened;
-        std::cout << "Set deafened status for " << user_id << ": " << deafened << std::endl;
+void VoiceChannel::RankSpeakers() {
+    // Everyone speaking, loudest (lowest -dBov) first; the top last_n_ are
+    // the ones to forward
+    rank_scratch_.clear();
+    {
+        std::lock_guard<std::mutex> lock(participants_mutex_);
+        for (const auto& pair : participants_) {
+            auto detector = voice_activity_.find(pair.second->ssrc);
+            if (detector != voice_activity_.end() && detector->second->IsSpeaking()) {
+                rank_scratch_.emplace_back(detector->second->smoothedLevel(), pair.first);
+            }
+        }
+
+        // Slots of speakers who left are free again
+        for (size_t i = 0; i < last_n_; ++i) {
+            LastNSlot& slot = last_n_slots_[i];
+            if (slot.holder != kInvalidParticipantHandle && participants_.count(slot.holder) == 0) {
+                slot.holder = kInvalidParticipantHandle;
+                slot.published.store(kInvalidParticipantHandle, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t selected = std::min(last_n_, rank_scratch_.size());
+    std::partial_sort(rank_scratch_.begin(), rank_scratch_.begin() + selected, rank_scratch_.end());
+
+    // Holders keep their slot while they are in the top N, or while no one
+    // in it needs the slot, so quiet speakers are only displaced by louder ones
+    for (size_t i = 0; i < last_n_; ++i) {
+        LastNSlot& slot = last_n_slots_[i];
+        slot.keep = false;
+        for (size_t j = 0; j < selected && !slot.keep; ++j) {
+            slot.keep = rank_scratch_[j].second == slot.holder;
+        }
+    }
+
+    for (size_t j = 0; j < selected; ++j) {
+        ParticipantHandle speaker = rank_scratch_[j].second;
+        bool held = false;
+        for (size_t i = 0; i < last_n_ && !held; ++i) {
+            held = last_n_slots_[i].holder == speaker;
+        }
+        if (held) {
+            continue;
+        }
+
+        // An empty slot first, then the one of a holder outside the top N
+        size_t target = last_n_;
+        for (size_t i = 0; i < last_n_; ++i) {
+            if (last_n_slots_[i].holder == kInvalidParticipantHandle) {
+                target = i;
+                break;
+            }
+            if (target == last_n_ && !last_n_slots_[i].keep) {
+                target = i;
+            }
+        }
+        if (target == last_n_) {
+            break;
+        }
+
+        LastNSlot& slot = last_n_slots_[target];
+        slot.holder = speaker;
+        slot.source_ssrc = 0; // Re-anchor on the speaker's next packet
+        slot.published.store(speaker, std::memory_order_relaxed);
+        slot.keep = true;
     }
 }
 
-uint32_t VoiceChannel::AssignSSRC(const std::string& user_id) {
-    auto participant = GetParticipant(user_id);
+void VoiceChannel::SetLastN(size_t n) {
+    last_n_ = n;
+    last_n_slots_.reset(n > 0 ? new LastNSlot[n] : nullptr);
+    for (size_t i = 0; i < n; ++i) {
+        last_n_slots_[i].virtual_ssrc = GenerateSSRC();
+    }
+    LOG_INFO << "Last-N for channel " << channel_id_ << ": " << n;
+}
+
+std::vector<std::pair<uint32_t, ParticipantHandle>> VoiceChannel::GetForwardedSpeakers() const {
+    std::vector<std::pair<uint32_t, ParticipantHandle>> speakers;
+    speakers.reserve(last_n_);
+    for (size_t i = 0; i < last_n_; ++i) {
+        speakers.emplace_back(last_n_slots_[i].virtual_ssrc,
+                              last_n_slots_[i].published.load(std::memory_order_relaxed));
+    }
+    return speakers;
+}
+
+void VoiceChannel::SetMixingEnabled(bool enabled, AudioProcessor* processor) {
+    if (processor) {
+        mixing_processor_.store(processor, std::memory_order_release);
+    }
+    mixing_enabled_.store(enabled && mixing_processor_.load(std::memory_order_acquire), std::memory_order_release);
+    version_.fetch_add(1, std::memory_order_release);
+    LOG_INFO << "Mixing mode for channel " << channel_id_ << ": " << (enabled ? "on" : "off");
+}
+
+bool VoiceChannel::MixTick(uint64_t now_us) {
+    UdpMediaEngine* transport = transport_.load(std::memory_order_acquire);
+    if (!IsMixingEnabled() || !transport) {
+        mixer_.reset();
+        return IsMixingEnabled();
+    }
+
+    if (!mixer_) {
+        mixer_ = std::make_unique<AudioMixer>(mixing_processor_.load(std::memory_order_acquire), GenerateSSRC());
+    }
+
+    mix_targets_.clear();
+    {
+        std::lock_guard<std::mutex> lock(participants_mutex_);
+        for (const auto& pair : participants_) {
+            const Participant& participant = *pair.second;
+            auto jitter_buffer = jitter_buffers_.find(participant.ssrc);
+            mix_targets_.push_back(MixTarget{
+                participant.ssrc, participant.payload_type, participant.is_muted, participant.is_deafened,
+                participant.endpoint,
+                jitter_buffer != jitter_buffers_.end() ? jitter_buffer->second : nullptr,
+                participant.srtp->outbound()});
+        }
+    }
+
+    mixer_->BeginFrame();
+
+    AudioPacket packet;
+    for (const MixTarget& target : mix_targets_) {
+        if (!target.jitter_buffer) {
+            continue;
+        }
+        switch (target.jitter_buffer->Pop(now_us, &packet)) {
+        case JitterBuffer::PopResult::kPacket:
+            if (!target.is_muted) {
+                mixer_->AddSpeaker(target.ssrc, packet.payload(), packet.payload_size);
+            }
+            break;
+        case JitterBuffer::PopResult::kLost:
+            if (!target.is_muted) {
+                const AudioPacket* next = target.jitter_buffer->PeekNext();
+                if (next) {
+                    mixer_->AddSpeaker(target.ssrc, next->payload(), next->payload_size, true);
+                } else {
+                    mixer_->AddSpeaker(target.ssrc, nullptr, 0);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    RtpHeader header;
+    uint8_t header_bytes[rtp::kFixedHeaderSize];
+    for (const MixTarget& target : mix_targets_) {
+        if (target.is_deafened || !target.endpoint.IsSet()) {
+            continue;
+        }
+
+        MediaBufferRef mix = mixer_->EncodeFor(target.ssrc);
+        if (!mix) {
+            continue;
+        }
+
+        mixer_->NextHeader(target.ssrc, target.payload_type, &header);
+        RtpPacketWriter writer(header_bytes, sizeof(header_bytes));
+        writer.WriteHeader(header);
+
+        if (transport->queueForward(mix, header_bytes, sizeof(header_bytes), mix->data(), mix->size(), target.endpoint,
+                                    0, target.srtp)) {
+            packets_sent_++;
+            bytes_sent_ += sizeof(header_bytes) + mix->size();
+        }
+    }
+
+    mixer_->EndFrame();
+    return true;
+}
+
+std::shared_ptr<JitterBuffer> VoiceChannel::GetJitterBuffer(uint32_t ssrc) const {
+    std::lock_guard<std::mutex> lock(participants_mutex_);
+
+    auto it = jitter_buffers_.find(ssrc);
+    if (it != jitter_buffers_.end()) {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<VoiceActivityDetector> VoiceChannel::GetVoiceActivity(uint32_t ssrc) const {
+    std::lock_guard<std::mutex> lock(participants_mutex_);
+
+    auto it = voice_activity_.find(ssrc);
+    if (it != voice_activity_.end()) {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
+void VoiceChannel::SetParticipantEndpoint(Participant& participant, const MediaEndpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(participants_mutex_);
+    participant.endpoint = endpoint;
+}
+
+void VoiceChannel::SetPayloadType(ParticipantHandle handle, uint8_t payload_type) {
+    std::lock_guard<std::mutex> lock(participants_mutex_);
+
+    auto it = participants_.find(handle);
+    if (it != participants_.end()) {
+        it->second->payload_type = payload_type & 0x7F;
+    }
+}
+
+bool VoiceChannel::SetSrtpSessions(ParticipantHandle handle, std::unique_ptr<SrtpSession> inbound,
+                                   std::shared_ptr<SrtpSession> outbound) {
+    auto participant = GetParticipant(handle);
+    if (!participant || !inbound || !outbound || !participant->srtp->SetSessions(std::move(inbound), std::move(outbound))) {
+        return false;
+    }
+    LOG_INFO << "SRTP keyed for " << participant->user_id << " ("
+             << srtp::ProfileName(participant->srtp->outbound()->profile()) << ")";
+    return true;
+}
+
+void VoiceChannel::SetAudioLevelExtensionId(ParticipantHandle handle, uint8_t id) {
+    std::lock_guard<std::mutex> lock(participants_mutex_);
+
+    auto it = participants_.find(handle);
+    if (it != participants_.end()) {
+        auto detector = voice_activity_.find(it->second->ssrc);
+        if (detector != voice_activity_.end()) {
+            detector->second->SetExtensionId(id);
+        }
+    }
+}
+
+void VoiceChannel::SetSpeaking(ParticipantHandle handle, bool speaking) {
+    // Called from the media thread on voice activity transitions; the flag
+    // is read under the lock by GetStats() and GetParticipants()
+    std::string changed_user;
+    {
+        std::lock_guard<std::mutex> lock(participants_mutex_);
+
+        auto it = participants_.find(handle);
+        if (it == participants_.end() || it->second->is_speaking == speaking) {
+            return;
+        }
+        it->second->is_speaking = speaking;
+        version_.fetch_add(1, std::memory_order_release);
+        LOG_DEBUG << "Set speaking status for " << it->second->user_id << ": " << speaking;
+        if (speaking_callback_) {
+            changed_user = it->second->user_id;
+        }
+    }
+
+    if (speaking_callback_) {
+        speaking_callback_(changed_user, speaking);
+    }
+}
+
+void VoiceChannel::SetMuted(ParticipantHandle handle, bool muted) {
+    // Read under the lock by the media worker and by GetParticipants()
+    std::lock_guard<std::mutex> lock(participants_mutex_);
+
+    auto it = participants_.find(handle);
+    if (it != participants_.end()) {
+        it->second->is_muted = muted;
+        version_.fetch_add(1, std::memory_order_release);
+        LOG_INFO << "Set muted status for " << it->second->user_id << ": " << muted;
+    }
+}
+
+void VoiceChannel::SetDeafened(ParticipantHandle handle, bool deafened) {
+    std::lock_guard<std::mutex> lock(participants_mutex_);
+
+    auto it = participants_.find(handle);
+    if (it != participants_.end()) {
+        it->second->is_deafened = deafened;
+        version_.fetch_add(1, std::memory_order_release);
+        LOG_INFO << "Set deafened status for " << it->second->user_id << ": " << deafened;
+    }
+}
+
+uint32_t VoiceChannel::AssignSSRC(ParticipantHandle handle) {
+    auto participant = GetParticipant(handle);
     if (participant) {
         return participant->ssrc;
     }
     return 0;
 }
 
-uint32_t VoiceChannel::GetSSRC(const std::string& user_id) const {
+uint32_t VoiceChannel::GetSSRC(ParticipantHandle handle) const {
     std::lock_guard<std::mutex> lock(participants_mutex_);
     
-    auto it = participants_.find(user_id);
+    auto it = participants_.find(handle);
     if (it != participants_.end()) {
         return it->second->ssrc;
     }
@@ -167,20 +620,20 @@ uint32_t VoiceChannel::GetSSRC(const std::string& user_id) const {
     return 0;
 }
 
-std::string VoiceChannel::GetUserBySSRC(uint32_t ssrc) const {
+ParticipantHandle VoiceChannel::GetParticipantBySSRC(uint32_t ssrc) const {
     std::lock_guard<std::mutex> lock(participants_mutex_);
     
-    auto it = ssrc_to_user_.find(ssrc);
-    if (it != ssrc_to_user_.end()) {
+    auto it = ssrc_to_participant_.find(ssrc);
+    if (it != ssrc_to_participant_.end()) {
         return it->second;
     }
     
-    return "";
+    return kInvalidParticipantHandle;
 }
 
 void VoiceChannel::SetMaxParticipants(size_t max_participants) {
     max_participants_ = max_participants;
-    std::cout << "Set max participants for channel " << channel_id_ << " to " << max_participants << std::endl;
+    LOG_INFO << "Set max participants for channel " << channel_id_ << " to " << max_participants;
 }
 
 VoiceChannel::ChannelStats VoiceChannel::GetStats() const {
@@ -194,17 +647,38 @@ VoiceChannel::ChannelStats VoiceChannel::GetStats() const {
             stats.active_speakers++;
         }
     }
+
+    size_t measured_streams = 0;
+    for (const auto& pair : jitter_buffers_) {
+        JitterBuffer::Stats stream = pair.second->GetStats();
+        if (stream.packets_received == 0) {
+            continue;
+        }
+        stats.average_packet_loss += stream.loss_fraction;
+        stats.average_jitter += stream.jitter_ms;
+        measured_streams++;
+    }
+    if (measured_streams > 0) {
+        stats.average_packet_loss /= measured_streams;
+        stats.average_jitter /= measured_streams;
+    }
     
     stats.total_packets_sent = packets_sent_;
     stats.total_packets_received = packets_received_;
     stats.total_bytes_sent = bytes_sent_;
     stats.total_bytes_received = bytes_received_;
+    stats.total_packets_suppressed = packets_suppressed_;
     
     return stats;
 }
 
+void VoiceChannel::SetMediaWorker(uint32_t index, uint32_t worker_count) {
+    worker_count_ = worker_count == 0 ? 1 : worker_count;
+    worker_index_ = index % worker_count_;
+}
+
 uint32_t VoiceChannel::GenerateSSRC() {
-    return next_ssrc_++;
+    return g_next_ssrc_block++ * worker_count_ + worker_index_;
 }
 
 } // namespace driftway
\ No newline at end of file
@@ -5,13 +5,72 @@
 #include "database_client.h"
 #include "redis_client.h"
 #include "http_server.h"
+#include "jitter_buffer.h"
+#include "epoch.h"
+#include "logger.h"
+#include "metrics.h"
+#include "packet_pool.h"
+#include "srtp_session.h"
+
+#include <openssl/crypto.h>
 
-#include <iostream>
 #include <stdexcept>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <algorithm>
 
 namespace driftway {
 
+namespace {
+
+// Redis key naming the channel a user is in, for other services to route by
+std::string UserChannelKey(const std::string& user_id) {
+    return "voice:user:" + user_id;
+}
+
+// SDES key offered in an "a=crypto:<tag> <suite> inline:<key>" line
+struct SdesOffer {
+    int tag = 0;
+    SrtpProfile profile = SrtpProfile::kAesCm128HmacSha1_80;
+    uint8_t key[srtp::kMasterKeySize];
+    uint8_t salt[srtp::kMaxMasterSaltSize];
+};
+
+// The offer's best supported crypto line; AES-GCM beats AES-CM
+bool ParseSdesOffer(const std::string& sdp, SdesOffer* offer) {
+    bool found = false;
+    for (size_t pos = sdp.find("a=crypto:"); pos != std::string::npos; pos = sdp.find("a=crypto:", pos + 1)) {
+        size_t end = sdp.find_first_of("\r\n", pos);
+        std::string_view line(sdp.data() + pos, (end == std::string::npos ? sdp.size() : end) - pos);
+
+        size_t suite_start = line.find(' ');
+        size_t key_start = line.find(" inline:");
+        if (suite_start == std::string_view::npos || key_start == std::string_view::npos || key_start < suite_start) {
+            continue;
+        }
+
+        SdesOffer candidate;
+        candidate.tag = std::atoi(line.data() + 9);
+        std::string_view suite = line.substr(suite_start + 1, key_start - suite_start - 1);
+        std::string_view key = line.substr(key_start + 8);
+        key = key.substr(0, key.find(' '));
+        if (!srtp::ParseProfileName(suite, &candidate.profile) ||
+            !srtp::ParseInlineKey(key, candidate.profile, candidate.key, candidate.salt)) {
+            continue;
+        }
+        if (!found || candidate.profile == SrtpProfile::kAeadAes128Gcm) {
+            *offer = candidate;
+            found = true;
+        }
+        OPENSSL_cleanse(&candidate, sizeof(candidate));
+    }
+    return found;
+}
+
+} // namespace
+
 VoiceServer::VoiceServer(const VoiceServerConfig& config)
     : config_(config), running_(false) {
 }
@@ -26,20 +85,19 @@ bool VoiceServer::Start() {
     }
 
     try {
-        std::cout << "Initializing voice server components..." << std::endl;
+        LOG_INFO << "Initializing voice server components...";
         InitializeComponents();
 
         running_.store(true);
 
-        // Start server thread
-        server_thread_ = std::thread(&VoiceServer::ServerLoop, this);
+        // Media runs on the WebRTC handler's workers; only housekeeping here
         cleanup_thread_ = std::thread(&VoiceServer::CleanupLoop, this);
 
-        std::cout << "Voice server started successfully!" << std::endl;
+        LOG_INFO << "Voice server started successfully!";
         return true;
 
     } catch (const std::exception& e) {
-        std::cerr << "Failed to start voice server: " << e.what() << std::endl;
+        LOG_ERROR << "Failed to start voice server: " << e.what();
         running_.store(false);
         return false;
     }
@@ -50,19 +108,16 @@ void VoiceServer::Stop() {
         return;
     }
 
-    std::cout << "Stopping voice server..." << std::endl;
+    LOG_INFO << "Stopping voice server...";
     running_.store(false);
 
     // Wait for threads to finish
-    if (server_thread_.joinable()) {
-        server_thread_.join();
-    }
     if (cleanup_thread_.joinable()) {
         cleanup_thread_.join();
     }
 
     ShutdownComponents();
-    std::cout << "Voice server stopped." << std::endl;
+    LOG_INFO << "Voice server stopped.";
 }
 
 bool VoiceServer::IsRunning() const {
@@ -70,73 +125,142 @@ bool VoiceServer::IsRunning() const {
 }
 
 std::shared_ptr<VoiceChannel> VoiceServer::CreateChannel(const std::string& channel_id, const std::string& server_id) {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    
-    auto it = channels_.find(channel_id);
-    if (it != channels_.end()) {
-        return it->second; // Channel already exists
+    bool created = false;
+    auto channel = channels_.GetOrCreate(channel_id, [&]() {
+        auto channel = std::make_shared<VoiceChannel>(channel_id, server_id);
+        channel->SetMaxParticipants(config_.max_participants);
+        channel->SetSilenceSuppression(config_.silence_suppression);
+        if (webrtc_handler_) {
+            webrtc_handler_->assignWorker(*channel);
+        }
+        // After the worker: virtual SSRCs are allocated for it
+        if (config_.last_n > 0) {
+            channel->SetLastN(static_cast<size_t>(config_.last_n));
+        }
+        // From the media thread; the client only queues, and outlives it
+        channel->SetSpeakingCallback([this, channel_id](const std::string& user_id, bool speaking) {
+            if (redis_client_) {
+                redis_client_->publishSpeaking(channel_id, user_id, speaking);
+            }
+        });
+        return channel;
+    }, &created);
+
+    if (created) {
+        LOG_INFO << "Created voice channel: " << channel_id << " for server: " << server_id;
+        if (db_client_) {
+            db_client_->logActivity("channel_created " + channel_id + " " + server_id);
+        }
     }
-
-    auto channel = std::make_shared<VoiceChannel>(channel_id, server_id);
-    channel->SetMaxParticipants(config_.max_participants);
-    
-    channels_[channel_id] = channel;
-    
-    std::cout << "Created voice channel: " << channel_id << " for server: " << server_id << std::endl;
     return channel;
 }
 
 std::shared_ptr<VoiceChannel> VoiceServer::GetChannel(const std::string& channel_id) {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    
-    auto it = channels_.find(channel_id);
-    if (it != channels_.end()) {
-        return it->second;
-    }
-    
-    return nullptr;
+    return channels_.Find(channel_id);
 }
 
 bool VoiceServer::RemoveChannel(const std::string& channel_id) {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    
-    auto it = channels_.find(channel_id);
-    if (it != channels_.end()) {
-        std::cout << "Removing voice channel: " << channel_id << std::endl;
-        channels_.erase(it);
-        return true;
+    auto channel = channels_.Remove(channel_id);
+    if (!channel) {
+        return false;
     }
-    
-    return false;
+
+    LOG_INFO << "Removing voice channel: " << channel_id;
+    ssrc_router_.RemoveChannel(channel.get());
+    if (db_client_) {
+        db_client_->logActivity("channel_removed " + channel_id);
+    }
+
+    // Whoever is still inside drops the membership reference on their handle
+    for (ParticipantHandle handle : channel->RemoveAllParticipants()) {
+        std::string user_id = users_.GetUserId(handle);
+        if (redis_client_) {
+            redis_client_->publishPresence(channel_id, user_id, false);
+            redis_client_->del(UserChannelKey(user_id));
+        }
+        if (db_client_) {
+            db_client_->removeParticipant(channel_id, user_id);
+        }
+        users_.Release(handle);
+    }
+    return true;
 }
 
-bool VoiceServer::JoinChannel(const std::string& channel_id, const std::string& user_id) {
+bool VoiceServer::JoinChannel(const std::string& channel_id, const std::string& user_id, uint32_t* ssrc_out) {
     auto channel = GetChannel(channel_id);
     if (!channel) {
         return false;
     }
 
-    bool success = channel->AddParticipant(user_id);
+    // Joining and publishing the route under the shard lock keeps cleanup
+    // from removing the channel, and a leave or RemoveChannel from dropping
+    // the route, between the join and the route going live
+    ParticipantHandle handle = users_.Acquire(user_id);
+    bool success = false;
+    uint32_t ssrc = 0;
+    channels_.Visit(channel_id, [&](VoiceChannel& registered) {
+        if (&registered != channel.get() || !registered.AddParticipant(handle, user_id)) {
+            return;
+        }
+        ssrc = registered.GetSSRC(handle);
+        ssrc_router_.Add(ssrc, channel, registered.GetParticipant(handle), registered.GetJitterBuffer(ssrc),
+                         registered.GetVoiceActivity(ssrc));
+        success = true;
+    });
     if (success) {
-        std::cout << "User " << user_id << " joined voice channel " << channel_id << std::endl;
+        if (ssrc_out) {
+            *ssrc_out = ssrc;
+        }
+        // Queued, and coalesced with the rest of a join storm
+        if (redis_client_) {
+            redis_client_->publishPresence(channel_id, user_id, true);
+            redis_client_->set(UserChannelKey(user_id), channel_id);
+        }
+        if (db_client_ && !db_client_->addParticipant(channel_id, user_id)) {
+            LOG_WARN << "Database write queue full, join of " << user_id << " to " << channel_id << " not recorded";
+        }
+        LOG_INFO << "User " << user_id << " joined voice channel " << channel_id;
+    } else {
+        users_.Release(handle);
     }
     
     return success;
 }
 
 bool VoiceServer::LeaveChannel(const std::string& channel_id, const std::string& user_id) {
-    auto channel = GetChannel(channel_id);
-    if (!channel) {
+    ParticipantHandle handle = users_.Find(user_id);
+    if (handle == kInvalidParticipantHandle) {
         return false;
     }
 
-    bool success = channel->RemoveParticipant(user_id);
+    // Under the shard lock, like the join, so the route goes with the
+    // participant; a channel already removed has released it
+    bool success = false;
+    channels_.Visit(channel_id, [&](VoiceChannel& registered) {
+        uint32_t ssrc = registered.GetSSRC(handle);
+        success = registered.RemoveParticipant(handle);
+        if (success) {
+            ssrc_router_.Remove(ssrc);
+        }
+    });
     if (success) {
-        std::cout << "User " << user_id << " left voice channel " << channel_id << std::endl;
+        users_.Release(handle);
+        if (redis_client_) {
+            redis_client_->publishPresence(channel_id, user_id, false);
+            redis_client_->del(UserChannelKey(user_id));
+        }
+        if (db_client_ && !db_client_->removeParticipant(channel_id, user_id)) {
+            LOG_WARN << "Database write queue full, leave of " << user_id << " from " << channel_id << " not recorded";
+        }
+
+        LOG_INFO << "User " << user_id << " left voice channel " << channel_id;
         
-        // Remove empty channels
-        if (channel->IsEmpty()) {
-            RemoveChannel(channel_id);
+        // Remove empty channels, unless someone joined meanwhile
+        if (channels_.RemoveIf(channel_id, [](const VoiceChannel& c) { return c.IsEmpty(); })) {
+            LOG_INFO << "Removing voice channel: " << channel_id;
+            if (db_client_) {
+                db_client_->logActivity("channel_removed " + channel_id);
+            }
         }
     }
     
@@ -160,9 +284,89 @@ std::vector<std::string> VoiceServer::GetChannelParticipants(const std::string&
     return user_ids;
 }
 
-bool VoiceServer::HandleOffer(const std::string& channel_id, const std::string& user_id, const std::string& sdp) {
+bool VoiceServer::SetChannelMixing(const std::string& channel_id, bool enabled) {
+    auto channel = GetChannel(channel_id);
+    if (!channel || !audio_processor_ || !webrtc_handler_) {
+        return false;
+    }
+
+    channel->SetMixingEnabled(enabled, audio_processor_.get());
+    if (enabled) {
+        webrtc_handler_->addMixingChannel(channel);
+    }
+    return true;
+}
+
+bool VoiceServer::HandleOffer(const std::string& channel_id, const std::string& user_id, const std::string& sdp,
+                              std::string* answer_sdp) {
     // Implementation would involve WebRTC peer connection setup
-    std::cout << "Handling WebRTC offer for user " << user_id << " in channel " << channel_id << std::endl;
+    LOG_INFO << "Handling WebRTC offer for user " << user_id << " in channel " << channel_id;
+
+    auto channel = GetChannel(channel_id);
+    ParticipantHandle handle = users_.Find(user_id);
+
+    // Forwarded packets are rewritten to the Opus payload type this client offered
+    auto rtpmap = sdp.find(" opus/48000");
+    if (rtpmap != std::string::npos) {
+        auto pt_start = sdp.rfind("a=rtpmap:", rtpmap);
+        if (pt_start != std::string::npos && channel && handle != kInvalidParticipantHandle) {
+            int payload_type = std::atoi(sdp.c_str() + pt_start + 9);
+            if (payload_type > 0 && payload_type < 128) {
+                channel->SetPayloadType(handle, static_cast<uint8_t>(payload_type));
+            }
+        }
+    }
+
+    // Voice activity reads the RFC 6464 audio level under the id this client mapped it to
+    auto extmap = sdp.find(" urn:ietf:params:rtp-hdrext:ssrc-audio-level");
+    if (extmap != std::string::npos && channel && handle != kInvalidParticipantHandle) {
+        auto id_start = sdp.rfind("a=extmap:", extmap);
+        if (id_start != std::string::npos) {
+            int id = std::atoi(sdp.c_str() + id_start + 9);
+            if (id > 0 && id < 256) {
+                channel->SetAudioLevelExtensionId(handle, static_cast<uint8_t>(id));
+            }
+        }
+    }
+
+    // The client's ufrag ties its connectivity checks to this participant;
+    // without one its plain RTP never latches an address
+    auto ice_ufrag = sdp.find("a=ice-ufrag:");
+    if (ice_ufrag != std::string::npos && channel && handle != kInvalidParticipantHandle && webrtc_handler_) {
+        ice_ufrag += 12;
+        std::string ufrag = sdp.substr(ice_ufrag, sdp.find_first_of("\r\n", ice_ufrag) - ice_ufrag);
+        auto participant = channel->GetParticipant(handle);
+        if (participant && !webrtc_handler_->addIcePeer(ufrag, participant->ice)) {
+            LOG_WARN << "ICE ufrag offered by " << user_id << " is already in use";
+        }
+    }
+
+    if (answer_sdp && webrtc_handler_) {
+        *answer_sdp = "a=ice-lite\r\na=ice-ufrag:" + webrtc_handler_->iceUfrag() +
+                      "\r\na=ice-pwd:" + webrtc_handler_->icePassword() + "\r\n";
+    }
+
+    // SDES: the client's key unprotects its media; it is answered with a
+    // fresh key of ours for what we send it
+    SdesOffer offer;
+    if (channel && handle != kInvalidParticipantHandle && ParseSdesOffer(sdp, &offer)) {
+        uint8_t key[srtp::kMasterKeySize];
+        uint8_t salt[srtp::kMaxMasterSaltSize];
+        if (srtp::GenerateMasterKey(offer.profile, key, salt)) {
+            auto inbound = std::make_unique<SrtpSession>(offer.profile, SrtpSession::Direction::kUnprotect,
+                                                         offer.key, offer.salt);
+            auto outbound = std::make_shared<SrtpSession>(offer.profile, SrtpSession::Direction::kProtect,
+                                                          key, salt);
+            if (inbound->IsValid() && outbound->IsValid() &&
+                channel->SetSrtpSessions(handle, std::move(inbound), std::move(outbound)) && answer_sdp) {
+                *answer_sdp += "a=crypto:" + std::to_string(offer.tag) + " " + srtp::ProfileName(offer.profile) +
+                               " inline:" + srtp::FormatInlineKey(key, salt, offer.profile) + "\r\n";
+            }
+        }
+        OPENSSL_cleanse(key, sizeof(key));
+        OPENSSL_cleanse(salt, sizeof(salt));
+        OPENSSL_cleanse(&offer, sizeof(offer));
+    }
     
     // For now, just return true to indicate the offer was processed
     // In a real implementation, this would:
@@ -175,14 +379,14 @@ bool VoiceServer::HandleOffer(const std::string& channel_id, const std::string&
 }
 
 bool VoiceServer::HandleAnswer(const std::string& channel_id, const std::string& user_id, const std::string& sdp) {
-    std::cout << "Handling WebRTC answer for user " << user_id << " in channel " << channel_id << std::endl;
+    LOG_INFO << "Handling WebRTC answer for user " << user_id << " in channel " << channel_id;
     
     // Implementation would set the remote description for the peer connection
     return true;
 }
 
 bool VoiceServer::HandleIceCandidate(const std::string& channel_id, const std::string& user_id, const std::string& candidate) {
-    std::cout << "Handling ICE candidate for user " << user_id << " in channel " << channel_id << std::endl;
+    LOG_INFO << "Handling ICE candidate for user " << user_id << " in channel " << channel_id;
     
     // Implementation would add the ICE candidate to the peer connection
     return true;
@@ -207,40 +411,234 @@ bool VoiceServer::IsHealthy() const {
     return healthy;
 }
 
+std::string VoiceServer::RenderMetrics() const {
+    PrometheusWriter out;
+    auto counter = [&out](const char* name, const char* help, uint64_t value) {
+        out.Family(name, "counter", help);
+        out.Sample(name, value);
+    };
+    auto gauge = [&out](const char* name, const char* help, double value) {
+        out.Family(name, "gauge", help);
+        out.Sample(name, value);
+    };
+
+    std::vector<std::shared_ptr<VoiceChannel>> channels = channels_.Snapshot();
+    gauge("driftway_voice_up", "Whether the server is running and its backends are connected.",
+          IsHealthy() ? 1.0 : 0.0);
+    gauge("driftway_voice_channels", "Active voice channels.", static_cast<double>(channels.size()));
+    gauge("driftway_voice_users", "Distinct users in voice channels.", static_cast<double>(users_.size()));
+
+    // Media transport
+    if (webrtc_handler_) {
+        UdpMediaEngine::Stats media = webrtc_handler_->getMediaStats();
+        gauge("driftway_voice_media_workers", "Media threads sharing the RTC port.",
+              static_cast<double>(webrtc_handler_->workerCount()));
+        counter("driftway_voice_media_packets_received_total", "Datagrams received on the RTC port.",
+                media.packets_received);
+        counter("driftway_voice_media_bytes_received_total", "Bytes received on the RTC port.",
+                media.bytes_received);
+        counter("driftway_voice_media_packets_sent_total", "Datagrams sent from the RTC port.", media.packets_sent);
+        counter("driftway_voice_media_bytes_sent_total", "Bytes sent from the RTC port.", media.bytes_sent);
+        counter("driftway_voice_media_receive_batches_total", "recvmmsg() calls that returned datagrams.",
+                media.receive_batches);
+        counter("driftway_voice_media_send_batches_total", "sendmmsg() calls that sent datagrams.",
+                media.send_batches);
+        counter("driftway_voice_media_send_drops_total", "Outgoing datagrams dropped by the transport.",
+                media.send_drops);
+        counter("driftway_voice_media_handoffs_total", "Datagrams passed to the worker owning their channel.",
+                webrtc_handler_->getHandoffs());
+        counter("driftway_voice_media_handoff_drops_total", "Datagrams dropped because a worker inbox was full.",
+                webrtc_handler_->getHandoffDrops());
+    }
+
+    MediaMetrics& media = GetMediaMetrics();
+    counter("driftway_voice_packets_dropped_total", "Incoming datagrams dropped as malformed, unrouted or undeliverable.",
+            media.packets_dropped.Value());
+    counter("driftway_voice_packets_forwarded_total", "Incoming RTP packets fanned out to channel participants.",
+            media.packets_forwarded.Value());
+    counter("driftway_voice_forwarded_copies_total", "Datagrams queued by packet fan-out.",
+            media.copies_forwarded.Value());
+    counter("driftway_voice_forwarded_bytes_total", "Bytes queued by packet fan-out.", media.bytes_forwarded.Value());
+    counter("driftway_voice_packets_unselected_total", "Incoming RTP not forwarded because its sender was outside the last N.",
+            media.packets_unselected.Value());
+    counter("driftway_voice_packets_suppressed_total", "Incoming RTP not forwarded because its audio level was silent.",
+            media.packets_suppressed.Value());
+    counter("driftway_voice_stun_responses_total", "ICE connectivity checks answered with a binding success.",
+            media.stun_responses.Value());
+    counter("driftway_voice_stun_rejections_total", "ICE connectivity checks answered with an error.",
+            media.stun_rejections.Value());
+    counter("driftway_voice_unverified_sources_total",
+            "Plain RTP from an address that passed no ICE check of its sender, so not latched.",
+            media.unverified_sources.Value());
+    counter("driftway_voice_dtls_packets_total", "DTLS records received on the RTC port.", media.dtls_packets.Value());
+    counter("driftway_voice_rtcp_packets_total", "RTCP packets received from participants and consumed.",
+            media.rtcp_packets.Value());
+    counter("driftway_voice_srtp_auth_failures_total", "SRTP packets dropped because their tag did not verify.",
+            media.srtp_auth_failures.Value());
+    counter("driftway_voice_srtp_replays_total", "SRTP packets dropped as replays.", media.srtp_replays.Value());
+
+    static const std::vector<double> kLatencyBounds = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+                                                       0.01,   0.025,   0.05,   0.1,   0.25};
+    static const std::vector<double> kDepthBounds = {0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 64};
+
+    HdrHistogram::Snapshot forward_latency = media.forward_latency_us.GetSnapshot();
+    HdrHistogram::Snapshot queue_wait = media.queue_wait_us.GetSnapshot();
+    HdrHistogram::Snapshot depth = media.jitter_buffer_depth.GetSnapshot();
+    out.Histogram("driftway_voice_forward_latency_seconds",
+                  "Kernel receive to transmission of each forwarded datagram.", forward_latency, kLatencyBounds,
+                  1e-6);
+    out.Quantiles("driftway_voice_forward_latency_quantile_seconds",
+                  "Forwarding latency quantiles since start, at full histogram resolution.", forward_latency, 1e-6);
+    out.Histogram("driftway_voice_queue_wait_seconds",
+                  "Kernel receive to handling on the channel's media worker, including handoff.", queue_wait,
+                  kLatencyBounds, 1e-6);
+    out.Quantiles("driftway_voice_queue_wait_quantile_seconds",
+                  "Queue wait quantiles since start, at full histogram resolution.", queue_wait, 1e-6);
+    out.Histogram("driftway_voice_jitter_buffer_depth_packets",
+                  "Packets held by a playout jitter buffer, sampled on each insert.", depth, kDepthBounds, 1.0);
+
+    // Process-wide infrastructure
+    PacketPool::Stats pool = PacketPool::GetStats();
+    counter("driftway_voice_packet_pool_allocations_total", "Media buffers allocated from the heap.",
+            pool.buffers_allocated);
+    counter("driftway_voice_packet_pool_frees_total", "Media buffers returned to the heap.", pool.buffers_freed);
+    counter("driftway_voice_packet_pool_depot_exchanges_total", "Magazines moved through the shared depot.",
+            pool.depot_exchanges);
+    gauge("driftway_voice_packet_pool_depot_buffers", "Media buffers parked in the shared depot.",
+          static_cast<double>(pool.buffers_in_depot));
+    counter("driftway_voice_log_records_dropped_total", "Log records dropped because a thread's ring was full.",
+            log::DroppedRecords());
+
+    if (db_client_) {
+        DatabaseClient::Stats db = db_client_->getStats();
+        gauge("driftway_voice_db_queue_depth", "Participant and activity records waiting for a bulk write.",
+              static_cast<double>(db.queued));
+        gauge("driftway_voice_db_queue_depth_peak", "Highest database write queue depth since start.",
+              static_cast<double>(db.queued_peak));
+        counter("driftway_voice_db_records_accepted_total", "Participant and activity records queued for the database.",
+                db.accepted);
+        counter("driftway_voice_db_records_collapsed_total",
+                "Records that cancelled or replaced an unwritten change for the same participant.", db.collapsed);
+        counter("driftway_voice_db_records_written_total", "Records written by successful bulk writes.", db.written);
+        counter("driftway_voice_db_records_dropped_total", "Records refused or shed because the write queue was full.",
+                db.dropped);
+        counter("driftway_voice_db_bulk_writes_total", "Successful bulk writes.", db.batches);
+        counter("driftway_voice_db_bulk_write_failures_total", "Bulk writes that failed and were retried.",
+                db.failed_batches);
+    }
+
+    if (redis_client_) {
+        RedisClient::Stats redis = redis_client_->getStats();
+        gauge("driftway_voice_redis_connected", "Whether the Redis command connection is up.",
+              redis_client_->IsConnected() ? 1.0 : 0.0);
+        counter("driftway_voice_redis_commands_sent_total", "Commands pipelined to Redis.", redis.commands_sent);
+        counter("driftway_voice_redis_commands_failed_total", "Redis commands answered with an error or lost.",
+                redis.commands_failed);
+        counter("driftway_voice_redis_commands_dropped_total", "Redis commands dropped because the queue was full.",
+                redis.commands_dropped);
+        counter("driftway_voice_redis_events_total", "Presence and speaking changes queued for Redis.",
+                redis.events_queued);
+        counter("driftway_voice_redis_event_publishes_total", "PUBLISHes the queued changes were coalesced into.",
+                redis.events_published);
+        counter("driftway_voice_redis_writes_total", "Key writes queued for Redis.", redis.writes_queued);
+        counter("driftway_voice_redis_write_batches_total", "MULTI/EXEC blocks the key writes were coalesced into.",
+                redis.write_batches);
+        counter("driftway_voice_redis_reconnects_total", "Redis connections lost; each is retried with backoff.",
+                redis.reconnects);
+        gauge("driftway_voice_redis_queued", "Commands and key writes waiting to be sent to Redis.",
+              static_cast<double>(redis.queued));
+    }
+
+    // Per channel
+    std::vector<std::pair<std::string, VoiceChannel::ChannelStats>> channel_stats;
+    channel_stats.reserve(channels.size());
+    for (const auto& channel : channels) {
+        channel_stats.emplace_back(channel->GetChannelId(), channel->GetStats());
+    }
+
+    struct ChannelFamily {
+        const char* name;
+        const char* type;
+        const char* help;
+        double (*value)(const VoiceChannel::ChannelStats&);
+    };
+    static const ChannelFamily kChannelFamilies[] = {
+        {"driftway_voice_channel_participants", "gauge", "Participants in the channel.",
+         [](const VoiceChannel::ChannelStats& s) { return static_cast<double>(s.total_participants); }},
+        {"driftway_voice_channel_active_speakers", "gauge", "Participants currently speaking.",
+         [](const VoiceChannel::ChannelStats& s) { return static_cast<double>(s.active_speakers); }},
+        {"driftway_voice_channel_packets_received_total", "counter", "RTP packets received from participants.",
+         [](const VoiceChannel::ChannelStats& s) { return static_cast<double>(s.total_packets_received); }},
+        {"driftway_voice_channel_bytes_received_total", "counter", "RTP bytes received from participants.",
+         [](const VoiceChannel::ChannelStats& s) { return static_cast<double>(s.total_bytes_received); }},
+        {"driftway_voice_channel_packets_sent_total", "counter", "RTP packets forwarded to participants.",
+         [](const VoiceChannel::ChannelStats& s) { return static_cast<double>(s.total_packets_sent); }},
+        {"driftway_voice_channel_bytes_sent_total", "counter", "RTP bytes forwarded to participants.",
+         [](const VoiceChannel::ChannelStats& s) { return static_cast<double>(s.total_bytes_sent); }},
+        {"driftway_voice_channel_packets_suppressed_total", "counter", "Silent RTP packets not forwarded.",
+         [](const VoiceChannel::ChannelStats& s) { return static_cast<double>(s.total_packets_suppressed); }},
+        {"driftway_voice_channel_packet_loss_ratio", "gauge", "Mean loss fraction over incoming streams.",
+         [](const VoiceChannel::ChannelStats& s) { return s.average_packet_loss; }},
+        {"driftway_voice_channel_jitter_seconds", "gauge", "Mean RFC 3550 interarrival jitter of incoming streams.",
+         [](const VoiceChannel::ChannelStats& s) { return s.average_jitter / 1000.0; }},
+    };
+
+    for (const ChannelFamily& family : kChannelFamilies) {
+        out.Family(family.name, family.type, family.help);
+        for (const auto& entry : channel_stats) {
+            out.Sample(family.name, family.value(entry.second), {{"channel", entry.first}});
+        }
+    }
+
+    return out.str();
+}
+
 void VoiceServer::InitializeComponents() {
     // Initialize database client
-    std::cout << "Connecting to MongoDB..." << std::endl;
+    LOG_INFO << "Connecting to MongoDB...";
     db_client_ = std::make_unique<DatabaseClient>(config_.mongo_uri);
     
     // Initialize Redis client
-    std::cout << "Connecting to Redis..." << std::endl;
+    LOG_INFO << "Connecting to Redis...";
     redis_client_ = std::make_unique<RedisClient>(config_.redis_url);
     
     // Initialize HTTP server
-    std::cout << "Starting HTTP server..." << std::endl;
-    http_server_ = std::make_unique<HttpServer>(config_.http_port, this);
+    LOG_INFO << "Starting HTTP server...";
+    http_server_ = std::make_unique<HttpServer>(config_.http_port, this, config_.http_signaling);
     http_server_->start();
     
     // Initialize audio processor
-    std::cout << "Initializing audio processor..." << std::endl;
-    audio_processor_ = std::make_unique<AudioProcessor>();
+    LOG_INFO << "Initializing audio processor...";
+    OpusCodec::Config codec_config;
+    codec_config.complexity = config_.opus_complexity;
+    codec_config.bitrate = config_.opus_bitrate;
+    codec_config.fec = config_.opus_fec;
+    codec_config.dtx = config_.opus_dtx;
+    audio_processor_ = std::make_unique<AudioProcessor>(codec_config);
+    audio_processor_->setNoiseSuppression(config_.noise_suppression);
     
     // Initialize WebRTC handler
-    std::cout << "Initializing WebRTC handler..." << std::endl;
-    webrtc_handler_ = std::make_unique<WebRTCHandler>(config_.rtc_port, this);
+    LOG_INFO << "Initializing WebRTC handler...";
+    webrtc_handler_ = std::make_unique<WebRTCHandler>(config_.rtc_port, this,
+                                                      static_cast<size_t>(std::max(config_.media_workers, 0)),
+                                                      config_.ice_ufrag, config_.ice_password);
+    webrtc_handler_->initialize();
 }
 
 void VoiceServer::ShutdownComponents() {
-    std::cout << "Shutting down components..." << std::endl;
+    LOG_INFO << "Shutting down components...";
     
     // Clear all channels
-    {
-        std::lock_guard<std::mutex> lock(channels_mutex_);
-        channels_.clear();
-    }
+    channels_.Clear();
     
     // Shutdown components in reverse order
     webrtc_handler_.reset();
+
+    // With the media loop gone nothing reads routes: release the channels
+    // they kept alive while the audio processor their mixers use still exists
+    ssrc_router_.Clear();
+    epoch::Reclaim();
+
     audio_processor_.reset();
     if(http_server_) {
         http_server_->stop();
@@ -250,51 +648,28 @@ void VoiceServer::ShutdownComponents() {
     db_client_.reset();
 }
 
-void VoiceServer::ServerLoop() {
-    std::cout << "Voice server main loop started" << std::endl;
-    
-    while (running_.load()) {
-        try {
-            // Main server processing loop
-            // Handle any background tasks here
-            
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            
-        } catch (const std::exception& e) {
-            std::cerr << "Error in server loop: " << e.what() << std::endl;
-        }
-    }
-    
-    std::cout << "Voice server main loop stopped" << std::endl;
-}
-
 void VoiceServer::CleanupLoop() {
-    std::cout << "Voice server cleanup loop started" << std::endl;
+    LOG_INFO << "Voice server cleanup loop started";
     
     while (running_.load()) {
         try {
-            // Cleanup empty channels every 30 seconds
-            {
-                std::lock_guard<std::mutex> lock(channels_mutex_);
-                auto it = channels_.begin();
-                while (it != channels_.end()) {
-                    if (it->second->IsEmpty()) {
-                        std::cout << "Cleaning up empty channel: " << it->first << std::endl;
-                        it = channels_.erase(it);
-                    } else {
-                        ++it;
-                    }
+            // Cleanup empty channels every 30 seconds, one shard at a time
+            auto removed = channels_.Sweep([](const VoiceChannel& channel) { return channel.IsEmpty(); });
+            for (const auto& channel : removed) {
+                LOG_INFO << "Cleaning up empty channel: " << channel->GetChannelId();
+                if (db_client_) {
+                    db_client_->logActivity("channel_removed " + channel->GetChannelId());
                 }
             }
             
             std::this_thread::sleep_for(std::chrono::seconds(30));
             
         } catch (const std::exception& e) {
-            std::cerr << "Error in cleanup loop: " << e.what() << std::endl;
+            LOG_ERROR << "Error in cleanup loop: " << e.what();
         }
     }
     
-    std::cout << "Voice server cleanup loop stopped" << std::endl;
+    LOG_INFO << "Voice server cleanup loop stopped";
 }
 
 } // namespace driftway
\ No newline at end of file
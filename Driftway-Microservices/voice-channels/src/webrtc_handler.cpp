@@ -1,12 +1,60 @@
-#include <iostream>
 #include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <sched.h>
 #include "webrtc_handler.h"
+#include "voice_server.h"
+#include "voice_channel.h"
+#include "rtp_packet.h"
+#include "rtc_demux.h"
+#include "srtp_session.h"
+#include "stun_handler.h"
+#include "epoch.h"
+#include "packet_pool.h"
+#include "voice_activity.h"
+#include "logger.h"
+#include "metrics.h"
 
 namespace driftway {
 
-WebRTCHandler::WebRTCHandler(int rtc_port, VoiceServer* voice_server) 
-    : rtc_port_(rtc_port), voice_server_(voice_server), initialized_(false) {
-    std::cout << "WebRTCHandler created on port " << rtc_port << std::endl;
+namespace {
+
+// CPUs this process may run on, in ascending order
+std::vector<int> AllowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+} // namespace
+
+WebRTCHandler::WebRTCHandler(int rtc_port, VoiceServer* voice_server, size_t media_workers,
+                             const std::string& ice_ufrag, const std::string& ice_password)
+    : rtc_port_(rtc_port), voice_server_(voice_server), initialized_(false),
+      stun_handler_(ice_ufrag, ice_password) {
+    std::vector<int> cpus = AllowedCpus();
+    if (media_workers == 0) {
+        media_workers = std::max<size_t>(cpus.size(), 1);
+    }
+
+    // Worker i runs on the i-th allowed CPU; extra workers share CPUs, and
+    // an unknown mask leaves them unpinned
+    for (size_t i = 0; i < media_workers; ++i) {
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        workers_.push_back(std::make_unique<MediaWorker>(static_cast<uint32_t>(i), rtc_port, cpu));
+    }
+
+    LOG_INFO << "WebRTCHandler created on port " << rtc_port << " with " << workers_.size()
+              << " media worker(s)";
 }
 
 WebRTCHandler::~WebRTCHandler() {
@@ -14,45 +62,390 @@ WebRTCHandler::~WebRTCHandler() {
 }
 
 void WebRTCHandler::initialize() {
-    std::cout << "WebRTC Handler initialized" << std::endl;
+    if (initialized_) {
+        return;
+    }
+
+    // Warm the packet pool so the first seconds of media don't hit malloc
+    PacketPool::Reserve(workers_.size() * PacketPool::kMagazineSize);
+
+    // Sockets join the reuseport group in index order, which is the order
+    // the steering program's SSRC % N result refers to
+    for (auto& worker : workers_) {
+        if (!worker->open()) {
+            for (auto& opened : workers_) {
+                opened->close();
+            }
+            throw std::runtime_error("unable to bind RTC port " + std::to_string(rtc_port_));
+        }
+    }
+
+    // Without steering the kernel spreads peers by address hash, and the
+    // handoff below still delivers every packet to its channel's worker
+    if (workers_.size() > 1 && !workers_.front()->engine().attachSsrcSteering(workers_.size())) {
+        LOG_WARN << "SSRC steering unavailable; media will be handed off between workers";
+    }
+
+    for (auto& worker : workers_) {
+        worker->start([this](MediaWorker& owner, MediaDatagram* datagrams, size_t count, bool handed_off) {
+            handleIncomingMedia(owner, datagrams, count, handed_off);
+        });
+    }
+
+    LOG_INFO << "WebRTC Handler initialized";
     initialized_ = true;
 }
 
 void WebRTCHandler::shutdown() {
     if (initialized_) {
-        std::cout << "WebRTC Handler shutting down" << std::endl;
+        LOG_INFO << "WebRTC Handler shutting down";
+        for (auto& worker : workers_) {
+            worker->stop();
+        }
+        for (auto& worker : workers_) {
+            worker->close();
+        }
         initialized_ = false;
     }
 }
 
 std::string WebRTCHandler::createOffer() {
-    std::cout << "Creating WebRTC offer" << std::endl;
+    LOG_INFO << "Creating WebRTC offer";
     return R"({"type":"offer","sdp":"v=0\r\no=- 0 0 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"})";
 }
 
 std::string WebRTCHandler::createAnswer(const std::string& offer) {
-    std::cout << "Creating WebRTC answer for offer" << std::endl;
-    return R"({"type":"answer","sdp":"v=0\r\no=- 0 0 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"})";
+    LOG_INFO << "Creating WebRTC answer for offer";
+    // The RTC port is ICE-lite: it answers the client's checks with these credentials
+    return R"({"type":"answer","sdp":"v=0\r\no=- 0 0 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\na=ice-lite\r\na=ice-ufrag:)" +
+           iceUfrag() + R"(\r\na=ice-pwd:)" + icePassword() + R"(\r\n"})";
 }
 
 void WebRTCHandler::setLocalDescription(const std::string& sdp) {
-    std::cout << "Setting local description: " << sdp.substr(0, 50) << "..." << std::endl;
+    LOG_INFO << "Setting local description: " << sdp.substr(0, 50) << "...";
 }
 
 void WebRTCHandler::setRemoteDescription(const std::string& sdp) {
-    std::cout << "Setting remote description: " << sdp.substr(0, 50) << "..." << std::endl;
+    LOG_INFO << "Setting remote description: " << sdp.substr(0, 50) << "...";
 }
 
 void WebRTCHandler::addIceCandidate(const std::string& candidate) {
-    std::cout << "Adding ICE candidate: " << candidate << std::endl;
+    LOG_INFO << "Adding ICE candidate: " << candidate;
 }
 
-void WebRTCHandler::handleIncomingMedia(const std::vector<uint8_t>& data) {
-    std::cout << "Handling incoming media data of size: " << data.size() << std::endl;
+void WebRTCHandler::handleIncomingMedia(MediaWorker& worker, MediaDatagram* datagrams, size_t count,
+                                        bool handed_off) {
+    MediaMetrics& metrics = GetMediaMetrics();
+    uint64_t now_us = MediaClockMicros();
+
+    // SRTP datagrams are collected and unprotected a chunk at a time, then
+    // delivered in arrival order
+    SrtpBatchItem srtp_items[kSrtpChunkSize];
+    const SsrcRoute* srtp_routes[kSrtpChunkSize];
+    const MediaDatagram* srtp_datagrams[kSrtpChunkSize];
+    size_t srtp_count = 0;
+
+    // Routes looked up below stay valid until the batch is done
+    epoch::ReadGuard guard;
+
+    for (size_t i = 0; i < count; ++i) {
+        const MediaDatagram& datagram = datagrams[i];
+
+        // Only RTP and RTCP are handed off, so STUN and DTLS are never seen
+        // twice; the two are told apart again on the owning worker
+        switch (ClassifyRtcPacket(datagram.data, datagram.size)) {
+        case RtcPacketType::kRtp:
+            break;
+        case RtcPacketType::kRtcp:
+            HandleRtcp(worker, datagram, handed_off);
+            continue;
+        case RtcPacketType::kStun:
+            HandleStun(worker, datagram);
+            continue;
+        case RtcPacketType::kDtls:
+            // No DTLS endpoint yet: counted so handshakes are visible
+            metrics.dtls_packets.Add();
+            continue;
+        default:
+            metrics.packets_dropped.Add();
+            continue;
+        }
+
+        // Only RTP version 2 is accepted on the media path; the SSRC is
+        // in the clear even under SRTP
+        if (datagram.size < rtp::kFixedHeaderSize || (datagram.data[0] >> 6) != 2) {
+            metrics.packets_dropped.Add();
+            continue;
+        }
+
+        const SsrcRoute* route = voice_server_->FindRoute(rtp::ReadU32(datagram.data + 8));
+        if (!route) {
+            metrics.packets_dropped.Add();
+            continue;
+        }
+
+        // A channel's state is only touched on its own worker
+        uint32_t owner = route->channel->GetMediaWorker();
+        if (owner != worker.index()) {
+            if (handed_off || owner >= workers_.size() || !workers_[owner]->handOff(datagram)) {
+                metrics.packets_dropped.Add();
+            }
+            continue;
+        }
+
+        SrtpSession* inbound = route->participant->srtp->inbound();
+        if (!inbound) {
+            DeliverRtp(*route, datagram, datagram.size, now_us, false);
+            continue;
+        }
+
+        SrtpBatchItem& item = srtp_items[srtp_count];
+        item.session = inbound;
+        item.data = datagram.data;
+        item.size = datagram.size;
+        srtp_routes[srtp_count] = route;
+        srtp_datagrams[srtp_count] = &datagram;
+        if (++srtp_count == kSrtpChunkSize) {
+            UnprotectAndDeliver(srtp_items, srtp_routes, srtp_datagrams, srtp_count, now_us);
+            srtp_count = 0;
+        }
+    }
+
+    if (srtp_count > 0) {
+        UnprotectAndDeliver(srtp_items, srtp_routes, srtp_datagrams, srtp_count, now_us);
+    }
 }
 
-void WebRTCHandler::sendMedia(const std::vector<uint8_t>& data, const std::string& destination) {
-    std::cout << "Sending media data of size " << data.size() << " to " << destination << std::endl;
+void WebRTCHandler::UnprotectAndDeliver(SrtpBatchItem* items, const SsrcRoute* const* routes,
+                                        const MediaDatagram* const* datagrams, size_t count, uint64_t now_us) {
+    MediaMetrics& metrics = GetMediaMetrics();
+    SrtpSession::UnprotectRtp(items, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        switch (items[i].status) {
+        case SrtpStatus::kOk:
+            DeliverRtp(*routes[i], *datagrams[i], items[i].size, now_us, true);
+            break;
+        case SrtpStatus::kAuthFailed:
+            metrics.srtp_auth_failures.Add();
+            break;
+        case SrtpStatus::kReplayed:
+            metrics.srtp_replays.Add();
+            break;
+        default:
+            metrics.packets_dropped.Add();
+            break;
+        }
+    }
+}
+
+void WebRTCHandler::DeliverRtp(const SsrcRoute& route, const MediaDatagram& datagram, size_t size,
+                               uint64_t now_us, bool authenticated) {
+    MediaMetrics& metrics = GetMediaMetrics();
+    RtpPacketView rtp;
+    if (!rtp.Parse(datagram.data, size)) {
+        metrics.packets_dropped.Add();
+        return;
+    }
+    datagram.buffer->setSize(size);
+
+    // Symmetric RTP: the address a participant sends from is where it
+    // receives. SSRCs are easy to guess, so only a source the participant
+    // proved is latched: SRTP that passed its auth tag, or for plain RTP an
+    // address its own ICE checks came from. Anything else cannot redirect
+    // the participant's media.
+    if (route.participant->endpoint != *datagram.source) {
+        if (authenticated || route.participant->ice->IsVerified(*datagram.source)) {
+            route.channel->SetParticipantEndpoint(*route.participant, *datagram.source);
+        } else {
+            metrics.unverified_sources.Add();
+        }
+    }
+
+    // Socket queue plus, for handed-off datagrams, the owner's inbox
+    if (now_us >= datagram.arrival_us) {
+        metrics.queue_wait_us.Record(now_us - datagram.arrival_us);
+    }
+
+    AudioPacket packet;
+    packet.buffer = MediaBufferRef(datagram.buffer);
+    packet.source = route.participant->handle;
+    packet.header_size = static_cast<uint16_t>(rtp.headerSize());
+    packet.payload_size = static_cast<uint16_t>(rtp.payloadSize());
+    packet.sequence_number = rtp.sequenceNumber();
+    packet.timestamp = rtp.timestamp();
+    packet.ssrc = rtp.ssrc();
+    packet.arrival_us = datagram.arrival_us;
+
+    if (route.voice_activity && rtp.hasExtension()) {
+        uint8_t extension_id = route.voice_activity->extensionId();
+        RtpHeaderExtension level;
+        if (extension_id != 0 && rtp.FindExtension(extension_id, &level)) {
+            ParseAudioLevel(level, &packet.audio_level, &packet.voice);
+        }
+    }
+
+    route.channel->ReceiveAudio(packet, route.jitter_buffer, route.voice_activity);
+}
+
+void WebRTCHandler::HandleRtcp(MediaWorker& worker, const MediaDatagram& datagram, bool handed_off) {
+    MediaMetrics& metrics = GetMediaMetrics();
+
+    // Routed by the reporter's SSRC, in the header of the first packet of
+    // the compound; the SSRC at offset 8 is someone else's
+    if (datagram.size < kRtcpHeaderSize) {
+        metrics.packets_dropped.Add();
+        return;
+    }
+    const SsrcRoute* route = voice_server_->FindRoute(rtp::ReadU32(datagram.data + 4));
+    if (!route) {
+        metrics.packets_dropped.Add();
+        return;
+    }
+
+    // The participant's SRTCP replay state lives on the channel's worker
+    uint32_t owner = route->channel->GetMediaWorker();
+    if (owner != worker.index()) {
+        if (handed_off || owner >= workers_.size() || !workers_[owner]->handOff(datagram)) {
+            metrics.packets_dropped.Add();
+        }
+        return;
+    }
+
+    SrtpSession* inbound = route->participant->srtp->inbound();
+    if (inbound) {
+        size_t size = datagram.size;
+        switch (inbound->UnprotectRtcp(datagram.data, &size)) {
+        case SrtpStatus::kOk:
+            break;
+        case SrtpStatus::kAuthFailed:
+            metrics.srtp_auth_failures.Add();
+            return;
+        case SrtpStatus::kReplayed:
+            metrics.srtp_replays.Add();
+            return;
+        default:
+            metrics.packets_dropped.Add();
+            return;
+        }
+    }
+
+    // Reports are terminated here: they describe what the sender received
+    // from us, so they never reach a channel as media or endpoint updates
+    metrics.rtcp_packets.Add();
+}
+
+void WebRTCHandler::HandleStun(MediaWorker& worker, const MediaDatagram& datagram) {
+    MediaMetrics& metrics = GetMediaMetrics();
+    uint8_t response[stun::kMaxMessageSize];
+    size_t response_size = 0;
+
+    // Checks need no channel state, so whichever worker received one
+    // answers it from the same port
+    std::string_view remote_ufrag;
+    switch (stun_handler_.HandleMessage(datagram.data, datagram.size, *datagram.source, response,
+                                        sizeof(response), &response_size, &remote_ufrag)) {
+    case StunHandler::Result::kResponded:
+        metrics.stun_responses.Add();
+        RecordIceCheck(remote_ufrag, *datagram.source);
+        break;
+    case StunHandler::Result::kRejected:
+        metrics.stun_rejections.Add();
+        break;
+    case StunHandler::Result::kIgnored:
+        metrics.packets_dropped.Add();
+        return;
+    }
+    worker.engine().queueSend(response, response_size, *datagram.source);
+}
+
+void WebRTCHandler::RecordIceCheck(std::string_view remote_ufrag, const MediaEndpoint& source) {
+    std::shared_ptr<IcePeer> peer;
+    {
+        std::lock_guard<std::mutex> lock(ice_mutex_);
+        auto it = ice_peers_.find(std::string(remote_ufrag));
+        if (it == ice_peers_.end()) {
+            return;
+        }
+        peer = it->second.lock();
+        if (!peer) {
+            ice_peers_.erase(it);
+            return;
+        }
+    }
+    peer->RecordCheck(source);
+}
+
+bool WebRTCHandler::addIcePeer(const std::string& remote_ufrag, const std::shared_ptr<IcePeer>& peer) {
+    if (remote_ufrag.empty() || !peer) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(ice_mutex_);
+    if (ice_peers_.size() >= ice_prune_at_) {
+        for (auto it = ice_peers_.begin(); it != ice_peers_.end();) {
+            it = it->second.expired() ? ice_peers_.erase(it) : std::next(it);
+        }
+        ice_prune_at_ = std::max<size_t>(64, ice_peers_.size() * 2);
+    }
+
+    auto& entry = ice_peers_[remote_ufrag];
+    auto current = entry.lock();
+    if (current && current != peer) {
+        return false;
+    }
+    entry = peer;
+    return true;
+}
+
+void WebRTCHandler::assignWorker(VoiceChannel& channel) {
+    uint32_t index = next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    channel.SetMediaWorker(index, static_cast<uint32_t>(workers_.size()));
+    channel.SetTransport(&workers_[index]->engine());
+}
+
+void WebRTCHandler::addMixingChannel(const std::shared_ptr<VoiceChannel>& channel) {
+    workers_[channel->GetMediaWorker() % workers_.size()]->addMixingChannel(channel);
+}
+
+bool WebRTCHandler::sendMedia(const VoiceChannel& channel, const uint8_t* data, size_t size,
+                              const MediaEndpoint& destination) {
+    return workers_[channel.GetMediaWorker() % workers_.size()]->engine().queueSend(data, size, destination);
+}
+
+UdpMediaEngine::Stats WebRTCHandler::getMediaStats() const {
+    UdpMediaEngine::Stats total;
+    for (const auto& worker : workers_) {
+        UdpMediaEngine::Stats stats = worker->engine().getStats();
+        total.packets_received += stats.packets_received;
+        total.bytes_received += stats.bytes_received;
+        total.packets_sent += stats.packets_sent;
+        total.bytes_sent += stats.bytes_sent;
+        total.receive_batches += stats.receive_batches;
+        total.send_batches += stats.send_batches;
+        total.send_drops += stats.send_drops;
+    }
+    return total;
+}
+
+uint64_t WebRTCHandler::getDroppedPackets() const {
+    return GetMediaMetrics().packets_dropped.Value();
+}
+
+uint64_t WebRTCHandler::getHandoffs() const {
+    uint64_t total = 0;
+    for (const auto& worker : workers_) {
+        total += worker->getHandoffs();
+    }
+    return total;
+}
+
+uint64_t WebRTCHandler::getHandoffDrops() const {
+    uint64_t total = 0;
+    for (const auto& worker : workers_) {
+        total += worker->getHandoffDrops();
+    }
+    return total;
 }
 
-} // namespace driftway
\ No newline at end of file
+} // namespace driftway
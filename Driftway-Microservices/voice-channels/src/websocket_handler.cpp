@@ -1,30 +1,30 @@
-#include <iostream>
 #include <string>
 #include <vector>
+#include "logger.h"
 
 class WebSocketHandler {
 public:
     static void initialize() {
-        std::cout << "WebSocket Handler initialized" << std::endl;
+        LOG_INFO << "WebSocket Handler initialized";
     }
     
     static void handleConnection(int client_id) {
-        std::cout << "WebSocket connection established for client " << client_id << std::endl;
+        LOG_INFO << "WebSocket connection established for client " << client_id;
     }
     
     static void handleMessage(int client_id, const std::string& message) {
-        std::cout << "WebSocket message from client " << client_id << ": " << message << std::endl;
+        LOG_INFO << "WebSocket message from client " << client_id << ": " << message;
     }
     
     static void broadcastToChannel(int channel_id, const std::string& message) {
-        std::cout << "Broadcasting to channel " << channel_id << ": " << message << std::endl;
+        LOG_INFO << "Broadcasting to channel " << channel_id << ": " << message;
     }
     
     static void handleDisconnection(int client_id) {
-        std::cout << "WebSocket disconnection for client " << client_id << std::endl;
+        LOG_INFO << "WebSocket disconnection for client " << client_id;
     }
     
     static void cleanup() {
-        std::cout << "WebSocket Handler cleanup" << std::endl;
+        LOG_INFO << "WebSocket Handler cleanup";
     }
 };
\ No newline at end of file
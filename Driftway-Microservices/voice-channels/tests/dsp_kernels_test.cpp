@@ -0,0 +1,366 @@
+// Checks every instruction-set variant of the DSP kernels this CPU can run
+// against the scalar reference.
+//
+//   dsp_kernels_test [--seed=N]
+//
+// Each kernel gets seeded random input at every length up to a few vector
+// widths and at frame-sized odd lengths, so every tail path runs, from
+// both aligned and misaligned pointers. Outputs are compared over guard
+// elements on either side too, which catches stray writes past the tail.
+// Element-wise results must agree to within a few ulps; reductions, whose
+// summation order differs between instruction sets, to within the error
+// bound of a float sum of that length. Exits non-zero on any mismatch.
+
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace driftway;
+
+namespace {
+
+constexpr size_t kGuard = 16;               // Elements either side of every buffer
+constexpr float kElementTolerance = 4e-7f;  // Relative, about 4 ulps
+constexpr float kEpsilon = std::numeric_limits<float>::epsilon();
+constexpr int kMaxReported = 20;
+
+// Every length up to a few AVX-512 widths, then odd frame-ish sizes
+std::vector<size_t> TestLengths() {
+    std::vector<size_t> lengths;
+    for (size_t n = 0; n <= 70; ++n) {
+        lengths.push_back(n);
+    }
+    for (size_t n : {127, 129, 255, 257, 479, 481, 959, 961, 1023}) {
+        lengths.push_back(n);
+    }
+    return lengths;
+}
+
+// A buffer with kGuard elements before and after the count in use, plus
+// one so the data can start misaligned
+template <typename T>
+struct Buffer {
+    std::vector<T> storage;
+    size_t offset;
+
+    Buffer(size_t count, size_t misalign) : storage(count + 2 * kGuard + 1), offset(kGuard + misalign) {}
+    T* data() { return storage.data() + offset; }
+    const T* data() const { return storage.data() + offset; }
+};
+
+class Checker {
+public:
+    Checker(const dsp::Kernels& reference, const dsp::Kernels& candidate, uint32_t seed)
+        : ref_(reference), isa_(candidate), rng_(seed) {}
+
+    int failures() const { return failures_; }
+
+    void Run() {
+        for (size_t count : TestLengths()) {
+            for (size_t misalign = 0; misalign < 2; ++misalign) {
+                count_ = count;
+                misalign_ = misalign;
+                CheckAccumulateS16();
+                CheckMixMinusS16();
+                CheckS16ToF32();
+                CheckF32ToS16();
+                CheckGainRampF32();
+                CheckMixF32();
+                CheckClipF32();
+                CheckPeakF32();
+                CheckSumSquaresF32();
+                CheckDotF32();
+                CheckFftButterflyF32();
+                CheckComplexMulF32();
+            }
+        }
+    }
+
+private:
+    const dsp::Kernels& ref_;
+    const dsp::Kernels& isa_;
+    std::mt19937 rng_;
+    size_t count_ = 0;
+    size_t misalign_ = 0;
+    int failures_ = 0;
+
+    template <typename T>
+    Buffer<T> NewBuffer(size_t count) const {
+        return Buffer<T>(count, misalign_);
+    }
+
+    void FillS16(std::vector<int16_t>* values) {
+        std::uniform_int_distribution<int> sample(-32768, 32767);
+        for (int16_t& value : *values) {
+            value = static_cast<int16_t>(sample(rng_));
+        }
+    }
+
+    void FillS32(std::vector<int32_t>* values, int32_t limit) {
+        std::uniform_int_distribution<int32_t> sample(-limit, limit);
+        for (int32_t& value : *values) {
+            value = sample(rng_);
+        }
+    }
+
+    // Audio slightly past full scale, so conversions saturate now and then
+    void FillF32(std::vector<float>* values, float limit = 1.25f) {
+        std::uniform_real_distribution<float> sample(-limit, limit);
+        for (float& value : *values) {
+            value = sample(rng_);
+        }
+    }
+
+    void Fail(const char* kernel, size_t index, double expected, double actual) {
+        if (failures_++ < kMaxReported) {
+            std::printf("  FAIL %s/%s count=%zu misalign=%zu index=%zu: expected %.9g, got %.9g\n", isa_.name,
+                        kernel, count_, misalign_, index, expected, actual);
+        }
+    }
+
+    template <typename T>
+    void ExpectEqual(const char* kernel, const Buffer<T>& expected, const Buffer<T>& actual) {
+        for (size_t i = 0; i < expected.storage.size(); ++i) {
+            if (std::memcmp(&expected.storage[i], &actual.storage[i], sizeof(T)) != 0) {
+                Fail(kernel, i, static_cast<double>(expected.storage[i]), static_cast<double>(actual.storage[i]));
+                return;
+            }
+        }
+    }
+
+    void ExpectClose(const char* kernel, const Buffer<float>& expected, const Buffer<float>& actual) {
+        for (size_t i = 0; i < expected.storage.size(); ++i) {
+            float e = expected.storage[i];
+            float a = actual.storage[i];
+            if (!(std::fabs(e - a) <= kElementTolerance * std::max(1.0f, std::fabs(e)))) {
+                Fail(kernel, i, e, a);
+                return;
+            }
+        }
+    }
+
+    // Reordering a sum of n terms moves it by at most about n * eps times
+    // the sum of the terms' magnitudes
+    void ExpectSum(const char* kernel, float expected, float actual, float magnitude) {
+        float bound = 2.0f * static_cast<float>(count_ + 1) * kEpsilon * magnitude + 1e-30f;
+        if (!(std::fabs(expected - actual) <= bound)) {
+            Fail(kernel, 0, expected, actual);
+        }
+    }
+
+    void CheckAccumulateS16() {
+        auto in = NewBuffer<int16_t>(count_);
+        auto expected = NewBuffer<int32_t>(count_);
+        FillS16(&in.storage);
+        FillS32(&expected.storage, 1 << 24);
+        auto actual = expected;
+        ref_.accumulate_s16(expected.data(), in.data(), count_);
+        isa_.accumulate_s16(actual.data(), in.data(), count_);
+        ExpectEqual("accumulate_s16", expected, actual);
+    }
+
+    void CheckMixMinusS16() {
+        auto acc = NewBuffer<int32_t>(count_);
+        auto self = NewBuffer<int16_t>(count_);
+        auto expected = NewBuffer<int16_t>(count_);
+        FillS32(&acc.storage, 100000); // Past int16 either way, to saturate
+        FillS16(&self.storage);
+        FillS16(&expected.storage);
+        auto actual = expected;
+        ref_.mix_minus_s16(expected.data(), acc.data(), self.data(), count_);
+        isa_.mix_minus_s16(actual.data(), acc.data(), self.data(), count_);
+        ExpectEqual("mix_minus_s16", expected, actual);
+
+        // Full mix, without a self signal to take out
+        ref_.mix_minus_s16(expected.data(), acc.data(), nullptr, count_);
+        isa_.mix_minus_s16(actual.data(), acc.data(), nullptr, count_);
+        ExpectEqual("mix_minus_s16(null)", expected, actual);
+    }
+
+    void CheckS16ToF32() {
+        auto in = NewBuffer<int16_t>(count_);
+        auto expected = NewBuffer<float>(count_);
+        FillS16(&in.storage);
+        FillF32(&expected.storage);
+        auto actual = expected;
+        ref_.s16_to_f32(expected.data(), in.data(), count_);
+        isa_.s16_to_f32(actual.data(), in.data(), count_);
+        ExpectEqual("s16_to_f32", expected, actual);
+    }
+
+    void CheckF32ToS16() {
+        auto in = NewBuffer<float>(count_);
+        auto expected = NewBuffer<int16_t>(count_);
+        FillF32(&in.storage);
+        // Every fourth sample exactly halfway between two outputs, where
+        // round-half-to-even is decided
+        std::uniform_int_distribution<int> step(-32768, 32767);
+        for (size_t i = 0; i < in.storage.size(); i += 4) {
+            in.storage[i] = (static_cast<float>(step(rng_)) + 0.5f) / 32768.0f;
+        }
+        FillS16(&expected.storage);
+        auto actual = expected;
+        ref_.f32_to_s16(expected.data(), in.data(), count_);
+        isa_.f32_to_s16(actual.data(), in.data(), count_);
+        ExpectEqual("f32_to_s16", expected, actual);
+    }
+
+    void CheckGainRampF32() {
+        auto expected = NewBuffer<float>(count_);
+        FillF32(&expected.storage);
+        auto actual = expected;
+        float step = count_ > 0 ? -0.75f / static_cast<float>(count_) : 0.0f;
+        ref_.gain_ramp_f32(expected.data(), count_, 1.0f, step);
+        isa_.gain_ramp_f32(actual.data(), count_, 1.0f, step);
+        ExpectClose("gain_ramp_f32", expected, actual);
+
+        ref_.gain_ramp_f32(expected.data(), count_, 0.5f, 0.0f);
+        isa_.gain_ramp_f32(actual.data(), count_, 0.5f, 0.0f);
+        ExpectClose("gain_ramp_f32(constant)", expected, actual);
+    }
+
+    void CheckMixF32() {
+        auto in = NewBuffer<float>(count_);
+        auto expected = NewBuffer<float>(count_);
+        FillF32(&in.storage);
+        FillF32(&expected.storage);
+        auto actual = expected;
+        ref_.mix_f32(expected.data(), in.data(), count_, 0.7f);
+        isa_.mix_f32(actual.data(), in.data(), count_, 0.7f);
+        ExpectClose("mix_f32", expected, actual);
+    }
+
+    void CheckClipF32() {
+        auto expected = NewBuffer<float>(count_);
+        FillF32(&expected.storage, 2.0f);
+        auto actual = expected;
+        ref_.clip_f32(expected.data(), count_, 1.0f);
+        isa_.clip_f32(actual.data(), count_, 1.0f);
+        ExpectEqual("clip_f32", expected, actual);
+    }
+
+    void CheckPeakF32() {
+        auto in = NewBuffer<float>(count_);
+        FillF32(&in.storage);
+        // The loudest sample anywhere, tail included
+        if (count_ > 0) {
+            in.data()[rng_() % count_] = -1.5f;
+        }
+        float expected = ref_.peak_f32(in.data(), count_);
+        float actual = isa_.peak_f32(in.data(), count_);
+        if (expected != actual) {
+            Fail("peak_f32", 0, expected, actual);
+        }
+    }
+
+    void CheckSumSquaresF32() {
+        auto in = NewBuffer<float>(count_);
+        FillF32(&in.storage);
+        float magnitude = 0.0f;
+        for (size_t i = 0; i < count_; ++i) {
+            magnitude += in.data()[i] * in.data()[i];
+        }
+        ExpectSum("sum_squares_f32", ref_.sum_squares_f32(in.data(), count_),
+                  isa_.sum_squares_f32(in.data(), count_), magnitude);
+    }
+
+    void CheckDotF32() {
+        auto a = NewBuffer<float>(count_);
+        auto b = NewBuffer<float>(count_);
+        FillF32(&a.storage);
+        FillF32(&b.storage);
+        float magnitude = 0.0f;
+        for (size_t i = 0; i < count_; ++i) {
+            magnitude += std::fabs(a.data()[i] * b.data()[i]);
+        }
+        ExpectSum("dot_f32", ref_.dot_f32(a.data(), b.data(), count_), isa_.dot_f32(a.data(), b.data(), count_),
+                  magnitude);
+    }
+
+    void CheckFftButterflyF32() {
+        // Strides as a radix-2 pass uses them (the half length), and wider
+        for (size_t extra : {0, 3}) {
+            size_t x_stride = count_ + extra;
+            size_t y_stride = count_ + (extra ? 5 : 0);
+            auto x_re = NewBuffer<float>(count_ + x_stride);
+            auto x_im = NewBuffer<float>(count_ + x_stride);
+            auto expected_re = NewBuffer<float>(count_ + y_stride);
+            auto expected_im = NewBuffer<float>(count_ + y_stride);
+            FillF32(&x_re.storage);
+            FillF32(&x_im.storage);
+            FillF32(&expected_re.storage);
+            FillF32(&expected_im.storage);
+            auto actual_re = expected_re;
+            auto actual_im = expected_im;
+
+            std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+            float theta = angle(rng_);
+            float w_re = std::cos(theta);
+            float w_im = -std::sin(theta);
+
+            ref_.fft_butterfly_f32(expected_re.data(), expected_im.data(), x_re.data(), x_im.data(), count_,
+                                   x_stride, y_stride, w_re, w_im);
+            isa_.fft_butterfly_f32(actual_re.data(), actual_im.data(), x_re.data(), x_im.data(), count_, x_stride,
+                                   y_stride, w_re, w_im);
+            ExpectClose("fft_butterfly_f32(re)", expected_re, actual_re);
+            ExpectClose("fft_butterfly_f32(im)", expected_im, actual_im);
+        }
+    }
+
+    void CheckComplexMulF32() {
+        auto w_re = NewBuffer<float>(count_);
+        auto w_im = NewBuffer<float>(count_);
+        auto expected_re = NewBuffer<float>(count_);
+        auto expected_im = NewBuffer<float>(count_);
+        FillF32(&w_re.storage);
+        FillF32(&w_im.storage);
+        FillF32(&expected_re.storage);
+        FillF32(&expected_im.storage);
+        auto actual_re = expected_re;
+        auto actual_im = expected_im;
+        ref_.complex_mul_f32(expected_re.data(), expected_im.data(), w_re.data(), w_im.data(), count_);
+        isa_.complex_mul_f32(actual_re.data(), actual_im.data(), w_re.data(), w_im.data(), count_);
+        ExpectClose("complex_mul_f32(re)", expected_re, actual_re);
+        ExpectClose("complex_mul_f32(im)", expected_im, actual_im);
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--seed=") == 0) {
+            seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: %s [--seed=N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const dsp::Kernels* reference = dsp::ForIsa(dsp::Isa::kScalar);
+    int failures = 0;
+    for (dsp::Isa isa : {dsp::Isa::kSse42, dsp::Isa::kAvx2, dsp::Isa::kAvx512}) {
+        const dsp::Kernels* kernels = dsp::ForIsa(isa);
+        if (!kernels) {
+            std::printf("skip: isa %d not supported by this CPU\n", static_cast<int>(isa));
+            continue;
+        }
+        Checker checker(*reference, *kernels, seed);
+        checker.Run();
+        std::printf("%s: %s\n", kernels->name, checker.failures() == 0 ? "ok" : "FAILED");
+        failures += checker.failures();
+    }
+    std::printf("active: %s\n", dsp::Active().name);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// Checks what NoiseSuppressor does to noise, to speech, and to timing.
+//
+//   noise_suppressor_test [--seed=N]
+//
+// At 48 kHz, with a speech-like signal (harmonic syllables with gaps) and
+// stationary white noise:
+//   - clean speech after silence comes out unchanged, exactly kLatency
+//     samples late
+//   - background noise alone is attenuated once its floor is learned
+//   - speech in that noise keeps its level and shape
+//   - random-sized Process calls and the int16 path give the same samples
+//     as one float call
+// Exits non-zero on any failure.
+
+#include "dsp_kernels.h"
+#include "noise_suppressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace driftway;
+
+namespace {
+
+constexpr int kRate = 48000;
+constexpr size_t kFrame = 960;                 // 20 ms, as the mixer calls it
+constexpr double kNoiseRms = 0.003;            // -50 dBFS
+constexpr double kTransparencyLimit = 1e-3;    // Clean speech error relative to its RMS, -60 dB
+constexpr double kMinNoiseReductionDb = 12.0;  // The gain floor is -20 dB
+constexpr double kMaxSpeechGainDb = 1.0;       // Level change of speech in noise, either way
+constexpr double kSpeechErrorLimit = 0.05;     // Speech-in-noise error relative to the speech, -26 dB
+
+int g_failures = 0;
+
+void Fail(const char* test, const std::string& what) {
+    if (g_failures++ < 20) {
+        std::printf("FAIL: %s: %s\n", test, what.c_str());
+    }
+}
+
+// Voiced syllables: a 150 Hz harmonic series with a 4 Hz envelope, 400 ms
+// on and 300 ms off
+std::vector<float> Speech(size_t count, size_t start) {
+    std::vector<float> speech(count, 0.0f);
+    size_t on = kRate * 4 / 10;
+    size_t period = kRate * 7 / 10;
+    for (size_t n = start; n < count; ++n) {
+        size_t position = (n - start) % period;
+        if (position >= on) {
+            continue;
+        }
+        double t = static_cast<double>(n) / kRate;
+        double envelope = std::sin(M_PI * static_cast<double>(position) / static_cast<double>(on));
+        double sum = 0.0;
+        for (int harmonic = 1; harmonic <= 12; ++harmonic) {
+            sum += std::sin(2.0 * M_PI * 150.0 * harmonic * t + harmonic) / harmonic;
+        }
+        speech[n] = static_cast<float>(0.08 * envelope * sum);
+    }
+    return speech;
+}
+
+std::vector<float> Noise(size_t count, std::mt19937& rng) {
+    std::normal_distribution<float> normal(0.0f, static_cast<float>(kNoiseRms));
+    std::vector<float> noise(count);
+    for (float& sample : noise) {
+        sample = normal(rng);
+    }
+    return noise;
+}
+
+std::vector<float> Suppress(std::vector<float> signal) {
+    NoiseSuppressor suppressor;
+    for (size_t offset = 0; offset < signal.size(); offset += kFrame) {
+        suppressor.Process(signal.data() + offset, std::min(kFrame, signal.size() - offset));
+    }
+    return signal;
+}
+
+double Rms(const std::vector<float>& signal, size_t begin, size_t end) {
+    double sum = 0.0;
+    for (size_t n = begin; n < end; ++n) {
+        sum += static_cast<double>(signal[n]) * signal[n];
+    }
+    return std::sqrt(sum / static_cast<double>(end - begin));
+}
+
+// Speech with nothing behind it must pass untouched, kLatency samples late
+void CheckTransparency() {
+    size_t count = 2 * kRate;
+    std::vector<float> speech = Speech(count, kRate / 4);  // After the warm-up blocks
+    std::vector<float> out = Suppress(speech);
+
+    double error = 0.0;
+    for (size_t n = 0; n + NoiseSuppressor::kLatency < count; ++n) {
+        double diff = out[n + NoiseSuppressor::kLatency] - speech[n];
+        error += diff * diff;
+    }
+    double relative = std::sqrt(error / static_cast<double>(count - NoiseSuppressor::kLatency)) /
+                      Rms(speech, 0, count);
+    if (relative > kTransparencyLimit) {
+        Fail("transparency", "clean speech changed by " + std::to_string(20.0 * std::log10(relative)) + " dB");
+    }
+}
+
+// Noise alone is brought down once the suppressor has learned it, and
+// speech arriving in it keeps its level
+void CheckNoise(std::mt19937& rng) {
+    size_t speech_start = 2 * kRate;
+    size_t count = 6 * kRate;
+    std::vector<float> speech = Speech(count, speech_start);
+    std::vector<float> noise = Noise(count, rng);
+    std::vector<float> noisy(count);
+    for (size_t n = 0; n < count; ++n) {
+        noisy[n] = speech[n] + noise[n];
+    }
+    std::vector<float> out = Suppress(noisy);
+    const size_t latency = NoiseSuppressor::kLatency;
+
+    // Second 1 to 2, before any speech
+    double reduction_db = 20.0 * std::log10(Rms(noise, kRate, 2 * kRate) /
+                                            Rms(out, kRate + latency, 2 * kRate + latency));
+    if (reduction_db < kMinNoiseReductionDb) {
+        Fail("noise", "background reduced by only " + std::to_string(reduction_db) + " dB");
+    }
+
+    // The middle 300 ms of every syllable after the first
+    double dot = 0.0, energy = 0.0, error = 0.0;
+    size_t period = kRate * 7 / 10;
+    for (size_t syllable = speech_start + period; syllable + period <= count - latency; syllable += period) {
+        for (size_t n = syllable + kRate / 20; n < syllable + kRate * 35 / 100; ++n) {
+            double y = out[n + latency];
+            dot += y * speech[n];
+            energy += static_cast<double>(speech[n]) * speech[n];
+            error += (y - speech[n]) * (y - speech[n]);
+        }
+    }
+    double gain_db = 20.0 * std::log10(dot / energy);
+    if (std::fabs(gain_db) > kMaxSpeechGainDb) {
+        Fail("speech in noise", "level changed by " + std::to_string(gain_db) + " dB");
+    }
+    double relative = std::sqrt(error / energy);
+    if (relative > kSpeechErrorLimit) {
+        Fail("speech in noise", "error " + std::to_string(20.0 * std::log10(relative)) + " dB against the speech");
+    }
+}
+
+// Output depends only on the samples, not on how they were handed over
+void CheckContinuity(std::mt19937& rng) {
+    size_t count = 2 * kRate;
+    std::vector<float> noisy = Speech(count, kRate / 2);
+    std::vector<float> noise = Noise(count, rng);
+    std::vector<int16_t> noisy_s16(count);
+    for (size_t n = 0; n < count; ++n) {
+        noisy_s16[n] = static_cast<int16_t>(std::lround(std::clamp(noisy[n] + noise[n], -1.0f, 1.0f) * 32767.0f));
+    }
+    dsp::Active().s16_to_f32(noisy.data(), noisy_s16.data(), count);
+    std::vector<float> whole = Suppress(noisy);
+
+    NoiseSuppressor pieces;
+    NoiseSuppressor pieces_s16;
+    std::vector<float> out = noisy;
+    std::vector<int16_t> out_s16 = noisy_s16;
+    std::uniform_int_distribution<size_t> piece(0, 1500);
+    for (size_t offset = 0; offset < count;) {
+        size_t take = std::min(piece(rng), count - offset);
+        pieces.Process(out.data() + offset, take);
+        pieces_s16.Process(out_s16.data() + offset, take);
+        offset += take;
+    }
+    if (std::memcmp(out.data(), whole.data(), count * sizeof(float)) != 0) {
+        Fail("continuity", "output depends on how the input was split");
+    }
+    std::vector<int16_t> expected_s16(count);
+    dsp::Active().f32_to_s16(expected_s16.data(), whole.data(), count);
+    if (out_s16 != expected_s16) {
+        Fail("continuity", "int16 output differs from the float output");
+    }
+
+    // Reset starts over as a new instance
+    pieces.Reset();
+    std::vector<float> again = noisy;
+    for (size_t offset = 0; offset < count; offset += kFrame) {
+        pieces.Process(again.data() + offset, std::min(kFrame, count - offset));
+    }
+    if (std::memcmp(again.data(), whole.data(), count * sizeof(float)) != 0) {
+        Fail("continuity", "output after Reset differs from a new instance");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--seed=") == 0) {
+            seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: %s [--seed=N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    CheckTransparency();
+    CheckNoise(rng);
+    CheckContinuity(rng);
+    std::printf("noise suppressor: %s\n", g_failures == 0 ? "ok" : "FAILED");
+    return g_failures == 0 ? 0 : 1;
+}
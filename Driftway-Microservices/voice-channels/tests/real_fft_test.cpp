@@ -0,0 +1,139 @@
+// Checks RealFft against a naive DFT computed in double precision.
+//
+//   real_fft_test [--seed=N]
+//
+// For every size from 32 to 4096, random input is transformed forward and
+// compared bin by bin with the DFT, a random spectrum is transformed back
+// and compared with the inverse DFT (whose imaginary parts at bins 0 and
+// size/2 are ignored), and Inverse(Forward(x)) must give back x. Errors
+// are relative to the signal's RMS and must stay within a small multiple
+// of float rounding per FFT stage. Exits non-zero on any failure.
+
+#include "real_fft.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace driftway;
+
+namespace {
+
+constexpr size_t kMinSize = 32;
+constexpr size_t kMaxSize = 4096;
+constexpr double kEpsilon = std::numeric_limits<float>::epsilon();
+constexpr double kUlpsPerStage = 4.0;
+
+int g_failures = 0;
+
+void Fail(size_t size, const char* what, size_t index, double error) {
+    if (g_failures++ < 20) {
+        std::printf("FAIL: size %zu: %s at %zu, relative error %.3g\n", size, what, index, error);
+    }
+}
+
+double Rms(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double v : values) {
+        sum += v * v;
+    }
+    return std::sqrt(sum / static_cast<double>(values.size()));
+}
+
+void CheckSize(size_t size, std::mt19937& rng) {
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    size_t bins = size / 2 + 1;
+    double tolerance = kUlpsPerStage * kEpsilon * std::log2(static_cast<double>(size));
+    RealFft fft(size);
+
+    // Forward against the DFT. Each bin sums size inputs, so its error is
+    // compared with the RMS scaled by sqrt(size).
+    std::vector<float> in(size);
+    std::vector<double> in_double(size);
+    for (size_t t = 0; t < size; ++t) {
+        in[t] = normal(rng);
+        in_double[t] = in[t];
+    }
+    std::vector<float> re(bins), im(bins);
+    fft.Forward(in.data(), re.data(), im.data());
+    double scale = Rms(in_double) * std::sqrt(static_cast<double>(size));
+    for (size_t k = 0; k < bins; ++k) {
+        double expected_re = 0.0, expected_im = 0.0;
+        for (size_t t = 0; t < size; ++t) {
+            double angle = -2.0 * M_PI * static_cast<double>((k * t) % size) / static_cast<double>(size);
+            expected_re += in_double[t] * std::cos(angle);
+            expected_im += in_double[t] * std::sin(angle);
+        }
+        double error = std::hypot(re[k] - expected_re, im[k] - expected_im) / scale;
+        if (error > tolerance) {
+            Fail(size, "forward bin", k, error);
+        }
+    }
+
+    // Inverse against the inverse DFT of a Hermitian spectrum
+    std::vector<double> spectrum_re(bins), spectrum_im(bins);
+    for (size_t k = 0; k < bins; ++k) {
+        re[k] = normal(rng);
+        im[k] = normal(rng);
+        spectrum_re[k] = re[k];
+        spectrum_im[k] = (k == 0 || k == bins - 1) ? 0.0 : im[k];
+    }
+    std::vector<float> out(size);
+    fft.Inverse(re.data(), im.data(), out.data());
+    std::vector<double> expected(size);
+    for (size_t t = 0; t < size; ++t) {
+        double sum = 0.0;
+        for (size_t k = 0; k < bins; ++k) {
+            double angle = 2.0 * M_PI * static_cast<double>((k * t) % size) / static_cast<double>(size);
+            double term = spectrum_re[k] * std::cos(angle) - spectrum_im[k] * std::sin(angle);
+            sum += (k == 0 || k == bins - 1) ? term : 2.0 * term;
+        }
+        expected[t] = sum / static_cast<double>(size);
+    }
+    double expected_rms = Rms(expected);
+    for (size_t t = 0; t < size; ++t) {
+        double error = std::fabs(out[t] - expected[t]) / expected_rms;
+        if (error > tolerance) {
+            Fail(size, "inverse sample", t, error);
+        }
+    }
+
+    // Round trip
+    fft.Forward(in.data(), re.data(), im.data());
+    fft.Inverse(re.data(), im.data(), out.data());
+    double in_rms = Rms(in_double);
+    for (size_t t = 0; t < size; ++t) {
+        double error = std::fabs(out[t] - in_double[t]) / in_rms;
+        if (error > 2.0 * tolerance) {
+            Fail(size, "round trip sample", t, error);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--seed=") == 0) {
+            seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: %s [--seed=N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    for (size_t size = kMinSize; size <= kMaxSize; size *= 2) {
+        int before = g_failures;
+        CheckSize(size, rng);
+        std::printf("size %zu: %s\n", size, g_failures == before ? "ok" : "FAILED");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
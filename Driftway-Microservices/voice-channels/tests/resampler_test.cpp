@@ -0,0 +1,231 @@
+// Checks Resampler conversions between the client rates (8, 16, 24 and
+// 48 kHz) against what a tone should come out as.
+//
+//   resampler_test [--seed=N]
+//
+// For every rate pair a 100 Hz and a 3 kHz tone are converted, and a sine
+// of the input frequency is fitted to the output once the filter has
+// settled: it must match the input amplitude, leave almost nothing
+// unexplained (aliases, images, a wrong frequency), and be delayed by the
+// filter's linear-phase delay: 32 samples at the slower rate, less half a
+// sample at the rate the filter runs at. A tone just above the output Nyquist
+// frequency must be rejected when downsampling. Feeding the same input
+// in random-sized pieces, or as int16, must give the same output as one
+// call. Exits non-zero on any failure.
+
+#include "dsp_kernels.h"
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace driftway;
+
+namespace {
+
+constexpr int kRates[] = {8000, 16000, 24000, 48000};
+constexpr double kAmplitude = 0.5;
+constexpr double kSeconds = 0.5;
+constexpr double kSettleSeconds = 0.02;  // Past the filter delay
+constexpr double kDelaySamples = 32.0;   // At the slower rate: half the filter's zero crossings
+constexpr double kDelayToleranceMs = 0.001;
+constexpr double kGainTolerance = 0.01;  // Passband ripple, relative
+constexpr double kResidualLimit = 1e-3;  // Unexplained RMS relative to the tone's, -60 dB
+constexpr double kRejectionLimit = 3e-4; // Stopband RMS relative to the input's, -70 dB
+
+int g_failures = 0;
+
+void Fail(int in_rate, int out_rate, const std::string& what) {
+    if (g_failures++ < 20) {
+        std::printf("FAIL: %d -> %d: %s\n", in_rate, out_rate, what.c_str());
+    }
+}
+
+std::vector<float> Tone(double hz, int rate, size_t count) {
+    std::vector<float> tone(count);
+    for (size_t n = 0; n < count; ++n) {
+        tone[n] = static_cast<float>(kAmplitude * std::cos(2.0 * M_PI * hz * static_cast<double>(n) / rate));
+    }
+    return tone;
+}
+
+std::vector<float> Convert(int in_rate, int out_rate, const std::vector<float>& in) {
+    Resampler resampler(in_rate, out_rate);
+    std::vector<float> out(resampler.MaxOutputSamples(in.size()));
+    out.resize(resampler.Process(in.data(), in.size(), out.data(), out.size()));
+    return out;
+}
+
+// Least-squares fit of a cos(w k) + b sin(w k) to y[start..), as the
+// amplitude, the phase lag and the RMS left over relative to the tone's
+struct ToneFit {
+    double amplitude = 0.0;
+    double phase = 0.0;
+    double residual = 0.0;
+};
+
+ToneFit FitTone(const std::vector<float>& y, size_t start, double hz, int rate) {
+    double w = 2.0 * M_PI * hz / rate;
+    double cc = 0.0, ss = 0.0, cs = 0.0, yc = 0.0, ys = 0.0;
+    for (size_t k = start; k < y.size(); ++k) {
+        double c = std::cos(w * static_cast<double>(k));
+        double s = std::sin(w * static_cast<double>(k));
+        cc += c * c;
+        ss += s * s;
+        cs += c * s;
+        yc += y[k] * c;
+        ys += y[k] * s;
+    }
+    double det = cc * ss - cs * cs;
+    double a = (yc * ss - ys * cs) / det;
+    double b = (ys * cc - yc * cs) / det;
+
+    double error = 0.0;
+    for (size_t k = start; k < y.size(); ++k) {
+        double fitted = a * std::cos(w * static_cast<double>(k)) + b * std::sin(w * static_cast<double>(k));
+        error += (y[k] - fitted) * (y[k] - fitted);
+    }
+    ToneFit fit;
+    fit.amplitude = std::hypot(a, b);
+    fit.phase = std::atan2(b, a);
+    if (fit.phase < 0.0) {
+        fit.phase += 2.0 * M_PI;
+    }
+    double rms = std::sqrt(error / static_cast<double>(y.size() - start));
+    fit.residual = rms / (fit.amplitude / std::sqrt(2.0));
+    return fit;
+}
+
+void CheckTone(int in_rate, int out_rate, double hz, bool check_delay) {
+    size_t in_count = static_cast<size_t>(in_rate * kSeconds);
+    std::vector<float> out = Convert(in_rate, out_rate, Tone(hz, in_rate, in_count));
+    size_t expected = static_cast<size_t>(out_rate * kSeconds);
+    if (out.size() < expected - 1 || out.size() > expected + 1) {
+        Fail(in_rate, out_rate, std::to_string(out.size()) + " samples out for " + std::to_string(expected));
+        return;
+    }
+
+    ToneFit fit = FitTone(out, static_cast<size_t>(out_rate * kSettleSeconds), hz, out_rate);
+    char text[128];
+    if (std::fabs(fit.amplitude / kAmplitude - 1.0) > kGainTolerance) {
+        std::snprintf(text, sizeof(text), "%.0f Hz tone came out at %.4f of its amplitude", hz,
+                      fit.amplitude / kAmplitude);
+        Fail(in_rate, out_rate, text);
+    }
+    if (fit.residual > kResidualLimit) {
+        std::snprintf(text, sizeof(text), "%.0f Hz tone: %.1f dB not explained by the tone", hz,
+                      20.0 * std::log10(fit.residual));
+        Fail(in_rate, out_rate, text);
+    }
+    if (check_delay) {
+        // The period is longer than the delay, so the phase lag is unambiguous
+        double delay_ms = 1000.0 * fit.phase / (2.0 * M_PI * hz);
+        // The prototype filter runs at the common multiple of the rates
+        // and has an even length, so its centre falls between two samples
+        double expected_ms = 1000.0 * (kDelaySamples / std::min(in_rate, out_rate) -
+                                       0.5 / std::lcm(in_rate, out_rate));
+        if (std::fabs(delay_ms - expected_ms) > kDelayToleranceMs) {
+            std::snprintf(text, sizeof(text), "delay %.4f ms, expected %.4f ms", delay_ms, expected_ms);
+            Fail(in_rate, out_rate, text);
+        }
+    }
+}
+
+// A tone the output rate cannot carry must not alias into it
+void CheckRejection(int in_rate, int out_rate) {
+    double hz = 0.55 * out_rate;  // A tenth above the output Nyquist frequency
+    size_t in_count = static_cast<size_t>(in_rate * kSeconds);
+    std::vector<float> out = Convert(in_rate, out_rate, Tone(hz, in_rate, in_count));
+
+    double energy = 0.0;
+    size_t start = static_cast<size_t>(out_rate * kSettleSeconds);
+    for (size_t k = start; k < out.size(); ++k) {
+        energy += static_cast<double>(out[k]) * out[k];
+    }
+    double relative = std::sqrt(energy / static_cast<double>(out.size() - start)) / (kAmplitude / std::sqrt(2.0));
+    if (relative > kRejectionLimit) {
+        char text[128];
+        std::snprintf(text, sizeof(text), "%.0f Hz tone leaks through at %.1f dB", hz, 20.0 * std::log10(relative));
+        Fail(in_rate, out_rate, text);
+    }
+}
+
+// Random-sized Process calls and the int16 path give the one-call output
+void CheckContinuity(int in_rate, int out_rate, std::mt19937& rng) {
+    size_t in_count = static_cast<size_t>(in_rate * kSeconds);
+    std::vector<float> in(in_count);
+    std::vector<int16_t> in_s16(in_count);
+    std::normal_distribution<float> noise(0.0f, 0.2f);
+    for (size_t n = 0; n < in_count; ++n) {
+        in_s16[n] = static_cast<int16_t>(std::clamp(noise(rng), -1.0f, 1.0f) * 32767.0f);
+    }
+    dsp::Active().s16_to_f32(in.data(), in_s16.data(), in_count);
+    std::vector<float> whole = Convert(in_rate, out_rate, in);
+
+    Resampler pieces(in_rate, out_rate);
+    Resampler pieces_s16(in_rate, out_rate);
+    std::vector<float> out;
+    std::vector<int16_t> out_s16;
+    std::uniform_int_distribution<size_t> piece(0, 2500);
+    for (size_t offset = 0; offset < in_count;) {
+        size_t count = std::min(piece(rng), in_count - offset);
+        size_t written = out.size();
+        out.resize(written + pieces.MaxOutputSamples(count));
+        out.resize(written + pieces.Process(in.data() + offset, count, out.data() + written, out.size() - written));
+        written = out_s16.size();
+        out_s16.resize(written + pieces_s16.MaxOutputSamples(count));
+        out_s16.resize(written + pieces_s16.Process(in_s16.data() + offset, count, out_s16.data() + written,
+                                                    out_s16.size() - written));
+        offset += count;
+    }
+
+    if (out.size() != whole.size() || std::memcmp(out.data(), whole.data(), out.size() * sizeof(float)) != 0) {
+        Fail(in_rate, out_rate, "output depends on how the input was split");
+    }
+    std::vector<int16_t> expected_s16(whole.size());
+    dsp::Active().f32_to_s16(expected_s16.data(), whole.data(), whole.size());
+    if (out_s16 != expected_s16) {
+        Fail(in_rate, out_rate, "int16 output differs from the float output");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--seed=") == 0) {
+            seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: %s [--seed=N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    for (int in_rate : kRates) {
+        for (int out_rate : kRates) {
+            if (in_rate == out_rate) {
+                continue;
+            }
+            int before = g_failures;
+            CheckTone(in_rate, out_rate, 100.0, true);
+            CheckTone(in_rate, out_rate, 3000.0, false);
+            if (out_rate < in_rate) {
+                CheckRejection(in_rate, out_rate);
+            }
+            CheckContinuity(in_rate, out_rate, rng);
+            std::printf("%d -> %d: %s\n", in_rate, out_rate, g_failures == before ? "ok" : "FAILED");
+        }
+    }
+    return g_failures == 0 ? 0 : 1;
+}
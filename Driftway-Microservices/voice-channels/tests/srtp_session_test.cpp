@@ -0,0 +1,130 @@
+// Cycles more SSRCs than SrtpSession::kMaxStreams through one outbound
+// session, the way a long-lived receiver sees senders come and go, and
+// checks that every packet still protects and unprotects.
+//
+//   srtp_session_test [--seed=N]
+//
+// Each sender gets a few packets and is then removed from both sessions.
+// Also checks that the cap still refuses SSRCs beyond it while none are
+// removed, and that a removed SSRC is not started over. Exits non-zero on
+// any failure.
+
+#include "rtp_packet.h"
+#include "srtp_session.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace driftway;
+
+namespace {
+
+constexpr size_t kPayloadSize = 40;
+constexpr size_t kPacketsPerSender = 4;
+constexpr size_t kSenders = 3 * SrtpSession::kMaxStreams + 1;
+
+int g_failures = 0;
+
+void Fail(const char* what, uint32_t ssrc) {
+    if (g_failures++ < 20) {
+        std::printf("FAIL: %s (ssrc %u)\n", what, ssrc);
+    }
+}
+
+struct Packet {
+    uint8_t data[rtp::kFixedHeaderSize + kPayloadSize + srtp::kMaxOverhead];
+    size_t size = rtp::kFixedHeaderSize + kPayloadSize;
+};
+
+Packet MakePacket(uint32_t ssrc, uint16_t sequence, std::mt19937& rng) {
+    Packet packet;
+    std::memset(packet.data, 0, sizeof(packet.data));
+    packet.data[0] = 0x80;
+    packet.data[1] = 111;
+    rtp::WriteU16(packet.data + 2, sequence);
+    rtp::WriteU32(packet.data + 4, sequence * 960u);
+    rtp::WriteU32(packet.data + 8, ssrc);
+    for (size_t i = 0; i < kPayloadSize; ++i) {
+        packet.data[rtp::kFixedHeaderSize + i] = static_cast<uint8_t>(rng());
+    }
+    return packet;
+}
+
+// Protects a packet and unprotects it again; true if it came back intact
+bool RoundTrip(SrtpSession& protect, SrtpSession& unprotect, uint32_t ssrc, uint16_t sequence, std::mt19937& rng) {
+    Packet packet = MakePacket(ssrc, sequence, rng);
+    Packet original = packet;
+    if (protect.ProtectRtp(packet.data, &packet.size, sizeof(packet.data)) != SrtpStatus::kOk) {
+        return false;
+    }
+    return unprotect.UnprotectRtp(packet.data, &packet.size) == SrtpStatus::kOk && packet.size == original.size &&
+           std::memcmp(packet.data, original.data, packet.size) == 0;
+}
+
+void CheckProfile(SrtpProfile profile, std::mt19937& rng) {
+    uint8_t key[srtp::kMasterKeySize];
+    uint8_t salt[srtp::kMaxMasterSaltSize];
+    if (!srtp::GenerateMasterKey(profile, key, salt)) {
+        Fail("no master key", 0);
+        return;
+    }
+    SrtpSession protect(profile, SrtpSession::Direction::kProtect, key, salt);
+    SrtpSession unprotect(profile, SrtpSession::Direction::kUnprotect, key, salt);
+
+    // Senders joining and leaving, one after another
+    for (uint32_t ssrc = 1; ssrc <= kSenders; ++ssrc) {
+        for (uint16_t sequence = 0; sequence < kPacketsPerSender; ++sequence) {
+            if (!RoundTrip(protect, unprotect, ssrc, static_cast<uint16_t>(sequence + ssrc * 7), rng)) {
+                Fail("packet of a new sender lost", ssrc);
+                break;
+            }
+        }
+        protect.RemoveStream(ssrc);
+        unprotect.RemoveStream(ssrc);
+    }
+
+    // A packet of a sender that just left, still queued, is not started over
+    Packet late = MakePacket(static_cast<uint32_t>(kSenders), 100, rng);
+    if (protect.ProtectRtp(late.data, &late.size, sizeof(late.data)) == SrtpStatus::kOk) {
+        Fail("removed stream started over", static_cast<uint32_t>(kSenders));
+    }
+
+    // Without removals the cap still holds
+    SrtpSession capped(profile, SrtpSession::Direction::kProtect, key, salt);
+    for (uint32_t i = 0; i <= SrtpSession::kMaxStreams; ++i) {
+        uint32_t ssrc = 100000 + i;
+        Packet packet = MakePacket(ssrc, 0, rng);
+        bool ok = capped.ProtectRtp(packet.data, &packet.size, sizeof(packet.data)) == SrtpStatus::kOk;
+        if (ok != (i < SrtpSession::kMaxStreams)) {
+            Fail(ok ? "stream accepted beyond the cap" : "stream refused below the cap", ssrc);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--seed=") == 0) {
+            seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: %s [--seed=N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    for (SrtpProfile profile : {SrtpProfile::kAesCm128HmacSha1_80, SrtpProfile::kAeadAes128Gcm}) {
+        int before = g_failures;
+        CheckProfile(profile, rng);
+        std::printf("%s: %s\n", srtp::ProfileName(profile), g_failures == before ? "ok" : "FAILED");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
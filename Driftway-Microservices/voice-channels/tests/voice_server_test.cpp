@@ -0,0 +1,132 @@
+// Races joins, leaves and channel removals on a few channels from several
+// threads, then checks that no SSRC route outlived its participant.
+//
+//   voice_server_test [--seed=N]
+//
+// The server is not started: no database, Redis or media workers, just the
+// channel registry, the user table and the SSRC router the calls share.
+// Once every thread is done and every user has left, each SSRC handed out
+// must be gone from FindRoute and every channel still registered empty.
+// Exits non-zero otherwise.
+
+#include "epoch.h"
+#include "logger.h"
+#include "ssrc_router.h"
+#include "voice_channel.h"
+#include "voice_server.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace driftway;
+
+namespace {
+
+constexpr int kChannels = 4;
+constexpr int kUsers = 16;
+constexpr int kThreads = 4;
+constexpr int kIterations = 20000;
+
+std::string ChannelId(int index) {
+    return "race-" + std::to_string(index);
+}
+
+std::string UserId(int index) {
+    return "user-" + std::to_string(index);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--seed=") == 0) {
+            seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: %s [--seed=N]\n", argv[0]);
+            return 2;
+        }
+    }
+    log::SetLevel(log::Level::kError);
+
+    VoiceServerConfig config;
+    config.max_participants = kUsers;
+    VoiceServer server(config);
+
+    std::mutex ssrcs_mutex;
+    std::vector<uint32_t> ssrcs;
+    std::atomic<bool> done{false};
+
+    // Joins and leaves of random users, so a user's leave often races
+    // its own join on another thread
+    auto join_leave = [&](uint32_t thread_seed) {
+        std::mt19937 rng(thread_seed);
+        std::vector<uint32_t> joined;
+        for (int i = 0; i < kIterations; ++i) {
+            std::string channel_id = ChannelId(static_cast<int>(rng() % kChannels));
+            std::string user_id = UserId(static_cast<int>(rng() % kUsers));
+            if (rng() % 2 == 0) {
+                uint32_t ssrc = 0;
+                server.CreateChannel(channel_id, "test");
+                if (server.JoinChannel(channel_id, user_id, &ssrc)) {
+                    joined.push_back(ssrc);
+                }
+            } else {
+                server.LeaveChannel(channel_id, user_id);
+            }
+        }
+        std::lock_guard<std::mutex> lock(ssrcs_mutex);
+        ssrcs.insert(ssrcs.end(), joined.begin(), joined.end());
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back(join_leave, seed * 7919 + static_cast<uint32_t>(t));
+    }
+    std::thread remover([&] {
+        std::mt19937 rng(seed);
+        while (!done.load()) {
+            server.RemoveChannel(ChannelId(static_cast<int>(rng() % kChannels)));
+            std::this_thread::yield();
+        }
+    });
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    done.store(true);
+    remover.join();
+
+    for (int c = 0; c < kChannels; ++c) {
+        for (int u = 0; u < kUsers; ++u) {
+            server.LeaveChannel(ChannelId(c), UserId(u));
+        }
+    }
+
+    int failures = 0;
+    for (const auto& channel : server.GetChannels()) {
+        if (!channel->IsEmpty()) {
+            std::printf("FAIL: channel %s not empty after every user left\n", channel->GetChannelId().c_str());
+            failures++;
+        }
+    }
+    {
+        epoch::ReadGuard guard;
+        for (uint32_t ssrc : ssrcs) {
+            if (const SsrcRoute* route = server.FindRoute(ssrc)) {
+                if (failures++ < 20) {
+                    std::printf("FAIL: route for ssrc %u outlived its participant\n", route->ssrc);
+                }
+            }
+        }
+    }
+    std::printf("%zu joins: %s\n", ssrcs.size(), failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
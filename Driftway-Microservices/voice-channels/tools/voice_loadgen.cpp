@@ -0,0 +1,886 @@
+// Synthetic RTP load against a running voice server on this host, for
+// certifying how many participants it carries before a rollout.
+//
+// Every client joins through the HTTP signaling endpoint, gets its SSRC,
+// passes an ICE connectivity check from its own UDP socket, and then sends
+// from that socket to the RTC port: speakers a paced 20 ms Opus-sized
+// packet, listeners an occasional DTX-style keepalive (which is also what
+// latches their checked address on the server).
+// Each payload is stamped with its sender, a sequence number and the send
+// time, so every receiver can measure loss and RFC 3550 jitter per
+// incoming stream and the end-to-end latency of every packet (send() to
+// kernel receive, both on CLOCK_REALTIME).
+//
+//   voice_loadgen [--clients=N] [--channel-sizes=SPEC] [--speakers=RATIO] [--duration=SECONDS] ...
+//
+// Channel sizes are drawn from SPEC: "fixed:N", "uniform:MIN-MAX" or
+// "weighted:SIZE=WEIGHT,..." (e.g. weighted:2=50,10=35,50=12,200=3).
+// Run with --help for the rest. Measures SFU forwarding; in mixing mode
+// the stamps do not survive re-encoding.
+
+#include "metrics.h"
+#include "rtp_packet.h"
+#include "stun_message.h"
+#include "voice_activity.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace driftway;
+
+namespace {
+
+constexpr uint32_t kStampMagic = 0x44574c47; // "DWLG"
+constexpr size_t kStampSize = 20;            // magic, sender, sequence, send time
+constexpr uint32_t kFrameMs = 20;
+constexpr uint32_t kSamplesPerMs = rtp::kOpusClockRate / 1000;
+constexpr size_t kReceiveBatch = 32;
+constexpr uint8_t kOpusPayloadType = 111; // As in kSdpOffer
+
+// What a browser offers, trimmed to the lines the server reads; each
+// client appends its own a=ice-ufrag
+const char* const kSdpOffer =
+    "v=0\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 111\r\n"
+    "a=rtpmap:111 opus/48000/2\r\n"
+    "a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n";
+
+constexpr int kIceCheckTimeoutMs = 200;
+constexpr int kIceCheckAttempts = 5;
+
+struct Options {
+    std::string server = "127.0.0.1";
+    int http_port = 9090;
+    int rtc_port = 3478;
+    size_t clients = 1000;
+    std::string channel_sizes = "fixed:10";
+    double speakers = 0.1;    // Fraction of each channel, at least one
+    double duration = 30.0;   // Seconds measured
+    double warmup = 5.0;      // Seconds sent but not measured
+    size_t payload_bytes = 80; // 32 kbit/s Opus
+    uint32_t keepalive_ms = 400; // Listener packets; 0: one, to latch the address
+    size_t threads = 2;
+    std::string prefix = "loadgen";
+    uint32_t seed = 1;
+    bool json = false;
+    double max_loss = -1.0;   // Percent; exit 1 above it
+    double max_p99_ms = -1.0; // Exit 1 above it
+};
+
+uint64_t RealtimeNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint64_t MonotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Channel sizes
+
+class SizeDistribution {
+public:
+    bool Parse(const std::string& spec) {
+        spec_ = spec;
+        std::string kind = spec.substr(0, spec.find(':'));
+        std::string args = spec.find(':') == std::string::npos ? "" : spec.substr(spec.find(':') + 1);
+        if (kind == "fixed") {
+            sizes_ = {std::strtoul(args.c_str(), nullptr, 10)};
+            weights_ = {1.0};
+        } else if (kind == "uniform") {
+            size_t dash = args.find('-');
+            if (dash == std::string::npos) {
+                return false;
+            }
+            size_t low = std::strtoul(args.c_str(), nullptr, 10);
+            size_t high = std::strtoul(args.c_str() + dash + 1, nullptr, 10);
+            for (size_t size = low; size <= high && low > 0; ++size) {
+                sizes_.push_back(size);
+                weights_.push_back(1.0);
+            }
+        } else if (kind == "weighted") {
+            for (size_t pos = 0; pos < args.size();) {
+                size_t end = args.find(',', pos);
+                end = end == std::string::npos ? args.size() : end;
+                std::string item = args.substr(pos, end - pos);
+                size_t eq = item.find('=');
+                if (eq == std::string::npos) {
+                    return false;
+                }
+                sizes_.push_back(std::strtoul(item.c_str(), nullptr, 10));
+                weights_.push_back(std::atof(item.c_str() + eq + 1));
+                pos = end + 1;
+            }
+        } else {
+            return false;
+        }
+        if (sizes_.empty()) {
+            return false;
+        }
+        for (size_t i = 0; i < sizes_.size(); ++i) {
+            if (sizes_[i] == 0 || weights_[i] <= 0.0) {
+                return false;
+            }
+        }
+        pick_ = std::discrete_distribution<size_t>(weights_.begin(), weights_.end());
+        return true;
+    }
+
+    size_t Sample(std::mt19937& rng) { return sizes_[pick_(rng)]; }
+    const std::string& spec() const { return spec_; }
+
+private:
+    std::string spec_;
+    std::vector<size_t> sizes_;
+    std::vector<double> weights_;
+    std::discrete_distribution<size_t> pick_;
+};
+
+// Signaling
+
+// One blocking HTTP/1.1 POST on a fresh connection; the server closes it
+// after the response
+bool HttpPost(const sockaddr_in& server, const std::string& target, const std::string& body, int* status,
+              std::string* response_body) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    timeval timeout{5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&server), sizeof(server)) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    std::string request = "POST " + target + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n"
+                          "Content-Type: application/sdp\r\nContent-Length: " + std::to_string(body.size()) +
+                          "\r\n\r\n" + body;
+    for (size_t sent = 0; sent < request.size();) {
+        ssize_t n = ::send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            ::close(fd);
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    std::string response;
+    char chunk[4096];
+    ssize_t n;
+    while ((n = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+        response.append(chunk, static_cast<size_t>(n));
+    }
+    ::close(fd);
+
+    size_t header_end = response.find("\r\n\r\n");
+    if (response.compare(0, 5, "HTTP/") != 0 || response.find(' ') == std::string::npos ||
+        header_end == std::string::npos) {
+        return false;
+    }
+    *status = std::atoi(response.c_str() + response.find(' ') + 1);
+    *response_body = response.substr(header_end + 4);
+    return true;
+}
+
+// Reads "key":<number> from a flat JSON object
+bool JsonNumber(const std::string& json, const std::string& key, uint64_t* value) {
+    size_t pos = json.find("\"" + key + "\":");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    *value = std::strtoull(json.c_str() + pos + key.size() + 3, nullptr, 10);
+    return true;
+}
+
+// Reads an "a=<name>:" line out of the (JSON-escaped) SDP answer
+bool AnswerAttribute(const std::string& json, const std::string& name, std::string* value) {
+    size_t pos = json.find("a=" + name + ":");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos += name.size() + 3;
+    *value = json.substr(pos, json.find_first_of("\\\"", pos) - pos);
+    return !value->empty();
+}
+
+std::string RandomIceString(std::mt19937& rng, size_t length) {
+    static const char kIceChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string result(length, '\0');
+    for (char& c : result) {
+        c = kIceChars[rng() & 63];
+    }
+    return result;
+}
+
+// A browser's connectivity check, from the connected socket fd: USERNAME
+// "<server ufrag>:<our ufrag>", keyed with the server's password. The
+// server only latches plain RTP from an address that passed one.
+bool IceCheck(int fd, const std::string& username, const std::string& password, std::mt19937& rng) {
+    uint8_t transaction_id[stun::kTransactionIdSize];
+    for (uint8_t& byte : transaction_id) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    uint8_t request[stun::kMaxMessageSize];
+    StunMessageWriter writer(request, sizeof(request));
+    writer.WriteHeader(stun::kBindingRequest, transaction_id);
+    writer.AddAttribute(stun::kAttrUsername, reinterpret_cast<const uint8_t*>(username.data()), username.size());
+    writer.AddMessageIntegrity(StunIntegrityKey(password));
+    writer.AddFingerprint();
+    size_t request_size = writer.Finish();
+    if (request_size == 0) {
+        return false;
+    }
+
+    for (int attempt = 0; attempt < kIceCheckAttempts; ++attempt) {
+        if (::send(fd, request, request_size, 0) < 0) {
+            return false;
+        }
+        pollfd ready{fd, POLLIN, 0};
+        while (::poll(&ready, 1, kIceCheckTimeoutMs) > 0) {
+            uint8_t response[stun::kMaxMessageSize];
+            ssize_t n = ::recv(fd, response, sizeof(response), 0);
+            StunMessageView view;
+            if (n > 0 && view.Parse(response, static_cast<size_t>(n)) &&
+                std::memcmp(view.transactionId(), transaction_id, sizeof(transaction_id)) == 0) {
+                return view.type() == stun::kBindingSuccessResponse;
+            }
+        }
+    }
+    return false;
+}
+
+// Clients and their streams
+
+// What one receiver saw of one sender, within the measured window
+struct StreamStats {
+    uint64_t received = 0;
+    int64_t last_transit_ns = 0;
+    double jitter_ns = 0.0; // RFC 3550 A.8 estimator
+};
+
+struct Client {
+    uint32_t index = 0;
+    std::string user_id;
+    size_t channel = 0;
+    bool speaker = false;
+    bool joined = false;
+    int fd = -1;
+    uint32_t ssrc = 0;
+    std::unique_ptr<RtpStream> rtp;
+
+    // Sender side; written by the owning worker, read after it has joined
+    uint32_t next_sequence = 0;
+    uint32_t first_measured = UINT32_MAX; // First sequence sent in the window
+    uint32_t last_measured = 0;
+    uint64_t next_send_ns = 0;            // CLOCK_MONOTONIC
+
+    // Receiver side, by sender index
+    std::unordered_map<uint32_t, StreamStats> streams;
+    uint32_t socket_drops = 0; // Kernel's running count for this socket
+};
+
+struct Counters {
+    uint64_t speaker_sent = 0;
+    uint64_t keepalives_sent = 0;
+    uint64_t send_errors = 0;
+    uint64_t speaker_received = 0;
+    uint64_t keepalives_received = 0;
+    uint64_t warmup_received = 0;
+    uint64_t foreign_received = 0; // Not one of our stamped packets
+    uint64_t socket_drops = 0;     // Lost in our own receive queues (SO_RXQ_OVFL)
+
+    void Add(const Counters& other) {
+        speaker_sent += other.speaker_sent;
+        keepalives_sent += other.keepalives_sent;
+        send_errors += other.send_errors;
+        speaker_received += other.speaker_received;
+        keepalives_received += other.keepalives_received;
+        warmup_received += other.warmup_received;
+        foreign_received += other.foreign_received;
+        socket_drops += other.socket_drops;
+    }
+};
+
+// The measured window, on both clocks: monotonic for pacing, realtime for
+// the stamps
+struct Window {
+    uint64_t start_mono = 0;    // Sending starts
+    uint64_t measure_mono = 0;  // Warm-up over
+    uint64_t stop_mono = 0;     // Sending stops
+    uint64_t end_mono = 0;      // Receiving stops, after in-flight packets drained
+    uint64_t measure_real = 0;
+};
+
+struct Shared {
+    const Options* options;
+    const std::vector<Client>* clients;
+    Window window;
+    HdrHistogram latency_us;
+    HdrHistogram lateness_us; // How late the generator sent; large values void the run
+};
+
+class Worker {
+public:
+    Worker(Shared& shared, std::vector<Client*> clients) : shared_(shared), clients_(std::move(clients)) {}
+
+    void Run() {
+        const Options& options = *shared_.options;
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        // Wakes the loop for the next send on time, without spinning
+        timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        epoll_event timer{};
+        timer.events = EPOLLIN;
+        timer.data.ptr = nullptr;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &timer);
+        std::mt19937 rng(options.seed + clients_.front()->index);
+        std::uniform_int_distribution<uint64_t> phase(0, kFrameMs * 1000000ull - 1);
+        for (Client* client : clients_) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.ptr = client;
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client->fd, &event);
+            // Spread the clients over the frame so sends do not come in bursts
+            client->next_send_ns = shared_.window.start_mono + phase(rng);
+            schedule_.push({client->next_send_ns, client});
+        }
+
+        std::vector<epoll_event> events(256);
+        while (true) {
+            uint64_t now = MonotonicNs();
+            if (now >= shared_.window.end_mono) {
+                break;
+            }
+            while (!schedule_.empty() && schedule_.top().first <= now && now < shared_.window.stop_mono) {
+                Client* client = schedule_.top().second;
+                schedule_.pop();
+                Send(*client, now);
+                now = MonotonicNs();
+            }
+
+            uint64_t wake = shared_.window.end_mono;
+            if (!schedule_.empty() && now < shared_.window.stop_mono) {
+                wake = std::min(wake, schedule_.top().first);
+            }
+            itimerspec due{};
+            due.it_value.tv_sec = static_cast<time_t>(wake / 1000000000ull);
+            due.it_value.tv_nsec = static_cast<long>(wake % 1000000000ull);
+            ::timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &due, nullptr);
+
+            int ready = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+            for (int i = 0; i < ready; ++i) {
+                if (events[i].data.ptr) {
+                    Receive(*static_cast<Client*>(events[i].data.ptr));
+                } else {
+                    uint64_t expirations;
+                    ssize_t ignored = ::read(timer_fd_, &expirations, sizeof(expirations));
+                    (void)ignored;
+                }
+            }
+        }
+        ::close(timer_fd_);
+        ::close(epoll_fd_);
+    }
+
+    const Counters& counters() const { return counters_; }
+
+private:
+    using Due = std::pair<uint64_t, Client*>;
+
+    Shared& shared_;
+    std::vector<Client*> clients_;
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> schedule_;
+    Counters counters_;
+
+    void Send(Client& client, uint64_t now) {
+        const Options& options = *shared_.options;
+        uint64_t interval_ms = client.speaker ? kFrameMs : options.keepalive_ms;
+        shared_.lateness_us.Record((now - client.next_send_ns) / 1000);
+
+        RtpHeader header;
+        client.rtp->NextHeader(static_cast<uint32_t>(std::max<uint64_t>(interval_ms, kFrameMs) * kSamplesPerMs),
+                               &header);
+        uint8_t packet[1500];
+        RtpPacketWriter writer(packet, sizeof(packet));
+        writer.WriteHeader(header);
+        // RFC 6464 level: speech at -30 dBov, or silence
+        uint8_t level = client.speaker ? (0x80 | 30) : kAudioLevelSilence;
+        writer.BeginExtensions();
+        writer.AddExtension(kDefaultAudioLevelExtensionId, &level, 1);
+
+        size_t available = 0;
+        uint8_t* payload = writer.PayloadBuffer(&available);
+        size_t size = client.speaker ? options.payload_bytes : kStampSize;
+        uint32_t sequence = client.next_sequence++;
+        uint64_t sent_ns = RealtimeNs();
+        std::memset(payload, 0x5A, std::min(size, available));
+        std::memcpy(payload, &kStampMagic, 4);
+        std::memcpy(payload + 4, &client.index, 4);
+        std::memcpy(payload + 8, &sequence, 4);
+        std::memcpy(payload + 12, &sent_ns, 8);
+        writer.CommitPayload(size);
+        size_t length = writer.Finish();
+
+        if (length == 0 || ::send(client.fd, packet, length, 0) != static_cast<ssize_t>(length)) {
+            counters_.send_errors++;
+        } else if (client.speaker) {
+            counters_.speaker_sent++;
+        } else {
+            counters_.keepalives_sent++;
+        }
+        // Same test as the receivers apply to the stamp
+        if (client.speaker && sent_ns >= shared_.window.measure_real) {
+            client.first_measured = std::min(client.first_measured, sequence);
+            client.last_measured = sequence;
+        }
+
+        if (interval_ms > 0) {
+            // Paced from the schedule, not from when this send happened
+            client.next_send_ns += interval_ms * 1000000ull;
+            schedule_.push({client.next_send_ns, &client});
+        }
+    }
+
+    void Receive(Client& client) {
+        uint8_t buffers[kReceiveBatch][1500];
+        alignas(cmsghdr) uint8_t control[kReceiveBatch][CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+        iovec iov[kReceiveBatch];
+        mmsghdr messages[kReceiveBatch];
+
+        while (true) {
+            for (size_t i = 0; i < kReceiveBatch; ++i) {
+                iov[i] = {buffers[i], sizeof(buffers[i])};
+                messages[i] = {};
+                messages[i].msg_hdr.msg_iov = &iov[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+                messages[i].msg_hdr.msg_control = control[i];
+                messages[i].msg_hdr.msg_controllen = sizeof(control[i]);
+            }
+            int count = ::recvmmsg(client.fd, messages, kReceiveBatch, MSG_DONTWAIT, nullptr);
+            if (count <= 0) {
+                return;
+            }
+            uint64_t fallback_ns = RealtimeNs();
+            for (int i = 0; i < count; ++i) {
+                uint64_t arrival_ns = fallback_ns;
+                for (cmsghdr* cmsg = CMSG_FIRSTHDR(&messages[i].msg_hdr); cmsg;
+                     cmsg = CMSG_NXTHDR(&messages[i].msg_hdr, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS) {
+                        timespec ts;
+                        std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                        arrival_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+                                     static_cast<uint64_t>(ts.tv_nsec);
+                    } else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                        uint32_t drops;
+                        std::memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                        counters_.socket_drops += drops - client.socket_drops;
+                        client.socket_drops = drops;
+                    }
+                }
+                Deliver(client, buffers[i], messages[i].msg_len, arrival_ns);
+            }
+            if (static_cast<size_t>(count) < kReceiveBatch) {
+                return;
+            }
+        }
+    }
+
+    void Deliver(Client& client, const uint8_t* data, size_t size, uint64_t arrival_ns) {
+        RtpPacketView rtp;
+        if (!rtp.Parse(data, size) || rtp.payloadSize() < kStampSize) {
+            counters_.foreign_received++;
+            return;
+        }
+        uint32_t magic;
+        uint32_t sender;
+        uint64_t sent_ns;
+        std::memcpy(&magic, rtp.payload(), 4);
+        std::memcpy(&sender, rtp.payload() + 4, 4);
+        std::memcpy(&sent_ns, rtp.payload() + 12, 8);
+        const std::vector<Client>& clients = *shared_.clients;
+        if (magic != kStampMagic || sender >= clients.size()) {
+            counters_.foreign_received++;
+            return;
+        }
+        if (sent_ns < shared_.window.measure_real) {
+            counters_.warmup_received++;
+            return;
+        }
+        if (!clients[sender].speaker) {
+            counters_.keepalives_received++;
+            return;
+        }
+
+        counters_.speaker_received++;
+        int64_t transit = static_cast<int64_t>(arrival_ns - sent_ns);
+        shared_.latency_us.Record(transit > 0 ? static_cast<uint64_t>(transit) / 1000 : 0);
+
+        StreamStats& stream = client.streams[sender];
+        if (stream.received > 0) {
+            double d = static_cast<double>(std::llabs(transit - stream.last_transit_ns));
+            stream.jitter_ns += (d - stream.jitter_ns) / 16.0;
+        }
+        stream.last_transit_ns = transit;
+        stream.received++;
+    }
+};
+
+// Report
+
+double Percentile(std::vector<double> values, double q) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(q * static_cast<double>(values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+void PrintUsage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [options]\n"
+                 "  --server=IPV4           server address (127.0.0.1)\n"
+                 "  --http-port=N           HTTP signaling port (9090)\n"
+                 "  --rtc-port=N            RTC media port (3478)\n"
+                 "  --clients=N             participants (1000)\n"
+                 "  --channel-sizes=SPEC    fixed:N | uniform:MIN-MAX | weighted:SIZE=WEIGHT,... (fixed:10)\n"
+                 "  --speakers=RATIO        speaking fraction of each channel, at least one (0.1)\n"
+                 "  --duration=SECONDS      measured time (30)\n"
+                 "  --warmup=SECONDS        unmeasured time first (5)\n"
+                 "  --payload-bytes=N       speaker payload per 20 ms, at least 20 (80)\n"
+                 "  --keepalive-ms=N        listener packet interval, 0 for one packet (400)\n"
+                 "  --threads=N             sending/receiving threads (2)\n"
+                 "  --prefix=NAME           channel and user id prefix (loadgen)\n"
+                 "  --seed=N                channel plan and send phases (1)\n"
+                 "  --format=text|json      report format (text)\n"
+                 "  --max-loss=PERCENT      exit 1 if the overall loss is higher\n"
+                 "  --max-p99-ms=MS         exit 1 if the p99 latency is higher\n",
+                 program);
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* flag) -> const char* {
+            size_t length = std::strlen(flag);
+            return arg.compare(0, length, flag) == 0 ? argv[i] + length : nullptr;
+        };
+        const char* v;
+        if ((v = value("--server="))) {
+            options->server = v;
+        } else if ((v = value("--http-port="))) {
+            options->http_port = std::atoi(v);
+        } else if ((v = value("--rtc-port="))) {
+            options->rtc_port = std::atoi(v);
+        } else if ((v = value("--clients="))) {
+            options->clients = std::strtoul(v, nullptr, 10);
+        } else if ((v = value("--channel-sizes="))) {
+            options->channel_sizes = v;
+        } else if ((v = value("--speakers="))) {
+            options->speakers = std::atof(v);
+        } else if ((v = value("--duration="))) {
+            options->duration = std::atof(v);
+        } else if ((v = value("--warmup="))) {
+            options->warmup = std::atof(v);
+        } else if ((v = value("--payload-bytes="))) {
+            options->payload_bytes = std::strtoul(v, nullptr, 10);
+        } else if ((v = value("--keepalive-ms="))) {
+            options->keepalive_ms = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+        } else if ((v = value("--threads="))) {
+            options->threads = std::strtoul(v, nullptr, 10);
+        } else if ((v = value("--prefix="))) {
+            options->prefix = v;
+        } else if ((v = value("--seed="))) {
+            options->seed = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+        } else if ((v = value("--format="))) {
+            if (std::strcmp(v, "json") != 0 && std::strcmp(v, "text") != 0) {
+                return false;
+            }
+            options->json = std::strcmp(v, "json") == 0;
+        } else if ((v = value("--max-loss="))) {
+            options->max_loss = std::atof(v);
+        } else if ((v = value("--max-p99-ms="))) {
+            options->max_p99_ms = std::atof(v);
+        } else {
+            return false;
+        }
+    }
+    return options->clients > 0 && options->threads > 0 && options->payload_bytes >= kStampSize &&
+           options->payload_bytes <= 1200 && options->duration > 0.0 && options->warmup >= 0.0 &&
+           options->speakers >= 0.0 && options->speakers <= 1.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    SizeDistribution sizes;
+    if (!ParseOptions(argc, argv, &options) || !sizes.Parse(options.channel_sizes)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    sockaddr_in http_addr{};
+    http_addr.sin_family = AF_INET;
+    http_addr.sin_port = htons(static_cast<uint16_t>(options.http_port));
+    sockaddr_in rtc_addr = http_addr;
+    rtc_addr.sin_port = htons(static_cast<uint16_t>(options.rtc_port));
+    if (inet_pton(AF_INET, options.server.c_str(), &http_addr.sin_addr) != 1) {
+        std::fprintf(stderr, "voice_loadgen: --server must be an IPv4 address\n");
+        return 2;
+    }
+    rtc_addr.sin_addr = http_addr.sin_addr;
+
+    // One socket per client
+    rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    // Channel plan: sizes drawn until every client has a seat; the first
+    // members of each channel speak
+    std::mt19937 rng(options.seed);
+    std::vector<Client> clients(options.clients);
+    std::vector<size_t> channel_sizes;
+    std::vector<size_t> channel_speakers;
+    for (size_t next = 0; next < clients.size();) {
+        size_t size = std::min(sizes.Sample(rng), clients.size() - next);
+        size_t speakers = options.speakers > 0.0
+                              ? std::max<size_t>(1, static_cast<size_t>(static_cast<double>(size) * options.speakers + 0.5))
+                              : 0;
+        for (size_t seat = 0; seat < size; ++seat, ++next) {
+            Client& client = clients[next];
+            client.index = static_cast<uint32_t>(next);
+            client.user_id = options.prefix + "-user-" + std::to_string(next);
+            client.channel = channel_sizes.size();
+            client.speaker = seat < speakers;
+        }
+        channel_sizes.push_back(size);
+        channel_speakers.push_back(speakers);
+    }
+
+    // Join flow: socket, HTTP join with an SDP offer, SSRC and ICE
+    // credentials from the answer, then a connectivity check
+    HdrHistogram join_us;
+    size_t join_failures = 0;
+    for (Client& client : clients) {
+        client.fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        if (client.fd < 0 || setsockopt(client.fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0 ||
+            setsockopt(client.fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0 ||
+            ::connect(client.fd, reinterpret_cast<const sockaddr*>(&rtc_addr), sizeof(rtc_addr)) < 0) {
+            std::fprintf(stderr, "voice_loadgen: cannot open client socket %u: %s\n", client.index,
+                         std::strerror(errno));
+            return 1;
+        }
+
+        std::string target = "/channels/" + options.prefix + "-" + std::to_string(client.channel) +
+                             "/join?user_id=" + client.user_id;
+        std::string ufrag = RandomIceString(rng, 8);
+        int status = 0;
+        std::string body;
+        uint64_t ssrc = 0;
+        std::string server_ufrag;
+        std::string server_password;
+        uint64_t started = MonotonicNs();
+        if (!HttpPost(http_addr, target, kSdpOffer + ("a=ice-ufrag:" + ufrag + "\r\n"), &status, &body) ||
+            status != 200 || !JsonNumber(body, "ssrc", &ssrc) || !AnswerAttribute(body, "ice-ufrag", &server_ufrag) ||
+            !AnswerAttribute(body, "ice-pwd", &server_password) ||
+            !IceCheck(client.fd, server_ufrag + ":" + ufrag, server_password, rng)) {
+            if (status == 404) {
+                std::fprintf(stderr, "voice_loadgen: HTTP signaling is off; start the server with "
+                                     "VOICE_HTTP_SIGNALING=1\n");
+                return 1;
+            }
+            join_failures++;
+            continue;
+        }
+        join_us.Record((MonotonicNs() - started) / 1000);
+        client.joined = true;
+        client.ssrc = static_cast<uint32_t>(ssrc);
+        client.rtp = std::make_unique<RtpStream>(client.ssrc, kOpusPayloadType);
+    }
+
+    std::vector<Client*> joined;
+    for (Client& client : clients) {
+        if (client.joined) {
+            joined.push_back(&client);
+        }
+    }
+    if (joined.empty()) {
+        std::fprintf(stderr, "voice_loadgen: no client could join via http://%s:%d\n", options.server.c_str(),
+                     options.http_port);
+        return 1;
+    }
+
+    Shared shared;
+    shared.options = &options;
+    shared.clients = &clients;
+    uint64_t now_mono = MonotonicNs();
+    uint64_t now_real = RealtimeNs();
+    uint64_t warmup_ns = static_cast<uint64_t>(options.warmup * 1e9);
+    shared.window.start_mono = now_mono + 100000000ull;
+    shared.window.measure_mono = shared.window.start_mono + warmup_ns;
+    shared.window.stop_mono = shared.window.measure_mono + static_cast<uint64_t>(options.duration * 1e9);
+    shared.window.end_mono = shared.window.stop_mono + 500000000ull;
+    shared.window.measure_real = now_real + (shared.window.measure_mono - now_mono);
+
+    size_t thread_count = std::min(options.threads, joined.size());
+    std::vector<std::vector<Client*>> shares(thread_count);
+    for (size_t i = 0; i < joined.size(); ++i) {
+        shares[i % thread_count].push_back(joined[i]);
+    }
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    for (auto& share : shares) {
+        workers.push_back(std::make_unique<Worker>(shared, std::move(share)));
+    }
+    for (auto& worker : workers) {
+        threads.emplace_back([&worker] { worker->Run(); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // Leave, so the channels go away
+    for (Client* client : joined) {
+        int status = 0;
+        std::string body;
+        HttpPost(http_addr,
+                 "/channels/" + options.prefix + "-" + std::to_string(client->channel) + "/leave?user_id=" +
+                     client->user_id,
+                 "", &status, &body);
+        ::close(client->fd);
+    }
+
+    // Every joined speaker should reach every other joined member of its channel
+    Counters totals;
+    for (auto& worker : workers) {
+        totals.Add(worker->counters());
+    }
+    uint64_t expected = 0;
+    uint64_t received = 0;
+    size_t streams = 0;
+    size_t silent_streams = 0;
+    std::vector<double> stream_loss;
+    std::vector<double> stream_jitter_ms;
+    for (const Client* receiver : joined) {
+        for (const Client* sender : joined) {
+            if (sender == receiver || !sender->speaker || sender->channel != receiver->channel ||
+                sender->first_measured == UINT32_MAX) {
+                continue;
+            }
+            uint64_t sent = sender->last_measured - sender->first_measured + 1;
+            auto it = receiver->streams.find(sender->index);
+            uint64_t got = it == receiver->streams.end() ? 0 : std::min(it->second.received, sent);
+            streams++;
+            silent_streams += got == 0;
+            expected += sent;
+            received += got;
+            stream_loss.push_back(100.0 * static_cast<double>(sent - got) / static_cast<double>(sent));
+            stream_jitter_ms.push_back(it == receiver->streams.end() ? 0.0 : it->second.jitter_ns / 1e6);
+        }
+    }
+
+    size_t speakers = 0;
+    for (const Client* client : joined) {
+        speakers += client->speaker;
+    }
+    double loss = expected ? 100.0 * static_cast<double>(expected - received) / static_cast<double>(expected) : 0.0;
+    HdrHistogram::Snapshot latency = shared.latency_us.GetSnapshot();
+    HdrHistogram::Snapshot lateness = shared.lateness_us.GetSnapshot();
+    HdrHistogram::Snapshot joins = join_us.GetSnapshot();
+    auto ms = [](uint64_t us) { return static_cast<double>(us) / 1000.0; };
+    double p99_ms = ms(latency.ValueAtQuantile(0.99));
+
+    if (options.json) {
+        std::printf("{\"clients\": %zu, \"joined\": %zu, \"join_failures\": %zu, \"channels\": %zu, "
+                    "\"channel_sizes\": \"%s\", \"speakers\": %zu, \"duration_s\": %g, \"warmup_s\": %g,\n"
+                    " \"join_ms\": {\"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n"
+                    " \"sent\": {\"speaker\": %llu, \"keepalive\": %llu, \"errors\": %llu, \"lateness_p99_ms\": %.3f},\n"
+                    " \"received\": {\"speaker\": %llu, \"expected\": %llu, \"keepalive\": %llu, \"warmup\": %llu, "
+                    "\"foreign\": %llu, \"generator_drops\": %llu},\n"
+                    " \"loss_percent\": %.4f,\n"
+                    " \"streams\": {\"count\": %zu, \"without_packets\": %zu, \"loss_p50\": %.4f, \"loss_p99\": %.4f, "
+                    "\"loss_max\": %.4f, \"jitter_p50_ms\": %.3f, \"jitter_p99_ms\": %.3f, \"jitter_max_ms\": %.3f},\n"
+                    " \"latency_ms\": {\"p50\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f}}\n",
+                    clients.size(), joined.size(), join_failures, channel_sizes.size(), sizes.spec().c_str(),
+                    speakers, options.duration, options.warmup, ms(joins.ValueAtQuantile(0.5)),
+                    ms(joins.ValueAtQuantile(0.99)), ms(joins.ValueAtQuantile(1.0)),
+                    static_cast<unsigned long long>(totals.speaker_sent),
+                    static_cast<unsigned long long>(totals.keepalives_sent),
+                    static_cast<unsigned long long>(totals.send_errors), ms(lateness.ValueAtQuantile(0.99)),
+                    static_cast<unsigned long long>(received), static_cast<unsigned long long>(expected),
+                    static_cast<unsigned long long>(totals.keepalives_received),
+                    static_cast<unsigned long long>(totals.warmup_received),
+                    static_cast<unsigned long long>(totals.foreign_received),
+                    static_cast<unsigned long long>(totals.socket_drops), loss, streams, silent_streams,
+                    Percentile(stream_loss, 0.5), Percentile(stream_loss, 0.99), Percentile(stream_loss, 1.0),
+                    Percentile(stream_jitter_ms, 0.5), Percentile(stream_jitter_ms, 0.99),
+                    Percentile(stream_jitter_ms, 1.0), ms(latency.ValueAtQuantile(0.5)), p99_ms,
+                    ms(latency.ValueAtQuantile(0.999)), ms(latency.ValueAtQuantile(1.0)));
+    } else {
+        std::printf("voice_loadgen: %zu clients in %zu channels (%s), %zu speakers, %g s measured after %g s warm-up\n",
+                    clients.size(), channel_sizes.size(), sizes.spec().c_str(), speakers, options.duration,
+                    options.warmup);
+        std::printf("Joins:     %zu ok, %zu failed; p50 %.2f ms, p99 %.2f ms\n", joined.size(), join_failures,
+                    ms(joins.ValueAtQuantile(0.5)), ms(joins.ValueAtQuantile(0.99)));
+        std::printf("Sent:      %llu speaker packets, %llu keepalives, %llu errors; pacing lateness p99 %.2f ms\n",
+                    static_cast<unsigned long long>(totals.speaker_sent),
+                    static_cast<unsigned long long>(totals.keepalives_sent),
+                    static_cast<unsigned long long>(totals.send_errors), ms(lateness.ValueAtQuantile(0.99)));
+        std::printf("Received:  %llu of %llu expected speaker packets (loss %.4f%%), %llu keepalives, %llu unknown, "
+                    "%llu dropped by the generator's sockets\n",
+                    static_cast<unsigned long long>(received), static_cast<unsigned long long>(expected), loss,
+                    static_cast<unsigned long long>(totals.keepalives_received),
+                    static_cast<unsigned long long>(totals.foreign_received),
+                    static_cast<unsigned long long>(totals.socket_drops));
+        std::printf("Streams:   %zu (%zu without a packet); loss p50 %.3f%% p99 %.3f%% max %.3f%%; "
+                    "jitter p50 %.3f ms p99 %.3f ms max %.3f ms\n",
+                    streams, silent_streams, Percentile(stream_loss, 0.5), Percentile(stream_loss, 0.99),
+                    Percentile(stream_loss, 1.0), Percentile(stream_jitter_ms, 0.5),
+                    Percentile(stream_jitter_ms, 0.99), Percentile(stream_jitter_ms, 1.0));
+        std::printf("Latency:   p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms\n",
+                    ms(latency.ValueAtQuantile(0.5)), p99_ms, ms(latency.ValueAtQuantile(0.999)),
+                    ms(latency.ValueAtQuantile(1.0)));
+    }
+    // Either means the generator, not the server, ran out of CPU
+    if (ms(lateness.ValueAtQuantile(0.99)) > kFrameMs / 2.0 || totals.socket_drops > 0) {
+        std::fprintf(stderr, "voice_loadgen: the generator could not keep up; results understate the server. "
+                             "Add --threads or run it on other cores\n");
+    }
+
+    bool failed = (options.max_loss >= 0.0 && loss > options.max_loss) ||
+                  (options.max_p99_ms >= 0.0 && p99_ms > options.max_p99_ms) || join_failures > 0;
+    return failed ? 1 : 0;
+}